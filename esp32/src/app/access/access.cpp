@@ -0,0 +1,612 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include <stdlib.h>
+#include "mbedtls/md.h"
+
+#include "access.h"
+#include "../../app_cfg.h"
+
+#if ACCESS_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define ACCESS_UID_MAX          10
+#define ACCESS_MAC_LEN          32
+#define ACCESS_SLOT_EMPTY       0ULL
+#define ACCESS_SLOT_MASK        (ACCESS_TABLE_SLOTS - 1)
+
+#if (ACCESS_TABLE_SLOTS & ACCESS_SLOT_MASK) != 0
+#error "ACCESS_TABLE_SLOTS must be a power of two"
+#endif
+
+#if ACCESS_BLOOM_ENABLED == STD_ON
+#define ACCESS_BLOOM_MASK       (ACCESS_BLOOM_BITS - 1)
+#if (ACCESS_BLOOM_BITS & ACCESS_BLOOM_MASK) != 0
+#error "ACCESS_BLOOM_BITS must be a power of two"
+#endif
+#endif
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef struct {
+    uint64_t slots[ACCESS_TABLE_SLOTS];     // Fingerprints, 0 = empty
+#if ACCESS_BLOOM_ENABLED == STD_ON
+    uint32_t bloom[ACCESS_BLOOM_BITS / 32];
+#endif
+    uint16_t cards;
+    uint8_t  max_probe;
+} Access_Table_t;
+
+// NVS image: the fingerprints, not the UIDs
+typedef struct {
+    uint32_t version;
+    uint32_t count;
+    uint64_t cards[ACCESS_MAX_CARDS];
+} Access_Image_t;
+
+typedef enum {
+    ACCESS_OP_ADD = 0,
+    ACCESS_OP_REVOKE,
+    ACCESS_OP_SET
+} Access_Op_t;
+
+#define ACCESS_REASON_NAME(id, name)    name,
+static const char* const g_reasonNames[] = {
+    ACCESS_REASON_TABLE(ACCESS_REASON_NAME)
+};
+#undef ACCESS_REASON_NAME
+
+static const char* const g_resultNames[] = {
+    "ok", "stale", "gap", "bad_mac", "bad_format", "full", "no_key", "wrong_room"
+};
+
+static const char* const g_keyPlaceholders[] = {
+#define ACCESS_KEY_PLACEHOLDER_ROW(text)    text,
+    ACCESS_KEY_PLACEHOLDER_TABLE(ACCESS_KEY_PLACEHOLDER_ROW)
+#undef ACCESS_KEY_PLACEHOLDER_ROW
+};
+
+// Lookups read g_tables[g_active]; updates build the other one and swap
+static portMUX_TYPE   g_accessMux = portMUX_INITIALIZER_UNLOCKED;
+static Access_Table_t g_tables[2];
+static uint8_t        g_active = 0;
+static uint32_t       g_version = 0;
+static Access_Stats_t g_stats;
+static volatile bool  g_reportReady = false;
+
+// Update key from NVS, length 0 until the room is commissioned
+static uint8_t        g_updateKey[ACCESS_KEY_MAX_LEN];
+static size_t         g_updateKeyLen = 0;
+
+// Submitted lines, double buffered: Access_Submit() fills the slot the
+// processor is not reading, so only the slot index changes under the lock
+static char           g_lines[2][MQTT_BUFFER_SIZE];
+static size_t         g_lineLength[2];
+static uint8_t        g_readSlot = 0;       // Processor's slot
+static bool           g_submitPending = false;
+static TaskHandle_t   g_processor = NULL;
+
+// Update scratch (processor task only)
+static Access_Image_t g_image;
+static uint64_t       g_parsed[ACCESS_MAX_CARDS];
+
+static const char* const g_seedCards[] = {
+#define ACCESS_SEED_ROW(uid)    uid,
+    ACCESS_SEED_TABLE(ACCESS_SEED_ROW)
+#undef ACCESS_SEED_ROW
+};
+
+// ==================== INTERNAL ====================
+
+/**
+ * @brief FNV-1a over (length, UID) with a 64-bit finalizer; never 0
+ */
+static uint64_t Access_Fingerprint(const uint8_t* uid, uint8_t size)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = (h ^ size) * 0x100000001b3ULL;
+    for (uint8_t i = 0; i < size; i++) {
+        h = (h ^ uid[i]) * 0x100000001b3ULL;
+    }
+
+    // Spread the bytes over all bits: slot index and Bloom bits use
+    // different parts of the word
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return (h == ACCESS_SLOT_EMPTY) ? 1 : h;
+}
+
+#if ACCESS_BLOOM_ENABLED == STD_ON
+static inline uint32_t Access_BloomBit(uint64_t fp, uint8_t k)
+{
+    return (uint32_t)(fp >> (16 + 16 * k)) & ACCESS_BLOOM_MASK;
+}
+
+static void Access_BloomAdd(Access_Table_t* table, uint64_t fp)
+{
+    for (uint8_t k = 0; k < 3; k++) {
+        uint32_t bit = Access_BloomBit(fp, k);
+        table->bloom[bit >> 5] |= 1UL << (bit & 31);
+    }
+}
+
+static bool Access_BloomTest(const Access_Table_t* table, uint64_t fp)
+{
+    for (uint8_t k = 0; k < 3; k++) {
+        uint32_t bit = Access_BloomBit(fp, k);
+        if ((table->bloom[bit >> 5] & (1UL << (bit & 31))) == 0) return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * @brief Linear probe, bounded by the longest probe sequence in the table
+ */
+static bool Access_Find(const Access_Table_t* table, uint64_t fp)
+{
+    uint32_t slot = (uint32_t)fp & ACCESS_SLOT_MASK;
+
+    for (uint16_t n = 0; n <= table->max_probe; n++) {
+        uint64_t entry = table->slots[slot];
+        if (entry == fp) return true;
+        if (entry == ACCESS_SLOT_EMPTY) return false;
+        slot = (slot + 1) & ACCESS_SLOT_MASK;
+    }
+    return false;
+}
+
+/**
+ * @return false if the table already holds ACCESS_MAX_CARDS
+ */
+static bool Access_Insert(Access_Table_t* table, uint64_t fp)
+{
+    uint32_t slot = (uint32_t)fp & ACCESS_SLOT_MASK;
+    uint8_t  probe = 0;
+
+    while (table->slots[slot] != ACCESS_SLOT_EMPTY) {
+        if (table->slots[slot] == fp) return true;      // Already listed
+        slot = (slot + 1) & ACCESS_SLOT_MASK;
+        probe++;
+    }
+
+    if (table->cards >= ACCESS_MAX_CARDS) return false;
+
+    table->slots[slot] = fp;
+    table->cards++;
+    if (probe > table->max_probe) table->max_probe = probe;
+#if ACCESS_BLOOM_ENABLED == STD_ON
+    Access_BloomAdd(table, fp);
+#endif
+    return true;
+}
+
+static int8_t Access_HexNibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief Hex UID ("04864652714080" or "04:86:...") to bytes
+ * @return UID length (4, 7 or 10), 0 if malformed
+ */
+static uint8_t Access_ParseUID(const char* text, size_t length, uint8_t* uid)
+{
+    uint8_t size = 0;
+    size_t  i = 0;
+
+    while (i < length) {
+        if (text[i] == ':') { i++; continue; }
+        if (i + 1 >= length || size >= ACCESS_UID_MAX) return 0;
+
+        int8_t hi = Access_HexNibble(text[i]);
+        int8_t lo = Access_HexNibble(text[i + 1]);
+        if (hi < 0 || lo < 0) return 0;
+        uid[size++] = (uint8_t)((hi << 4) | lo);
+        i += 2;
+    }
+
+    return (size == 4 || size == 7 || size == 10) ? size : 0;
+}
+
+/**
+ * @brief Next space separated token in [*cursor, end)
+ */
+static bool Access_NextToken(const char** cursor, const char* end, const char** token, size_t* length)
+{
+    const char* p = *cursor;
+    while (p < end && *p == ' ') p++;
+    if (p >= end) return false;
+
+    *token = p;
+    while (p < end && *p != ' ') p++;
+    *length = p - *token;
+    *cursor = p;
+    return true;
+}
+
+/**
+ * @brief Next token as a decimal number (at most 10 digits)
+ */
+static bool Access_NextNumber(const char** cursor, const char* end, unsigned long* value)
+{
+    const char* token;
+    size_t      length;
+
+    if (!Access_NextToken(cursor, end, &token, &length) || length > 10) return false;
+
+    char number[11];
+    memcpy(number, token, length);
+    number[length] = '\0';
+    char* number_end = NULL;
+    *value = strtoul(number, &number_end, 10);
+    return number_end == number + length;
+}
+
+static bool Access_VerifyMac(const char* message, size_t length, const char* mac_hex, size_t mac_length)
+{
+    if (mac_length != ACCESS_MAC_LEN * 2) return false;
+
+    uint8_t expected[ACCESS_MAC_LEN];
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                        g_updateKey, g_updateKeyLen,
+                        (const unsigned char*)message, length, expected) != 0) {
+        return false;
+    }
+
+    // Compare every byte so the time taken says nothing about the match
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < ACCESS_MAC_LEN; i++) {
+        int8_t hi = Access_HexNibble(mac_hex[2 * i]);
+        int8_t lo = Access_HexNibble(mac_hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        diff |= expected[i] ^ (uint8_t)((hi << 4) | lo);
+    }
+    return diff == 0;
+}
+
+static void Access_Save(const Access_Table_t* table, uint32_t version)
+{
+    g_image.version = version;
+    g_image.count = 0;
+    for (uint16_t i = 0; i < ACCESS_TABLE_SLOTS; i++) {
+        if (table->slots[i] != ACCESS_SLOT_EMPTY) {
+            g_image.cards[g_image.count++] = table->slots[i];
+        }
+    }
+
+    Preferences prefs;
+    if (prefs.begin(ACCESS_NVS_NS, false)) {
+        size_t bytes = offsetof(Access_Image_t, cards) + g_image.count * sizeof(uint64_t);
+        if (prefs.putBytes(ACCESS_NVS_KEY, &g_image, bytes) != bytes) {
+            Serial.println("[ACCESS] NVS write failed");
+        }
+        prefs.end();
+    }
+}
+
+static bool Access_Load(Access_Table_t* table, uint32_t* version)
+{
+    Preferences prefs;
+    if (!prefs.begin(ACCESS_NVS_NS, true)) return false;
+
+    size_t bytes = prefs.getBytesLength(ACCESS_NVS_KEY);
+    bool ok = bytes >= offsetof(Access_Image_t, cards) && bytes <= sizeof(g_image) &&
+              prefs.getBytes(ACCESS_NVS_KEY, &g_image, bytes) == bytes &&
+              bytes == offsetof(Access_Image_t, cards) + g_image.count * sizeof(uint64_t);
+    prefs.end();
+    if (!ok) return false;
+
+    memset(table, 0, sizeof(*table));
+    for (uint32_t i = 0; i < g_image.count; i++) {
+        Access_Insert(table, g_image.cards[i]);
+    }
+    *version = g_image.version;
+    return true;
+}
+
+static void Access_Publish(uint8_t built, uint32_t version)
+{
+    portENTER_CRITICAL(&g_accessMux);
+    g_active = built;
+    g_version = version;
+    portEXIT_CRITICAL(&g_accessMux);
+}
+
+static Access_Result_t Access_Finish(Access_Result_t result)
+{
+    portENTER_CRITICAL(&g_accessMux);
+    g_stats.last_result = result;
+    portEXIT_CRITICAL(&g_accessMux);
+    g_reportReady = true;
+    return result;
+}
+
+// ==================== PUBLIC API ====================
+
+void Access_Init(void)
+{
+    Access_Table_t* table = &g_tables[0];
+    uint32_t version = 0;
+
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    g_updateKeyLen = Access_LoadKey(ACCESS_KEY_NVS_UPDATES, g_updateKey, sizeof(g_updateKey));
+    if (g_updateKeyLen == 0) {
+        Serial.println("[ACCESS] No update key provisioned - allowlist updates refused");
+    }
+
+    if (!Access_Load(table, &version)) {
+        memset(table, 0, sizeof(*table));
+        for (uint8_t i = 0; i < sizeof(g_seedCards) / sizeof(g_seedCards[0]); i++) {
+            uint8_t uid[ACCESS_UID_MAX];
+            uint8_t size = Access_ParseUID(g_seedCards[i], strlen(g_seedCards[i]), uid);
+            if (size != 0) Access_Insert(table, Access_Fingerprint(uid, size));
+        }
+        version = 0;
+    }
+
+    Access_Publish(0, version);
+    g_reportReady = true;
+
+    DEBUG_PRINTF("[ACCESS] %u cards, version %lu, max probe %u\n",
+                 table->cards, (unsigned long)version, table->max_probe);
+}
+
+bool Access_CheckCard(const uint8_t* uid, uint8_t size, Access_Reason_t* reason)
+{
+    if (uid == NULL || size == 0 || size > ACCESS_UID_MAX) {
+        if (reason != NULL) *reason = ACCESS_REASON_BAD_UID;
+        return false;
+    }
+
+    uint64_t fp = Access_Fingerprint(uid, size);
+    bool granted;
+
+    portENTER_CRITICAL(&g_accessMux);
+    const Access_Table_t* table = &g_tables[g_active];
+#if ACCESS_BLOOM_ENABLED == STD_ON
+    if (!Access_BloomTest(table, fp)) {
+        g_stats.bloom_rejects++;
+        granted = false;
+    } else {
+        granted = Access_Find(table, fp);
+    }
+#else
+    granted = Access_Find(table, fp);
+#endif
+    if (granted) g_stats.granted++;
+    else         g_stats.denied++;
+    portEXIT_CRITICAL(&g_accessMux);
+
+    if (reason != NULL) *reason = granted ? ACCESS_REASON_LISTED : ACCESS_REASON_NOT_LISTED;
+    return granted;
+}
+
+uint64_t Access_HashUID(const uint8_t* uid, uint8_t size)
+{
+    if (uid == NULL || size > ACCESS_UID_MAX) return 0;
+    return Access_Fingerprint(uid, size);
+}
+
+size_t Access_LoadKey(const char* name, uint8_t* key, size_t size)
+{
+    Preferences prefs;
+    if (key == NULL || !prefs.begin(ACCESS_KEY_NVS_NS, true)) return 0;
+
+    size_t length = prefs.getBytesLength(name);
+    if (length < ACCESS_KEY_MIN_LEN || length > size ||
+        prefs.getBytes(name, key, length) != length) {
+        length = 0;
+    }
+    prefs.end();
+
+    for (uint8_t i = 0; length != 0 && i < sizeof(g_keyPlaceholders) / sizeof(g_keyPlaceholders[0]); i++) {
+        if (length == strlen(g_keyPlaceholders[i]) && memcmp(key, g_keyPlaceholders[i], length) == 0) {
+            length = 0;
+        }
+    }
+    if (length == 0) memset(key, 0, size);
+    return length;
+}
+
+const char* Access_GetReasonName(Access_Reason_t reason)
+{
+    return (reason < ACCESS_REASON_COUNT) ? g_reasonNames[reason] : "unknown";
+}
+
+Access_Result_t Access_ApplyUpdate(const char* payload, size_t length)
+{
+    if (g_updateKeyLen == 0) return Access_Finish(ACCESS_RESULT_NO_KEY);
+    if (payload == NULL) return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+
+    // Trailing newline from command-line publishers
+    while (length > 0 && (payload[length - 1] == '\n' || payload[length - 1] == '\r' ||
+                          payload[length - 1] == ' ')) {
+        length--;
+    }
+
+    // "<signed part> <hmac>"
+    size_t split = length;
+    while (split > 0 && payload[split - 1] != ' ') split--;
+    if (split < 2) return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+
+    if (!Access_VerifyMac(payload, split - 1, payload + split, length - split)) {
+        return Access_Finish(ACCESS_RESULT_BAD_MAC);
+    }
+
+    const char* cursor = payload;
+    const char* end = payload + split - 1;
+    const char* token;
+    size_t      token_length;
+
+    // Room: the key is shared by the property, so a line for another room
+    // carries a valid MAC
+    unsigned long room;
+    if (!Access_NextNumber(&cursor, end, &room)) return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+    if (room != ROOM_NUMBER) return Access_Finish(ACCESS_RESULT_WRONG_ROOM);
+
+    // Version
+    unsigned long version;
+    if (!Access_NextNumber(&cursor, end, &version)) return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+
+    // Operation
+    Access_Op_t op;
+    if (!Access_NextToken(&cursor, end, &token, &token_length)) {
+        return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+    }
+    if (token_length == 3 && strncmp(token, "add", 3) == 0)         op = ACCESS_OP_ADD;
+    else if (token_length == 6 && strncmp(token, "revoke", 6) == 0) op = ACCESS_OP_REVOKE;
+    else if (token_length == 3 && strncmp(token, "set", 3) == 0)    op = ACCESS_OP_SET;
+    else return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+
+    // Ordering: incremental updates must not skip or repeat a version
+    if (version <= g_version) return Access_Finish(ACCESS_RESULT_STALE);
+    if (op != ACCESS_OP_SET && version != g_version + 1) {
+        return Access_Finish(ACCESS_RESULT_GAP);
+    }
+
+    // UIDs
+    uint16_t parsed = 0;
+    while (Access_NextToken(&cursor, end, &token, &token_length)) {
+        uint8_t uid[ACCESS_UID_MAX];
+        uint8_t size = Access_ParseUID(token, token_length, uid);
+        if (size == 0) return Access_Finish(ACCESS_RESULT_BAD_FORMAT);
+        if (parsed >= ACCESS_MAX_CARDS) return Access_Finish(ACCESS_RESULT_FULL);
+        g_parsed[parsed++] = Access_Fingerprint(uid, size);
+    }
+
+    // Build the inactive table; lookups keep using the active one meanwhile
+    uint8_t built = g_active ^ 1;
+    const Access_Table_t* current = &g_tables[g_active];
+    Access_Table_t* next = &g_tables[built];
+    memset(next, 0, sizeof(*next));
+
+    if (op != ACCESS_OP_SET) {
+        for (uint16_t i = 0; i < ACCESS_TABLE_SLOTS; i++) {
+            uint64_t fp = current->slots[i];
+            if (fp == ACCESS_SLOT_EMPTY) continue;
+
+            bool revoked = false;
+            if (op == ACCESS_OP_REVOKE) {
+                for (uint16_t j = 0; j < parsed && !revoked; j++) {
+                    revoked = (g_parsed[j] == fp);
+                }
+            }
+            if (!revoked) Access_Insert(next, fp);
+        }
+    }
+    if (op != ACCESS_OP_REVOKE) {
+        for (uint16_t i = 0; i < parsed; i++) {
+            if (!Access_Insert(next, g_parsed[i])) return Access_Finish(ACCESS_RESULT_FULL);
+        }
+    }
+
+    Access_Save(next, version);
+    Access_Publish(built, version);
+
+    DEBUG_PRINTF("[ACCESS] Version %lu: %u cards, max probe %u\n",
+                 version, next->cards, next->max_probe);
+    return Access_Finish(ACCESS_RESULT_OK);
+}
+
+void Access_SetProcessor(TaskHandle_t task)
+{
+    g_processor = task;
+}
+
+void Access_Submit(const char* payload, size_t length)
+{
+    if (payload == NULL) return;
+    if (length > sizeof(g_lines[0])) length = sizeof(g_lines[0]);     // Fails the MAC
+
+    // Claim the free slot; with nothing pending the processor leaves it alone
+    portENTER_CRITICAL(&g_accessMux);
+    uint8_t slot = g_readSlot ^ 1;
+    if (g_submitPending) g_stats.overwritten++;
+    g_submitPending = false;
+    portEXIT_CRITICAL(&g_accessMux);
+
+    memcpy(g_lines[slot], payload, length);
+    g_lineLength[slot] = length;
+
+    portENTER_CRITICAL(&g_accessMux);
+    g_submitPending = true;
+    portEXIT_CRITICAL(&g_accessMux);
+
+    if (g_processor != NULL) xTaskNotifyGive(g_processor);
+}
+
+void Access_Process(void)
+{
+    bool submitted;
+
+    // Take the pending slot; the submitter's next line goes to the other one
+    portENTER_CRITICAL(&g_accessMux);
+    submitted = g_submitPending;
+    if (submitted) {
+        g_readSlot ^= 1;
+        g_submitPending = false;
+    }
+    portEXIT_CRITICAL(&g_accessMux);
+
+    if (!submitted) return;
+
+    size_t length = g_lineLength[g_readSlot];
+    Access_Result_t result = Access_ApplyUpdate(g_lines[g_readSlot], length);
+    Serial.printf("[ACCESS] List update (%u bytes): %s\n", (unsigned)length, g_resultNames[result]);
+}
+
+int Access_FormatUID(const uint8_t* uid, uint8_t size, char* buffer, uint16_t buffer_size)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint16_t n = 0;
+
+    if (buffer == NULL || buffer_size == 0) return 0;
+
+    for (uint8_t i = 0; i < size && n + 3 < buffer_size; i++) {
+        if (i > 0) buffer[n++] = ':';
+        buffer[n++] = hex[uid[i] >> 4];
+        buffer[n++] = hex[uid[i] & 0x0F];
+    }
+    buffer[n] = '\0';
+    return n;
+}
+
+void Access_GetStats(Access_Stats_t* stats)
+{
+    if (stats == NULL) return;
+
+    portENTER_CRITICAL(&g_accessMux);
+    *stats = g_stats;
+    stats->version = g_version;
+    stats->cards = g_tables[g_active].cards;
+    stats->max_probe = g_tables[g_active].max_probe;
+    portEXIT_CRITICAL(&g_accessMux);
+}
+
+bool Access_TakeReport(char* buffer, uint16_t size)
+{
+    if (!g_reportReady || buffer == NULL) return false;
+
+    Access_Stats_t stats;
+    Access_GetStats(&stats);
+    snprintf(buffer, size,
+             "{\"version\":%lu,\"cards\":%u,\"result\":\"%s\",\"max_probe\":%u,"
+             "\"granted\":%lu,\"denied\":%lu,\"bloom_rejects\":%lu,\"overwritten\":%lu}",
+             (unsigned long)stats.version, stats.cards, g_resultNames[stats.last_result],
+             stats.max_probe, (unsigned long)stats.granted, (unsigned long)stats.denied,
+             (unsigned long)stats.bloom_rejects, (unsigned long)stats.overwritten);
+    g_reportReady = false;
+    return true;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file access.h
+ * @brief Key card allowlist: hashed UIDs, NVS backed, updated over MQTT
+ *
+ * @note Access_CheckCard() works on the raw UID bytes from the reader: one
+ *       hash, an optional Bloom test and a short linear probe under a
+ *       spinlock. No strings are built on the access path. Updates are
+ *       authenticated (HMAC-SHA256) and versioned so a replayed or reordered
+ *       message cannot re-admit a revoked card (access_cfg.h).
+ */
+
+#ifndef ACCESS_H
+#define ACCESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "access_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define ACCESS_ENUM_REASON(id, name)    ACCESS_REASON_##id,
+typedef enum {
+    ACCESS_REASON_TABLE(ACCESS_ENUM_REASON)
+    ACCESS_REASON_COUNT
+} Access_Reason_t;
+#undef ACCESS_ENUM_REASON
+
+typedef enum {
+    ACCESS_RESULT_OK = 0,
+    ACCESS_RESULT_STALE,        // Version not newer than the stored one (replay)
+    ACCESS_RESULT_GAP,          // add/revoke skipped a version: send a set
+    ACCESS_RESULT_BAD_MAC,
+    ACCESS_RESULT_BAD_FORMAT,
+    ACCESS_RESULT_FULL,         // More than ACCESS_MAX_CARDS
+    ACCESS_RESULT_NO_KEY,       // No update key provisioned: nothing is accepted
+    ACCESS_RESULT_WRONG_ROOM    // Signed for another room
+} Access_Result_t;
+
+typedef struct {
+    uint32_t version;
+    uint16_t cards;
+    uint8_t  max_probe;         ///< Longest probe sequence in the table
+    uint32_t granted;           ///< Lookups since boot
+    uint32_t denied;
+    uint32_t bloom_rejects;     ///< Denied without touching the table
+    uint32_t overwritten;       ///< Submitted lines replaced before they were applied
+    Access_Result_t last_result;
+} Access_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Load the stored list, or the seed cards if there is none
+ */
+void Access_Init(void);
+
+/**
+ * @brief Is this card on the allowlist?
+ * @param uid  UID bytes as read (4, 7 or 10)
+ * @param size UID length
+ * @param reason Optional: why it was granted or denied
+ */
+bool Access_CheckCard(const uint8_t* uid, uint8_t size, Access_Reason_t* reason);
+
+/**
+ * @brief Fingerprint the allowlist stores for a UID (the journal keeps the
+ *        low 32 bits instead of the UID)
+ */
+uint64_t Access_HashUID(const uint8_t* uid, uint8_t size);
+
+const char* Access_GetReasonName(Access_Reason_t reason);
+
+/**
+ * @brief Read a commissioning key from NVS (ACCESS_KEY_NVS_NS)
+ * @return Key length, 0 if it is missing, shorter than ACCESS_KEY_MIN_LEN
+ *         or one of the old placeholders
+ */
+size_t Access_LoadKey(const char* name, uint8_t* key, size_t size);
+
+/**
+ * @brief Verify and apply one update line from MQTT_TOPIC_ACCESS
+ * @note Payload need not be NUL-terminated. HMAC plus an NVS write, so it
+ *       runs in the processor task (Access_Process()), not the MQTT callback.
+ */
+Access_Result_t Access_ApplyUpdate(const char* payload, size_t length);
+
+/**
+ * @brief Task that applies submitted updates; it is notified for each one
+ */
+void Access_SetProcessor(TaskHandle_t task);
+
+/**
+ * @brief Copy an update line for the processor task (MQTT callback)
+ * @note One line is held: senders wait for MQTT_TOPIC_ACCESS_STATUS before
+ *       the next page. A line that replaces an unapplied one is counted in
+ *       Access_Stats_t.overwritten.
+ */
+void Access_Submit(const char* payload, size_t length);
+
+/**
+ * @brief Apply the submitted update, if any (processor task)
+ */
+void Access_Process(void);
+
+/**
+ * @brief "04:86:46:52:71:40:80" style text for logs
+ */
+int Access_FormatUID(const uint8_t* uid, uint8_t size, char* buffer, uint16_t buffer_size);
+
+void Access_GetStats(Access_Stats_t* stats);
+
+/**
+ * @brief Status JSON after boot and each update (for MQTT_TOPIC_ACCESS_STATUS)
+ */
+bool Access_TakeReport(char* buffer, uint16_t size);
+
+#endif // ACCESS_H
@@ -0,0 +1,112 @@
+#ifndef ACCESS_CFG_H
+#define ACCESS_CFG_H
+
+/* =========================
+ * Key Card Allowlist
+ * =========================
+ * Cards are stored as 64-bit fingerprints of (length, UID bytes) in an
+ * open-addressing table, so 4, 7 and 10 byte UIDs share one key space. The
+ * table is rebuilt on every update and kept in NVS with its version.
+ *
+ * Updates arrive on MQTT_TOPIC_ACCESS as one text line:
+ *
+ *   <room> <version> <add|revoke|set> [<uid> ...] <hmac>
+ *
+ * <room> must be ROOM_NUMBER: the update key is shared by the property, so
+ * the room is part of the signed text and a line signed for one room is
+ * refused by every other. <uid> is hex, ':' separators allowed ("04:86:46:52:71:40:80"). <hmac> is
+ * HMAC-SHA256 over everything before the last space with the update key
+ * (ACCESS_KEY_NVS_UPDATES), as 64 hex digits. add/revoke must carry the next
+ * version; set replaces the whole list and only needs a newer one (resync
+ * after a gap).
+ *
+ * A line must fit one MQTT message (MQTT_BUFFER_SIZE with the topic), which
+ * holds about 78 seven-byte UIDs written without ':' - well short of
+ * ACCESS_MAX_CARDS. Longer lists are paged: `set` with the first page, then
+ * `add` with the following versions for the rest.
+ */
+
+// Slots must be a power of two; cards are capped at 3/4 load
+#define ACCESS_TABLE_SLOTS      256
+#define ACCESS_MAX_CARDS        ((ACCESS_TABLE_SLOTS * 3) / 4)
+
+// Bloom prefilter in front of the table: rejects most unknown cards
+// without probing. 3 bits per card out of ACCESS_BLOOM_BITS.
+#define ACCESS_BLOOM_ENABLED    STD_ON
+#define ACCESS_BLOOM_BITS       2048
+
+#define ACCESS_NVS_NS           "access"
+#define ACCESS_NVS_KEY          "list"
+
+/* =========================
+ * Commissioning Keys
+ * =========================
+ * Signing keys are per property and never part of the source. They are
+ * written to NVS as raw bytes when the room is commissioned
+ * (tools/provision_keys.py); until then whatever needs a key fails closed.
+ */
+#define ACCESS_KEY_NVS_NS       "keys"
+#define ACCESS_KEY_NVS_UPDATES  "access_hmac"   // Signs MQTT_TOPIC_ACCESS updates
+#define ACCESS_KEY_NVS_TOKEN    "token"         // Kiosk signs guest cards with it
+#define ACCESS_KEY_MIN_LEN      16
+#define ACCESS_KEY_MAX_LEN      64
+
+// Placeholders that once shipped in app_cfg.h, never accepted as a key: X(text)
+#define ACCESS_KEY_PLACEHOLDER_TABLE(X) \
+    X("change-me-per-property") \
+    X("change-me-token-key")
+
+// Why a card was granted or denied (journal reason codes, keep the order)
+// X(id, name)
+#define ACCESS_REASON_TABLE(X) \
+    X(LISTED,           "listed")           \
+    X(NOT_LISTED,       "not_listed")       \
+    X(BAD_UID,          "bad_uid")          \
+    X(TOKEN,            "token")            \
+    X(TOKEN_BAD_MAC,    "token_bad_mac")    \
+    X(TOKEN_NOT_YET,    "token_not_yet")    \
+    X(TOKEN_EXPIRED,    "token_expired")    \
+    X(TOKEN_WRONG_ROOM, "token_wrong_room") \
+    X(TOKEN_SUPERSEDED, "token_superseded") \
+    X(NO_CLOCK,         "no_clock")         \
+    X(TOKEN_NO_KEY,     "token_no_key")
+
+// Version 0: cards allowed until the first update is stored
+#define ACCESS_SEED_TABLE(X) \
+    X("04:86:46:52:71:40:80")   \
+    X("59:52:67:D9")
+
+/* =========================
+ * Card Tokens
+ * =========================
+ * Guest cards carry a token written by the check-in kiosk: room, stay
+ * window and an issue number, MACed with the property key (ACCESS_KEY_NVS_TOKEN)
+ * over the card UID. Cards not on the allowlist are checked against it
+ * locally. A valid token with a higher issue number supersedes all older
+ * cards for the room. The window needs the SNTP clock; until it is set, or
+ * while no token key is provisioned, only allowlisted cards open.
+ */
+#define ACCESS_TOKEN_SKEW_S     300     // Clock tolerance at both ends of the window
+#define ACCESS_TOKEN_NVS_KEY    "issue" // Highest issue seen (ACCESS_NVS_NS)
+
+/* =========================
+ * Access Journal
+ * =========================
+ * Every card decision is kept as a 16-byte record in a flash ring on the
+ * data partition below (unused by the firmware otherwise). Records are
+ * uploaded in compressed chunks on MQTT_TOPIC_JOURNAL and only erased once
+ * the cloud has acknowledged them; if the ring fills first the oldest
+ * records are overwritten and counted as dropped.
+ */
+#define JOURNAL_PARTITION_LABEL "spiffs"
+#define JOURNAL_SECTORS         16      // 4 KB each, 256 records per sector
+#define JOURNAL_STAGING         32      // Records buffered in RAM until flushed
+#define JOURNAL_CHUNK_RECORDS   64      // Per upload, ~450 bytes compressed
+#define JOURNAL_ACK_TIMEOUT_MS  10000   // Resend an unacknowledged chunk
+#define JOURNAL_POLL_MS         2000    // Connection check while idle
+#define JOURNAL_STACK_SIZE      3072
+#define JOURNAL_PRIORITY        1
+
+#define JOURNAL_NVS_NS          "journal"
+
+#endif // ACCESS_CFG_H
@@ -0,0 +1,456 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "access_journal.h"
+#include "../../app_cfg.h"
+#include "../app_rtos/app_rtos.h"
+#include "../../hal/communication/hal_mqtt/hal_mqtt.h"
+
+#if ACCESS_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define JOURNAL_SECTOR_SIZE     4096
+#define JOURNAL_RECORD_SIZE     16
+#define JOURNAL_PER_SECTOR      (JOURNAL_SECTOR_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_SLOTS           (JOURNAL_SECTORS * JOURNAL_PER_SECTOR)
+#define JOURNAL_SCAN_RECORDS    16          // Records per flash read while scanning
+#define JOURNAL_BLANK_SEQ       0xFFFFFFFFUL
+#define JOURNAL_TIME_UPTIME     0x80000000UL
+#define JOURNAL_CHUNK_HEADER    12
+#define JOURNAL_CHUNK_MAX       (JOURNAL_CHUNK_HEADER + JOURNAL_CHUNK_RECORDS * 10)
+
+// Region layout stored in NVS; a different layout erases the region once
+#define JOURNAL_LAYOUT          ((1UL << 16) | JOURNAL_SECTORS)
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef struct {
+    uint32_t seq;
+    uint32_t time;          // Unix s, or uptime s | JOURNAL_TIME_UPTIME
+    uint32_t uid_hash;      // Low 32 bits of Access_HashUID()
+    uint8_t  granted;
+    uint8_t  reason;        // Access_Reason_t
+    uint16_t crc;           // CRC-16/CCITT over the bytes above
+} Journal_Record_t;
+
+static_assert(sizeof(Journal_Record_t) == JOURNAL_RECORD_SIZE, "Journal record must stay 16 bytes");
+static_assert(JOURNAL_CHUNK_RECORDS <= 255, "Chunk record count is one byte");
+
+// Staging ring: written by the RFID task, drained by the journal task
+static portMUX_TYPE     g_journalMux = portMUX_INITIALIZER_UNLOCKED;
+static Journal_Record_t g_staging[JOURNAL_STAGING];
+static uint8_t          g_stagingHead = 0;
+static uint8_t          g_stagingCount = 0;
+static uint32_t         g_ackRx = 0;            // Latest ack from the callback, 0 = none
+static TaskHandle_t     g_task = NULL;
+
+// Flash ring (journal task only; stats copied under g_journalMux)
+static const esp_partition_t* g_part = NULL;
+static uint32_t g_writeSlot = 0;
+static uint32_t g_nextSeq = 1;
+static uint32_t g_sendSlot = 0;                 // First unacknowledged record
+static uint32_t g_sendSeq = 1;
+static uint32_t g_ackedSeq = 0;
+static uint32_t g_inflightLast = 0;             // Last seq of the chunk awaiting ack
+static uint32_t g_inflightMs = 0;
+static Access_Journal_Stats_t g_stats;
+
+static uint8_t g_chunk[JOURNAL_CHUNK_MAX];
+
+// ==================== INTERNAL ====================
+
+static uint16_t Journal_Crc16(const uint8_t* data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool Journal_Valid(const Journal_Record_t* rec)
+{
+    return rec->seq != JOURNAL_BLANK_SEQ && rec->seq != 0 &&
+           rec->crc == Journal_Crc16((const uint8_t*)rec, offsetof(Journal_Record_t, crc));
+}
+
+static bool Journal_Read(uint32_t slot, Journal_Record_t* rec)
+{
+    return esp_partition_read(g_part, slot * JOURNAL_RECORD_SIZE, rec, sizeof(*rec)) == ESP_OK;
+}
+
+static inline uint32_t Journal_NextSlot(uint32_t slot)
+{
+    return (slot + 1) % JOURNAL_SLOTS;
+}
+
+static void Journal_CountDropped(uint32_t records)
+{
+    portENTER_CRITICAL(&g_journalMux);
+    g_stats.dropped += records;
+    portEXIT_CRITICAL(&g_journalMux);
+}
+
+static inline bool Journal_Pending(void)
+{
+    return g_sendSeq != g_nextSeq;
+}
+
+/**
+ * @brief First valid record from `slot` up to the write position with seq > after
+ * @return Its slot, or g_writeSlot if there is none; sets g_sendSeq
+ * @note `slot` may equal g_writeSlot when the ring is full
+ */
+static uint32_t Journal_Seek(uint32_t slot, uint32_t after)
+{
+    Journal_Record_t rec;
+
+    do {
+        if (Journal_Read(slot, &rec) && Journal_Valid(&rec) && rec.seq > after) {
+            g_sendSeq = rec.seq;
+            return slot;
+        }
+        slot = Journal_NextSlot(slot);
+    } while (slot != g_writeSlot);
+
+    g_sendSeq = g_nextSeq;
+    return g_writeSlot;
+}
+
+/**
+ * @brief Erase a sector before the writer enters it
+ * @note Unacknowledged records in it are lost; the upload skips ahead and the
+ *       cloud sees the gap in sequence numbers
+ */
+static void Journal_PrepareSector(uint32_t sector)
+{
+    if (Journal_Pending() && g_sendSlot / JOURNAL_PER_SECTOR == sector) {
+        uint32_t lostFrom = g_sendSeq;
+        uint32_t next = ((sector + 1) % JOURNAL_SECTORS) * JOURNAL_PER_SECTOR;
+
+        g_sendSlot = Journal_Seek(next, 0);
+        Journal_CountDropped(g_sendSeq - lostFrom);
+        g_inflightLast = 0;
+    }
+
+    esp_partition_erase_range(g_part, sector * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE);
+}
+
+static void Journal_Append(Journal_Record_t* rec)
+{
+    Journal_Record_t slot;
+
+    // Find a blank slot (a torn write at power loss leaves one unusable)
+    for (;;) {
+        if (g_writeSlot % JOURNAL_PER_SECTOR == 0) {
+            Journal_PrepareSector(g_writeSlot / JOURNAL_PER_SECTOR);
+        }
+        if (Journal_Read(g_writeSlot, &slot) && slot.seq == JOURNAL_BLANK_SEQ) break;
+        g_writeSlot = Journal_NextSlot(g_writeSlot);
+    }
+    if (!Journal_Pending()) g_sendSlot = g_writeSlot;
+
+    rec->seq = g_nextSeq;
+    rec->crc = Journal_Crc16((const uint8_t*)rec, offsetof(Journal_Record_t, crc));
+
+    if (esp_partition_write(g_part, g_writeSlot * JOURNAL_RECORD_SIZE, rec, sizeof(*rec)) != ESP_OK) {
+        Journal_CountDropped(1);
+        return;
+    }
+
+    g_writeSlot = Journal_NextSlot(g_writeSlot);
+    g_nextSeq++;
+}
+
+/**
+ * @brief Find the write position and the first unacknowledged record
+ */
+static void Journal_Scan(void)
+{
+    Journal_Record_t recs[JOURNAL_SCAN_RECORDS];
+    uint32_t maxSeq = 0, maxSlot = 0;
+    uint32_t minUnacked = JOURNAL_BLANK_SEQ, minUnackedSlot = 0;
+
+    for (uint32_t base = 0; base < JOURNAL_SLOTS; base += JOURNAL_SCAN_RECORDS) {
+        if (esp_partition_read(g_part, base * JOURNAL_RECORD_SIZE, recs, sizeof(recs)) != ESP_OK) continue;
+
+        for (uint32_t i = 0; i < JOURNAL_SCAN_RECORDS; i++) {
+            if (!Journal_Valid(&recs[i])) continue;
+            if (recs[i].seq > maxSeq) {
+                maxSeq = recs[i].seq;
+                maxSlot = base + i;
+            }
+            if (recs[i].seq > g_ackedSeq && recs[i].seq < minUnacked) {
+                minUnacked = recs[i].seq;
+                minUnackedSlot = base + i;
+            }
+        }
+    }
+
+    if (maxSeq == 0) {
+        // Empty region: continue numbering after what the cloud already has
+        g_writeSlot = 0;
+        g_nextSeq = g_ackedSeq + 1;
+    } else {
+        g_writeSlot = Journal_NextSlot(maxSlot);
+        g_nextSeq = (maxSeq > g_ackedSeq ? maxSeq : g_ackedSeq) + 1;
+    }
+
+    if (minUnacked != JOURNAL_BLANK_SEQ) {
+        g_sendSlot = minUnackedSlot;
+        g_sendSeq = minUnacked;
+    } else {
+        g_sendSlot = g_writeSlot;
+        g_sendSeq = g_nextSeq;
+    }
+}
+
+static bool Journal_Open(void)
+{
+    g_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                      JOURNAL_PARTITION_LABEL);
+    if (g_part == NULL || g_part->size < JOURNAL_SECTORS * JOURNAL_SECTOR_SIZE) {
+        Serial.println("[JOURNAL] No flash region, decisions are not persisted");
+        g_part = NULL;
+        return false;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(JOURNAL_NVS_NS, false)) {
+        if (prefs.getUInt("layout", 0) != JOURNAL_LAYOUT) {
+            // First use (or resized): whatever the partition held goes
+            esp_partition_erase_range(g_part, 0, JOURNAL_SECTORS * JOURNAL_SECTOR_SIZE);
+            prefs.putUInt("layout", JOURNAL_LAYOUT);
+        }
+        g_ackedSeq = prefs.getUInt("acked", 0);
+        prefs.end();
+    }
+
+    Journal_Scan();
+    return true;
+}
+
+static void Journal_SaveAck(void)
+{
+    Preferences prefs;
+    if (prefs.begin(JOURNAL_NVS_NS, false)) {
+        prefs.putUInt("acked", g_ackedSeq);
+        prefs.end();
+    }
+}
+
+static void Journal_Flush(void)
+{
+    Journal_Record_t rec;
+
+    for (;;) {
+        portENTER_CRITICAL(&g_journalMux);
+        bool have = g_stagingCount > 0;
+        if (have) {
+            rec = g_staging[g_stagingHead];
+            g_stagingHead = (g_stagingHead + 1) % JOURNAL_STAGING;
+            g_stagingCount--;
+        }
+        portEXIT_CRITICAL(&g_journalMux);
+
+        if (!have) break;
+        Journal_Append(&rec);
+    }
+}
+
+static void Journal_HandleAck(void)
+{
+    portENTER_CRITICAL(&g_journalMux);
+    uint32_t ack = g_ackRx;
+    g_ackRx = 0;
+    portEXIT_CRITICAL(&g_journalMux);
+
+    if (ack == 0 || ack <= g_ackedSeq) return;
+    if (ack >= g_nextSeq) ack = g_nextSeq - 1;
+
+    g_ackedSeq = ack;
+    g_sendSlot = Journal_Seek(g_sendSlot, g_ackedSeq);
+    Journal_SaveAck();
+
+    // A partial ack resends the rest right away; a full one frees the next chunk
+    g_inflightLast = 0;
+}
+
+static void Journal_PutU32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Compress and publish the next run of unacknowledged records
+ * @return true if a chunk went out
+ */
+static bool Journal_Upload(void)
+{
+    if (!Journal_Pending()) return false;
+    if (g_inflightLast != 0 && millis() - g_inflightMs < JOURNAL_ACK_TIMEOUT_MS) return false;
+    if (!MQTT_IsConnected()) return false;
+
+    Journal_Record_t rec;
+    uint32_t slot = g_sendSlot;
+    uint32_t expect = 0, prevTime = 0, last = 0;
+    uint16_t n = JOURNAL_CHUNK_HEADER;
+    uint8_t  count = 0;
+
+    for (uint32_t i = 0; i < JOURNAL_SLOTS && count < JOURNAL_CHUNK_RECORDS; i++) {
+        if (i > 0 && slot == g_writeSlot) break;
+        if (!Journal_Read(slot, &rec) || !Journal_Valid(&rec)) {
+            slot = Journal_NextSlot(slot);
+            continue;
+        }
+        // Sequence numbers are implicit, so a chunk ends at a gap
+        if (count > 0 && rec.seq != expect) break;
+
+        if (count == 0) {
+            g_chunk[0] = 'A';
+            g_chunk[1] = 'J';
+            g_chunk[2] = 1;
+            Journal_PutU32(&g_chunk[4], rec.seq);
+            Journal_PutU32(&g_chunk[8], rec.time);
+            prevTime = rec.time;
+        }
+
+        // Time delta as a zigzag varint: decisions minutes apart take 2 bytes
+        int32_t delta = (int32_t)(rec.time - prevTime);
+        uint32_t zz = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        while (zz >= 0x80) {
+            g_chunk[n++] = (uint8_t)(zz | 0x80);
+            zz >>= 7;
+        }
+        g_chunk[n++] = (uint8_t)zz;
+        prevTime = rec.time;
+
+        Journal_PutU32(&g_chunk[n], rec.uid_hash);
+        n += 4;
+        g_chunk[n++] = (uint8_t)((rec.granted ? 0x80 : 0) | (rec.reason & 0x7F));
+
+        last = rec.seq;
+        expect = rec.seq + 1;
+        count++;
+        slot = Journal_NextSlot(slot);
+    }
+
+    if (count == 0) return false;
+    g_chunk[3] = count;
+
+    if (!MQTT_PublishBinary(MQTT_TOPIC_JOURNAL, g_chunk, n, pdMS_TO_TICKS(1000))) return false;
+
+    g_inflightLast = last;
+    g_inflightMs = millis();
+    portENTER_CRITICAL(&g_journalMux);
+    g_stats.chunks++;
+    portEXIT_CRITICAL(&g_journalMux);
+    DEBUG_PRINTF("[JOURNAL] Sent %u records up to #%lu (%u bytes)\n",
+                 count, (unsigned long)last, n);
+    return true;
+}
+
+// ==================== PUBLIC API ====================
+
+void Access_Journal_Init(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_task = App_RTOS_CreateTask(APP_TASK_ACCESS_JOURNAL);
+}
+
+void Access_Journal_Record(const uint8_t* uid, uint8_t size, bool granted, Access_Reason_t reason)
+{
+    Journal_Record_t rec;
+    memset(&rec, 0, sizeof(rec));
+
+    time_t now = time(NULL);
+    rec.time = (now >= TIME_VALID_EPOCH) ? (uint32_t)now
+             : ((uint32_t)(esp_timer_get_time() / 1000000) | JOURNAL_TIME_UPTIME);
+    rec.uid_hash = (uint32_t)Access_HashUID(uid, size);
+    rec.granted = granted ? 1 : 0;
+    rec.reason = (uint8_t)reason;
+
+    portENTER_CRITICAL(&g_journalMux);
+    if (g_stagingCount < JOURNAL_STAGING) {
+        g_staging[(g_stagingHead + g_stagingCount) % JOURNAL_STAGING] = rec;
+        g_stagingCount++;
+    } else {
+        g_stats.dropped++;
+    }
+    portEXIT_CRITICAL(&g_journalMux);
+
+    if (g_task != NULL) xTaskNotifyGive(g_task);
+}
+
+void Access_Journal_Ack(const char* payload)
+{
+    if (payload == NULL) return;
+
+    char* end = NULL;
+    unsigned long seq = strtoul(payload, &end, 10);
+    if (end == payload || seq == 0) return;
+
+    portENTER_CRITICAL(&g_journalMux);
+    if (seq > g_ackRx) g_ackRx = (uint32_t)seq;
+    portEXIT_CRITICAL(&g_journalMux);
+
+    if (g_task != NULL) xTaskNotifyGive(g_task);
+}
+
+void Access_Journal_GetStats(Access_Journal_Stats_t* stats)
+{
+    if (stats == NULL) return;
+
+    portENTER_CRITICAL(&g_journalMux);
+    *stats = g_stats;
+    stats->ready = (g_part != NULL);
+    stats->next_seq = g_nextSeq;
+    stats->acked_seq = g_ackedSeq;
+    stats->pending = g_nextSeq - g_sendSeq;
+    portEXIT_CRITICAL(&g_journalMux);
+}
+
+void Access_Journal_Task(void* parameter)
+{
+    (void)parameter;
+
+    // Scanning 64 KB of flash here keeps it off the boot path
+    if (!Journal_Open()) {
+        // Keep draining staging so Access_Journal_Record() stays cheap
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            portENTER_CRITICAL(&g_journalMux);
+            g_stats.dropped += g_stagingCount;
+            g_stagingCount = 0;
+            portEXIT_CRITICAL(&g_journalMux);
+        }
+    }
+
+    DEBUG_PRINTF("[JOURNAL] Next #%lu, acked #%lu, %lu pending\n",
+                 (unsigned long)g_nextSeq, (unsigned long)g_ackedSeq,
+                 (unsigned long)(g_nextSeq - g_sendSeq));
+
+    for (;;) {
+        // Poll for the broker only while something waits for upload
+        TickType_t wait = Journal_Pending() ? pdMS_TO_TICKS(JOURNAL_POLL_MS) : portMAX_DELAY;
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        Journal_Flush();
+        Journal_HandleAck();
+        Journal_Upload();
+    }
+}
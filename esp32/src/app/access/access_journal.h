@@ -0,0 +1,62 @@
+/**
+ * @file access_journal.h
+ * @brief Persistent journal of card decisions with acknowledged bulk upload
+ *
+ * @note Access_Journal_Record() only copies a record into RAM and wakes the
+ *       journal task, so the door decision never waits on flash or network.
+ *       The task appends to an erase-ahead flash ring, uploads compressed
+ *       chunks while MQTT is up and frees records once the cloud has
+ *       acknowledged their sequence numbers (access_cfg.h).
+ *
+ *       Chunk on MQTT_TOPIC_JOURNAL (little endian):
+ *         'A' 'J' 1 <count u8> <first_seq u32> <first_time u32>
+ *         then per record: <time delta, zigzag varint> <uid_hash u32>
+ *                          <granted << 7 | reason u8>
+ *       Sequence numbers are consecutive within a chunk. Times are Unix s,
+ *       or seconds since boot with bit 31 set while the clock is unset.
+ *       The cloud answers with the last stored sequence number (decimal)
+ *       on MQTT_TOPIC_JOURNAL_ACK.
+ */
+
+#ifndef ACCESS_JOURNAL_H
+#define ACCESS_JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "access.h"
+
+typedef struct {
+    bool     ready;             ///< Flash region found and scanned
+    uint32_t next_seq;          ///< Sequence number of the next record
+    uint32_t acked_seq;         ///< Last record the cloud confirmed
+    uint32_t pending;           ///< Stored, not yet acknowledged
+    uint32_t dropped;           ///< Lost before upload (ring or staging full)
+    uint32_t chunks;            ///< Chunks published since boot
+} Access_Journal_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Find and scan the flash ring, start the journal task
+ */
+void Access_Journal_Init(void);
+
+/**
+ * @brief Log one decision; never blocks
+ */
+void Access_Journal_Record(const uint8_t* uid, uint8_t size, bool granted, Access_Reason_t reason);
+
+/**
+ * @brief Acknowledgement from MQTT_TOPIC_JOURNAL_ACK (NUL-terminated)
+ * @note Safe from the MQTT callback: stores the number and wakes the task
+ */
+void Access_Journal_Ack(const char* payload);
+
+void Access_Journal_GetStats(Access_Journal_Stats_t* stats);
+
+/**
+ * @brief Flushes staged records to flash and uploads unacknowledged ones
+ */
+void Access_Journal_Task(void* parameter);
+
+#endif // ACCESS_JOURNAL_H
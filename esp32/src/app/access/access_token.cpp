@@ -0,0 +1,204 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include <time.h>
+#include "mbedtls/md.h"
+
+#include "access_token.h"
+#include "../../app_cfg.h"
+
+#if ACCESS_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define TOKEN_UID_MAX           10
+#define TOKEN_BODY_LEN          16      // Signed fields, bytes 0-15
+#define TOKEN_MAC_LEN           16      // Truncated HMAC-SHA256
+#define TOKEN_MAGIC_0           'H'
+#define TOKEN_MAGIC_1           'K'
+
+// ==================== STATIC VARIABLES ====================
+
+static portMUX_TYPE g_tokenMux = portMUX_INITIALIZER_UNLOCKED;
+static Access_Token_Stats_t g_stats;
+
+// Token key from NVS, length 0 until the room is commissioned
+static uint8_t g_tokenKey[ACCESS_KEY_MAX_LEN];
+static size_t  g_tokenKeyLen = 0;
+
+// ==================== HELPER FUNCTIONS ====================
+
+static void Token_Put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void Token_Put32(uint8_t* p, uint32_t v)
+{
+    Token_Put16(p, (uint16_t)v);
+    Token_Put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t Token_Get16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Token_Get32(const uint8_t* p)
+{
+    return (uint32_t)Token_Get16(p) | ((uint32_t)Token_Get16(p + 2) << 16);
+}
+
+static bool Token_Mac(const uint8_t* body, const uint8_t* uid, uint8_t size, uint8_t* mac)
+{
+    uint8_t message[1 + TOKEN_UID_MAX + TOKEN_BODY_LEN];
+    message[0] = size;
+    memcpy(message + 1, uid, size);
+    memcpy(message + 1 + size, body, TOKEN_BODY_LEN);
+
+    uint8_t full[32];
+    if (g_tokenKeyLen == 0) return false;
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                        g_tokenKey, g_tokenKeyLen,
+                        message, 1 + size + TOKEN_BODY_LEN, full) != 0) {
+        return false;
+    }
+    memcpy(mac, full, TOKEN_MAC_LEN);
+    return true;
+}
+
+static void Token_SaveIssue(uint16_t issue)
+{
+    Preferences prefs;
+    if (prefs.begin(ACCESS_NVS_NS, false)) {
+        prefs.putUShort(ACCESS_TOKEN_NVS_KEY, issue);
+        prefs.end();
+    }
+}
+
+static bool Token_Result(bool granted, Access_Reason_t why, Access_Reason_t* reason)
+{
+    portENTER_CRITICAL(&g_tokenMux);
+    if (granted) g_stats.granted++;
+    else g_stats.denied++;
+    portEXIT_CRITICAL(&g_tokenMux);
+
+    if (reason) *reason = why;
+    return granted;
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void Access_Token_Init(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    g_tokenKeyLen = Access_LoadKey(ACCESS_KEY_NVS_TOKEN, g_tokenKey, sizeof(g_tokenKey));
+    if (g_tokenKeyLen == 0) {
+        Serial.println("[TOKEN] No token key provisioned - guest cards refused");
+    }
+
+    Preferences prefs;
+    if (prefs.begin(ACCESS_NVS_NS, true)) {
+        g_stats.highest_issue = prefs.getUShort(ACCESS_TOKEN_NVS_KEY, 0);
+        prefs.end();
+    }
+    DEBUG_PRINTF("[TOKEN] Room %u, key %u, highest issue %u\n",
+                 (unsigned)ROOM_NUMBER, (unsigned)ACCESS_TOKEN_KEY_ID,
+                 (unsigned)g_stats.highest_issue);
+}
+
+bool Access_Token_Build(const Access_Token_t* token, const uint8_t* uid, uint8_t size, uint8_t* out)
+{
+    if (!token || !uid || !out || size == 0 || size > TOKEN_UID_MAX) return false;
+
+    out[0] = TOKEN_MAGIC_0;
+    out[1] = TOKEN_MAGIC_1;
+    out[2] = ACCESS_TOKEN_FORMAT;
+    out[3] = ACCESS_TOKEN_KEY_ID;
+    Token_Put16(out + 4, token->room);
+    Token_Put16(out + 6, token->issue);
+    Token_Put32(out + 8, token->valid_from);
+    Token_Put32(out + 12, token->valid_to);
+    return Token_Mac(out, uid, size, out + TOKEN_BODY_LEN);
+}
+
+bool Access_Token_Verify(const uint8_t* data, const uint8_t* uid, uint8_t size, Access_Reason_t* reason)
+{
+    if (!data || !uid || size == 0 || size > TOKEN_UID_MAX) {
+        return Token_Result(false, ACCESS_REASON_BAD_UID, reason);
+    }
+
+    // Blank or foreign cards: nothing to verify
+    if (data[0] != TOKEN_MAGIC_0 || data[1] != TOKEN_MAGIC_1 ||
+        data[2] != ACCESS_TOKEN_FORMAT || data[3] != ACCESS_TOKEN_KEY_ID) {
+        return Token_Result(false, ACCESS_REASON_NOT_LISTED, reason);
+    }
+
+    // Fail closed until commissioning has written a real key
+    if (g_tokenKeyLen == 0) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_NO_KEY, reason);
+    }
+
+    uint8_t expected[TOKEN_MAC_LEN];
+    if (!Token_Mac(data, uid, size, expected)) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_BAD_MAC, reason);
+    }
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < TOKEN_MAC_LEN; i++) {
+        diff |= expected[i] ^ data[TOKEN_BODY_LEN + i];
+    }
+    if (diff != 0) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_BAD_MAC, reason);
+    }
+
+    if (Token_Get16(data + 4) != ROOM_NUMBER) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_WRONG_ROOM, reason);
+    }
+
+    // Without a clock the window means nothing; fail closed
+    time_t now = time(NULL);
+    if (now < TIME_VALID_EPOCH) {
+        return Token_Result(false, ACCESS_REASON_NO_CLOCK, reason);
+    }
+    int64_t t = (int64_t)now;
+    if (t + ACCESS_TOKEN_SKEW_S < (int64_t)Token_Get32(data + 8)) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_NOT_YET, reason);
+    }
+    if (t - ACCESS_TOKEN_SKEW_S > (int64_t)Token_Get32(data + 12)) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_EXPIRED, reason);
+    }
+
+    uint16_t issue = Token_Get16(data + 6);
+    bool newer = false;
+    bool superseded = false;
+    portENTER_CRITICAL(&g_tokenMux);
+    if (issue < g_stats.highest_issue) {
+        superseded = true;
+    } else if (issue > g_stats.highest_issue) {
+        g_stats.highest_issue = issue;
+        newer = true;
+    }
+    portEXIT_CRITICAL(&g_tokenMux);
+
+    if (superseded) {
+        return Token_Result(false, ACCESS_REASON_TOKEN_SUPERSEDED, reason);
+    }
+    if (newer) {
+        // Rare (once per re-issue), so the NVS write on the swipe is fine
+        Token_SaveIssue(issue);
+        DEBUG_PRINTF("[TOKEN] Issue %u now current\n", (unsigned)issue);
+    }
+    return Token_Result(true, ACCESS_REASON_TOKEN, reason);
+}
+
+void Access_Token_GetStats(Access_Token_Stats_t* stats)
+{
+    if (!stats) return;
+    portENTER_CRITICAL(&g_tokenMux);
+    *stats = g_stats;
+    portEXIT_CRITICAL(&g_tokenMux);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file access_token.h
+ * @brief Signed validity tokens carried on guest cards (offline door checks)
+ *
+ * @note The token sits in blocks 5-6 (RFID_TOKEN_BLOCK), 32 bytes, little
+ *       endian:
+ *         0  'H' 'K' <format u8> <key_id u8>
+ *         4  <room u16> <issue u16>
+ *         8  <valid_from u32> <valid_to u32>     (Unix s, UTC)
+ *         16 <mac, 16 bytes>
+ *       mac = first 16 bytes of HMAC-SHA256(token key,
+ *             uid_len | uid | bytes 0-15). Binding the UID means a token
+ *       copied onto another card does not verify. Checking one costs a
+ *       single card session and one HMAC (ESP32 SHA accelerator), no network.
+ *       The token key comes from NVS (ACCESS_KEY_NVS_TOKEN); without one
+ *       no token is built or accepted.
+ */
+
+#ifndef ACCESS_TOKEN_H
+#define ACCESS_TOKEN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "access.h"
+
+#define ACCESS_TOKEN_SIZE       32
+#define ACCESS_TOKEN_FORMAT     1
+
+typedef struct {
+    uint16_t room;
+    uint16_t issue;             ///< Per-room counter; a higher one locks out older cards
+    uint32_t valid_from;
+    uint32_t valid_to;
+} Access_Token_t;
+
+typedef struct {
+    uint16_t highest_issue;
+    uint32_t granted;
+    uint32_t denied;
+} Access_Token_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Load the token key and the highest issue number seen for this room
+ */
+void Access_Token_Init(void);
+
+/**
+ * @brief Encode and sign a token for a card (check-in kiosk / encoder)
+ * @param out ACCESS_TOKEN_SIZE bytes, ready for RFID_WriteToken()
+ */
+bool Access_Token_Build(const Access_Token_t* token, const uint8_t* uid, uint8_t size, uint8_t* out);
+
+/**
+ * @brief Check a token read from the card against its UID, this room and
+ *        the clock
+ * @param data   ACCESS_TOKEN_SIZE bytes from RFID_ReadToken()
+ * @param reason ACCESS_REASON_TOKEN if granted, else why not (optional)
+ * @note A valid token with a new highest issue is stored in NVS, so the
+ *       first swipe of a re-issued card revokes the previous one.
+ */
+bool Access_Token_Verify(const uint8_t* data, const uint8_t* uid, uint8_t size, Access_Reason_t* reason);
+
+void Access_Token_GetStats(Access_Token_Stats_t* stats);
+
+#endif // ACCESS_TOKEN_H
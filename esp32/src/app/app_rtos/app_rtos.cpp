@@ -0,0 +1,232 @@
+#include <Arduino.h>
+#include "app_rtos.h"
+#include "../../app_cfg.h"
+
+#include "../thermostat/thermostat_rtos.h"
+#include "../thermostat/thermostat_config.h"
+#include "../room/room_rtos.h"
+#include "../room/room_types.h"
+#include "../../hal/communication/hal_mqtt/hal_mqtt.h"
+#include "../../hal/communication/hal_wifi/hal_wifi.h"
+#include "../../drivers/driver_adc/driver_adc.h"
+#include "../../drivers/driver_uart/driver_uart.h"
+#include "../../drivers/driver_bus/driver_bus.h"
+#include "../access/access_journal.h"
+
+// ============================================================================
+// Static storage (one block per table row)
+// ============================================================================
+
+#define APP_RTOS_TASK_STORAGE(id, entry, name, stack, prio) \
+    static StackType_t  g_taskStack_##id[stack];              \
+    static StaticTask_t g_taskTcb_##id;
+#define APP_RTOS_QUEUE_STORAGE(id, length, item_size)                   \
+    static uint8_t       g_queueStorage_##id[(length) * (item_size)];   \
+    static StaticQueue_t g_queueCb_##id;
+#define APP_RTOS_MUTEX_STORAGE(id)          static StaticSemaphore_t g_mutexCb_##id;
+#define APP_RTOS_SEMAPHORE_STORAGE(id)      static StaticSemaphore_t g_semCb_##id;
+#define APP_RTOS_EVENT_GROUP_STORAGE(id)    static StaticEventGroup_t g_eventGroupCb_##id;
+#define APP_RTOS_TIMER_STORAGE(id, callback, name, period, reload) \
+    static StaticTimer_t g_timerCb_##id;
+
+APP_RTOS_TASK_TABLE(APP_RTOS_TASK_STORAGE)
+APP_RTOS_QUEUE_TABLE(APP_RTOS_QUEUE_STORAGE)
+APP_RTOS_MUTEX_TABLE(APP_RTOS_MUTEX_STORAGE)
+APP_RTOS_SEMAPHORE_TABLE(APP_RTOS_SEMAPHORE_STORAGE)
+APP_RTOS_EVENT_GROUP_TABLE(APP_RTOS_EVENT_GROUP_STORAGE)
+APP_RTOS_TIMER_TABLE(APP_RTOS_TIMER_STORAGE)
+
+// ============================================================================
+// Descriptors
+// ============================================================================
+
+typedef struct {
+    TaskFunction_t entry;
+    const char*    name;
+    uint32_t       stack_bytes;
+    UBaseType_t    priority;
+    StackType_t*   stack;
+    StaticTask_t*  tcb;
+} App_RTOS_TaskDesc_t;
+
+typedef struct {
+    UBaseType_t    length;
+    UBaseType_t    item_size;
+    uint8_t*       storage;
+    StaticQueue_t* cb;
+} App_RTOS_QueueDesc_t;
+
+typedef struct {
+    TimerCallbackFunction_t callback;
+    const char*    name;
+    uint32_t       period_ms;
+    UBaseType_t    auto_reload;
+    StaticTimer_t* cb;
+} App_RTOS_TimerDesc_t;
+
+// A table may be empty (e.g. a feature switched off); its arrays keep one
+// unused slot so none is zero-length
+#define APP_RTOS_SLOTS(count)   ((count) > 0 ? (count) : 1)
+
+#define APP_RTOS_TASK_DESC(id, entry, name, stack, prio) \
+    { entry, name, stack, prio, g_taskStack_##id, &g_taskTcb_##id },
+#define APP_RTOS_QUEUE_DESC(id, length, item_size) \
+    { length, item_size, g_queueStorage_##id, &g_queueCb_##id },
+#define APP_RTOS_MUTEX_DESC(id)         &g_mutexCb_##id,
+#define APP_RTOS_SEMAPHORE_DESC(id)     &g_semCb_##id,
+#define APP_RTOS_EVENT_GROUP_DESC(id)   &g_eventGroupCb_##id,
+#define APP_RTOS_TIMER_DESC(id, callback, name, period, reload) \
+    { callback, name, period, reload, &g_timerCb_##id },
+#define APP_RTOS_QUEUE_SET_DESC(id, length)     length,
+
+static const App_RTOS_TaskDesc_t g_tasks[APP_RTOS_SLOTS(APP_TASK_COUNT)] = {
+    APP_RTOS_TASK_TABLE(APP_RTOS_TASK_DESC)
+};
+static const App_RTOS_QueueDesc_t g_queues[APP_RTOS_SLOTS(APP_QUEUE_COUNT)] = {
+    APP_RTOS_QUEUE_TABLE(APP_RTOS_QUEUE_DESC)
+};
+static StaticSemaphore_t* const g_mutexes[APP_RTOS_SLOTS(APP_MUTEX_COUNT)] = {
+    APP_RTOS_MUTEX_TABLE(APP_RTOS_MUTEX_DESC)
+};
+static StaticSemaphore_t* const g_semaphores[APP_RTOS_SLOTS(APP_SEM_COUNT)] = {
+    APP_RTOS_SEMAPHORE_TABLE(APP_RTOS_SEMAPHORE_DESC)
+};
+static StaticEventGroup_t* const g_eventGroups[APP_RTOS_SLOTS(APP_EVENT_GROUP_COUNT)] = {
+    APP_RTOS_EVENT_GROUP_TABLE(APP_RTOS_EVENT_GROUP_DESC)
+};
+static const App_RTOS_TimerDesc_t g_timers[APP_RTOS_SLOTS(APP_TIMER_COUNT)] = {
+    APP_RTOS_TIMER_TABLE(APP_RTOS_TIMER_DESC)
+};
+static const UBaseType_t g_queueSetLengths[APP_RTOS_SLOTS(APP_QUEUE_SET_COUNT)] = {
+    APP_RTOS_QUEUE_SET_TABLE(APP_RTOS_QUEUE_SET_DESC)
+};
+
+// ============================================================================
+// Compile-time RAM budget
+// ============================================================================
+
+#define APP_RTOS_TASK_BYTES(id, entry, name, stack, prio)   + (stack) + sizeof(StaticTask_t)
+#define APP_RTOS_QUEUE_BYTES(id, length, item_size)         + ((length) * (item_size)) + sizeof(StaticQueue_t)
+#define APP_RTOS_MUTEX_BYTES(id)                            + sizeof(StaticSemaphore_t)
+#define APP_RTOS_SEMAPHORE_BYTES(id)                        + sizeof(StaticSemaphore_t)
+#define APP_RTOS_EVENT_GROUP_BYTES(id)                      + sizeof(StaticEventGroup_t)
+#define APP_RTOS_TIMER_BYTES(id, callback, name, period, reload) + sizeof(StaticTimer_t)
+// Heap rows: a queue of member handles plus its control block
+#define APP_RTOS_QUEUE_SET_BYTES(id, length)                + ((length) * sizeof(QueueSetMemberHandle_t)) + sizeof(StaticQueue_t)
+
+static constexpr uint32_t APP_RTOS_STATIC_RAM_BYTES = 0
+    APP_RTOS_TASK_TABLE(APP_RTOS_TASK_BYTES)
+    APP_RTOS_QUEUE_TABLE(APP_RTOS_QUEUE_BYTES)
+    APP_RTOS_MUTEX_TABLE(APP_RTOS_MUTEX_BYTES)
+    APP_RTOS_SEMAPHORE_TABLE(APP_RTOS_SEMAPHORE_BYTES)
+    APP_RTOS_EVENT_GROUP_TABLE(APP_RTOS_EVENT_GROUP_BYTES)
+    APP_RTOS_TIMER_TABLE(APP_RTOS_TIMER_BYTES)
+    APP_RTOS_QUEUE_SET_TABLE(APP_RTOS_QUEUE_SET_BYTES);
+
+static_assert(APP_RTOS_STATIC_RAM_BYTES <= APP_RTOS_RAM_BUDGET_BYTES,
+              "RTOS objects exceed APP_RTOS_RAM_BUDGET_BYTES - shrink a stack/queue or raise the budget");
+
+// ============================================================================
+// Creation
+// ============================================================================
+
+// Each object may be created once; a second call would corrupt a live object
+static bool g_taskCreated[APP_RTOS_SLOTS(APP_TASK_COUNT)];
+static bool g_queueCreated[APP_RTOS_SLOTS(APP_QUEUE_COUNT)];
+static bool g_mutexCreated[APP_RTOS_SLOTS(APP_MUTEX_COUNT)];
+static bool g_semCreated[APP_RTOS_SLOTS(APP_SEM_COUNT)];
+static bool g_eventGroupCreated[APP_RTOS_SLOTS(APP_EVENT_GROUP_COUNT)];
+static bool g_timerCreated[APP_RTOS_SLOTS(APP_TIMER_COUNT)];
+static bool g_queueSetCreated[APP_RTOS_SLOTS(APP_QUEUE_SET_COUNT)];
+
+TaskHandle_t App_RTOS_CreateTask(App_RTOS_TaskId_t id)
+{
+    configASSERT(id < APP_TASK_COUNT && !g_taskCreated[id]);
+    g_taskCreated[id] = true;
+
+    const App_RTOS_TaskDesc_t* task = &g_tasks[id];
+    TaskHandle_t handle = xTaskCreateStatic(task->entry, task->name, task->stack_bytes,
+                                            NULL, task->priority, task->stack, task->tcb);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+QueueHandle_t App_RTOS_CreateQueue(App_RTOS_QueueId_t id)
+{
+    configASSERT(id < APP_QUEUE_COUNT && !g_queueCreated[id]);
+    g_queueCreated[id] = true;
+
+    const App_RTOS_QueueDesc_t* queue = &g_queues[id];
+    QueueHandle_t handle = xQueueCreateStatic(queue->length, queue->item_size,
+                                              queue->storage, queue->cb);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+SemaphoreHandle_t App_RTOS_CreateMutex(App_RTOS_MutexId_t id)
+{
+    configASSERT(id < APP_MUTEX_COUNT && !g_mutexCreated[id]);
+    g_mutexCreated[id] = true;
+
+    SemaphoreHandle_t handle = xSemaphoreCreateMutexStatic(g_mutexes[id]);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+SemaphoreHandle_t App_RTOS_CreateSemaphore(App_RTOS_SemaphoreId_t id)
+{
+    configASSERT(id < APP_SEM_COUNT && !g_semCreated[id]);
+    g_semCreated[id] = true;
+
+    SemaphoreHandle_t handle = xSemaphoreCreateBinaryStatic(g_semaphores[id]);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+EventGroupHandle_t App_RTOS_CreateEventGroup(App_RTOS_EventGroupId_t id)
+{
+    configASSERT(id < APP_EVENT_GROUP_COUNT && !g_eventGroupCreated[id]);
+    g_eventGroupCreated[id] = true;
+
+    EventGroupHandle_t handle = xEventGroupCreateStatic(g_eventGroups[id]);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+TimerHandle_t App_RTOS_CreateTimer(App_RTOS_TimerId_t id)
+{
+    configASSERT(id < APP_TIMER_COUNT && !g_timerCreated[id]);
+    g_timerCreated[id] = true;
+
+    const App_RTOS_TimerDesc_t* timer = &g_timers[id];
+    TimerHandle_t handle = xTimerCreateStatic(timer->name, pdMS_TO_TICKS(timer->period_ms),
+                                              timer->auto_reload, NULL, timer->callback, timer->cb);
+    configASSERT(handle != NULL);
+    return handle;
+}
+
+QueueSetHandle_t App_RTOS_CreateQueueSet(App_RTOS_QueueSetId_t id)
+{
+    configASSERT(id < APP_QUEUE_SET_COUNT && !g_queueSetCreated[id]);
+    g_queueSetCreated[id] = true;
+
+    // No xQueueCreateSetStatic in IDF 4.4; the size is in the budget above
+    return xQueueCreateSet(g_queueSetLengths[id]);
+}
+
+uint32_t App_RTOS_GetStaticRamBytes(void)
+{
+    return APP_RTOS_STATIC_RAM_BYTES;
+}
+
+void App_RTOS_PrintBudget(void)
+{
+    Serial.printf("[RTOS] Static objects: %u tasks, %u queues, %u mutexes, %u semaphores, %u event groups, %u timers\n",
+                  (unsigned)APP_TASK_COUNT, (unsigned)APP_QUEUE_COUNT, (unsigned)APP_MUTEX_COUNT,
+                  (unsigned)APP_SEM_COUNT, (unsigned)APP_EVENT_GROUP_COUNT, (unsigned)APP_TIMER_COUNT);
+    Serial.printf("[RTOS] Heap objects: %u queue sets (counted in the budget)\n",
+                  (unsigned)APP_QUEUE_SET_COUNT);
+    Serial.printf("[RTOS] RAM: %u / %u bytes (%u%%)\n",
+                  (unsigned)APP_RTOS_STATIC_RAM_BYTES, (unsigned)APP_RTOS_RAM_BUDGET_BYTES,
+                  (unsigned)((APP_RTOS_STATIC_RAM_BYTES * 100UL) / APP_RTOS_RAM_BUDGET_BYTES));
+}
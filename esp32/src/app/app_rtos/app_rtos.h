@@ -0,0 +1,70 @@
+#ifndef APP_RTOS_H
+#define APP_RTOS_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+#include <freertos/timers.h>
+#include "app_rtos_cfg.h"
+
+// Object identifiers generated from the tables in app_rtos_cfg.h
+#define APP_RTOS_TASK_ID(id, entry, name, stack, prio)  APP_TASK_##id,
+#define APP_RTOS_QUEUE_ID(id, length, item_size)        APP_QUEUE_##id,
+#define APP_RTOS_QUEUE_SET_ID(id, length)               APP_QUEUE_SET_##id,
+#define APP_RTOS_MUTEX_ID(id)                           APP_MUTEX_##id,
+#define APP_RTOS_SEMAPHORE_ID(id)                       APP_SEM_##id,
+#define APP_RTOS_EVENT_GROUP_ID(id)                     APP_EVENT_GROUP_##id,
+#define APP_RTOS_TIMER_ID(id, callback, name, period, reload) APP_TIMER_##id,
+
+typedef enum {
+    APP_RTOS_TASK_TABLE(APP_RTOS_TASK_ID)
+    APP_TASK_COUNT
+} App_RTOS_TaskId_t;
+
+typedef enum {
+    APP_RTOS_QUEUE_TABLE(APP_RTOS_QUEUE_ID)
+    APP_QUEUE_COUNT
+} App_RTOS_QueueId_t;
+
+typedef enum {
+    APP_RTOS_QUEUE_SET_TABLE(APP_RTOS_QUEUE_SET_ID)
+    APP_QUEUE_SET_COUNT
+} App_RTOS_QueueSetId_t;
+
+typedef enum {
+    APP_RTOS_MUTEX_TABLE(APP_RTOS_MUTEX_ID)
+    APP_MUTEX_COUNT
+} App_RTOS_MutexId_t;
+
+typedef enum {
+    APP_RTOS_SEMAPHORE_TABLE(APP_RTOS_SEMAPHORE_ID)
+    APP_SEM_COUNT
+} App_RTOS_SemaphoreId_t;
+
+typedef enum {
+    APP_RTOS_EVENT_GROUP_TABLE(APP_RTOS_EVENT_GROUP_ID)
+    APP_EVENT_GROUP_COUNT
+} App_RTOS_EventGroupId_t;
+
+typedef enum {
+    APP_RTOS_TIMER_TABLE(APP_RTOS_TIMER_ID)
+    APP_TIMER_COUNT
+} App_RTOS_TimerId_t;
+
+// Creation from static storage; never fails at runtime (asserts on misuse)
+TaskHandle_t       App_RTOS_CreateTask(App_RTOS_TaskId_t id);
+QueueHandle_t      App_RTOS_CreateQueue(App_RTOS_QueueId_t id);
+SemaphoreHandle_t  App_RTOS_CreateMutex(App_RTOS_MutexId_t id);
+SemaphoreHandle_t  App_RTOS_CreateSemaphore(App_RTOS_SemaphoreId_t id);
+EventGroupHandle_t App_RTOS_CreateEventGroup(App_RTOS_EventGroupId_t id);
+TimerHandle_t      App_RTOS_CreateTimer(App_RTOS_TimerId_t id);   // Created stopped
+// Heap allocated (no static API); NULL if the heap is exhausted
+QueueSetHandle_t   App_RTOS_CreateQueueSet(App_RTOS_QueueSetId_t id);
+
+// Boot-time report of the static RAM budget
+uint32_t App_RTOS_GetStaticRamBytes(void);
+void App_RTOS_PrintBudget(void);
+
+#endif // APP_RTOS_H
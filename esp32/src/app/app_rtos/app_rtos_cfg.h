@@ -0,0 +1,92 @@
+#ifndef APP_RTOS_CFG_H
+#define APP_RTOS_CFG_H
+
+#include "../../app_cfg.h"
+
+/* =========================
+ * Central RTOS Object Table
+ * =========================
+ * Every task, queue, mutex, semaphore, event group and timer in the firmware is
+ * declared here and allocated statically by app_rtos.cpp. Adding an object
+ * means adding one row; the RAM budget below is checked at compile time.
+ *
+ * Queue sets are the one exception: IDF 4.4 has no static queue-set API, so
+ * their rows are allocated from the heap once at init. They still count
+ * against the budget, at the size of a static queue of the same length.
+ */
+
+// Total RAM allowed for stacks, queue storage and control blocks
+#define APP_RTOS_RAM_BUDGET_BYTES   (56 * 1024)
+
+// The I2C worker and its objects only exist while the bus is enabled
+#if I2C_ENABLED == STD_ON
+#define APP_RTOS_I2C_TASK(X)    X(BUS_I2C, Bus_I2cTask, "BusI2c", BUS_STACK_SIZE, BUS_PRIORITY)
+#define APP_RTOS_I2C_QUEUE(X)   X(BUS_I2C, BUS_QUEUE_LEN, sizeof(Bus_Transaction_t)) \
+                                X(BUS_I2C_HIGH, BUS_QUEUE_LEN, sizeof(Bus_Transaction_t))
+#define APP_RTOS_I2C_MUTEX(X)   X(BUS_I2C)
+#else
+#define APP_RTOS_I2C_TASK(X)
+#define APP_RTOS_I2C_QUEUE(X)
+#define APP_RTOS_I2C_MUTEX(X)
+#endif
+
+// Tasks: X(id, entry, name, stack_bytes, priority)
+#define APP_RTOS_TASK_TABLE(X) \
+    X(TEMP_SENSOR,   Task_TemperatureSensor,  "TempSensor",   TEMP_SENSOR_STACK_SIZE,       TEMP_SENSOR_PRIORITY)       \
+    X(USER_INPUT,    Task_UserInput,          "UserInput",    USER_INPUT_STACK_SIZE,        USER_INPUT_PRIORITY)        \
+    X(FAN_CONTROL,   Task_FanControl,         "FanControl",   FAN_CONTROL_STACK_SIZE,       FAN_CONTROL_PRIORITY)       \
+    X(MQTT,          Task_Mqtt,               "MqttPublish",  MQTT_STACK_SIZE,              MQTT_PRIORITY)              \
+    X(GAS_SENSOR,    Task_GasSensor,          "GasSensor",    GAS_SENSOR_STACK_SIZE,        GAS_SENSOR_PRIORITY)        \
+    X(ROOM_SENSOR,   Room_RTOS_SensorTask,    "SensorTask",   ROOM_TASK_STACK_SIZE_SMALL,   ROOM_TASK_PRIORITY_MEDIUM)  \
+    X(ROOM_CONTROL,  Room_RTOS_ControlTask,   "ControlTask",  ROOM_TASK_STACK_SIZE_LARGE,   ROOM_TASK_PRIORITY_MEDIUM)  \
+    X(ROOM_BUTTON,   Room_RTOS_ButtonTask,    "ButtonTask",   ROOM_TASK_STACK_SIZE_LARGE,   ROOM_TASK_PRIORITY_MEDIUM)  \
+    X(ROOM_RFID,     Room_RTOS_RFIDTask,      "RFIDTask",     ROOM_TASK_STACK_SIZE_LARGE,   ROOM_TASK_PRIORITY_MEDIUM)  \
+    X(ADC_ACQ,       ADC_Acq_Task,            "AdcAcq",       ADC_ACQ_STACK_SIZE,           ADC_ACQ_PRIORITY)           \
+    X(ACCESS_JOURNAL, Access_Journal_Task,    "Journal",      JOURNAL_STACK_SIZE,           JOURNAL_PRIORITY)           \
+    X(UART,          UART_Task,               "Uart",         UART_STACK_SIZE,              UART_PRIORITY)              \
+    X(BUS_SPI,       Bus_SpiTask,             "BusSpi",       BUS_STACK_SIZE,               BUS_PRIORITY)               \
+    X(WIFI,          WIFI_Task,               "WiFi",         WIFI_STACK_SIZE,              WIFI_PRIORITY)              \
+    APP_RTOS_I2C_TASK(X)
+
+// Queues: X(id, length, item_size)
+#define APP_RTOS_QUEUE_TABLE(X) \
+    X(MQTT_PUBLISH,     MQTT_PUBLISH_QUEUE_SIZE, sizeof(mqtt_pub_msg_t))    \
+    X(ROOM_MQTT_RX,     ROOM_MQTT_QUEUE_SIZE,   sizeof(Room_MQTTMessage_t)) \
+    X(ROOM_MQTT_TX,     ROOM_MQTT_QUEUE_SIZE,   sizeof(Room_MQTTMessage_t)) \
+    X(ROOM_RFID_EVENT,  ROOM_RFID_QUEUE_SIZE,   sizeof(Room_RFID_Event_t))  \
+    X(BUS_SPI,          BUS_QUEUE_LEN,          sizeof(Bus_Transaction_t))  \
+    X(BUS_SPI_HIGH,     BUS_QUEUE_LEN,          sizeof(Bus_Transaction_t))  \
+    APP_RTOS_I2C_QUEUE(X)
+
+// Queue sets (heap, see above): X(id, length)
+//   length - total events the members can hold: queue lengths + 1 per semaphore
+#define APP_RTOS_QUEUE_SET_TABLE(X) \
+    X(MQTT_WAIT,        MQTT_PUBLISH_QUEUE_SIZE + 1)                        \
+    X(UART_EVENT,       UART_PORT_COUNT * UART_EVENT_QUEUE_LEN + 1)
+
+// Mutexes: X(id)
+#define APP_RTOS_MUTEX_TABLE(X) \
+    X(ROOM_STATUS)          \
+    X(THERMO_TEMPERATURE)   \
+    X(THERMO_TARGET_TEMP)   \
+    X(MQTT_CLIENT)          \
+    X(RULES)                \
+    X(UART_TX)              \
+    X(BUS_SPI)              \
+    APP_RTOS_I2C_MUTEX(X)
+
+// Binary semaphores: X(id)
+#define APP_RTOS_SEMAPHORE_TABLE(X) \
+    X(UART_ACTIVE)  \
+    X(MQTT_WAKE)
+
+// Event groups: X(id)
+#define APP_RTOS_EVENT_GROUP_TABLE(X) \
+    X(THERMOSTAT)   \
+    X(WIFI)
+
+// Software timers: X(id, callback, name, period_ms, auto_reload)
+#define APP_RTOS_TIMER_TABLE(X) \
+    X(WIFI_RECONNECT,   WIFI_TimerCallback,     "WifiTimer",    1000,   pdFALSE)
+
+#endif // APP_RTOS_CFG_H
@@ -0,0 +1,260 @@
+#include <Arduino.h>
+#include <ctype.h>
+#include <string.h>
+#include "esp_timer.h"
+
+#include "cmd_trace.h"
+
+#if CMD_TRACE_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define CMD_TRACE_UNSET     0xFFFFFFFFUL
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef enum {
+    CMD_TRACE_SLOT_FREE = 0,
+    CMD_TRACE_SLOT_OPEN,        // Waiting for apply / echo
+    CMD_TRACE_SLOT_DONE         // Waiting for Cmd_Trace_TakeReport()
+} Cmd_Trace_SlotState_t;
+
+typedef struct {
+    Cmd_Trace_SlotState_t state;
+    Cmd_Trace_Cmd_t    cmd;
+    Cmd_Trace_Result_t result;
+    uint32_t serial;            // Completion order
+    int64_t  rx_us;             // Callback entry, esp_timer
+    uint32_t poll_gap_us;
+    uint32_t lock_wait_us;
+    uint32_t parse_us;          // Offsets from rx_us, CMD_TRACE_UNSET if not reached
+    uint32_t apply_us;
+    uint32_t echo_us;
+    char     cid[CMD_TRACE_ID_MAX + 1];
+} Cmd_Trace_Slot_t;
+
+// ==================== STATIC VARIABLES ====================
+
+#define CMD_TRACE_CMD_ENTRY(id, name, topic)    { name, topic },
+static const struct {
+    const char* name;
+    const char* topic;
+} g_commands[CMD_TRACE_CMD_COUNT] = {
+    CMD_TRACE_CMD_TABLE(CMD_TRACE_CMD_ENTRY)
+};
+#undef CMD_TRACE_CMD_ENTRY
+
+static const char* const g_resultNames[] = { "ok", "invalid", "denied", "timeout" };
+
+static portMUX_TYPE g_traceMux = portMUX_INITIALIZER_UNLOCKED;
+static Cmd_Trace_Slot_t g_slots[CMD_TRACE_SLOTS];
+static uint32_t g_serial = 0;
+static Cmd_Trace_Stats_t g_stats;
+
+// Poll being serviced (set and read in Task_Mqtt only)
+static int64_t  g_lastPollEndUs = 0;
+static uint32_t g_pollGapUs = 0;
+static uint32_t g_pollLockWaitUs = 0;
+
+// ==================== HELPER FUNCTIONS ====================
+
+static uint32_t Cmd_Trace_Since(int64_t start_us)
+{
+    int64_t d = esp_timer_get_time() - start_us;
+    return (d < 0) ? 0 : (d >= (int64_t)CMD_TRACE_UNSET ? CMD_TRACE_UNSET - 1 : (uint32_t)d);
+}
+
+static Cmd_Trace_Slot_t* Cmd_Trace_Open(uint8_t trace)
+{
+    if (trace == CMD_TRACE_NONE || trace > CMD_TRACE_SLOTS) return NULL;
+    Cmd_Trace_Slot_t* slot = &g_slots[trace - 1];
+    return (slot->state == CMD_TRACE_SLOT_OPEN) ? slot : NULL;
+}
+
+// Caller holds g_traceMux
+static void Cmd_Trace_Close(Cmd_Trace_Slot_t* slot, Cmd_Trace_Result_t result)
+{
+    slot->result = result;
+    slot->serial = g_serial++;
+    slot->state = CMD_TRACE_SLOT_DONE;
+}
+
+static bool Cmd_Trace_ValidId(const char* id)
+{
+    size_t n = strlen(id);
+    if (n == 0 || n > CMD_TRACE_ID_MAX) return false;
+    for (size_t i = 0; i < n; i++) {
+        char c = id[i];
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+
+static int Cmd_Trace_AppendStage(char* p, size_t left, const char* name, uint32_t value)
+{
+    if (value == CMD_TRACE_UNSET || left == 0) return 0;
+    int n = snprintf(p, left, ",\"%s\":%lu", name, (unsigned long)value);
+    return (n < 0 || (size_t)n >= left) ? 0 : n;
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void Cmd_Trace_PollStart(uint32_t lock_wait_us)
+{
+    int64_t now = esp_timer_get_time();
+    g_pollGapUs = (g_lastPollEndUs != 0) ? (uint32_t)(now - g_lastPollEndUs) : 0;
+    g_pollLockWaitUs = lock_wait_us;
+}
+
+void Cmd_Trace_PollEnd(void)
+{
+    g_lastPollEndUs = esp_timer_get_time();
+}
+
+uint8_t Cmd_Trace_Begin(const char* topic, char* message)
+{
+    int64_t now = esp_timer_get_time();
+    if (topic == NULL || message == NULL) return CMD_TRACE_NONE;
+
+    uint8_t cmd = 0;
+    while (cmd < CMD_TRACE_CMD_COUNT && strcmp(topic, g_commands[cmd].topic) != 0) cmd++;
+    if (cmd == CMD_TRACE_CMD_COUNT) return CMD_TRACE_NONE;
+
+    char* sep = strrchr(message, CMD_TRACE_SEPARATOR);
+    if (sep == NULL || !Cmd_Trace_ValidId(sep + 1)) return CMD_TRACE_NONE;
+    *sep = '\0';                                // Parsers see the bare value
+
+    uint8_t trace = CMD_TRACE_NONE;
+    portENTER_CRITICAL(&g_traceMux);
+    for (uint8_t i = 0; i < CMD_TRACE_SLOTS; i++) {
+        Cmd_Trace_Slot_t* slot = &g_slots[i];
+        if (slot->state != CMD_TRACE_SLOT_FREE) continue;
+
+        slot->state = CMD_TRACE_SLOT_OPEN;
+        slot->cmd = (Cmd_Trace_Cmd_t)cmd;
+        slot->rx_us = now;
+        slot->poll_gap_us = g_pollGapUs;
+        slot->lock_wait_us = g_pollLockWaitUs;
+        slot->parse_us = CMD_TRACE_UNSET;
+        slot->apply_us = CMD_TRACE_UNSET;
+        slot->echo_us = CMD_TRACE_UNSET;
+        strncpy(slot->cid, sep + 1, CMD_TRACE_ID_MAX);
+        slot->cid[CMD_TRACE_ID_MAX] = '\0';
+        trace = i + 1;
+        break;
+    }
+    if (trace != CMD_TRACE_NONE) {
+        g_stats.traced++;
+        g_stats.last_poll_gap_us = g_pollGapUs;
+        if (g_pollLockWaitUs > g_stats.max_lock_wait_us) g_stats.max_lock_wait_us = g_pollLockWaitUs;
+    } else {
+        g_stats.dropped++;
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+
+    DEBUG_PRINTF("[TRACE] %s %s -> %u\n", g_commands[cmd].name, sep + 1, (unsigned)trace);
+    return trace;
+}
+
+void Cmd_Trace_Parsed(uint8_t trace)
+{
+    portENTER_CRITICAL(&g_traceMux);
+    Cmd_Trace_Slot_t* slot = Cmd_Trace_Open(trace);
+    if (slot != NULL && slot->parse_us == CMD_TRACE_UNSET) {
+        slot->parse_us = Cmd_Trace_Since(slot->rx_us);
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+}
+
+void Cmd_Trace_Applied(uint8_t trace)
+{
+    portENTER_CRITICAL(&g_traceMux);
+    Cmd_Trace_Slot_t* slot = Cmd_Trace_Open(trace);
+    if (slot != NULL && slot->apply_us == CMD_TRACE_UNSET) {
+        slot->apply_us = Cmd_Trace_Since(slot->rx_us);
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+}
+
+void Cmd_Trace_AppliedType(Cmd_Trace_Cmd_t cmd)
+{
+    portENTER_CRITICAL(&g_traceMux);
+    for (uint8_t i = 0; i < CMD_TRACE_SLOTS; i++) {
+        Cmd_Trace_Slot_t* slot = &g_slots[i];
+        if (slot->state != CMD_TRACE_SLOT_OPEN || slot->cmd != cmd) continue;
+        slot->apply_us = Cmd_Trace_Since(slot->rx_us);
+        Cmd_Trace_Close(slot, CMD_TRACE_OK);
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+}
+
+void Cmd_Trace_Finish(uint8_t trace, Cmd_Trace_Result_t result)
+{
+    portENTER_CRITICAL(&g_traceMux);
+    Cmd_Trace_Slot_t* slot = Cmd_Trace_Open(trace);
+    if (slot != NULL) {
+        if (result == CMD_TRACE_OK) {
+            slot->echo_us = Cmd_Trace_Since(slot->rx_us);
+        }
+        Cmd_Trace_Close(slot, result);
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+}
+
+bool Cmd_Trace_TakeReport(char* buffer, uint16_t size)
+{
+    if (buffer == NULL || size == 0) return false;
+
+    Cmd_Trace_Slot_t slot;
+    bool found = false;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&g_traceMux);
+    int8_t oldest = -1;
+    for (uint8_t i = 0; i < CMD_TRACE_SLOTS; i++) {
+        Cmd_Trace_Slot_t* s = &g_slots[i];
+        if (s->state == CMD_TRACE_SLOT_OPEN &&
+            now - s->rx_us > (int64_t)CMD_TRACE_TIMEOUT_MS * 1000) {
+            Cmd_Trace_Close(s, CMD_TRACE_TIMEOUT);
+            g_stats.timeouts++;
+        }
+        if (s->state == CMD_TRACE_SLOT_DONE &&
+            (oldest < 0 || (int32_t)(s->serial - g_slots[oldest].serial) < 0)) {
+            oldest = i;
+        }
+    }
+    if (oldest >= 0) {
+        slot = g_slots[oldest];
+        g_slots[oldest].state = CMD_TRACE_SLOT_FREE;
+        found = true;
+    }
+    portEXIT_CRITICAL(&g_traceMux);
+
+    if (!found) return false;
+
+    int n = snprintf(buffer, size,
+                     "{\"cid\":\"%s\",\"cmd\":\"%s\",\"result\":\"%s\","
+                     "\"poll_gap_us\":%lu,\"lock_wait_us\":%lu",
+                     slot.cid, g_commands[slot.cmd].name, g_resultNames[slot.result],
+                     (unsigned long)slot.poll_gap_us, (unsigned long)slot.lock_wait_us);
+    if (n < 0 || n >= size) return false;
+
+    n += Cmd_Trace_AppendStage(buffer + n, size - n, "parse_us", slot.parse_us);
+    n += Cmd_Trace_AppendStage(buffer + n, size - n, "apply_us", slot.apply_us);
+    n += Cmd_Trace_AppendStage(buffer + n, size - n, "echo_us", slot.echo_us);
+    n += Cmd_Trace_AppendStage(buffer + n, size - n, "ack_us", Cmd_Trace_Since(slot.rx_us));
+    if (n + 2 > size) return false;
+    buffer[n++] = '}';
+    buffer[n] = '\0';
+    return true;
+}
+
+void Cmd_Trace_GetStats(Cmd_Trace_Stats_t* stats)
+{
+    if (stats == NULL) return;
+    portENTER_CRITICAL(&g_traceMux);
+    *stats = g_stats;
+    portEXIT_CRITICAL(&g_traceMux);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file cmd_trace.h
+ * @brief Correlation IDs and per-stage timing for dashboard commands
+ *
+ * @note A command carrying "@<id>" gets a trace slot when the MQTT callback
+ *       sees it. The handlers mark each stage with the esp_timer clock, and
+ *       Task_Mqtt publishes the acknowledgement (MQTT_TOPIC_CMD_ACK):
+ *
+ *         {"cid":"d41f","cmd":"led1","result":"ok","poll_gap_us":180250,
+ *          "lock_wait_us":35,"parse_us":41,"apply_us":388,"echo_us":5120,
+ *          "ack_us":5190}
+ *
+ *       Stage times count from the callback entry. poll_gap_us is the time
+ *       between the previous MQTT poll and the one that delivered the command,
+ *       an upper bound on how long it waited in the socket. lock_wait_us is
+ *       the wait for the client mutex before that poll. A stage that never
+ *       happened is omitted (no echo for thermostat commands; "apply" for them
+ *       is the fan control task acting on the new value).
+ */
+
+#ifndef CMD_TRACE_H
+#define CMD_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../app_cfg.h"
+
+#define CMD_TRACE_NONE  0           // "Not traced" handle; every call accepts it
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define CMD_TRACE_ENUM_CMD(id, name, topic)     CMD_TRACE_CMD_##id,
+typedef enum {
+    CMD_TRACE_CMD_TABLE(CMD_TRACE_ENUM_CMD)
+    CMD_TRACE_CMD_COUNT
+} Cmd_Trace_Cmd_t;
+#undef CMD_TRACE_ENUM_CMD
+
+typedef enum {
+    CMD_TRACE_OK = 0,
+    CMD_TRACE_INVALID,          // Payload did not parse
+    CMD_TRACE_DENIED,           // Refused by the rules / room mode
+    CMD_TRACE_TIMEOUT           // Not applied within CMD_TRACE_TIMEOUT_MS
+} Cmd_Trace_Result_t;
+
+typedef struct {
+    uint32_t traced;
+    uint32_t dropped;           ///< No free slot: command ran untraced
+    uint32_t timeouts;
+    uint32_t last_poll_gap_us;
+    uint32_t max_lock_wait_us;
+} Cmd_Trace_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Around every mqttClient.loop(): the poll gap and mutex wait are
+ *        attributed to the commands that poll delivers
+ */
+void Cmd_Trace_PollStart(uint32_t lock_wait_us);
+void Cmd_Trace_PollEnd(void);
+
+/**
+ * @brief Open a trace if the topic is traced and the payload carries an id
+ * @param message NUL-terminated payload; the "@<id>" suffix is cut off
+ * @return Handle for the other calls, or CMD_TRACE_NONE
+ */
+uint8_t Cmd_Trace_Begin(const char* topic, char* message);
+
+void Cmd_Trace_Parsed(uint8_t trace);
+void Cmd_Trace_Applied(uint8_t trace);
+
+/**
+ * @brief The fan control task acted on a thermostat command: completes every
+ *        open trace of that command type
+ */
+void Cmd_Trace_AppliedType(Cmd_Trace_Cmd_t cmd);
+
+/**
+ * @brief Close a trace: the status echo was published, or the command failed
+ * @note Commands that echo end here; the result is reported with the stages
+ *       reached so far
+ */
+void Cmd_Trace_Finish(uint8_t trace, Cmd_Trace_Result_t result);
+
+/**
+ * @brief Next acknowledgement JSON, oldest first (for MQTT_TOPIC_CMD_ACK)
+ */
+bool Cmd_Trace_TakeReport(char* buffer, uint16_t size);
+
+void Cmd_Trace_GetStats(Cmd_Trace_Stats_t* stats);
+
+#endif // CMD_TRACE_H
@@ -0,0 +1,404 @@
+#include <Arduino.h>
+#include "occupancy.h"
+#include "../../app_cfg.h"
+#include "../room/room_logic.h"
+#include "../room/room_gamma.h"
+#include "../thermostat/thermostat_fan_control.h"
+#include "../thermostat/thermostat_config.h"
+#include "../rules/rules.h"
+#include "esp_timer.h"
+
+#if OCCUPANCY_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+// ==================== PROFILES ====================
+
+typedef struct {
+    const char* name;
+    uint32_t    hold_ms;
+    float       setback_c;
+    bool        lights_off;
+    uint8_t     rate_div;
+} Occupancy_Profile_t;
+
+#define OCC_PROFILE_ROW(id, name, hold_ms, setback_c, lights_off, rate_div) \
+    { name, hold_ms, setback_c, lights_off, rate_div },
+
+static const Occupancy_Profile_t OCC_PROFILES[OCC_STATE_COUNT] = {
+    OCC_STATE_TABLE(OCC_PROFILE_ROW)
+};
+
+static_assert(OCC_STATE_OCCUPIED == 0, "OCCUPIED must be the first (comfort) row");
+
+// ==================== STATE ====================
+
+// Comfort settings saved on leaving OCCUPIED, and what the setback changed
+typedef struct {
+    Room_Mode_t       room_mode;
+    Thermostat_Mode_t thermo_mode;
+    float             target;
+    bool              lights_applied;
+    bool              thermo_applied;
+    bool              target_applied;
+    Thermostat_Mode_t applied_mode;
+    float             applied_target;
+    uint32_t          light_mw;         // Lights that were on when the room emptied
+    float             fan_duty_pct;     // Fan mean duty while occupied
+} Occupancy_Comfort_t;
+
+static portMUX_TYPE       g_occMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t  g_pendingEvidence = 0;
+static volatile bool      g_changed = false;
+static bool               g_precondition = false;   // Thermostat setback lifted for an arrival
+static TaskHandle_t       g_processor = NULL;
+
+static volatile Occupancy_State_t g_state = OCC_STATE_OCCUPIED;
+static Occupancy_Comfort_t g_comfort;
+static Occupancy_Stats_t   g_stats;
+
+static int64_t  g_stateSinceUs    = 0;
+static int64_t  g_lastActivityUs  = 0;
+static int64_t  g_lastTrendUs     = 0;
+static int64_t  g_lastAccountUs   = 0;
+static uint64_t g_occupiedMs      = 0;
+static uint64_t g_vacantMs        = 0;
+static uint64_t g_savedMwMs       = 0;
+
+// Weak evidence trackers
+static int16_t  g_lastLdr         = -1;
+static bool     g_lastDark        = false;
+static int16_t  g_tempMin         = 0;
+static int64_t  g_tempWindowUs    = 0;
+
+// ==================== INTERNAL ====================
+
+static void Occupancy_Account(int64_t now_us)
+{
+    uint32_t dt_ms = (uint32_t)((now_us - g_lastAccountUs) / 1000);
+    g_lastAccountUs = now_us;
+
+    if (g_state == OCC_STATE_OCCUPIED) {
+        g_occupiedMs += dt_ms;
+    } else {
+        g_vacantMs += dt_ms;
+
+        uint32_t mw = g_comfort.lights_applied ? g_comfort.light_mw : 0;
+        Fan_Control_Stats_t fan;
+        Thermostat_GetFanStats(&fan);
+        if (g_comfort.fan_duty_pct > fan.duty_pct) {
+            mw += (uint32_t)((g_comfort.fan_duty_pct - fan.duty_pct) * (OCC_FAN_POWER_MW / 100.0f));
+        }
+        g_savedMwMs += (uint64_t)mw * dt_ms;
+    }
+
+    portENTER_CRITICAL(&g_occMux);
+    g_stats.state = g_state;
+    g_stats.state_s = (uint32_t)((now_us - g_stateSinceUs) / 1000000);
+    g_stats.occupied_s = (uint32_t)(g_occupiedMs / 1000);
+    g_stats.vacant_s = (uint32_t)(g_vacantMs / 1000);
+    g_stats.saved_mwh = (uint32_t)(g_savedMwMs / 3600000ULL);
+    portEXIT_CRITICAL(&g_occMux);
+}
+
+/**
+ * @brief Light and temperature trends; only meaningful while occupied
+ */
+static bool Occupancy_CheckTrends(int64_t now_us)
+{
+    bool weak = false;
+
+    // A light jump with our own lights off is daylight/curtains, i.e. a person
+    int16_t ldr = Rules_GetInput(RULES_IN_LDR);
+    bool dark = (Room_Logic_GetMode() == ROOM_MODE_OFF) ||
+                (Room_Logic_GetLEDState(ROOM_LED_1) == ROOM_LED_OFF &&
+                 Room_Logic_GetLEDState(ROOM_LED_2) == ROOM_LED_OFF);
+    if (g_lastLdr >= 0 && dark && g_lastDark && abs(ldr - g_lastLdr) >= OCC_LDR_STEP_PCT) {
+        weak = true;
+    }
+    g_lastLdr = ldr;
+    g_lastDark = dark;
+
+    // A temperature rise over the window (0 = no reading yet)
+    int16_t temp = Rules_GetInput(RULES_IN_TEMP);
+    if (temp != 0) {
+        if (g_tempWindowUs == 0 || now_us - g_tempWindowUs >= (int64_t)OCC_TEMP_WINDOW_MS * 1000) {
+            g_tempWindowUs = now_us;
+            g_tempMin = temp;
+        } else if (temp < g_tempMin) {
+            g_tempMin = temp;
+        } else if (temp - g_tempMin >= OCC_TEMP_RISE_DECI) {
+            weak = true;
+            g_tempMin = temp;
+        }
+    }
+
+    return weak;
+}
+
+static void Occupancy_SaveComfort(void)
+{
+    g_comfort.room_mode = Room_Logic_GetMode();
+    g_comfort.thermo_mode = Thermostat_GetMode();
+    g_comfort.target = Thermostat_GetTargetTemp();
+    g_comfort.lights_applied = false;
+    g_comfort.thermo_applied = false;
+    g_comfort.target_applied = false;
+
+    g_comfort.light_mw = 0;
+    if (g_comfort.room_mode != ROOM_MODE_OFF) {
+        for (int led = 0; led < ROOM_LED_COUNT; led++) {
+            if (Room_Logic_GetLEDState((Room_LED_t)led) == ROOM_LED_ON) {
+                uint8_t level = Room_Logic_GetLEDBrightness((Room_LED_t)led);
+                g_comfort.light_mw += (uint32_t)((uint64_t)OCC_LIGHT_POWER_MW *
+                                      ROOM_GAMMA_DUTY[level] / ROOM_PWM_MAX_DUTY);
+            }
+        }
+    }
+
+    Fan_Control_Stats_t fan;
+    Thermostat_GetFanStats(&fan);
+    g_comfort.fan_duty_pct = fan.duty_avg_pct;
+}
+
+/**
+ * @brief Apply a setback profile relative to the saved comfort settings
+ */
+static void Occupancy_ApplySetback(const Occupancy_Profile_t* profile)
+{
+    if (profile->lights_off && Room_Logic_GetMode() != ROOM_MODE_OFF) {
+        Room_Logic_SetMode(ROOM_MODE_OFF);
+        g_comfort.lights_applied = true;
+    }
+
+    if (g_precondition || profile->setback_c <= 0.0f || g_comfort.thermo_mode == THERMOSTAT_MODE_OFF) {
+        return;
+    }
+
+    // A fixed manual speed would ignore the target; let the loop relax instead
+    if (Thermostat_GetMode() == THERMOSTAT_MODE_MANUAL) {
+        Thermostat_SetMode(THERMOSTAT_MODE_AUTO);
+        thermostatMqttModeEventSet();
+        g_comfort.thermo_applied = true;
+        g_comfort.applied_mode = THERMOSTAT_MODE_AUTO;
+    }
+
+    // Relax towards the room's current temperature: less demand either way
+    float temp = Rules_GetInput(RULES_IN_TEMP) / 10.0f;
+    float target = g_comfort.target + ((temp >= g_comfort.target) ? profile->setback_c : -profile->setback_c);
+    target = constrain(target, POT_TO_TEMP_MIN, POT_TO_TEMP_MAX);
+    if (Thermostat_SetTargetTemp(target)) {
+        thermostatMqttEventSet();
+    }
+    g_comfort.target_applied = true;
+    g_comfort.applied_target = target;
+}
+
+/**
+ * @brief Undo the setback, leaving anything changed meanwhile by someone else
+ */
+static void Occupancy_RestoreComfort(void)
+{
+    if (g_comfort.lights_applied && Room_Logic_GetMode() == ROOM_MODE_OFF) {
+        Room_Logic_SetMode(g_comfort.room_mode);
+    }
+    if (g_comfort.thermo_applied && Thermostat_GetMode() == g_comfort.applied_mode) {
+        Thermostat_SetMode(g_comfort.thermo_mode);
+        thermostatMqttModeEventSet();
+    }
+    if (g_comfort.target_applied && fabsf(Thermostat_GetTargetTemp() - g_comfort.applied_target) < 0.05f) {
+        if (Thermostat_SetTargetTemp(g_comfort.target)) {
+            thermostatMqttEventSet();
+        }
+    }
+    g_comfort.lights_applied = false;
+    g_comfort.thermo_applied = false;
+    g_comfort.target_applied = false;
+}
+
+static void Occupancy_Enter(Occupancy_State_t next, int64_t now_us)
+{
+    Occupancy_State_t prev = g_state;
+    if (next == prev) return;
+
+    if (prev == OCC_STATE_OCCUPIED) {
+        Occupancy_SaveComfort();
+    }
+
+    g_state = next;
+    g_stateSinceUs = now_us;
+
+    if (next == OCC_STATE_OCCUPIED) {
+        g_precondition = false;
+        Occupancy_RestoreComfort();
+        Rules_Post(RULES_EVT_OCCUPIED);
+    } else {
+        // Deeper profiles are applied on top of the same comfort baseline
+        Occupancy_ApplySetback(&OCC_PROFILES[next]);
+        if (prev == OCC_STATE_OCCUPIED) Rules_Post(RULES_EVT_VACANT);
+    }
+    Rules_SetInput(RULES_IN_OCCUPANCY, (int16_t)next);
+
+    portENTER_CRITICAL(&g_occMux);
+    g_stats.state = next;
+    g_stats.state_s = 0;
+    g_stats.transitions++;
+    portEXIT_CRITICAL(&g_occMux);
+    g_changed = true;
+
+    DEBUG_PRINTF("[OCC] %s -> %s\n", OCC_PROFILES[prev].name, OCC_PROFILES[next].name);
+}
+
+// ==================== PUBLIC API ====================
+
+void Occupancy_Init(TaskHandle_t processor)
+{
+    int64_t now = esp_timer_get_time();
+    g_stateSinceUs = now;
+    g_lastActivityUs = now;
+    g_lastTrendUs = now;
+    g_lastAccountUs = now;
+    g_state = OCC_STATE_OCCUPIED;
+    Rules_SetInput(RULES_IN_OCCUPANCY, OCC_STATE_OCCUPIED);
+
+    g_processor = processor;
+    if (g_processor != NULL) xTaskNotifyGive(g_processor);
+}
+
+void Occupancy_ReportActivity(Occupancy_Evidence_t evidence)
+{
+    portENTER_CRITICAL(&g_occMux);
+    g_pendingEvidence |= (1UL << evidence);
+    portEXIT_CRITICAL(&g_occMux);
+
+    // Only worth a wake-up when it changes something
+    if (g_state != OCC_STATE_OCCUPIED && g_processor != NULL) {
+        xTaskNotifyGive(g_processor);
+    }
+}
+
+void Occupancy_Process(void)
+{
+    if (g_processor == NULL) return;
+
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&g_occMux);
+    uint32_t evidence = g_pendingEvidence;
+    g_pendingEvidence = 0;
+    portEXIT_CRITICAL(&g_occMux);
+
+    Occupancy_Account(now);
+
+    if (evidence != 0) {
+        g_lastActivityUs = now;
+        if (g_state != OCC_STATE_OCCUPIED) {
+            DEBUG_PRINTF("[OCC] Activity (0x%02lx)\n", (unsigned long)evidence);
+            Occupancy_Enter(OCC_STATE_OCCUPIED, now);
+        }
+    }
+
+    if (now - g_lastTrendUs >= (int64_t)Occupancy_ScalePeriod(OCC_TREND_PERIOD_MS) * 1000) {
+        g_lastTrendUs = now;
+        if (Occupancy_CheckTrends(now) && g_state == OCC_STATE_OCCUPIED) {
+            g_lastActivityUs = now;
+        }
+    }
+
+    uint32_t hold_ms = OCC_PROFILES[g_state].hold_ms;
+    int64_t since = (g_lastActivityUs > g_stateSinceUs) ? g_lastActivityUs : g_stateSinceUs;
+    if (hold_ms != 0 && now - since >= (int64_t)hold_ms * 1000) {
+        Occupancy_Enter((Occupancy_State_t)(g_state + 1), now);
+    }
+}
+
+void Occupancy_BeginPrecondition(float target)
+{
+    if (g_state == OCC_STATE_OCCUPIED) return;     // Guest already in; comfort is theirs
+
+    // The new guest's comfort: AUTO at the scheduled setpoint
+    g_precondition = true;
+    g_comfort.thermo_mode = THERMOSTAT_MODE_AUTO;
+    g_comfort.target = target;
+    g_comfort.thermo_applied = false;
+    g_comfort.target_applied = false;
+
+    if (Thermostat_GetMode() != THERMOSTAT_MODE_AUTO) {
+        Thermostat_SetMode(THERMOSTAT_MODE_AUTO);
+        thermostatMqttModeEventSet();
+    }
+    if (Thermostat_SetTargetTemp(target)) {
+        thermostatMqttEventSet();
+    }
+    DEBUG_PRINTF("[OCC] Pre-conditioning to %.1f\n", target);
+}
+
+void Occupancy_EndPrecondition(void)
+{
+    if (!g_precondition) return;
+    g_precondition = false;
+    if (g_state != OCC_STATE_OCCUPIED) {
+        Occupancy_ApplySetback(&OCC_PROFILES[g_state]);
+    }
+}
+
+TickType_t Occupancy_WaitTicks(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t due = g_lastTrendUs + (int64_t)Occupancy_ScalePeriod(OCC_TREND_PERIOD_MS) * 1000;
+
+    uint32_t hold_ms = OCC_PROFILES[g_state].hold_ms;
+    if (hold_ms != 0) {
+        int64_t since = (g_lastActivityUs > g_stateSinceUs) ? g_lastActivityUs : g_stateSinceUs;
+        int64_t timeout = since + (int64_t)hold_ms * 1000;
+        if (timeout < due) due = timeout;
+    }
+
+    if (due <= now) return 1;
+    return pdMS_TO_TICKS((uint32_t)((due - now) / 1000)) + 1;
+}
+
+Occupancy_State_t Occupancy_GetState(void)
+{
+    return g_state;
+}
+
+const char* Occupancy_GetStateName(Occupancy_State_t state)
+{
+    return (state < OCC_STATE_COUNT) ? OCC_PROFILES[state].name : "unknown";
+}
+
+uint32_t Occupancy_ScalePeriod(uint32_t base_ms)
+{
+    return base_ms * OCC_PROFILES[g_state].rate_div;
+}
+
+void Occupancy_GetStats(Occupancy_Stats_t* stats)
+{
+    if (stats == NULL) return;
+    portENTER_CRITICAL(&g_occMux);
+    *stats = g_stats;
+    portEXIT_CRITICAL(&g_occMux);
+}
+
+int Occupancy_FormatReport(char* buffer, uint16_t size)
+{
+    Occupancy_Stats_t s;
+    Occupancy_GetStats(&s);
+    return snprintf(buffer, size,
+                    "{\"state\":\"%s\",\"state_s\":%lu,\"occupied_s\":%lu,\"vacant_s\":%lu,"
+                    "\"transitions\":%lu,\"saved_wh\":%lu.%03lu}",
+                    Occupancy_GetStateName(s.state),
+                    (unsigned long)s.state_s, (unsigned long)s.occupied_s, (unsigned long)s.vacant_s,
+                    (unsigned long)s.transitions,
+                    (unsigned long)(s.saved_mwh / 1000), (unsigned long)(s.saved_mwh % 1000));
+}
+
+bool Occupancy_TakeChange(void)
+{
+    if (!g_changed) return false;
+    g_changed = false;
+    return true;
+}
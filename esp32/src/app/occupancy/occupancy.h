@@ -0,0 +1,98 @@
+/**
+ * @file occupancy.h
+ * @brief Room occupancy state machine and energy setback
+ *
+ * @note Activity reports are cheap and safe from any task; they only set a
+ *       flag and wake the room control task. Occupancy_Process() runs there
+ *       with the room status mutex held and applies the setback profile of
+ *       the new state (occupancy_cfg.h): relaxed thermostat target, lights
+ *       OFF, longer sampling/publish periods. Comfort settings are restored
+ *       as soon as strong evidence arrives.
+ */
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "occupancy_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define OCC_ENUM_STATE(id, name, hold_ms, setback_c, lights_off, rate_div)  OCC_STATE_##id,
+typedef enum {
+    OCC_STATE_TABLE(OCC_ENUM_STATE)
+    OCC_STATE_COUNT
+} Occupancy_State_t;
+#undef OCC_ENUM_STATE
+
+typedef enum {
+    OCC_EVIDENCE_CARD = 0,      // RFID access granted
+    OCC_EVIDENCE_BUTTON,        // Room light button pressed
+    OCC_EVIDENCE_DIAL           // Target temperature dial turned
+} Occupancy_Evidence_t;
+
+typedef struct {
+    Occupancy_State_t state;
+    uint32_t state_s;           ///< Time in the current state
+    uint32_t occupied_s;        ///< Totals since boot
+    uint32_t vacant_s;          ///< All non-OCCUPIED states
+    uint32_t transitions;
+    uint32_t saved_mwh;         ///< Estimated lights + fan energy avoided
+} Occupancy_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Start OCCUPIED (comfort) and wake the given task for processing
+ */
+void Occupancy_Init(TaskHandle_t processor);
+
+/**
+ * @brief Strong evidence: someone is in the room
+ */
+void Occupancy_ReportActivity(Occupancy_Evidence_t evidence);
+
+/**
+ * @brief Check timeouts and trends, apply/restore setback profiles
+ * @note Room control task, room status mutex held
+ */
+void Occupancy_Process(void);
+
+/**
+ * @brief An arrival is due: lift the thermostat setback and make `target`
+ *        (in AUTO) the comfort setting the guest returns to. Lights keep
+ *        their setback. Ends on arrival or Occupancy_EndPrecondition().
+ * @note Room control task, room status mutex held
+ */
+void Occupancy_BeginPrecondition(float target);
+
+/**
+ * @brief No-show: put the current state's thermostat setback back
+ */
+void Occupancy_EndPrecondition(void);
+
+/**
+ * @brief How long the processor may sleep before Occupancy_Process() is due
+ */
+TickType_t Occupancy_WaitTicks(void);
+
+Occupancy_State_t Occupancy_GetState(void);
+const char* Occupancy_GetStateName(Occupancy_State_t state);
+
+/**
+ * @brief Sampling/publish period for the current state
+ * @param base_ms Period used while occupied
+ */
+uint32_t Occupancy_ScalePeriod(uint32_t base_ms);
+
+void Occupancy_GetStats(Occupancy_Stats_t* stats);
+int  Occupancy_FormatReport(char* buffer, uint16_t size);
+
+/**
+ * @brief True once after each state change (report it right away)
+ */
+bool Occupancy_TakeChange(void);
+
+#endif // OCCUPANCY_H
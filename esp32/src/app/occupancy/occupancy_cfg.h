@@ -0,0 +1,42 @@
+#ifndef OCCUPANCY_CFG_H
+#define OCCUPANCY_CFG_H
+
+/* =========================
+ * Occupancy / Energy Setback
+ * =========================
+ * Strong evidence (card granted, button press, target dial turned) makes
+ * the room OCCUPIED at once and restores comfort settings. Without it the
+ * room steps down the state table below once each state's hold time has
+ * passed. Weak evidence (light or temperature trends) only keeps an
+ * OCCUPIED room from timing out; it never wakes a vacant one.
+ */
+
+// Occupancy states and their setback profile:
+// X(id, name, hold_ms, setback_c, lights_off, rate_div)
+//   hold_ms    - time without activity before moving to the next row (0 = stay)
+//   setback_c  - how far the thermostat target is relaxed from the comfort value
+//   lights_off - switch the room lights to OFF
+//   rate_div   - sampling/publish periods are multiplied by this
+//
+// VACANT keeps the lights: with a room light on the weak evidence is
+// blind (the LDR step needs our lights off), so a guest reading quietly
+// times out of OCCUPIED. Only the thermostat is relaxed then; the lights go
+// off once nothing has happened for the VACANT hold as well (AWAY).
+#define OCC_STATE_TABLE(X) \
+    X(OCCUPIED, "occupied", 30UL * 60 * 1000,       0.0f,   false,  1)  \
+    X(VACANT,   "vacant",   6UL * 60 * 60 * 1000,   2.0f,   false,  4)  \
+    X(AWAY,     "away",     0,                      4.0f,   true,   8)
+
+// Weak evidence, checked every OCC_TREND_PERIOD_MS (scaled by rate_div)
+#define OCC_TREND_PERIOD_MS         60000
+#define OCC_LDR_STEP_PCT            15      // Light jump with the room lights off (curtains)
+#define OCC_TEMP_RISE_DECI          5       // 0.5 °C rise over OCC_TEMP_WINDOW_MS (body heat, shower)
+#define OCC_TEMP_WINDOW_MS          (10UL * 60 * 1000)
+
+// Modelled loads for the energy estimate
+#define OCC_LIGHT_POWER_MW          9000    // One room light at full duty
+#define OCC_FAN_POWER_MW            40000   // Fan at 100 % duty
+
+#define OCC_REPORT_INTERVAL_MS      300000
+
+#endif // OCCUPANCY_CFG_H
@@ -12,26 +12,43 @@
 // Hardware Pin Configuration
 #define ROOM_LED1_PIN           25
 #define ROOM_LED2_PIN           26
-#define ROOM_BUTTON1_PIN        18
-#define ROOM_BUTTON2_PIN        19
+#define ROOM_BUTTON1_PIN        27    // Buttons are low-level wake sources: keep them
+#define ROOM_BUTTON2_PIN        15    // off bus pins that idle or toggle low (SPI 18/19/23)
 #define ACCESS_CONTROL          29
 
+#if (SPI_ENABLED == STD_ON) && \
+    (ROOM_BUTTON1_PIN == SPI_SCK_PIN || ROOM_BUTTON1_PIN == SPI_MISO_PIN || ROOM_BUTTON1_PIN == SPI_MOSI_PIN || \
+     ROOM_BUTTON2_PIN == SPI_SCK_PIN || ROOM_BUTTON2_PIN == SPI_MISO_PIN || ROOM_BUTTON2_PIN == SPI_MOSI_PIN)
+    #error "Room buttons share a pin with the SPI bus"
+#endif
+// The discrete fan speed LEDs (thermostat_config.h) are checked in
+// thermostat_fan_control.cpp, where both configs are visible
+
 // PWM Configuration
 #define ROOM_PWM_CHANNEL_LED1   0
 #define ROOM_PWM_CHANNEL_LED2   1
 #define ROOM_PWM_FREQUENCY      5000
-#define ROOM_PWM_RESOLUTION     8
+#define ROOM_PWM_RESOLUTION     12    // 5 kHz leaves 13 bits; 12 resolves the dark end of the gamma curve
 
 // Auto-dimming thresholds
 #define ROOM_LIGHT_THRESHOLD_LOW    30  // Below this: full brightness
 #define ROOM_LIGHT_THRESHOLD_HIGH   70  // Above this: dimmed
-#define ROOM_BRIGHTNESS_MAX         255
-#define ROOM_BRIGHTNESS_MIN         51  // 20% of 255
+#define ROOM_BRIGHTNESS_MAX         255 // Brightness levels are perceptual (CIE L*), see room_gamma.h
+#define ROOM_BRIGHTNESS_MIN         51  // 20% perceived lightness
+#define ROOM_BRIGHTNESS_DEADBAND    3   // AUTO ignores target moves smaller than this
 
 // Timing Configuration
 #define ROOM_BUTTON_DEBOUNCE_MS     200
+#define ROOM_BUTTON_POLL_MS         50    // Poll period while a button is held
 #define ROOM_MQTT_PUBLISH_INTERVAL  2000  // Publish LDR every 2 seconds
-#define ROOM_LED_UPDATE_INTERVAL    100   // Update LED brightness every 100ms
+#define ROOM_FADE_AUTO_MS           1500  // Hardware fade to a new AUTO level
+#define ROOM_FADE_SWITCH_MS         300   // Fade for on/off and mode changes
+
+// Status reporting (room_report.h)
+#define ROOM_REPORT_QUIET_MS        80    // Publish once changes stop for this long
+#define ROOM_REPORT_MAX_LATENCY_MS  250   // ...or at the latest this long after the first
+#define ROOM_REPORT_RETRY_MS        1000  // Next attempt after a failed publish
+#define ROOM_REPORT_LEGACY_TOPICS   STD_OFF // Also publish room/mode/status, room/ledN/status
 
 // Debug Configuration
 #define ROOM_DEBUG_ENABLED          STD_ON
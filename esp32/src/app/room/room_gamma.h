@@ -0,0 +1,58 @@
+/**
+ * @file room_gamma.h
+ * @brief Compile-time CIE 1931 lightness table for the room dimmers
+ *
+ * @note Brightness levels (0..ROOM_BRIGHTNESS_MAX) are perceptual: level
+ *       steps of equal size look equally large. ROOM_GAMMA_DUTY[] maps a level
+ *       to the LEDC duty at ROOM_PWM_RESOLUTION. The table is generated by the
+ *       compiler and lives in flash; nothing runs at boot.
+ */
+
+#ifndef ROOM_GAMMA_H
+#define ROOM_GAMMA_H
+
+#include <stdint.h>
+#include "room_config.h"
+
+#define ROOM_PWM_MAX_DUTY   ((1UL << ROOM_PWM_RESOLUTION) - 1)
+
+/**
+ * @brief Relative luminance Y (0..1) for CIE lightness L* (0..100)
+ */
+static constexpr float Room_CieLuminance(float lightness)
+{
+    return (lightness <= 8.0f) ? lightness / 902.3f :
+           ((lightness + 16.0f) / 116.0f) * ((lightness + 16.0f) / 116.0f) * ((lightness + 16.0f) / 116.0f);
+}
+
+static constexpr uint16_t Room_GammaDuty(uint32_t level)
+{
+    return (uint16_t)(Room_CieLuminance(level * 100.0f / ROOM_BRIGHTNESS_MAX) * ROOM_PWM_MAX_DUTY + 0.5f);
+}
+
+// C++11 has no std::index_sequence; expand 0..N-1 by hand
+template <uint32_t... Level>
+struct Room_GammaTable {
+    static constexpr uint16_t duty[sizeof...(Level)] = { Room_GammaDuty(Level)... };
+};
+
+template <uint32_t... Level>
+constexpr uint16_t Room_GammaTable<Level...>::duty[sizeof...(Level)];
+
+template <uint32_t N, uint32_t... Level>
+struct Room_GammaBuild : Room_GammaBuild<N - 1, N - 1, Level...> {};
+
+template <uint32_t... Level>
+struct Room_GammaBuild<0, Level...> {
+    typedef Room_GammaTable<Level...> type;
+};
+
+typedef Room_GammaBuild<ROOM_BRIGHTNESS_MAX + 1>::type Room_Gamma_t;
+
+#define ROOM_GAMMA_DUTY     Room_Gamma_t::duty
+
+static_assert(Room_Gamma_t::duty[0] == 0, "Level 0 must be fully off");
+static_assert(Room_Gamma_t::duty[ROOM_BRIGHTNESS_MAX] == ROOM_PWM_MAX_DUTY, "Top level must be full duty");
+static_assert(Room_Gamma_t::duty[1] > 0, "PWM resolution too low for the first level");
+
+#endif // ROOM_GAMMA_H
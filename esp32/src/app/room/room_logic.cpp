@@ -3,19 +3,21 @@
 #include "../../hal/hal_pwm/hal_pwm.h"
 #include "../../hal/hal_led/hal_led.h"
 #include "../../hal/sensors/hal_ldr/hal_ldr.h"
+#include "room_gamma.h"
+#include "room_report.h"
 #include "../../drivers/driver_gpio/driver_gpio.h"
+#include "../rules/rules.h"
+#include "../occupancy/occupancy.h"
 #include <string.h>
 
 // Internal state
 static Room_Status_t room_status;
 static unsigned long button1_last_press = 0;
 static unsigned long button2_last_press = 0;
-static unsigned long last_brightness_update = 0;
 
 // Internal function prototypes
-static void Room_Logic_SetBrightness(Room_LED_t led, uint8_t brightness);
 static uint8_t Room_Logic_CalculateBrightness(uint16_t light_percentage);
-static void Room_Logic_ApplyLEDState(Room_LED_t led);
+static void Room_Logic_ApplyLEDState(Room_LED_t led, uint32_t fade_ms);
 static void Room_Logic_TurnOffAllLEDs(void);
 static Room_LED_State_t Room_Logic_ParseLEDState(const char* payload);
 static Room_Mode_t Room_Logic_ParseMode(const char* payload);
@@ -33,7 +35,9 @@ void Room_Logic_Init(void)
     room_status.led2_brightness = ROOM_BRIGHTNESS_MAX;
     room_status.ldr_raw_value = 0;
     room_status.ldr_percentage = 0;
+    room_status.ldr_lux = 0;
     room_status.mqtt_connected = false;
+    Rules_SetInput(RULES_IN_ROOM_MODE, (int16_t)room_status.mode);
     
     // Initialize LEDs (basic GPIO init)
     LED_init(ROOM_LED1_PIN);
@@ -61,6 +65,7 @@ void Room_Logic_SetMode(Room_Mode_t mode)
 {
     Room_Mode_t old_mode = room_status.mode;
     room_status.mode = mode;
+    Rules_SetInput(RULES_IN_ROOM_MODE, (int16_t)mode);
     
     ROOM_DEBUG_PRINT("Mode changed: ");
     ROOM_DEBUG_PRINT(old_mode == ROOM_MODE_OFF ? "OFF" : 
@@ -81,19 +86,28 @@ void Room_Logic_SetMode(Room_Mode_t mode)
             // Keep current LED states, set brightness to max
             room_status.led1_brightness = ROOM_BRIGHTNESS_MAX;
             room_status.led2_brightness = ROOM_BRIGHTNESS_MAX;
-            Room_Logic_ApplyLEDState(ROOM_LED_1);
-            Room_Logic_ApplyLEDState(ROOM_LED_2);
+            Room_Logic_ApplyLEDState(ROOM_LED_1, ROOM_FADE_SWITCH_MS);
+            Room_Logic_ApplyLEDState(ROOM_LED_2, ROOM_FADE_SWITCH_MS);
             ROOM_DEBUG_PRINTLN("[MODE] Manual control enabled");
             break;
             
-        case ROOM_MODE_AUTO:
-            // Turn on both LEDs and let auto-dimming handle brightness
+        case ROOM_MODE_AUTO: {
+            // Both LEDs on at the LDR level, driven here: UpdateAutoMode()
+            // only reacts to a new level and would see nothing to do
+            uint8_t brightness = Room_Logic_CalculateBrightness(room_status.ldr_percentage);
+            room_status.led1_brightness = brightness;
+            room_status.led2_brightness = brightness;
             room_status.led1_state = ROOM_LED_ON;
             room_status.led2_state = ROOM_LED_ON;
-            Room_Logic_UpdateAutoMode();  // Immediately update brightness
+            Room_Logic_ApplyLEDState(ROOM_LED_1, ROOM_FADE_SWITCH_MS);
+            Room_Logic_ApplyLEDState(ROOM_LED_2, ROOM_FADE_SWITCH_MS);
             ROOM_DEBUG_PRINTLN("[MODE] Auto control enabled");
             break;
+        }
     }
+    
+    // Mode changes can switch the lights too
+    Room_Report_MarkDirty(ROOM_REPORT_ALL);
 }
 
 Room_Mode_t Room_Logic_GetMode(void)
@@ -125,6 +139,7 @@ void Room_Logic_SetLED(Room_LED_t led, Room_LED_State_t state, Room_ControlSourc
         return;
     }
     
+    // AUTO owns the lights; rules switch modes rather than fight it
     if (room_status.mode == ROOM_MODE_AUTO && source != ROOM_CONTROL_AUTO) {
         ROOM_DEBUG_PRINTLN("[LED] Cannot control - System is in AUTO mode");
         return;
@@ -151,22 +166,19 @@ void Room_Logic_SetLED(Room_LED_t led, Room_LED_State_t state, Room_ControlSourc
         case ROOM_CONTROL_AUTO:
             ROOM_DEBUG_PRINTLN("AUTO");
             break;
+        case ROOM_CONTROL_RULE:
+            ROOM_DEBUG_PRINTLN("RULE");
+            break;
     }
     
-    Room_Logic_ApplyLEDState(led);
+    Room_Logic_ApplyLEDState(led, ROOM_FADE_SWITCH_MS);
+    Room_Report_MarkDirty(ROOM_REPORT_LED(led));
 }
 
 void Room_Logic_ToggleLED(Room_LED_t led, Room_ControlSource_t source)
 {
     if (led >= ROOM_LED_COUNT) return;
     
-    // Check if mode allows manual control
-    if (room_status.mode != ROOM_MODE_MANUAL) {
-        ROOM_DEBUG_PRINT("[LED] Cannot toggle - Mode is ");
-        ROOM_DEBUG_PRINTLN(Room_Logic_GetModeString());
-        return;
-    }
-    
     Room_LED_State_t current_state = (led == ROOM_LED_1) ? 
         room_status.led1_state : room_status.led2_state;
     
@@ -222,18 +234,12 @@ void Room_Logic_UpdateAutoMode(void)
         return;
     }
     
-    // Throttle updates
-    unsigned long current_time = millis();
-    if (current_time - last_brightness_update < ROOM_LED_UPDATE_INTERVAL) {
-        return;
-    }
-    last_brightness_update = current_time;
-    
-    // Calculate new brightness based on LDR
+    // Target from the (median + EMA filtered) LDR; the LEDC fades to it in
+    // hardware, so nothing here has to run again until the target moves
     uint8_t new_brightness = Room_Logic_CalculateBrightness(room_status.ldr_percentage);
+    bool lit = (room_status.led1_state == ROOM_LED_ON && room_status.led2_state == ROOM_LED_ON);
     
-    // Update if changed
-    if (new_brightness != room_status.led1_brightness) {
+    if (!lit || new_brightness != room_status.led1_brightness) {
         room_status.led1_brightness = new_brightness;
         room_status.led2_brightness = new_brightness;
         
@@ -241,25 +247,33 @@ void Room_Logic_UpdateAutoMode(void)
         room_status.led1_state = ROOM_LED_ON;
         room_status.led2_state = ROOM_LED_ON;
         
-        Room_Logic_ApplyLEDState(ROOM_LED_1);
-        Room_Logic_ApplyLEDState(ROOM_LED_2);
+        Room_Logic_ApplyLEDState(ROOM_LED_1, lit ? ROOM_FADE_AUTO_MS : ROOM_FADE_SWITCH_MS);
+        Room_Logic_ApplyLEDState(ROOM_LED_2, lit ? ROOM_FADE_AUTO_MS : ROOM_FADE_SWITCH_MS);
         
-        ROOM_DEBUG_PRINT("[AUTO] Brightness updated to: ");
-        ROOM_DEBUG_PRINT((new_brightness * 100) / 255);
+        ROOM_DEBUG_PRINT("[AUTO] Brightness fading to: ");
+        ROOM_DEBUG_PRINT((new_brightness * 100) / ROOM_BRIGHTNESS_MAX);
         ROOM_DEBUG_PRINT("% (LDR: ");
         ROOM_DEBUG_PRINT(room_status.ldr_percentage);
         ROOM_DEBUG_PRINTLN("%)");
     }
 }
 
-void Room_Logic_UpdateLDR(void)
+bool Room_Logic_UpdateLDR(void)
 {
-    // Call HAL main function
-    LDR_1_main();
-    
+    // Sampled by the sensor registry after every ADC burst
     // Update status
    // room_status.ldr_raw_value = LDR_1_getRawValue();
     room_status.ldr_percentage = LDR_1_getLightPercentage();
+    room_status.ldr_lux = (uint32_t)LDR_1_calculateLux();
+    Rules_SetInput(RULES_IN_LDR, (int16_t)room_status.ldr_percentage);
+
+    if (room_status.mode != ROOM_MODE_AUTO) {
+        return false;
+    }
+
+    int delta = (int)Room_Logic_CalculateBrightness(room_status.ldr_percentage) -
+                (int)room_status.led1_brightness;
+    return (delta >= ROOM_BRIGHTNESS_DEADBAND || delta <= -ROOM_BRIGHTNESS_DEADBAND);
 }
 
 uint16_t Room_Logic_GetLDRRaw(void)
@@ -267,6 +281,11 @@ uint16_t Room_Logic_GetLDRRaw(void)
     return room_status.ldr_raw_value;
 }
 
+uint32_t Room_Logic_GetLDRLux(void)
+{
+    return room_status.ldr_lux;
+}
+
 uint16_t Room_Logic_GetLDRPercentage(void)
 {
     return room_status.ldr_percentage;
@@ -274,15 +293,32 @@ uint16_t Room_Logic_GetLDRPercentage(void)
 
 void Room_Logic_ProcessButtons(void)
 {
-    // Buttons only work in MANUAL mode
-    if (room_status.mode != ROOM_MODE_MANUAL) {
+    static int button1_last_level = HIGH;
+    static int button2_last_level = HIGH;
+
+    int button1_level = digitalRead(ROOM_BUTTON1_PIN);
+    int button2_level = digitalRead(ROOM_BUTTON2_PIN);
+    bool button1_pressed = (button1_level == LOW && button1_last_level == HIGH);
+    bool button2_pressed = (button2_level == LOW && button2_last_level == HIGH);
+    button1_last_level = button1_level;
+    button2_last_level = button2_level;
+
+    if (!(button1_pressed || button2_pressed)) {
+        return;
+    }
+
+    // A press means someone is in the room, even if the rules ignore it
+    Occupancy_ReportActivity(OCC_EVIDENCE_BUTTON);
+
+    // Whether buttons act is up to the rules (MANUAL mode only by default)
+    if (!Rules_Check(RULES_EVT_BUTTON)) {
         return;
     }
     
     unsigned long current_time = millis();
     
-    // Button 1 - LED1 control
-    if (digitalRead(ROOM_BUTTON1_PIN) == LOW) {
+    // Button 1 - LED1 control (toggle on press, not while held)
+    if (button1_pressed) {
         if (current_time - button1_last_press > ROOM_BUTTON_DEBOUNCE_MS) {
             button1_last_press = current_time;
             Room_Logic_ToggleLED(ROOM_LED_1, ROOM_CONTROL_BUTTON);
@@ -290,7 +326,7 @@ void Room_Logic_ProcessButtons(void)
     }
     
     // Button 2 - LED2 control
-    if (digitalRead(ROOM_BUTTON2_PIN) == LOW) {
+    if (button2_pressed) {
         if (current_time - button2_last_press > ROOM_BUTTON_DEBOUNCE_MS) {
             button2_last_press = current_time;
             Room_Logic_ToggleLED(ROOM_LED_2, ROOM_CONTROL_BUTTON);
@@ -317,10 +353,10 @@ void Room_Logic_ProcessMQTTMessage(const char* topic, const char* payload)
             ROOM_DEBUG_PRINTLN(payload);
         }
     }
-    // LED1 Control - Only works in MANUAL mode
+    // LED1 Control - Allowed by the rules (MANUAL mode only by default)
     else if (strcmp(topic, ROOM_TOPIC_LED1_CTRL) == 0) {
-        if (room_status.mode != ROOM_MODE_MANUAL) {
-            ROOM_DEBUG_PRINT("[MQTT] Cannot control LED1 - Mode is ");
+        if (!Rules_Check(RULES_EVT_LED_CMD)) {
+            ROOM_DEBUG_PRINT("[MQTT] LED1 command denied - Mode is ");
             ROOM_DEBUG_PRINTLN(Room_Logic_GetModeString());
             return;
         }
@@ -334,10 +370,10 @@ void Room_Logic_ProcessMQTTMessage(const char* topic, const char* payload)
             ROOM_DEBUG_PRINTLN(payload);
         }
     }
-    // LED2 Control - Only works in MANUAL mode
+    // LED2 Control - Allowed by the rules (MANUAL mode only by default)
     else if (strcmp(topic, ROOM_TOPIC_LED2_CTRL) == 0) {
-        if (room_status.mode != ROOM_MODE_MANUAL) {
-            ROOM_DEBUG_PRINT("[MQTT] Cannot control LED2 - Mode is ");
+        if (!Rules_Check(RULES_EVT_LED_CMD)) {
+            ROOM_DEBUG_PRINT("[MQTT] LED2 command denied - Mode is ");
             ROOM_DEBUG_PRINTLN(Room_Logic_GetModeString());
             return;
         }
@@ -385,16 +421,22 @@ static void Room_Logic_TurnOffAllLEDs(void)
 {
     room_status.led1_state = ROOM_LED_OFF;
     room_status.led2_state = ROOM_LED_OFF;
-    PWM_Write(ROOM_PWM_CHANNEL_LED1, 0);
-    PWM_Write(ROOM_PWM_CHANNEL_LED2, 0);
+    Rules_SetInput(RULES_IN_LED1, ROOM_LED_OFF);
+    Rules_SetInput(RULES_IN_LED2, ROOM_LED_OFF);
+    PWM_FadeTo(ROOM_PWM_CHANNEL_LED1, 0, ROOM_FADE_SWITCH_MS);
+    PWM_FadeTo(ROOM_PWM_CHANNEL_LED2, 0, ROOM_FADE_SWITCH_MS);
 }
 
-static void Room_Logic_ApplyLEDState(Room_LED_t led)
+/**
+ * @brief Fade one LED to its state/brightness through the gamma table
+ * @param fade_ms Hardware fade time, 0 for an immediate change
+ */
+static void Room_Logic_ApplyLEDState(Room_LED_t led, uint32_t fade_ms)
 {
     // Don't apply if mode is OFF
     if (room_status.mode == ROOM_MODE_OFF) {
-        PWM_Write(ROOM_PWM_CHANNEL_LED1, 0);
-        PWM_Write(ROOM_PWM_CHANNEL_LED2, 0);
+        PWM_FadeTo(ROOM_PWM_CHANNEL_LED1, 0, fade_ms);
+        PWM_FadeTo(ROOM_PWM_CHANNEL_LED2, 0, fade_ms);
         return;
     }
     
@@ -407,10 +449,12 @@ static void Room_Logic_ApplyLEDState(Room_LED_t led)
     uint8_t brightness = (led == ROOM_LED_1) ? 
         room_status.led1_brightness : room_status.led2_brightness;
     
+    Rules_SetInput((led == ROOM_LED_1) ? RULES_IN_LED1 : RULES_IN_LED2, (int16_t)state);
+    
     if (state == ROOM_LED_ON) {
-        PWM_Write(pwm_channel, brightness);
+        PWM_FadeTo(pwm_channel, ROOM_GAMMA_DUTY[brightness], fade_ms);
     } else {
-        PWM_Write(pwm_channel, 0);
+        PWM_FadeTo(pwm_channel, 0, fade_ms);
     }
 }
 
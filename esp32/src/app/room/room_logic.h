@@ -12,7 +12,7 @@ void Room_Logic_SetMode(Room_Mode_t mode);
 Room_Mode_t Room_Logic_GetMode(void);
 const char* Room_Logic_GetModeString(void);
 
-// LED Control (only works in MANUAL mode)
+// LED Control (never in OFF mode; commands are gated by the rules)
 void Room_Logic_SetLED(Room_LED_t led, Room_LED_State_t state, Room_ControlSource_t source);
 void Room_Logic_ToggleLED(Room_LED_t led, Room_ControlSource_t source);
 Room_LED_State_t Room_Logic_GetLEDState(Room_LED_t led);
@@ -26,10 +26,11 @@ void Room_Logic_UpdateAutoDimming(void);
 // Auto Mode Control
 void Room_Logic_UpdateAutoMode(void);
 
-// LDR Processing
-void Room_Logic_UpdateLDR(void);
+// LDR Processing (returns true when the AUTO brightness target moved)
+bool Room_Logic_UpdateLDR(void);
 uint16_t Room_Logic_GetLDRRaw(void);
 uint16_t Room_Logic_GetLDRPercentage(void);
+uint32_t Room_Logic_GetLDRLux(void);
 
 // Button Processing
 void Room_Logic_ProcessButtons(void);
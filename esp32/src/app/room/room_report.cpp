@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include <string.h>
+#include "room_report.h"
+#include "room_config.h"
+#include "room_logic.h"
+#include "../../hal/communication/hal_mqtt/hal_mqtt.h"
+
+// ==================== STATIC VARIABLES ====================
+
+static portMUX_TYPE g_reportMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t  g_dirty = 0;
+static uint32_t g_firstMarkMs = 0;      // Oldest unpublished change
+static uint32_t g_lastMarkMs = 0;       // Newest change (quiet window)
+static uint32_t g_retryAtMs = 0;        // After a failed publish
+static bool     g_retry = false;
+static uint8_t  g_traces[CMD_TRACE_SLOTS];
+static uint8_t  g_traceCount = 0;
+static SemaphoreHandle_t g_wake = NULL;
+static Room_Report_Stats_t g_stats;
+
+// ==================== HELPER FUNCTIONS ====================
+
+/**
+ * @brief Time left until the pending status is due, 0 if due now
+ * @note Caller holds g_reportMux and g_dirty != 0
+ */
+static uint32_t Room_Report_DueInMs(uint32_t now)
+{
+    if (g_retry) {
+        int32_t retry = (int32_t)(g_retryAtMs - now);
+        if (retry > 0) return (uint32_t)retry;
+    }
+
+    uint32_t quiet = now - g_lastMarkMs;
+    uint32_t age = now - g_firstMarkMs;
+    if (quiet >= ROOM_REPORT_QUIET_MS || age >= ROOM_REPORT_MAX_LATENCY_MS) return 0;
+
+    uint32_t to_quiet = ROOM_REPORT_QUIET_MS - quiet;
+    uint32_t to_deadline = ROOM_REPORT_MAX_LATENCY_MS - age;
+    return (to_quiet < to_deadline) ? to_quiet : to_deadline;
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void Room_Report_SetWake(SemaphoreHandle_t wake)
+{
+    g_wake = wake;
+}
+
+void Room_Report_MarkDirty(uint8_t fields, uint8_t trace)
+{
+    uint32_t now = millis();
+    bool first = false;
+
+    portENTER_CRITICAL(&g_reportMux);
+    if (g_dirty == 0 && (fields & ROOM_REPORT_ALL) != 0) {
+        g_firstMarkMs = now;
+        first = true;
+    }
+    g_dirty |= (fields & ROOM_REPORT_ALL);
+    g_lastMarkMs = now;
+    // A full list only loses the echo stage; the trace times out instead
+    if (trace != CMD_TRACE_NONE && g_traceCount < CMD_TRACE_SLOTS) {
+        g_traces[g_traceCount++] = trace;
+    }
+    g_stats.marks++;
+    portEXIT_CRITICAL(&g_reportMux);
+
+    if (first && g_wake != NULL) xSemaphoreGive(g_wake);
+}
+
+uint32_t Room_Report_WaitMs(uint32_t limit_ms)
+{
+    uint32_t wait = limit_ms;
+
+    portENTER_CRITICAL(&g_reportMux);
+    if (g_dirty != 0) {
+        uint32_t due = Room_Report_DueInMs(millis());
+        if (due < wait) wait = due;
+    }
+    portEXIT_CRITICAL(&g_reportMux);
+    return wait;
+}
+
+bool Room_Report_Flush(void)
+{
+    uint8_t dirty = 0;
+    uint8_t traces[CMD_TRACE_SLOTS];
+    uint8_t trace_count = 0;
+    uint32_t first_ms = 0;
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&g_reportMux);
+    if (g_dirty != 0 && Room_Report_DueInMs(now) == 0) {
+        dirty = g_dirty;
+        first_ms = g_firstMarkMs;
+        trace_count = g_traceCount;
+        memcpy(traces, g_traces, trace_count);
+        g_dirty = 0;
+        g_traceCount = 0;
+    }
+    portEXIT_CRITICAL(&g_reportMux);
+
+    if (dirty == 0) return false;
+
+    // State read after the last change it reports; a change racing this
+    // read marks the fields again and goes out with the next flush
+    const char* led1 = (Room_Logic_GetLEDState(ROOM_LED_1) == ROOM_LED_ON) ? "ON" : "OFF";
+    const char* led2 = (Room_Logic_GetLEDState(ROOM_LED_2) == ROOM_LED_ON) ? "ON" : "OFF";
+    char payload[64];
+    snprintf(payload, sizeof(payload), "{\"mode\":\"%s\",\"led1\":\"%s\",\"led2\":\"%s\"}",
+             Room_Logic_GetModeString(), led1, led2);
+    if (!MQTT_Publish(ROOM_TOPIC_STATUS, payload)) {
+        // Not sent: put the fields and traces back (ahead of any newer
+        // ones) and try again after ROOM_REPORT_RETRY_MS
+        portENTER_CRITICAL(&g_reportMux);
+        g_dirty |= dirty;
+        g_firstMarkMs = first_ms;
+        g_retryAtMs = now + ROOM_REPORT_RETRY_MS;
+        g_retry = true;
+        uint8_t keep = g_traceCount;
+        if (keep > CMD_TRACE_SLOTS - trace_count) keep = CMD_TRACE_SLOTS - trace_count;
+        memmove(g_traces + trace_count, g_traces, keep);
+        memcpy(g_traces, traces, trace_count);
+        g_traceCount = trace_count + keep;
+        portEXIT_CRITICAL(&g_reportMux);
+        return false;
+    }
+
+    portENTER_CRITICAL(&g_reportMux);
+    if (now - first_ms > g_stats.latency_max_ms) g_stats.latency_max_ms = now - first_ms;
+    g_stats.flushes++;
+    g_retry = false;
+    portEXIT_CRITICAL(&g_reportMux);
+
+#if ROOM_REPORT_LEGACY_TOPICS == STD_ON
+    // One message per changed value for subscribers of the old status topics
+    if (dirty & ROOM_REPORT_MODE) MQTT_Publish(ROOM_TOPIC_MODE_STATUS, Room_Logic_GetModeString());
+    if (dirty & ROOM_REPORT_LED1) MQTT_Publish(ROOM_TOPIC_LED1_STATUS, led1);
+    if (dirty & ROOM_REPORT_LED2) MQTT_Publish(ROOM_TOPIC_LED2_STATUS, led2);
+#endif
+
+    for (uint8_t i = 0; i < trace_count; i++) {
+        Cmd_Trace_Finish(traces[i], CMD_TRACE_OK);
+    }
+
+    ROOM_DEBUG_PRINT("Status: ");
+    ROOM_DEBUG_PRINTLN(payload);
+    return true;
+}
+
+void Room_Report_GetStats(Room_Report_Stats_t* stats)
+{
+    if (stats == NULL) return;
+    portENTER_CRITICAL(&g_reportMux);
+    *stats = g_stats;
+    portEXIT_CRITICAL(&g_reportMux);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file room_report.h
+ * @brief Coalescing room status reporter
+ *
+ * @note Room state changes only mark fields dirty; that is a few
+ *       instructions under a spinlock and safe with room_status_mutex held.
+ *       The MQTT task flushes one status message once the changes have been
+ *       quiet for ROOM_REPORT_QUIET_MS, or ROOM_REPORT_MAX_LATENCY_MS after
+ *       the first one, whichever comes first, so a mode change plus its LED
+ *       updates or a run of button presses costs one publish.
+ *
+ *       The message always carries the whole room status:
+ *         {"mode":"MANUAL","led1":"ON","led2":"OFF"}
+ */
+
+#ifndef ROOM_REPORT_H
+#define ROOM_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "room_types.h"
+#include "../cmd_trace/cmd_trace.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef enum {
+    ROOM_REPORT_MODE = 0x01,
+    ROOM_REPORT_LED1 = 0x02,
+    ROOM_REPORT_LED2 = 0x04,
+    ROOM_REPORT_ALL  = 0x07
+} Room_ReportField_t;
+
+#define ROOM_REPORT_LED(led)    ((uint8_t)(ROOM_REPORT_LED1 << (led)))
+
+typedef struct {
+    uint32_t marks;             ///< Changes reported by the room logic and handlers
+    uint32_t flushes;           ///< Status messages published
+    uint32_t latency_max_ms;    ///< Longest first change -> publish
+} Room_Report_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Task to wake when the status goes from clean to dirty
+ * @note Given on that transition only, so the MQTT task can recompute its
+ *       wait (Room_Report_WaitMs()) instead of sleeping through the window
+ */
+void Room_Report_SetWake(SemaphoreHandle_t wake);
+
+/**
+ * @brief Mark fields as changed (any task, any lock held)
+ * @param trace Command the next status message confirms (Cmd_Trace); its
+ *              trace closes when that message is published
+ */
+void Room_Report_MarkDirty(uint8_t fields, uint8_t trace = CMD_TRACE_NONE);
+
+/**
+ * @brief Milliseconds until a flush is due, capped at limit_ms
+ * @note Lets the MQTT task shorten its wait while a status is pending
+ */
+uint32_t Room_Report_WaitMs(uint32_t limit_ms);
+
+/**
+ * @brief Publish the coalesced status if it is due
+ * @note MQTT task only; takes no room lock. If the publish fails the
+ *       fields stay dirty and their traces open; retried after
+ *       ROOM_REPORT_RETRY_MS.
+ * @return true if a message was published
+ */
+bool Room_Report_Flush(void);
+
+void Room_Report_GetStats(Room_Report_Stats_t* stats);
+
+#endif // ROOM_REPORT_H
@@ -4,9 +4,17 @@
 #include "room_rtos.h"
 #include "room_logic.h"
 #include "room_config.h"
+#include "../app_rtos/app_rtos.h"
+#include "../rules/rules.h"
+#include "../occupancy/occupancy.h"
+#include "../thermostat/thermostat_precond.h"
+#include "../access/access.h"
+#include "../access/access_journal.h"
+#include "../access/access_token.h"
 #include "../../hal/communication/hal_mqtt/hal_mqtt.h"
 #include "../../hal/sensors/hal_rfid/hal_rfid.h"
 #include "../../hal/hal_led/hal_led.h"
+#include "../../hal/hal_power/hal_power.h"
 // Task handles
 TaskHandle_t room_sensor_task_handle = NULL;
 TaskHandle_t room_control_task_handle = NULL;
@@ -19,7 +27,6 @@ QueueHandle_t room_mqtt_tx_queue = NULL;
 
 // Mutex handles
 SemaphoreHandle_t room_status_mutex = NULL;
-SemaphoreHandle_t room_mutex;
 
 
 //////////////////////// RFID 
@@ -36,56 +43,20 @@ void Room_RTOS_Init(void)
 {
     ROOM_DEBUG_PRINTLN("Room RTOS: Initializing...");
     
-    // Create mutex
-    room_status_mutex = xSemaphoreCreateMutex();
+    // LEDs/PWM, button pull-ups and LDR
+    Room_Logic_Init();
     
-    // Create queues
-    room_mqtt_rx_queue = xQueueCreate(ROOM_MQTT_QUEUE_SIZE, sizeof(Room_MQTTMessage_t));
-    room_mqtt_tx_queue = xQueueCreate(ROOM_MQTT_QUEUE_SIZE, sizeof(Room_MQTTMessage_t));
+    // RTOS objects come from the static table in app_rtos_cfg.h
+    room_status_mutex = App_RTOS_CreateMutex(APP_MUTEX_ROOM_STATUS);
     
-    room_mutex = xSemaphoreCreateMutex();
-    
-    room_rfid_event_queue = xQueueCreate(5, sizeof(Room_RFID_Event_t));
-
-    // Create tasks
-    xTaskCreate(
-        Room_RTOS_SensorTask,
-        "SensorTask",
-        ROOM_TASK_STACK_SIZE_SMALL,
-        NULL,
-        ROOM_TASK_PRIORITY_MEDIUM,
-        &room_sensor_task_handle
-    );
-    
-    xTaskCreate(
-        Room_RTOS_ControlTask,
-        "ControlTask",
-        ROOM_TASK_STACK_SIZE_SMALL,
-        NULL,
-        ROOM_TASK_PRIORITY_MEDIUM,
-        &room_control_task_handle
-    );
-    
-    
-    xTaskCreate(
-        Room_RTOS_ButtonTask,
-        "ButtonTask",
-        4096,
-        NULL,
-        ROOM_TASK_PRIORITY_MEDIUM,
-        &room_button_task_handle
-    );
-
-
-    xTaskCreate(
-    Room_RTOS_RFIDTask,
-    "RFIDTask",
-    4096,                 // RFID + SPI + String = BIG stack
-    NULL,
-    ROOM_TASK_PRIORITY_MEDIUM,
-    &room_rfid_task_handle
-    );
-
+    room_mqtt_rx_queue = App_RTOS_CreateQueue(APP_QUEUE_ROOM_MQTT_RX);
+    room_mqtt_tx_queue = App_RTOS_CreateQueue(APP_QUEUE_ROOM_MQTT_TX);
+    room_rfid_event_queue = App_RTOS_CreateQueue(APP_QUEUE_ROOM_RFID_EVENT);
+
+    room_sensor_task_handle  = App_RTOS_CreateTask(APP_TASK_ROOM_SENSOR);
+    room_control_task_handle = App_RTOS_CreateTask(APP_TASK_ROOM_CONTROL);
+    room_button_task_handle  = App_RTOS_CreateTask(APP_TASK_ROOM_BUTTON);
+    room_rfid_task_handle    = App_RTOS_CreateTask(APP_TASK_ROOM_RFID);
     
     ROOM_DEBUG_PRINTLN("Room RTOS: Initialized");
 }
@@ -96,14 +67,20 @@ void Room_RTOS_Init(void)
 void Room_RTOS_SensorTask(void* parameter)
 {
     TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t frequency = pdMS_TO_TICKS(5000); // 100ms
     
     while (1) {
-        // Update LDR reading
+        // Slower while the room is vacant (occupancy setback profile)
+        const TickType_t frequency = pdMS_TO_TICKS(Occupancy_ScalePeriod(5000));
+
+        // Update LDR reading; wake the control task only if AUTO needs a new level
+        bool target_moved = false;
         if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
-            Room_Logic_UpdateLDR();
+            target_moved = Room_Logic_UpdateLDR();
             xSemaphoreGive(room_status_mutex);
         }
+        if (target_moved) {
+            xTaskNotifyGive(room_control_task_handle);
+        }
         
         // Publish LDR data every 5 seconds
         static uint8_t counter = 0;
@@ -119,35 +96,57 @@ void Room_RTOS_SensorTask(void* parameter)
 // ============================================================================
 // Control Task - Handles auto-dimming logic
 // ============================================================================
+// Sleeps until notified: by the sensor task when the AUTO target moves, by
+// the RFID task after queueing an event, by the rule engine when an event
+// or watched input is pending, or by occupancy activity in a vacant room.
+// Otherwise it wakes only when occupancy or pre-conditioning is due.
+// Ramps run in the LEDC fade engine.
 void Room_RTOS_ControlTask(void* parameter)
 {
-    TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t frequency = pdMS_TO_TICKS(100); // 100ms
-    
+    Rules_SetProcessor(xTaskGetCurrentTaskHandle());
+    Occupancy_Init(xTaskGetCurrentTaskHandle());
+    Thermostat_Precond_SetProcessor(xTaskGetCurrentTaskHandle());
+#if ROOM_DEBUG_ENABLED == STD_ON
+    UBaseType_t stack_low = UINT32_MAX;
+#endif
+
     while (1) {
+#if ROOM_DEBUG_ENABLED == STD_ON
+        // Rule actions, occupancy and pre-conditioning all run on this
+        // stack: log every new low-water mark (bytes on ESP-IDF)
+        UBaseType_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+        if (stack_free < stack_low) {
+            stack_low = stack_free;
+            Serial.printf("[ROOM] ControlTask stack: %u bytes never used\n", (unsigned)stack_free);
+        }
+#endif
+        TickType_t wait = Occupancy_WaitTicks();
+        TickType_t precond_wait = Thermostat_Precond_WaitTicks();
+        ulTaskNotifyTake(pdTRUE, (precond_wait < wait) ? precond_wait : wait);
+
         // Update auto mode if enabled
         if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
             Room_Logic_UpdateAutoMode();
             xSemaphoreGive(room_status_mutex);
         }
-        
-
-
 
         Room_RFID_Event_t rfid_event;
 
-        if (xQueueReceive(room_rfid_event_queue, &rfid_event, 0) == pdTRUE) {
+        while (xQueueReceive(room_rfid_event_queue, &rfid_event, 0) == pdTRUE) {
 
             switch (rfid_event.type) {
 
                 case RFID_EVENT_AUTH_GRANTED:
                     ROOM_DEBUG_PRINT("[RFID] Access granted: ");
                     ROOM_DEBUG_PRINTLN(rfid_event.uid);
+                    Occupancy_ReportActivity(OCC_EVIDENCE_CARD);
+                    Rules_Post(RULES_EVT_CARD_GRANTED);
                     break;
 
                 case RFID_EVENT_AUTH_DENIED:
                     ROOM_DEBUG_PRINT("[RFID] Access denied: ");
                     ROOM_DEBUG_PRINTLN(rfid_event.uid);
+                    Rules_Post(RULES_EVT_CARD_DENIED);
                     break;
 
                 default:
@@ -155,7 +154,14 @@ void Room_RTOS_ControlTask(void* parameter)
             }
         }
 
-        vTaskDelayUntil(&last_wake_time, frequency);
+        // Occupancy setback and rule actions touch room state, so they run
+        // under the same lock; occupancy first so rules see its events now
+        if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
+            Occupancy_Process();
+            Thermostat_Precond_Process();
+            Rules_Process();
+            xSemaphoreGive(room_status_mutex);
+        }
     }
 }
 
@@ -180,17 +186,8 @@ void Room_RTOS_MQTTWarrper(void )
         // Process incoming messages
         if (xQueueReceive(room_mqtt_rx_queue, &rx_message, 0) == pdTRUE) {
             if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
+                // Changes mark the status dirty; it is published outside the lock
                 Room_Logic_ProcessMQTTMessage(rx_message.topic, rx_message.payload);
-
-                if (strcmp(rx_message.topic, ROOM_TOPIC_MODE_CTRL) == 0) {
-                    Room_RTOS_PublishModeStatus();
-                } else if (strcmp(rx_message.topic, ROOM_TOPIC_LED1_CTRL) == 0) {
-                    Room_RTOS_PublishLEDStatus(ROOM_LED_1);
-                } else if (strcmp(rx_message.topic, ROOM_TOPIC_LED2_CTRL) == 0) {
-                    Room_RTOS_PublishLEDStatus(ROOM_LED_2);
-                } else if (strcmp(rx_message.topic, ROOM_TOPIC_AUTO_DIM) == 0) {
-                    Room_RTOS_PublishModeStatus();  // Auto-dim maps to mode
-                }
                 xSemaphoreGive(room_status_mutex);
 
             }  
@@ -205,17 +202,32 @@ void Room_RTOS_MQTTWarrper(void )
 // ============================================================================
 void Room_RTOS_ButtonTask(void* parameter)
 {
-    TickType_t last_wake_time = xTaskGetTickCount();
-    const TickType_t frequency = pdMS_TO_TICKS(1000); // 50ms
+#if POWER_MGMT_ENABLED == STD_ON
+    // Button ISRs wake the chip from light sleep and notify this task
+    Power_RegisterWakeButton(ROOM_BUTTON1_PIN, xTaskGetCurrentTaskHandle());
+    Power_RegisterWakeButton(ROOM_BUTTON2_PIN, xTaskGetCurrentTaskHandle());
+    const TickType_t idle_wait = portMAX_DELAY;
+#else
+    const TickType_t idle_wait = pdMS_TO_TICKS(ROOM_BUTTON_POLL_MS);
+#endif
     
     while (1) {
-        // Process button presses
-        if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
-            Room_Logic_ProcessButtons();
-            xSemaphoreGive(room_status_mutex);
-        }
-        
-        vTaskDelayUntil(&last_wake_time, frequency);
+        // Block until a button is pressed
+        ulTaskNotifyTake(pdTRUE, idle_wait);
+
+        // Stay awake and poll until both buttons are released
+        Power_LockAcquire(POWER_LOCK_BUTTON);
+        do {
+            if (xSemaphoreTake(room_status_mutex, portMAX_DELAY)) {
+                Room_Logic_ProcessButtons();
+                xSemaphoreGive(room_status_mutex);
+            }
+            vTaskDelay(pdMS_TO_TICKS(ROOM_BUTTON_POLL_MS));
+        } while (digitalRead(ROOM_BUTTON1_PIN) == LOW || digitalRead(ROOM_BUTTON2_PIN) == LOW);
+        Power_LockRelease(POWER_LOCK_BUTTON);
+
+        Power_RearmWakeButton(ROOM_BUTTON1_PIN);
+        Power_RearmWakeButton(ROOM_BUTTON2_PIN);
     }
 }
 
@@ -223,39 +235,61 @@ void Room_RTOS_RFIDTask(void *parameter)
 {
     ROOM_DEBUG_PRINTLN("[RFID TASK] Starting...");
 
+    // Allowlist updates are applied here, between card polls
+    Access_SetProcessor(xTaskGetCurrentTaskHandle());
+
     if (!RFID_INIT()) {
         ROOM_DEBUG_PRINTLN("[RFID TASK] RFID init failed!");
-        vTaskDelete(NULL);
+        // No reader, but the list in NVS still has to follow the updates
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            Access_Process();
+        }
     }
 
     Room_RFID_Event_t event;
-    String uid;
+    uint8_t uid[10];
+    uint8_t uid_size = 0;
+    uint8_t token[RFID_TOKEN_SIZE];
 
     while (1) {
 
+        Access_Process();
+
         if (RFID_IsNewCardPresent()) {
 
-            if (RFID_ReadCard(&uid, NULL, NULL)) {
+            if (RFID_ReadUID(uid, &uid_size)) {
+
+                // Decide on the raw bytes first; the text UID is only for logs
+                Access_Reason_t reason;
+                bool granted = Access_CheckCard(uid, uid_size, &reason);
+                if (!granted && reason == ACCESS_REASON_NOT_LISTED) {
+                    // Guest card: one session for the token, checked locally
+                    if (RFID_ReadToken(token, NULL)) {
+                        granted = Access_Token_Verify(token, uid, uid_size, &reason);
+                    }
+                }
+                if (granted) {
+                    LED_ON(ACCESS_CONTROL);
+                }
+                // Audit trail: RAM copy only, flushed and uploaded by the journal task
+                Access_Journal_Record(uid, uid_size, granted, reason);
 
                 memset(&event, 0, sizeof(event));
-                strncpy(event.uid, uid.c_str(), sizeof(event.uid) - 1);
+                Access_FormatUID(uid, uid_size, event.uid, sizeof(event.uid));
                 event.type = RFID_EVENT_CARD_DETECTED;
 
                 xQueueSend(room_rfid_event_queue, &event, 0);
 
-                if (RFID_CheckAuthorization(uid)) {
-                    event.type = RFID_EVENT_AUTH_GRANTED;
-                    LED_ON(ACCESS_CONTROL);
-
-                } else {
-                    event.type = RFID_EVENT_AUTH_DENIED;
-                }
+                event.type = granted ? RFID_EVENT_AUTH_GRANTED : RFID_EVENT_AUTH_DENIED;
 
                 xQueueSend(room_rfid_event_queue, &event, 0);
+                xTaskNotifyGive(room_control_task_handle);
             }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(200)); // RFID polling interval
+        // RFID polling interval; an allowlist update ends the wait early
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
     }
 }
 
@@ -280,23 +314,6 @@ bool Room_RTOS_ReceiveMQTTMessage(Room_MQTTMessage_t* message, uint32_t timeout_
     return xQueueReceive(room_mqtt_rx_queue, message, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
 }
 
-void Room_RTOS_PublishLEDStatus(Room_LED_t led)
-{
-    Room_MQTTMessage_t message;
-    Room_LED_State_t state = Room_Logic_GetLEDState(led);
-    
-    if (led == ROOM_LED_1) {
-        strcpy(message.topic, ROOM_TOPIC_LED1_STATUS);
-    } else {
-        strcpy(message.topic, ROOM_TOPIC_LED2_STATUS);
-    }
-    
-    strcpy(message.payload, (state == ROOM_LED_ON) ? "ON" : "OFF");
-    message.length = strlen(message.payload);
-    
-    Room_RTOS_SendMQTTMessage(&message);
-}
-
 void Room_RTOS_PublishLDRData(void)
 {
     Room_MQTTMessage_t message;
@@ -315,16 +332,11 @@ void Room_RTOS_PublishLDRData(void)
     sprintf(message.payload, "%d", percentage);
     message.length = strlen(message.payload);
     Room_RTOS_SendMQTTMessage(&message);
-}
 
-void Room_RTOS_PublishModeStatus(void)
-{
-    Room_MQTTMessage_t message;
-    
-    strcpy(message.topic, ROOM_TOPIC_MODE_STATUS);
-    strcpy(message.payload, Room_Logic_GetModeString());
+    // Publish calibrated illuminance
+    strcpy(message.topic, ROOM_TOPIC_LDR_LUX);
+    sprintf(message.payload, "%lu", (unsigned long)Room_Logic_GetLDRLux());
     message.length = strlen(message.payload);
-    
     Room_RTOS_SendMQTTMessage(&message);
 }
 
@@ -19,6 +19,7 @@
 
 // Queue sizes
 #define ROOM_MQTT_QUEUE_SIZE        10
+#define ROOM_RFID_QUEUE_SIZE        5
 
 // Task handles
 extern TaskHandle_t room_sensor_task_handle;
@@ -32,7 +33,6 @@ extern QueueHandle_t room_mqtt_tx_queue;
 
 // Mutex handles
 extern SemaphoreHandle_t room_status_mutex;
-extern SemaphoreHandle_t room_mutex;
 
 // Initialization
 void Room_RTOS_Init(void);
@@ -46,10 +46,8 @@ void Room_RTOS_MQTTWarrper(void );
 bool Room_RTOS_SendMQTTMessage(const Room_MQTTMessage_t* message);
 bool Room_RTOS_ReceiveMQTTMessage(Room_MQTTMessage_t* message, uint32_t timeout_ms);
 
-// Status publishing
-void Room_RTOS_PublishLEDStatus(Room_LED_t led);
+// Status publishing (mode and lights go through room_report.h)
 void Room_RTOS_PublishLDRData(void);
-void Room_RTOS_PublishModeStatus(void);
 void Room_RTOS_RFIDTask(void *parameter);
 
 #endif // ROOM_RTOS_
@@ -27,7 +27,8 @@ typedef enum {
 typedef enum {
     ROOM_CONTROL_BUTTON = 0,
     ROOM_CONTROL_MQTT,
-    ROOM_CONTROL_AUTO
+    ROOM_CONTROL_AUTO,
+    ROOM_CONTROL_RULE       // Automation rule action (rules.h)
 } Room_ControlSource_t;
 
 // Auto-dim mode (deprecated - replaced by Room_Mode_t)
@@ -45,6 +46,7 @@ typedef struct {
     uint8_t led2_brightness;
     uint16_t ldr_raw_value;
     uint16_t ldr_percentage;
+    uint32_t ldr_lux;               // Calibrated illuminance
     bool mqtt_connected;
 } Room_Status_t;
 
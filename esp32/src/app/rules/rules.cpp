@@ -0,0 +1,767 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include "rules.h"
+#include "rules_actions.h"
+#include "../../app_cfg.h"
+#include "../app_rtos/app_rtos.h"
+#include "esp_timer.h"
+
+#if RULES_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+// ==================== VOCABULARY ====================
+
+#define RULES_ENUM_DOMAIN(id)   RULES_DOMAIN_##id,
+typedef enum {
+    RULES_DOMAIN_TABLE(RULES_ENUM_DOMAIN)
+    RULES_DOMAIN_COUNT
+} Rules_Domain_t;
+#undef RULES_ENUM_DOMAIN
+
+typedef struct {
+    const char* name;
+    uint8_t     domain;
+    int16_t     value;
+} Rules_Symbol_t;
+
+typedef struct {
+    const char*      name;
+    uint8_t          domain;
+    Rules_ActionFn_t fn;
+} Rules_ActionDesc_t;
+
+#define RULES_SYMBOL_ROW(domain, name, value)   { name, RULES_DOMAIN_##domain, value },
+#define RULES_EVENT_NAME(id, name)              name,
+#define RULES_INPUT_NAME(id, name, domain)      name,
+#define RULES_INPUT_DOMAIN(id, name, domain)    RULES_DOMAIN_##domain,
+#define RULES_ACTION_ROW(id, name, domain, fn)  { name, RULES_DOMAIN_##domain, fn },
+
+static const Rules_Symbol_t     RULES_SYMBOLS[]       = { RULES_SYMBOL_TABLE(RULES_SYMBOL_ROW) };
+static const char* const        RULES_EVENT_NAMES[]   = { RULES_EVENT_TABLE(RULES_EVENT_NAME) };
+static const char* const        RULES_INPUT_NAMES[]   = { RULES_INPUT_TABLE(RULES_INPUT_NAME) };
+static const uint8_t            RULES_INPUT_DOMAINS[] = { RULES_INPUT_TABLE(RULES_INPUT_DOMAIN) };
+static const Rules_ActionDesc_t RULES_ACTIONS[]       = { RULES_ACTION_TABLE(RULES_ACTION_ROW) };
+
+// ==================== COMPILED TABLE ====================
+
+typedef enum {
+    RULES_OP_EQ = 0,
+    RULES_OP_NE,
+    RULES_OP_LT,
+    RULES_OP_LE,
+    RULES_OP_GT,
+    RULES_OP_GE
+} Rules_Op_t;
+
+typedef struct {
+    uint8_t input;
+    uint8_t op;
+    int16_t value;
+} Rules_Cond_t;
+
+typedef struct {
+    uint8_t action;
+    uint8_t reserved;
+    int16_t value;
+} Rules_Act_t;
+
+typedef struct {
+    uint8_t cond_first;
+    uint8_t cond_count;
+    uint8_t act_first;
+    uint8_t act_count;
+} Rules_Rule_t;
+
+// Everything one evaluation touches sits in one contiguous block
+typedef struct {
+    uint32_t     event_rules[RULES_EVT_COUNT];  // Rules each event triggers
+    uint32_t     input_rules[RULES_IN_COUNT];   // Rules each input change triggers
+    uint32_t     deny_rules;                    // Rules holding a deny action
+    uint8_t      rule_count;
+    uint8_t      cond_count;
+    uint8_t      act_count;
+    Rules_Rule_t rules[RULES_MAX];
+    Rules_Cond_t conds[RULES_MAX_CONDS];
+    Rules_Act_t  acts[RULES_MAX_ACTIONS];
+} Rules_Table_t;
+
+// Active table plus a scratch one to compile into; swapped under g_tableMutex
+static Rules_Table_t  g_tables[2];
+static Rules_Table_t* g_active = NULL;
+static SemaphoreHandle_t g_tableMutex = NULL;
+
+// Inputs and pending work; written from any task
+static portMUX_TYPE g_rulesMux = portMUX_INITIALIZER_UNLOCKED;
+static int16_t      g_inputs[RULES_IN_COUNT];
+static uint32_t     g_pendingEvents = 0;
+static uint32_t     g_dirtyInputs = 0;
+static uint32_t     g_watchedInputs = 0;        // Inputs some rule triggers on
+static uint32_t     g_latched = 0;              // Input-triggered rules currently true
+static TaskHandle_t g_processor = NULL;
+
+// Hash of the active source, to skip reloading the same text
+static uint32_t     g_activeHash = 0;
+static size_t       g_activeLength = 0;
+
+// Sources, double buffered: Rules_Submit() fills the slot the processor
+// (and boot) is not reading, so only the slot index changes under the lock
+static char         g_sources[2][RULES_SOURCE_MAX];
+static size_t       g_sourceLength[2];
+static uint8_t      g_readSlot = 0;         // Processor's slot
+static bool         g_submitPending = false;
+
+static Rules_Stats_t g_stats;
+static char g_report[128];
+static volatile bool g_reportReady = false;
+
+// ==================== PARSER ====================
+
+typedef struct {
+    const char* p;
+    const char* end;
+    uint16_t    line;
+    const char* error;
+} Rules_Lexer_t;
+
+static bool Rules_IsIdent(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/**
+ * @brief Skip blanks and comments inside one rule (stops at ';' / newline)
+ */
+static void Rules_SkipBlanks(Rules_Lexer_t* lx)
+{
+    while (lx->p < lx->end) {
+        char c = *lx->p;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            lx->p++;
+        } else if (c == '#') {
+            while (lx->p < lx->end && *lx->p != '\n') lx->p++;
+        } else {
+            break;
+        }
+    }
+}
+
+static bool Rules_AtRuleEnd(Rules_Lexer_t* lx)
+{
+    Rules_SkipBlanks(lx);
+    return lx->p >= lx->end || *lx->p == ';' || *lx->p == '\n';
+}
+
+/**
+ * @brief Read an identifier into a bounded buffer
+ */
+static bool Rules_Word(Rules_Lexer_t* lx, char* word, size_t size)
+{
+    Rules_SkipBlanks(lx);
+    size_t n = 0;
+    while (lx->p < lx->end && Rules_IsIdent(*lx->p)) {
+        if (n + 1 >= size) {
+            lx->error = "name too long";
+            return false;
+        }
+        word[n++] = *lx->p++;
+    }
+    word[n] = '\0';
+    if (n == 0) lx->error = "name expected";
+    return n > 0;
+}
+
+static bool Rules_Expect(Rules_Lexer_t* lx, const char* keyword)
+{
+    char word[16];
+    if (!Rules_Word(lx, word, sizeof(word)) || strcmp(word, keyword) != 0) {
+        lx->error = (strcmp(keyword, "do") == 0) ? "'do' expected" : "'on' expected";
+        return false;
+    }
+    return true;
+}
+
+static bool Rules_Accept(Rules_Lexer_t* lx, char c)
+{
+    Rules_SkipBlanks(lx);
+    if (lx->p < lx->end && *lx->p == c) {
+        lx->p++;
+        return true;
+    }
+    return false;
+}
+
+static int Rules_Find(const char* const* names, int count, const char* word)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], word) == 0) return i;
+    }
+    return -1;
+}
+
+static int Rules_FindAction(const char* word)
+{
+    for (int i = 0; i < RULES_ACT_COUNT; i++) {
+        if (strcmp(RULES_ACTIONS[i].name, word) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Number (DECI: one decimal, stored x10) or a symbol of the domain
+ */
+static bool Rules_Value(Rules_Lexer_t* lx, uint8_t domain, int16_t* value)
+{
+    Rules_SkipBlanks(lx);
+
+    bool negative = Rules_Accept(lx, '-');
+    if (lx->p < lx->end && *lx->p >= '0' && *lx->p <= '9') {
+        int32_t v = 0;
+        while (lx->p < lx->end && *lx->p >= '0' && *lx->p <= '9') {
+            v = v * 10 + (*lx->p++ - '0');
+            if (v > 30000) {
+                lx->error = "number out of range";
+                return false;
+            }
+        }
+        int32_t tenths = 0;
+        if (Rules_Accept(lx, '.')) {
+            if (lx->p < lx->end && *lx->p >= '0' && *lx->p <= '9') tenths = *lx->p++ - '0';
+            while (lx->p < lx->end && *lx->p >= '0' && *lx->p <= '9') lx->p++;
+        }
+        if (domain == RULES_DOMAIN_DECI) {
+            v = v * 10 + tenths;
+        } else if (domain != RULES_DOMAIN_NUMBER) {
+            lx->error = "symbol expected";
+            return false;
+        }
+        if (v > 32767) {
+            lx->error = "number out of range";
+            return false;
+        }
+        *value = (int16_t)(negative ? -v : v);
+        return true;
+    }
+    if (negative) {
+        lx->error = "number expected";
+        return false;
+    }
+
+    char word[16];
+    if (!Rules_Word(lx, word, sizeof(word))) return false;
+    for (size_t i = 0; i < sizeof(RULES_SYMBOLS) / sizeof(RULES_SYMBOLS[0]); i++) {
+        if (RULES_SYMBOLS[i].domain == domain && strcmp(RULES_SYMBOLS[i].name, word) == 0) {
+            *value = RULES_SYMBOLS[i].value;
+            return true;
+        }
+    }
+    lx->error = "unknown value";
+    return false;
+}
+
+static bool Rules_Operator(Rules_Lexer_t* lx, uint8_t* op)
+{
+    Rules_SkipBlanks(lx);
+    if (lx->end - lx->p >= 2) {
+        if (lx->p[0] == '=' && lx->p[1] == '=') { *op = RULES_OP_EQ; lx->p += 2; return true; }
+        if (lx->p[0] == '!' && lx->p[1] == '=') { *op = RULES_OP_NE; lx->p += 2; return true; }
+        if (lx->p[0] == '<' && lx->p[1] == '=') { *op = RULES_OP_LE; lx->p += 2; return true; }
+        if (lx->p[0] == '>' && lx->p[1] == '=') { *op = RULES_OP_GE; lx->p += 2; return true; }
+    }
+    if (Rules_Accept(lx, '<')) { *op = RULES_OP_LT; return true; }
+    if (Rules_Accept(lx, '>')) { *op = RULES_OP_GT; return true; }
+    lx->error = "operator expected";
+    return false;
+}
+
+/**
+ * @brief Compile one rule at lx->p into table t
+ */
+static bool Rules_CompileRule(Rules_Lexer_t* lx, Rules_Table_t* t)
+{
+    if (t->rule_count >= RULES_MAX) {
+        lx->error = "too many rules";
+        return false;
+    }
+
+    const uint32_t bit = 1UL << t->rule_count;
+    Rules_Rule_t* rule = &t->rules[t->rule_count];
+    char word[16];
+
+    rule->cond_first = t->cond_count;
+    rule->cond_count = 0;
+    rule->act_first = t->act_count;
+    rule->act_count = 0;
+
+    // Triggers
+    if (!Rules_Expect(lx, "on")) return false;
+    do {
+        if (!Rules_Word(lx, word, sizeof(word))) return false;
+        int evt = Rules_Find(RULES_EVENT_NAMES, RULES_EVT_COUNT, word);
+        int in = Rules_Find(RULES_INPUT_NAMES, RULES_IN_COUNT, word);
+        if (evt >= 0) {
+            t->event_rules[evt] |= bit;
+        } else if (in >= 0) {
+            t->input_rules[in] |= bit;
+        } else {
+            lx->error = "unknown trigger";
+            return false;
+        }
+    } while (Rules_Accept(lx, ','));
+
+    // Optional conditions, then actions
+    if (!Rules_Word(lx, word, sizeof(word))) return false;
+    if (strcmp(word, "if") == 0) {
+        do {
+            if (t->cond_count >= RULES_MAX_CONDS) {
+                lx->error = "too many conditions";
+                return false;
+            }
+            Rules_Cond_t* cond = &t->conds[t->cond_count];
+            if (!Rules_Word(lx, word, sizeof(word))) return false;
+            int in = Rules_Find(RULES_INPUT_NAMES, RULES_IN_COUNT, word);
+            if (in < 0) {
+                lx->error = "unknown input";
+                return false;
+            }
+            cond->input = (uint8_t)in;
+            if (!Rules_Operator(lx, &cond->op)) return false;
+            if (!Rules_Value(lx, RULES_INPUT_DOMAINS[in], &cond->value)) return false;
+            t->cond_count++;
+            rule->cond_count++;
+        } while (Rules_Accept(lx, '&'));
+        if (!Rules_Expect(lx, "do")) return false;
+    } else if (strcmp(word, "do") != 0) {
+        lx->error = "'if' or 'do' expected";
+        return false;
+    }
+
+    do {
+        if (t->act_count >= RULES_MAX_ACTIONS) {
+            lx->error = "too many actions";
+            return false;
+        }
+        Rules_Act_t* act = &t->acts[t->act_count];
+        if (!Rules_Word(lx, word, sizeof(word))) return false;
+        int a = Rules_FindAction(word);
+        if (a < 0) {
+            lx->error = "unknown action";
+            return false;
+        }
+        act->action = (uint8_t)a;
+        act->reserved = 0;
+        act->value = 0;
+        if (a == RULES_ACT_DENY) {
+            t->deny_rules |= bit;
+        } else {
+            if (!Rules_Accept(lx, '=')) {
+                lx->error = "'=' expected";
+                return false;
+            }
+            if (!Rules_Value(lx, RULES_ACTIONS[a].domain, &act->value)) return false;
+        }
+        t->act_count++;
+        rule->act_count++;
+    } while (Rules_Accept(lx, ','));
+
+    if (!Rules_AtRuleEnd(lx)) {
+        lx->error = "unexpected text";
+        return false;
+    }
+
+    t->rule_count++;
+    return true;
+}
+
+static bool Rules_Compile(const char* source, size_t length, Rules_Table_t* t, uint16_t* err_line, const char** err)
+{
+    Rules_Lexer_t lx = { source, source + length, 1, NULL };
+    memset(t, 0, sizeof(*t));
+
+    while (lx.p < lx.end) {
+        Rules_SkipBlanks(&lx);
+        if (lx.p >= lx.end) break;
+        if (*lx.p == ';' || *lx.p == '\n') {
+            if (*lx.p == '\n') lx.line++;
+            lx.p++;
+            continue;
+        }
+        if (!Rules_CompileRule(&lx, t)) {
+            *err_line = lx.line;
+            *err = lx.error ? lx.error : "syntax error";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ==================== EVALUATION ====================
+
+static bool Rules_Eval(const Rules_Table_t* t, const Rules_Rule_t* rule, const int16_t* inputs)
+{
+    const Rules_Cond_t* cond = &t->conds[rule->cond_first];
+    for (uint8_t i = 0; i < rule->cond_count; i++, cond++) {
+        int16_t v = inputs[cond->input];
+        bool ok;
+        switch (cond->op) {
+            case RULES_OP_EQ: ok = (v == cond->value); break;
+            case RULES_OP_NE: ok = (v != cond->value); break;
+            case RULES_OP_LT: ok = (v <  cond->value); break;
+            case RULES_OP_LE: ok = (v <= cond->value); break;
+            case RULES_OP_GT: ok = (v >  cond->value); break;
+            case RULES_OP_GE: ok = (v >= cond->value); break;
+            default:          ok = false;             break;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static void Rules_Notify(void)
+{
+    if (g_processor != NULL) {
+        xTaskNotifyGive(g_processor);
+    }
+}
+
+static uint32_t Rules_Hash(const char* source, size_t length)
+{
+    uint32_t h = 0x811c9dc5UL;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)source[i]) * 0x01000193UL;
+    }
+    return h;
+}
+
+static uint32_t Rules_WatchedInputs(const Rules_Table_t* t)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < RULES_IN_COUNT; i++) {
+        if (t->input_rules[i] != 0) mask |= (1UL << i);
+    }
+    return mask;
+}
+
+// ==================== PUBLIC API ====================
+
+void Rules_Init(void)
+{
+    if (g_tableMutex == NULL) {
+        g_tableMutex = App_RTOS_CreateMutex(APP_MUTEX_RULES);
+    }
+
+    bool loaded = false;
+    Preferences prefs;
+    if (prefs.begin(RULES_NVS_NS, true)) {
+        size_t length = prefs.getBytesLength(RULES_NVS_KEY);
+        // The processor task is not running yet, so its slot is free
+        if (length > 0 && length <= RULES_SOURCE_MAX) {
+            char* source = g_sources[g_readSlot];
+            if (prefs.getBytes(RULES_NVS_KEY, source, length) == length) {
+                loaded = Rules_Load(source, length, false);
+            }
+        }
+        prefs.end();
+    }
+
+    if (!loaded) {
+        Rules_Load(NULL, 0, false);
+    }
+
+    Rules_Post(RULES_EVT_BOOT);
+}
+
+void Rules_SetProcessor(TaskHandle_t task)
+{
+    g_processor = task;
+    Rules_Notify();     // Pick up anything posted before the task started
+}
+
+bool Rules_Load(const char* source, size_t length, bool persist)
+{
+    bool use_default = (source == NULL || length == 0);
+    if (use_default) {
+        source = RULES_DEFAULT_SOURCE;
+        length = strlen(RULES_DEFAULT_SOURCE);
+    }
+
+    uint16_t err_line = 0;
+    const char* err = NULL;
+    uint8_t rule_count = 0;
+    uint32_t hash = Rules_Hash(source, length);
+    bool unchanged = false;
+
+    if (length > RULES_SOURCE_MAX || g_tableMutex == NULL) {
+        err = (g_tableMutex == NULL) ? "not initialised" : "source too long";
+    } else if (xSemaphoreTake(g_tableMutex, portMAX_DELAY) == pdTRUE) {
+        Rules_Table_t* scratch = (g_active == &g_tables[0]) ? &g_tables[1] : &g_tables[0];
+        if (g_active != NULL && length == g_activeLength && hash == g_activeHash) {
+            unchanged = true;
+        } else if (Rules_Compile(source, length, scratch, &err_line, &err)) {
+            portENTER_CRITICAL(&g_rulesMux);
+            g_active = scratch;
+            g_watchedInputs = Rules_WatchedInputs(scratch);
+            g_latched = 0;
+            g_dirtyInputs = g_watchedInputs;   // Level rules see the current state once
+            portEXIT_CRITICAL(&g_rulesMux);
+            g_activeHash = hash;
+            g_activeLength = length;
+            rule_count = scratch->rule_count;
+        }
+        xSemaphoreGive(g_tableMutex);
+    }
+
+    // Already active (and stored when it was first loaded): keep the table,
+    // the latched rules and NVS as they are
+    if (unchanged) {
+        DEBUG_PRINTF("[RULES] Source unchanged (%u bytes)\n", (unsigned)length);
+        return true;
+    }
+
+    if (err != NULL) {
+        g_stats.errors++;
+        snprintf(g_report, sizeof(g_report), "{\"ok\":false,\"line\":%u,\"error\":\"%s\"}", err_line, err);
+        g_reportReady = true;
+        DEBUG_PRINTF("[RULES] Rejected: line %u: %s\n", err_line, err);
+        return false;
+    }
+
+    g_stats.loads++;
+    g_stats.rules = rule_count;
+    g_stats.from_default = use_default;
+    snprintf(g_report, sizeof(g_report), "{\"ok\":true,\"rules\":%u,\"default\":%s}",
+             rule_count, use_default ? "true" : "false");
+    g_reportReady = true;
+    DEBUG_PRINTF("[RULES] %u rules active (%s)\n", rule_count,
+                 g_stats.from_default ? "default" : "custom");
+
+    if (persist) {
+        Preferences prefs;
+        if (prefs.begin(RULES_NVS_NS, false)) {
+            if (use_default) {
+                prefs.remove(RULES_NVS_KEY);
+            } else {
+                prefs.putBytes(RULES_NVS_KEY, source, length);
+            }
+            prefs.end();
+        }
+    }
+
+    Rules_Notify();
+    return true;
+}
+
+void Rules_SetInput(Rules_Input_t input, int16_t value)
+{
+    if (input >= RULES_IN_COUNT) return;
+
+    bool wake = false;
+    portENTER_CRITICAL(&g_rulesMux);
+    if (g_inputs[input] != value) {
+        g_inputs[input] = value;
+        if (g_watchedInputs & (1UL << input)) {
+            g_dirtyInputs |= (1UL << input);
+            wake = true;
+        }
+    }
+    portEXIT_CRITICAL(&g_rulesMux);
+
+    if (wake) Rules_Notify();
+}
+
+bool Rules_Submit(const char* source, size_t length)
+{
+    if (length > RULES_SOURCE_MAX) {
+        g_stats.errors++;
+        snprintf(g_report, sizeof(g_report), "{\"ok\":false,\"line\":0,\"error\":\"source too long\"}");
+        g_reportReady = true;
+        return false;
+    }
+
+    // Claim the free slot; with nothing pending the processor leaves it alone
+    portENTER_CRITICAL(&g_rulesMux);
+    uint8_t slot = g_readSlot ^ 1;
+    g_submitPending = false;
+    portEXIT_CRITICAL(&g_rulesMux);
+
+    if (length > 0) memcpy(g_sources[slot], source, length);
+    g_sourceLength[slot] = length;
+
+    portENTER_CRITICAL(&g_rulesMux);
+    g_submitPending = true;
+    portEXIT_CRITICAL(&g_rulesMux);
+
+    Rules_Notify();
+    return true;
+}
+
+int16_t Rules_GetInput(Rules_Input_t input)
+{
+    return (input < RULES_IN_COUNT) ? g_inputs[input] : 0;
+}
+
+void Rules_Post(Rules_Event_t event)
+{
+    if (event >= RULES_EVT_COUNT) return;
+
+    portENTER_CRITICAL(&g_rulesMux);
+    g_pendingEvents |= (1UL << event);
+    portEXIT_CRITICAL(&g_rulesMux);
+
+    Rules_Notify();
+}
+
+bool Rules_Check(Rules_Event_t event)
+{
+    if (event >= RULES_EVT_COUNT) return true;
+
+    // The command happened whatever the deny rules say; the other rules on
+    // this event run in the processor like any posted event
+    Rules_Post(event);
+    if (g_tableMutex == NULL) return true;
+
+    bool allowed = true;
+    if (xSemaphoreTake(g_tableMutex, portMAX_DELAY) == pdTRUE) {
+        const Rules_Table_t* t = g_active;
+        uint32_t mask = (t != NULL) ? (t->event_rules[event] & t->deny_rules) : 0;
+
+        int16_t inputs[RULES_IN_COUNT];
+        portENTER_CRITICAL(&g_rulesMux);
+        memcpy(inputs, g_inputs, sizeof(inputs));
+        portEXIT_CRITICAL(&g_rulesMux);
+
+        while (mask) {
+            int r = __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (Rules_Eval(t, &t->rules[r], inputs)) {
+                allowed = false;
+                break;
+            }
+        }
+        xSemaphoreGive(g_tableMutex);
+    }
+
+    if (!allowed) {
+        g_stats.denied++;
+        DEBUG_PRINTF("[RULES] %s denied\n", RULES_EVENT_NAMES[event]);
+    }
+    return allowed;
+}
+
+void Rules_Process(void)
+{
+    if (g_tableMutex == NULL) return;
+
+    // A submitted source first, so its rules see this round's events
+    bool submitted;
+    portENTER_CRITICAL(&g_rulesMux);
+    submitted = g_submitPending;
+    if (submitted) {
+        g_readSlot ^= 1;
+        g_submitPending = false;
+    }
+    portEXIT_CRITICAL(&g_rulesMux);
+    if (submitted) {
+        size_t length = g_sourceLength[g_readSlot];
+        bool ok = Rules_Load(g_sources[g_readSlot], length, true);
+        Serial.printf("[RULES] Update (%u bytes) %s\n", (unsigned)length, ok ? "applied" : "rejected");
+    }
+
+    int16_t inputs[RULES_IN_COUNT];
+    uint32_t events, dirty;
+
+    portENTER_CRITICAL(&g_rulesMux);
+    events = g_pendingEvents;
+    dirty = g_dirtyInputs;
+    g_pendingEvents = 0;
+    g_dirtyInputs = 0;
+    memcpy(inputs, g_inputs, sizeof(inputs));
+    portEXIT_CRITICAL(&g_rulesMux);
+
+    if (events == 0 && dirty == 0) return;
+
+    // Actions run after the table is released: they change inputs and
+    // call into modules that may themselves ask Rules_Check(). Static: the
+    // room ControlTask is the only caller and its stack also runs the actions
+    static Rules_Act_t todo[RULES_MAX_ACTIONS];
+    uint8_t todo_count = 0;
+    uint32_t fired = 0;
+
+    if (xSemaphoreTake(g_tableMutex, portMAX_DELAY) != pdTRUE) return;
+
+    int64_t start = esp_timer_get_time();
+    const Rules_Table_t* t = g_active;
+    uint32_t by_event = 0, by_input = 0;
+
+    while (events) {
+        int e = __builtin_ctz(events);
+        events &= events - 1;
+        by_event |= t->event_rules[e];
+    }
+    while (dirty) {
+        int i = __builtin_ctz(dirty);
+        dirty &= dirty - 1;
+        by_input |= t->input_rules[i];
+    }
+
+    // Rule order is table order, so later rules win on conflicting actions
+    uint32_t candidates = by_event | by_input;
+    while (candidates) {
+        int r = __builtin_ctz(candidates);
+        uint32_t bit = 1UL << r;
+        candidates &= candidates - 1;
+
+        const Rules_Rule_t* rule = &t->rules[r];
+        bool pass = Rules_Eval(t, rule, inputs);
+        bool fire = pass && (by_event & bit);
+
+        // Input triggers are edge triggered: only when the rule becomes true
+        if (by_input & bit) {
+            if (pass && !(g_latched & bit)) fire = true;
+            g_latched = pass ? (g_latched | bit) : (g_latched & ~bit);
+        }
+        if (!fire) continue;
+
+        fired++;
+        const Rules_Act_t* act = &t->acts[rule->act_first];
+        for (uint8_t a = 0; a < rule->act_count; a++, act++) {
+            if (act->action != RULES_ACT_DENY && todo_count < RULES_MAX_ACTIONS) {
+                todo[todo_count++] = *act;
+            }
+        }
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    xSemaphoreGive(g_tableMutex);
+
+    g_stats.eval_last_us = elapsed;
+    if (elapsed > g_stats.eval_max_us) g_stats.eval_max_us = elapsed;
+    g_stats.fired += fired;
+
+    for (uint8_t i = 0; i < todo_count; i++) {
+        DEBUG_PRINTF("[RULES] %s = %d\n", RULES_ACTIONS[todo[i].action].name, todo[i].value);
+        RULES_ACTIONS[todo[i].action].fn(todo[i].value);
+    }
+}
+
+void Rules_GetStats(Rules_Stats_t* stats)
+{
+    if (stats != NULL) *stats = g_stats;
+}
+
+bool Rules_TakeReport(char* buffer, uint16_t size)
+{
+    if (!g_reportReady || buffer == NULL) return false;
+
+    Rules_Stats_t stats = g_stats;
+    int n = snprintf(buffer, size, "%s", g_report);
+    // Append evaluation cost so a config change can be judged right away
+    if (n > 1 && n < size && buffer[n - 1] == '}') {
+        snprintf(buffer + n - 1, size - n + 1, ",\"eval_max_us\":%lu}", (unsigned long)stats.eval_max_us);
+    }
+    g_reportReady = false;
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file rules.h
+ * @brief Table-driven room automation rules
+ *
+ * @note Rule text (rules_cfg.h grammar) is compiled once into flat arrays:
+ *       rules, conditions and actions, plus one bitmask per event and per
+ *       input naming the rules it can trigger. Posting an event or changing
+ *       an input only marks it pending; Rules_Process() then evaluates just
+ *       the rules in those masks. Sources: built-in default, NVS, or the
+ *       retained MQTT_TOPIC_RULES message (stored to NVS when it compiles).
+ *       MQTT sources are handed over with Rules_Submit() and compiled in the
+ *       processor task; a source identical to the active one is skipped.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "rules_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define RULES_ENUM_EVENT(id, name)                  RULES_EVT_##id,
+#define RULES_ENUM_INPUT(id, name, domain)          RULES_IN_##id,
+#define RULES_ENUM_ACTION(id, name, domain, fn)     RULES_ACT_##id,
+
+typedef enum {
+    RULES_EVENT_TABLE(RULES_ENUM_EVENT)
+    RULES_EVT_COUNT
+} Rules_Event_t;
+
+typedef enum {
+    RULES_INPUT_TABLE(RULES_ENUM_INPUT)
+    RULES_IN_COUNT
+} Rules_Input_t;
+
+typedef enum {
+    RULES_ACTION_TABLE(RULES_ENUM_ACTION)
+    RULES_ACT_COUNT
+} Rules_Action_t;
+
+#undef RULES_ENUM_EVENT
+#undef RULES_ENUM_INPUT
+#undef RULES_ENUM_ACTION
+
+static_assert(RULES_EVT_COUNT <= 32 && RULES_IN_COUNT <= 32, "Trigger masks are 32 bit");
+
+/**
+ * @brief Action handler, run from Rules_Process() in the processor task
+ */
+typedef void (*Rules_ActionFn_t)(int16_t value);
+
+typedef struct {
+    uint8_t  rules;             ///< Rules in the active table
+    bool     from_default;      ///< Active table is the built-in source
+    uint32_t loads;             ///< Successful compiles since boot
+    uint32_t errors;            ///< Rejected sources
+    uint32_t fired;             ///< Rules whose actions ran
+    uint32_t denied;            ///< Rules_Check() refusals
+    uint32_t eval_last_us;      ///< Last Rules_Process() evaluation time
+    uint32_t eval_max_us;
+} Rules_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Compile the NVS source (or the built-in one) and post RULES_EVT_BOOT
+ * @note Inputs may be set before this; they are kept.
+ */
+void Rules_Init(void);
+
+/**
+ * @brief Task that runs Rules_Process(); it is notified when work is pending
+ */
+void Rules_SetProcessor(TaskHandle_t task);
+
+/**
+ * @brief Compile a rule source and make it active
+ * @param source  Rule text (not necessarily NUL terminated), empty = defaults
+ * @param persist Store the text in NVS on success (empty erases it)
+ * @return false if the text does not compile; the active table is unchanged
+ * @note Same length and hash as the active source: nothing is compiled,
+ *       stored or reset (retained redelivery on every reconnect).
+ */
+bool Rules_Load(const char* source, size_t length, bool persist);
+
+/**
+ * @brief Copy a source for the processor task to load (persisted)
+ * @note Cheap, for the MQTT callback. Only the latest submission is kept.
+ * @return false if it is longer than RULES_SOURCE_MAX (reported as an error)
+ */
+bool Rules_Submit(const char* source, size_t length);
+
+/**
+ * @brief Update an input; wakes the processor if a rule watches it
+ * @note Cheap and safe from any task; values in the input's domain
+ *       (DECI inputs in 0.1 units)
+ */
+void Rules_SetInput(Rules_Input_t input, int16_t value);
+int16_t Rules_GetInput(Rules_Input_t input);
+
+/**
+ * @brief Queue an event for the processor
+ */
+void Rules_Post(Rules_Event_t event);
+
+/**
+ * @brief Ask the deny rules whether a command is allowed right now, and post
+ *        the event for the other rules on it
+ * @note Synchronous, evaluates only the rules with `deny` on this event. The
+ *       other actions run later in Rules_Process(), allowed or not, so
+ *       command events (led_cmd, button, fan_cmd) trigger rules like any
+ *       posted event.
+ */
+bool Rules_Check(Rules_Event_t event);
+
+/**
+ * @brief Evaluate the rules touched by pending events and changed inputs,
+ *        then run their actions
+ */
+void Rules_Process(void);
+
+void Rules_GetStats(Rules_Stats_t* stats);
+
+/**
+ * @brief Fetch the result of the last load (for MQTT_TOPIC_RULES_STATUS)
+ * @return false if nothing new since the last call
+ */
+bool Rules_TakeReport(char* buffer, uint16_t size);
+
+#endif // RULES_H
@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include "rules_actions.h"
+#include "../room/room_logic.h"
+#include "../thermostat/thermostat_fan_control.h"
+
+// Each handler applies one value; the room logic marks the status for the
+// coalesced report, so none of them publish.
+
+void Rules_Act_RoomMode(int16_t value)
+{
+    if (Room_Logic_GetMode() == (Room_Mode_t)value) return;
+    Room_Logic_SetMode((Room_Mode_t)value);
+}
+
+static void Rules_Act_Led(Room_LED_t led, int16_t value)
+{
+    Room_Logic_SetLED(led, value ? ROOM_LED_ON : ROOM_LED_OFF, ROOM_CONTROL_RULE);
+}
+
+void Rules_Act_Led1(int16_t value)
+{
+    Rules_Act_Led(ROOM_LED_1, value);
+}
+
+void Rules_Act_Led2(int16_t value)
+{
+    Rules_Act_Led(ROOM_LED_2, value);
+}
+
+void Rules_Act_ThermoMode(int16_t value)
+{
+    Thermostat_SetMode((Thermostat_Mode_t)value);
+    thermostatMqttModeEventSet();
+}
+
+void Rules_Act_Target(int16_t value)
+{
+    // Out-of-range targets are rejected by the thermostat itself
+    if (Thermostat_SetTargetTemp(value / 10.0f)) {
+        thermostatMqttEventSet();
+    }
+}
+
+void Rules_Act_FanSpeed(int16_t value)
+{
+    // Only takes effect in MANUAL; put "thermo_mode = manual" first
+    Thermostat_SetFanSpeed((Fan_Speed_t)value);
+    thermostatMqttFanSpeedEventSet();
+}
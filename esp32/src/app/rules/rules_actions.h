@@ -0,0 +1,15 @@
+#ifndef RULES_ACTIONS_H
+#define RULES_ACTIONS_H
+
+#include <stdint.h>
+
+// Handlers named in RULES_ACTION_TABLE; they run in the rules processor task
+// (the room control task) with the room status mutex held
+void Rules_Act_RoomMode(int16_t value);
+void Rules_Act_Led1(int16_t value);
+void Rules_Act_Led2(int16_t value);
+void Rules_Act_ThermoMode(int16_t value);
+void Rules_Act_Target(int16_t value);
+void Rules_Act_FanSpeed(int16_t value);
+
+#endif // RULES_ACTIONS_H
@@ -0,0 +1,96 @@
+#ifndef RULES_CFG_H
+#define RULES_CFG_H
+
+/* =========================
+ * Room Automation Rules
+ * =========================
+ * Vocabulary of the rule language. Names here are what rule sources use;
+ * ids become RULES_EVT_<id>, RULES_IN_<id>, RULES_ACT_<id>. Adding a word
+ * means adding one row (and, for actions, one handler in rules_actions.cpp).
+ *
+ *   on <trigger>[, <trigger>...] [if <input> <op> <value> [& ...]] do <action>[, ...]
+ *
+ * A trigger is an event (fires on every post) or an input (fires when the
+ * conditions become true after that input changed). Rules are separated by
+ * ';' or newlines, '#' starts a comment.
+ */
+
+// Capacity of a compiled table (rule masks are 32 bit)
+#define RULES_MAX               32
+#define RULES_MAX_CONDS         64
+#define RULES_MAX_ACTIONS       64
+#define RULES_SOURCE_MAX        1024    // Bytes of rule text (NVS / MQTT payload)
+
+#define RULES_NVS_NS            "rules"
+#define RULES_NVS_KEY           "src"
+
+// Value domains: which symbols an input or action accepts
+// X(id)
+#define RULES_DOMAIN_TABLE(X) \
+    X(NUMBER)       \
+    X(DECI)         \
+    X(ONOFF)        \
+    X(ROOM_MODE)    \
+    X(THERMO_MODE)  \
+    X(FAN_SPEED)    \
+    X(OCCUPANCY)
+
+// Symbols: X(domain, name, value) - values match the firmware enums
+#define RULES_SYMBOL_TABLE(X) \
+    X(ONOFF,        "off",      0)  \
+    X(ONOFF,        "on",       1)  \
+    X(ROOM_MODE,    "off",      0)  \
+    X(ROOM_MODE,    "manual",   1)  \
+    X(ROOM_MODE,    "auto",     2)  \
+    X(THERMO_MODE,  "off",      0)  \
+    X(THERMO_MODE,  "auto",     1)  \
+    X(THERMO_MODE,  "manual",   2)  \
+    X(FAN_SPEED,    "off",      0)  \
+    X(FAN_SPEED,    "low",      1)  \
+    X(FAN_SPEED,    "medium",   2)  \
+    X(FAN_SPEED,    "high",     3)  \
+    X(OCCUPANCY,    "occupied", 0)  \
+    X(OCCUPANCY,    "vacant",   1)  \
+    X(OCCUPANCY,    "away",     2)
+
+// Events: X(id, name)
+#define RULES_EVENT_TABLE(X) \
+    X(BOOT,          "boot")          \
+    X(CARD_GRANTED,  "card_granted")  \
+    X(CARD_DENIED,   "card_denied")   \
+    X(LED_CMD,       "led_cmd")       \
+    X(BUTTON,        "button")        \
+    X(FAN_CMD,       "fan_cmd")       \
+    X(OCCUPIED,      "occupied")      \
+    X(VACANT,        "vacant")
+
+// Inputs: X(id, name, domain)
+#define RULES_INPUT_TABLE(X) \
+    X(ROOM_MODE,    "room_mode",    ROOM_MODE)      \
+    X(LED1,         "led1",         ONOFF)          \
+    X(LED2,         "led2",         ONOFF)          \
+    X(LDR,          "ldr",          NUMBER)         \
+    X(THERMO_MODE,  "thermo_mode",  THERMO_MODE)    \
+    X(TEMP,         "temp",         DECI)           \
+    X(TARGET,       "target",       DECI)           \
+    X(GAS,          "gas",          ONOFF)          \
+    X(OCCUPANCY,    "occupancy",    OCCUPANCY)
+
+// Actions: X(id, name, domain, handler) - DENY has no handler, it only
+// answers Rules_Check()
+#define RULES_ACTION_TABLE(X) \
+    X(DENY,         "deny",         NUMBER,         NULL)                       \
+    X(ROOM_MODE,    "room_mode",    ROOM_MODE,      Rules_Act_RoomMode)         \
+    X(LED1,         "led1",         ONOFF,          Rules_Act_Led1)             \
+    X(LED2,         "led2",         ONOFF,          Rules_Act_Led2)             \
+    X(THERMO_MODE,  "thermo_mode",  THERMO_MODE,    Rules_Act_ThermoMode)       \
+    X(TARGET,       "target",       DECI,           Rules_Act_Target)           \
+    X(FAN_SPEED,    "fan_speed",    FAN_SPEED,      Rules_Act_FanSpeed)
+
+// Built-in rules, used when NVS holds none (or holds a broken set)
+#define RULES_DEFAULT_SOURCE \
+    "on led_cmd, button if room_mode != manual do deny\n"   \
+    "on fan_cmd if thermo_mode != manual do deny\n"         \
+    "on card_granted if room_mode != auto do room_mode = auto\n"
+
+#endif // RULES_CFG_H
@@ -0,0 +1,334 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shadow.h"
+#include "../../app_cfg.h"
+#include "../thermostat/thermostat_fan_control.h"
+#include "../thermostat/thermostat_config.h"
+#include "../room/room_logic.h"
+#include "../room/room_rtos.h"
+#include "../rules/rules.h"
+#include "../occupancy/occupancy.h"
+
+#if SHADOW_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define SHADOW_VALUE_MAX    16      // Longest string value accepted
+
+// ==================== STATIC VARIABLES ====================
+
+#define SHADOW_FIELD_CFG(id, name, kind, desired)   { name, kind, desired },
+static const struct {
+    const char*   name;
+    Shadow_Kind_t kind;
+    bool          desired;
+} g_fields[SHADOW_FIELD_COUNT] = {
+    SHADOW_FIELD_TABLE(SHADOW_FIELD_CFG)
+};
+#undef SHADOW_FIELD_CFG
+
+// Indexed by the device enums
+static const char* const g_switchNames[]      = { "OFF", "ON" };
+static const char* const g_thermoModeNames[]  = { "OFF", "AUTO", "MANUAL" };
+static const char* const g_roomModeNames[]    = { "OFF", "MANUAL", "AUTO" };
+
+static int32_t  g_reported[SHADOW_FIELD_COUNT];
+static bool     g_fullPending = true;           // First report after boot is a snapshot
+static uint32_t g_version = 0;                  // Reported documents since boot
+static int64_t  g_desiredVersion = -1;          // Last desired "v" applied, -1 = none
+static int64_t  g_storedDesired = -1;           // Value in NVS
+static int64_t  g_reportedDesired = -1;
+static uint32_t g_lastDeltaMs = 0;
+static char     g_doc[SHADOW_DOC_MAX];          // Desired document being parsed
+static Shadow_Stats_t g_stats;
+
+// ==================== HELPER FUNCTIONS ====================
+
+static const char* Shadow_Name(Shadow_Kind_t kind, int32_t value)
+{
+    switch (kind) {
+    case SHADOW_KIND_SWITCH:
+        return (value >= 0 && value < 2) ? g_switchNames[value] : NULL;
+    case SHADOW_KIND_THERMO_MODE:
+        return (value >= 0 && value < 3) ? g_thermoModeNames[value] : NULL;
+    case SHADOW_KIND_ROOM_MODE:
+        return (value >= 0 && value < 3) ? g_roomModeNames[value] : NULL;
+    case SHADOW_KIND_OCCUPANCY:
+        return (value >= 0 && value < OCC_STATE_COUNT)
+             ? Occupancy_GetStateName((Occupancy_State_t)value) : NULL;
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief Current device value of a field, in its shadow encoding
+ */
+static int32_t Shadow_Read(Shadow_Field_t field)
+{
+    switch (field) {
+    case SHADOW_FIELD_TARGET:    return (int32_t)lroundf(Thermostat_GetTargetTemp() * 10.0f);
+    case SHADOW_FIELD_MODE:      return (int32_t)Thermostat_GetMode();
+    case SHADOW_FIELD_FAN_SPEED: return (int32_t)Thermostat_GetFanSpeed();
+    case SHADOW_FIELD_HEATING:   return Thermostat_GetStatus().heating ? 1 : 0;
+    case SHADOW_FIELD_ROOM_MODE: return (int32_t)Room_Logic_GetMode();
+    case SHADOW_FIELD_LED1:      return (int32_t)Room_Logic_GetLEDState(ROOM_LED_1);
+    case SHADOW_FIELD_LED2:      return (int32_t)Room_Logic_GetLEDState(ROOM_LED_2);
+    case SHADOW_FIELD_OCCUPANCY: return (int32_t)Occupancy_GetState();
+    default:                     return 0;
+    }
+}
+
+/**
+ * @brief Drive the device to a desired value, through the same paths as the
+ *        single-value control topics (range checks, rules)
+ * @return false if the value was refused
+ */
+static bool Shadow_Write(Shadow_Field_t field, int32_t value)
+{
+    switch (field) {
+    case SHADOW_FIELD_TARGET: {
+        float target = value / 10.0f;
+        if (target < POT_TO_TEMP_MIN || target > POT_TO_TEMP_MAX) return false;
+        if (Thermostat_SetTargetTemp(target)) thermostatMqttEventSet();
+        return true;
+    }
+    case SHADOW_FIELD_MODE:
+        Thermostat_SetMode((Thermostat_Mode_t)value);
+        thermostatMqttModeEventSet();
+        return true;
+
+    case SHADOW_FIELD_FAN_SPEED:
+        if (value < FAN_SPEED_OFF || value > FAN_SPEED_HIGH) return false;
+        if (!Rules_Check(RULES_EVT_FAN_CMD)) return false;
+        Thermostat_SetFanSpeed((Fan_Speed_t)value);
+        thermostatMqttFanSpeedEventSet();
+        return true;
+
+    // Room state belongs to the room tasks: same lock as their writes
+    case SHADOW_FIELD_ROOM_MODE:
+        if (xSemaphoreTake(room_status_mutex, portMAX_DELAY) != pdTRUE) return false;
+        Room_Logic_SetMode((Room_Mode_t)value);
+        xSemaphoreGive(room_status_mutex);
+        return true;
+
+    case SHADOW_FIELD_LED1:
+    case SHADOW_FIELD_LED2: {
+        Room_LED_t led = (field == SHADOW_FIELD_LED1) ? ROOM_LED_1 : ROOM_LED_2;
+        if (!Rules_Check(RULES_EVT_LED_CMD)) return false;
+        if (xSemaphoreTake(room_status_mutex, portMAX_DELAY) != pdTRUE) return false;
+        Room_Logic_SetLED(led, (Room_LED_State_t)value, ROOM_CONTROL_MQTT);
+        xSemaphoreGive(room_status_mutex);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Raw value after "key": in a flat JSON object
+ * @return Start of the value (past any quote), NULL if the key is missing;
+ *         *quoted tells whether it was a string
+ */
+static const char* Shadow_JsonFind(const char* json, const char* key, bool* quoted)
+{
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    const char* p = strstr(json, pattern);
+    if (p == NULL) return NULL;
+    p = strchr(p + strlen(pattern), ':');
+    if (p == NULL) return NULL;
+    p++;
+    while (*p == ' ' || *p == '\t') p++;
+    *quoted = (*p == '"');
+    return *quoted ? p + 1 : p;
+}
+
+/**
+ * @brief Decode a desired field value into its shadow encoding
+ */
+static bool Shadow_Parse(Shadow_Kind_t kind, const char* raw, bool quoted, int32_t* value)
+{
+    if (kind == SHADOW_KIND_NUMBER || kind == SHADOW_KIND_TENTHS) {
+        char* end = NULL;
+        double number = strtod(raw, &end);
+        if (end == raw || (quoted && *end != '"')) return false;
+        *value = (int32_t)lround(kind == SHADOW_KIND_TENTHS ? number * 10.0 : number);
+        return true;
+    }
+
+    if (!quoted) return false;
+    const char* close = strchr(raw, '"');
+    size_t len = (close != NULL) ? (size_t)(close - raw) : 0;
+    if (len == 0 || len > SHADOW_VALUE_MAX) return false;
+
+    for (int32_t v = 0; ; v++) {
+        const char* name = Shadow_Name(kind, v);
+        if (name == NULL) return false;
+        if (strlen(name) == len && strncasecmp(name, raw, len) == 0) {
+            *value = v;
+            return true;
+        }
+    }
+}
+
+static int Shadow_AppendField(char* p, size_t left, Shadow_Field_t field, int32_t value)
+{
+    Shadow_Kind_t kind = g_fields[field].kind;
+    int n;
+    if (kind == SHADOW_KIND_NUMBER) {
+        n = snprintf(p, left, ",\"%s\":%ld", g_fields[field].name, (long)value);
+    } else if (kind == SHADOW_KIND_TENTHS) {
+        n = snprintf(p, left, ",\"%s\":%s%ld.%ld", g_fields[field].name, value < 0 ? "-" : "",
+                     (long)(labs(value) / 10), (long)(labs(value) % 10));
+    } else {
+        const char* name = Shadow_Name(kind, value);
+        n = snprintf(p, left, ",\"%s\":\"%s\"", g_fields[field].name, name != NULL ? name : "?");
+    }
+    return (n < 0 || (size_t)n >= left) ? -1 : n;
+}
+
+static void Shadow_SaveDesired(void)
+{
+    Preferences prefs;
+    if (prefs.begin(SHADOW_NVS_NS, false)) {
+        prefs.putLong64(SHADOW_NVS_KEY, g_desiredVersion);
+        prefs.end();
+    }
+    g_storedDesired = g_desiredVersion;
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void Shadow_Init(void)
+{
+    Preferences prefs;
+    if (prefs.begin(SHADOW_NVS_NS, true)) {
+        g_desiredVersion = prefs.getLong64(SHADOW_NVS_KEY, -1);
+        prefs.end();
+    }
+    g_storedDesired = g_desiredVersion;
+    g_reportedDesired = -1;     // Echoed with the first snapshot
+    DEBUG_PRINTF("[SHADOW] Last desired v%lld\n", (long long)g_desiredVersion);
+}
+
+bool Shadow_ApplyDesired(const char* payload, size_t length)
+{
+    if (payload == NULL || length == 0 || length >= sizeof(g_doc)) return false;
+    memcpy(g_doc, payload, length);
+    g_doc[length] = '\0';
+
+    const char* p = g_doc;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p != '{') return false;
+
+    bool quoted = false;
+    const char* raw = Shadow_JsonFind(g_doc, "v", &quoted);
+    int64_t version = -1;
+    if (raw != NULL) {
+        char* end = NULL;
+        version = strtoll(raw, &end, 10);
+        if (end == raw || quoted || version < 0) return false;
+        if (version <= g_desiredVersion) {
+            g_stats.desired_stale++;
+            DEBUG_PRINTF("[SHADOW] Desired v%lld already applied\n", (long long)version);
+            return true;
+        }
+    }
+
+    uint8_t applied = 0, refused = 0;
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        if (!g_fields[i].desired) continue;
+        raw = Shadow_JsonFind(g_doc, g_fields[i].name, &quoted);
+        if (raw == NULL) continue;
+
+        int32_t value;
+        if (!Shadow_Parse(g_fields[i].kind, raw, quoted, &value)) {
+            refused++;
+            continue;
+        }
+        if (value == Shadow_Read((Shadow_Field_t)i)) continue;     // Already there
+
+        if (Shadow_Write((Shadow_Field_t)i, value)) applied++;
+        else refused++;
+    }
+
+    if (version >= 0) g_desiredVersion = version;
+    g_stats.desired_docs++;
+    g_stats.fields_applied += applied;
+    g_stats.fields_refused += refused;
+    DEBUG_PRINTF("[SHADOW] Desired v%lld: %u applied, %u refused\n",
+                 (long long)version, applied, refused);
+    return true;
+}
+
+void Shadow_RequestFull(void)
+{
+    g_fullPending = true;
+}
+
+bool Shadow_TakeReport(char* buffer, uint16_t size)
+{
+    if (buffer == NULL || size == 0) return false;
+
+    // At most once per desired document, never in the message callback
+    if (g_desiredVersion != g_storedDesired) Shadow_SaveDesired();
+
+    bool full = g_fullPending;
+    uint32_t now = millis();
+    if (!full && now - g_lastDeltaMs < SHADOW_DELTA_MIN_MS) return false;
+
+    int32_t current[SHADOW_FIELD_COUNT];
+    bool changed = full || (g_desiredVersion != g_reportedDesired);
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        current[i] = Shadow_Read((Shadow_Field_t)i);
+        if (current[i] != g_reported[i]) changed = true;
+    }
+    if (!changed) return false;
+
+    int n = snprintf(buffer, size, "{\"v\":%lu%s", (unsigned long)(g_version + 1),
+                     full ? ",\"full\":true" : "");
+    if (n < 0 || n >= size) return false;
+
+    if (g_desiredVersion >= 0 && (full || g_desiredVersion != g_reportedDesired)) {
+        int m = snprintf(buffer + n, size - n, ",\"dv\":%lld", (long long)g_desiredVersion);
+        if (m < 0 || m >= size - n) return false;
+        n += m;
+    }
+    for (uint8_t i = 0; i < SHADOW_FIELD_COUNT; i++) {
+        if (!full && current[i] == g_reported[i]) continue;
+        int m = Shadow_AppendField(buffer + n, size - n, (Shadow_Field_t)i, current[i]);
+        if (m < 0) {
+            g_fullPending = true;       // Never send a truncated delta
+            return false;
+        }
+        n += m;
+    }
+    if (n + 2 > size) return false;
+    buffer[n++] = '}';
+    buffer[n] = '\0';
+
+    memcpy(g_reported, current, sizeof(g_reported));
+    g_reportedDesired = g_desiredVersion;
+    g_version++;
+    g_fullPending = false;
+    g_lastDeltaMs = now;
+
+    if (full) g_stats.full_reports++;
+    else g_stats.delta_reports++;
+    g_stats.reported_bytes += n;
+    return true;
+}
+
+void Shadow_GetStats(Shadow_Stats_t* stats)
+{
+    if (stats != NULL) *stats = g_stats;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file shadow.h
+ * @brief Device shadow: desired/reported state documents with delta sync
+ *
+ * @note Documents are flat JSON objects keyed by the names in
+ *       SHADOW_FIELD_TABLE:
+ *
+ *         desired   {"v":7,"target":22.5,"mode":"AUTO","led1":"ON"}
+ *         reported  {"v":41,"full":true,"dv":7,"target":22.5,"mode":"AUTO",...}
+ *                   {"v":42,"led1":"OFF"}
+ *
+ *       "v" in a desired document is its version; a document that is not
+ *       newer than the last one applied is ignored, so the retained copy
+ *       coming back after a reconnect does not undo local changes. Without
+ *       "v" every document is applied. Fields the device already matches
+ *       are skipped; fields refused (range, rules) stay different and show
+ *       up as such in the reported state.
+ *
+ *       Reported "v" counts documents since boot and "dv" is the last
+ *       desired version applied. A consumer that sees a gap in "v" asks for
+ *       a snapshot on MQTT_TOPIC_SHADOW_GET.
+ *
+ *       Everything here runs in the MQTT task (message callback and
+ *       Task_Mqtt), so the module keeps no locks of its own.
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "shadow_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef enum {
+    SHADOW_KIND_NUMBER = 0,     // Integer
+    SHADOW_KIND_TENTHS,         // Stored x10, sent with one decimal
+    SHADOW_KIND_SWITCH,         // "OFF"/"ON"
+    SHADOW_KIND_THERMO_MODE,    // Thermostat_Mode_t names
+    SHADOW_KIND_ROOM_MODE,      // Room_Mode_t names
+    SHADOW_KIND_OCCUPANCY       // Occupancy_State_t names
+} Shadow_Kind_t;
+
+#define SHADOW_ENUM_FIELD(id, name, kind, desired)  SHADOW_FIELD_##id,
+typedef enum {
+    SHADOW_FIELD_TABLE(SHADOW_ENUM_FIELD)
+    SHADOW_FIELD_COUNT
+} Shadow_Field_t;
+#undef SHADOW_ENUM_FIELD
+
+typedef struct {
+    uint32_t full_reports;
+    uint32_t delta_reports;
+    uint32_t reported_bytes;    ///< Payload bytes of both kinds
+    uint32_t desired_docs;      ///< Applied (not stale, not malformed)
+    uint32_t desired_stale;
+    uint32_t fields_applied;
+    uint32_t fields_refused;
+} Shadow_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Load the last applied desired version from NVS
+ */
+void Shadow_Init(void);
+
+/**
+ * @brief Apply a desired-state document (MQTT_TOPIC_SHADOW_DESIRED)
+ * @param payload JSON, not null-terminated
+ * @return false if the document is malformed or too large
+ */
+bool Shadow_ApplyDesired(const char* payload, size_t length);
+
+/**
+ * @brief Send a full snapshot with the next report (connect, MQTT_TOPIC_SHADOW_GET)
+ */
+void Shadow_RequestFull(void);
+
+/**
+ * @brief Next reported document: the pending snapshot, or a delta of the
+ *        fields that changed since the last report
+ * @return false if nothing is due
+ * @note Also stores a newly applied desired version (MQTT task, outside the
+ *       message callback).
+ */
+bool Shadow_TakeReport(char* buffer, uint16_t size);
+
+void Shadow_GetStats(Shadow_Stats_t* stats);
+
+#endif // SHADOW_H
@@ -0,0 +1,38 @@
+#ifndef SHADOW_CFG_H
+#define SHADOW_CFG_H
+
+/* =========================
+ * Device Shadow
+ * =========================
+ * The room's state as one versioned document. The cloud keeps the state it
+ * wants as a retained document on MQTT_TOPIC_SHADOW_DESIRED; the device
+ * applies only the fields that differ from what it is doing. What the
+ * device is actually doing goes to MQTT_TOPIC_SHADOW_REPORTED, as a full
+ * snapshot after every (re)connect or request on MQTT_TOPIC_SHADOW_GET and
+ * as deltas of the changed fields in between.
+ */
+
+// Shadow fields, in the order desired fields are applied (mode before the
+// fan speed and room mode before the lights, so the rules see the new mode)
+// X(id, name, kind, desired)
+//   kind    - value encoding (Shadow_Kind_t)
+//   desired - the cloud may set it; false = reported only
+#define SHADOW_FIELD_TABLE(X) \
+    X(TARGET,       "target",       SHADOW_KIND_TENTHS,         true)   \
+    X(MODE,         "mode",         SHADOW_KIND_THERMO_MODE,    true)   \
+    X(FAN_SPEED,    "fan_speed",    SHADOW_KIND_NUMBER,         true)   \
+    X(HEATING,      "heating",      SHADOW_KIND_SWITCH,         false)  \
+    X(ROOM_MODE,    "room_mode",    SHADOW_KIND_ROOM_MODE,      true)   \
+    X(LED1,         "led1",         SHADOW_KIND_SWITCH,         true)   \
+    X(LED2,         "led2",         SHADOW_KIND_SWITCH,         true)   \
+    X(OCCUPANCY,    "occupancy",    SHADOW_KIND_OCCUPANCY,      false)
+
+#define SHADOW_DOC_MAX          256     // Desired or reported document, bytes
+#define SHADOW_DELTA_MIN_MS     1000    // Changes inside this window share one delta
+
+// Last desired "v" applied, so a reboot does not re-apply the retained
+// document over local changes made since
+#define SHADOW_NVS_NS           "shadow"
+#define SHADOW_NVS_KEY          "dv"
+
+#endif // SHADOW_CFG_H
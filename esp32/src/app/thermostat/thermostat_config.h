@@ -12,6 +12,8 @@
 #define DEBUG_TIMING            0  // Show timing information
 #define DEBUG_QUEUE_STATUS      0  // Monitor queue status
 #define DEBUG_HUM_SENSOR        1  // Debug temperature sensor task
+#define DEBUG_GAS_SENSOR        1  // Debug gas detection task
+#define DEBUG_PRECOND           1  // Debug arrival pre-conditioning
 
 // Stack monitoring interval (ms)
 #define STACK_MONITOR_INTERVAL_MS  10000
@@ -42,6 +44,7 @@
 
 // ==================== CONSTANTS ====================
 #define TEMP_QUEUE_SIZE              5
+#define MQTT_PUBLISH_QUEUE_SIZE      5
 #define TEMP_SENSOR_SAMPLE_RATE_MS   3000
 #define INPUT_SAMPLE_RATE_MS         3000
 #define LOGIC_UPDATE_RATE_MS         3000
@@ -53,11 +56,11 @@
 
 #define TARGET_TEMP_THRESHOLD  1   // degrees Celsius
 
-// Fan state thresholds
+// Fan state thresholds (°C of demand; HIGH/LOW pairs form the hysteresis band)
 #define FAN_MEDIUM_THRESHOLD_HIGH    1.0f   // Switch to medium when delta >= this
-#define FAN_MEDIUM_THRESHOLD_LOW     1.0f   // Switch to low when delta < this
+#define FAN_MEDIUM_THRESHOLD_LOW     0.8f   // Switch to low when delta < this
 #define FAN_HIGH_THRESHOLD_HIGH      3.0f   // Switch to high when delta >= this
-#define FAN_HIGH_THRESHOLD_LOW       3.0f   // Switch to medium when delta < this
+#define FAN_HIGH_THRESHOLD_LOW       2.6f   // Switch to medium when delta < this
 /////////////////
 
 #define POT_TEMP_PIN     34  // POT1 for temperature reading
@@ -77,20 +80,78 @@
 #define UPDATE_INTERVAL_MS 1000   // Update every 1 second
 #define MQTT_PUBLISH_INTERVAL_MS 5000 // Publish every 5 seconds
 
+// ==================== FAN CONTROLLER ====================
+// Output stage: PWM fan on FAN_PWM_PIN, or the three speed LEDs
+#define FAN_OUTPUT_PWM           0
+#define FAN_OUTPUT_DISCRETE      1
+#define FAN_OUTPUT_STAGE         FAN_OUTPUT_PWM
+
+#define FAN_CTRL_PERIOD_MS       500    // Fixed control period (esp_timer)
+
+// PID demand is in %; this error maps to 100 %, so thresholds in °C above
+// translate to demand with FAN_DEMAND_PCT()
+#define FAN_DEMAND_FULL_SCALE_C  4.0f
+#define FAN_DEMAND_PCT(delta_c)  ((delta_c) * 100.0f / FAN_DEMAND_FULL_SCALE_C)
+
+// Gains: % per °C, % per °C·s, % per °C/s. Kp = 100 / full scale keeps the
+// old step map as the proportional part; I removes the steady-state offset.
+#define FAN_PID_KP_HEAT          25.0f
+#define FAN_PID_KI_HEAT          0.05f
+#define FAN_PID_KD_HEAT          0.0f
+#define FAN_PID_KP_COOL          30.0f  // Cooling coil is less effective per CFM
+#define FAN_PID_KI_COOL          0.08f
+#define FAN_PID_KD_COOL          0.0f
+#define FAN_PID_D_ALPHA          0.2f   // Derivative low-pass weight
+#define FAN_PID_RATE_PCT_PER_S   10.0f  // Output slew limit
+
+#define FAN_PWM_PIN              4
+#define FAN_PWM_CHANNEL          6      // Own LEDC timer; room dimmers use 0/1
+#define FAN_PWM_FREQUENCY        25000  // 4-wire fan spec, above audible range
+#define FAN_PWM_RESOLUTION       10     // 80 MHz / 25 kHz leaves 11 bits
+#define FAN_PWM_MIN_DUTY_PCT     30     // Lowest duty that keeps the fan spinning
+
+// Fixed duty for manual speeds and gas purge on the PWM stage
+#define FAN_MANUAL_LOW_PCT       35
+#define FAN_MANUAL_MEDIUM_PCT    65
+#define FAN_MANUAL_HIGH_PCT      100
+
+// Settling: |target - temp| <= band continuously for the hold time
+#define FAN_SETTLE_BAND_C        TEMP_DEADBAND
+#define FAN_SETTLE_HOLD_MS       60000
+#define FAN_REPORT_INTERVAL_MS   60000
+
+// ==================== PRE-CONDITIONING ====================
+// Start early enough to reach the arrival setpoint: lead = |setpoint - temp|
+// / learned rate + margin. Rates are learned from the StoreTemp history.
+#define PRECOND_CHECK_PERIOD_MS      60000   // Lead time re-evaluated this often
+#define PRECOND_MARGIN_S             600     // Fan spin-up / sensor lag allowance
+#define PRECOND_MAX_LEAD_S           (6L * 3600)
+#define PRECOND_NO_SHOW_S            (2L * 3600)   // Give up this long after the arrival
+#define PRECOND_DEFAULT_RATE_C_PER_H 2.0f    // Until the first samples are learned
+#define PRECOND_RATE_MIN_C_PER_H     0.2f
+#define PRECOND_RATE_MAX_C_PER_H     20.0f
+#define PRECOND_LEARN_MIN_DUTY_PCT   50.0f   // Only learn while the fan really drives
+#define PRECOND_LEARN_MIN_ERROR_C    1.0f    // ... and the room is still away from target
+#define PRECOND_LEARN_MAX_GAP_S      7200    // Older sample pairs are not one run
+#define PRECOND_LEARN_ALPHA          0.25f   // EMA weight of a new rate sample
+#define PRECOND_LEARN_SAVE_EVERY     4       // NVS write every N learned samples
+#define PRECOND_NVS_NS               "precond"
+
 
 // ==================== STACK SIZE DEFINITIONS ====================
 #define TEMP_SENSOR_STACK_SIZE  3072
 #define USER_INPUT_STACK_SIZE   3072
 #define FAN_CONTROL_STACK_SIZE  3072
 #define MQTT_STACK_SIZE         4096
-#define WIFI_STACK_SIZE         4096
+#define MQTT_REPORT_SIZE        256   // Shared static report buffer (largest: shadow document)
+#define GAS_SENSOR_STACK_SIZE   3072
 
 // ==================== TASK PRIORITY DEFINITIONS ====================
+#define GAS_SENSOR_PRIORITY     4   // Safety path preempts every other app task
 #define TEMP_SENSOR_PRIORITY    3
 #define USER_INPUT_PRIORITY     2
 #define FAN_CONTROL_PRIORITY    2
 #define MQTT_PRIORITY           1
-#define WIFI_PRIORITY           1
 
 // Event bits
 #define TEMP_UPDATED_BIT      (1 << 0)
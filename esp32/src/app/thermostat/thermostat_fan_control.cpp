@@ -6,11 +6,28 @@
 #include "../../hal/sensors/hal_potentiometer/hal_potentiometer.h"
 #include "../../hal/sensors/hal_mq5/hal_mq5.h"
 #include "../../hal/sensors/hal_dht/hal_dht.h"
+#include "../../hal/sensors/SensorCal/SensorCal.h"
+#include "../../drivers/driver_adc/driver_adc.h"
 #include "../../hal/hal_led/hal_led.h"
+#include "../../hal/hal_pwm/hal_pwm.h"
 #include "../../hal/communication/hal_mqtt/hal_mqtt.h"
 
 #include "thermostat_config.h"
 #include "thermostat_types.h"
+#include "thermostat_pid.h"
+#include "thermostat_precond.h"
+#include "../app_rtos/app_rtos.h"
+#include "../rules/rules.h"
+#include "../room/room_config.h"
+#include "esp_timer.h"
+
+// The speed LEDs are outputs; a room button on one of them would read its
+// own drive level (and a lit LED holds the light-sleep wake source low)
+#if (FAN_OUTPUT_STAGE == FAN_OUTPUT_DISCRETE) && \
+    (ROOM_BUTTON1_PIN == LED_LOW_SPEED || ROOM_BUTTON1_PIN == LED_MED_SPEED || ROOM_BUTTON1_PIN == LED_HIGH_SPEED || \
+     ROOM_BUTTON2_PIN == LED_LOW_SPEED || ROOM_BUTTON2_PIN == LED_MED_SPEED || ROOM_BUTTON2_PIN == LED_HIGH_SPEED)
+    #error "Room buttons share a pin with the discrete fan speed LEDs"
+#endif
 
 
 static int pot_raw_value = 0 ; 
@@ -28,38 +45,93 @@ static Thermostat_Status_t g_status = {
 static unsigned long g_lastUpdate = 0;
 static unsigned long g_lastPublish = 0;
 
+// Gas alarm forces full ventilation regardless of mode or target
+static volatile bool g_gasPurge = false;
+
+// ==================== FAN CONTROLLER STATE ====================
+static Thermostat_Pid_t  g_pid;
+static Thermostat_Mode_t g_ctrlMode    = THERMOSTAT_MODE_OFF;   // Mode last applied by the loop
+static Fan_Speed_t       g_manualSpeed = FAN_SPEED_OFF;
+static Fan_Speed_t       g_autoSpeed   = FAN_SPEED_OFF;         // Discrete stage hysteresis state
+static float             g_lastTarget  = INVALID_TEMP_VALUE;
+
+static const Thermostat_PidGains_t g_heatGains = { FAN_PID_KP_HEAT, FAN_PID_KI_HEAT, FAN_PID_KD_HEAT };
+static const Thermostat_PidGains_t g_coolGains = { FAN_PID_KP_COOL, FAN_PID_KI_COOL, FAN_PID_KD_COOL };
+
+// Level i is entered at or above g_stageUp[i] and held down to g_stageDown[i]
+static const float g_stageUp[] = {
+    0.0f,
+    FAN_DEMAND_PCT(TEMP_DEADBAND),
+    FAN_DEMAND_PCT(FAN_MEDIUM_THRESHOLD_HIGH),
+    FAN_DEMAND_PCT(FAN_HIGH_THRESHOLD_HIGH)
+};
+static const float g_stageDown[] = {
+    0.0f,
+    FAN_DEMAND_PCT(TEMP_DEADBAND - HYSTERESIS_VALUE),
+    FAN_DEMAND_PCT(FAN_MEDIUM_THRESHOLD_LOW),
+    FAN_DEMAND_PCT(FAN_HIGH_THRESHOLD_LOW)
+};
+static const float g_speedDuty[] = {
+    0.0f, FAN_MANUAL_LOW_PCT, FAN_MANUAL_MEDIUM_PCT, FAN_MANUAL_HIGH_PCT
+};
+
+// Metrics; written by the fan task, copied out by the MQTT task
+static portMUX_TYPE        g_fanStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static Fan_Control_Stats_t g_fanStats;
+static int64_t  g_lastTickUs    = 0;
+static uint64_t g_jitterSumUs   = 0;
+static uint32_t g_windowTicks   = 0;
+static float    g_dutySum       = 0.0f;
+static uint32_t g_windowPeriods = 0;
+static int64_t  g_settleStartUs = 0;
+static int64_t  g_inBandSinceUs = 0;
+static float    g_settleSign    = 0.0f;     // Side of the target the step started from
+static float    g_overshoot     = 0.0f;
+
 static SemaphoreHandle_t g_temperatureMutex    = NULL;
 static SemaphoreHandle_t g_targetTempMutex     = NULL; 
 
 void Thermostat_InitMutexes (void)
 {
-    g_temperatureMutex = xSemaphoreCreateMutex();
-    configASSERT(g_temperatureMutex != NULL);  // Ensure creation succeeded
-
-    g_targetTempMutex = xSemaphoreCreateMutex();
-    configASSERT(g_targetTempMutex != NULL);  // Ensure creation succeeded
+    g_temperatureMutex = App_RTOS_CreateMutex(APP_MUTEX_THERMO_TEMPERATURE);
+    g_targetTempMutex  = App_RTOS_CreateMutex(APP_MUTEX_THERMO_TARGET_TEMP);
 
 }
 // Private function prototypes
 static float mapPotToHumidity(uint16_t pot_value);
-static void  updateLEDs(void);
-static void  autoControlLogic(void);
+#if FAN_OUTPUT_STAGE == FAN_OUTPUT_DISCRETE
+static void  updateLEDs(Fan_Speed_t speed);
+#endif
+static void  Fan_ApplyOutput(float duty_pct, Fan_Speed_t speed);
 
 void Thermostat_Init_Hardware(void)
 {
     // Initialize all three POTs (you'll need to modify POT.cpp to support multiple instances)
     POT_init();
-    //MQ5_1_init();
+    MQ5_1_init();
     DHT22_INIT();
+
+#if FAN_OUTPUT_STAGE == FAN_OUTPUT_PWM
+    PWM_Init(FAN_PWM_CHANNEL, FAN_PWM_PIN, FAN_PWM_FREQUENCY, FAN_PWM_RESOLUTION);
+#else
     // Initialize LEDs
     LED_init(LED_LOW_SPEED);
     LED_init(LED_MED_SPEED);
     LED_init(LED_HIGH_SPEED);
-    
+
     // Turn off all LEDs initially
     LED_OFF(LED_LOW_SPEED);
     LED_OFF(LED_MED_SPEED);
     LED_OFF(LED_HIGH_SPEED);
+#endif
+    LED_init(GAS_ALARM_LED_PIN);
+    LED_OFF(GAS_ALARM_LED_PIN);
+
+    Thermostat_Pid_Init(&g_pid, 0.0f, 100.0f, FAN_PID_RATE_PCT_PER_S, FAN_PID_D_ALPHA);
+
+    // Rule inputs start from the boot defaults, not zero
+    Rules_SetInput(RULES_IN_THERMO_MODE, (int16_t)g_status.mode);
+    Rules_SetInput(RULES_IN_TARGET, (int16_t)lroundf(g_status.target_temp * 10.0f));
     
     Serial.println("Thermostat Hardware initialized");
 }
@@ -68,6 +140,7 @@ void Thermostat_Init_Hardware(void)
 void Thermostat_SetMode(Thermostat_Mode_t mode)
 {
     g_status.mode = mode;
+    Rules_SetInput(RULES_IN_THERMO_MODE, (int16_t)mode);
 
     Serial.print("[DEBUG] Thermostat_SetMode() -> ");
     Serial.println(mode);
@@ -86,6 +159,8 @@ void Thermostat_StoreTemp(float temp)
     if (xSemaphoreTake(g_temperatureMutex, portMAX_DELAY) == pdTRUE) {
         if (g_status.temperature != temp) {
             g_status.temperature = temp;
+            Rules_SetInput(RULES_IN_TEMP, (int16_t)lroundf(temp * 10.0f));
+            Thermostat_Precond_RecordTemp(temp);
             Serial.print("[DEBUG] Temperature stored: ");
             Serial.println(temp);
         }
@@ -116,6 +191,7 @@ bool Thermostat_SetTargetTemp(float target_temp)
             if (g_status.target_temp != target_temp) {
                 g_status.target_temp = target_temp;
                 changed = true;
+                Rules_SetInput(RULES_IN_TARGET, (int16_t)lroundf(target_temp * 10.0f));
                 Serial.print("[DEBUG] Target temp updated to: ");
                 Serial.println(target_temp);
             }
@@ -144,11 +220,11 @@ float Thermostat_GetTargetTemp(void)
     return cached_target ;
 }
 
-void updateLEDs(Fan_Speed_t speed)
+#if FAN_OUTPUT_STAGE == FAN_OUTPUT_DISCRETE
+static void updateLEDs(Fan_Speed_t speed)
 {
     // Turn on appropriate LED based on fan speed
-    g_status.fan_speed = speed ; 
-    switch (g_status.fan_speed)
+    switch (speed)
     {
         case FAN_SPEED_LOW:
             LED_OFF(LED_MED_SPEED);
@@ -167,21 +243,64 @@ void updateLEDs(Fan_Speed_t speed)
             break;
         case FAN_SPEED_OFF:
         default:
+            LED_OFF(LED_LOW_SPEED);
+            LED_OFF(LED_MED_SPEED);
+            LED_OFF(LED_HIGH_SPEED);
             break;
     }
 }
+#endif
+
+/**
+ * @brief Drive the configured output stage
+ * @param duty_pct Fan duty for the PWM stage (0..100)
+ * @param speed    Discrete speed for the LED stage and the reported status
+ */
+static void Fan_ApplyOutput(float duty_pct, Fan_Speed_t speed)
+{
+    if (g_gasPurge) {
+        duty_pct = 100.0f;
+        speed = FAN_SPEED_HIGH;
+    }
+
+    g_status.fan_speed = speed;
+
+#if FAN_OUTPUT_STAGE == FAN_OUTPUT_PWM
+    const uint32_t max_duty = (1UL << FAN_PWM_RESOLUTION) - 1;
+    PWM_Write(FAN_PWM_CHANNEL, (uint32_t)(duty_pct * max_duty / 100.0f + 0.5f));
+#else
+    updateLEDs(speed);
+    duty_pct = g_speedDuty[speed];
+#endif
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    g_fanStats.duty_pct = duty_pct;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+}
 
 void Thermostat_SetFanSpeed(Fan_Speed_t speed)
 {
-    if (g_status.mode == THERMOSTAT_MODE_MANUAL)
+    if (g_status.mode == THERMOSTAT_MODE_MANUAL && speed <= FAN_SPEED_HIGH)
     {
-        g_status.fan_speed = speed;
+        g_manualSpeed = speed;
         Serial.print("[DEBUG] Thermostat_SetFanSpeed() -> ");
         Serial.println(speed);
-        updateLEDs(speed);
+        Fan_ApplyOutput(g_speedDuty[speed], speed);
+    }
+}
 
+void Thermostat_SetGasPurge(bool active)
+{
+    g_gasPurge = active;
+    Rules_SetInput(RULES_IN_GAS, active ? 1 : 0);
 
-    }
+    // Drop the forced HIGH output on clear; the next control tick re-applies the mode
+    Fan_ApplyOutput(active ? 100.0f : 0.0f, active ? FAN_SPEED_HIGH : FAN_SPEED_OFF);
+}
+
+bool Thermostat_IsGasPurge(void)
+{
+    return g_gasPurge;
 }
 
 Fan_Speed_t Thermostat_GetFanSpeed (void)
@@ -193,8 +312,8 @@ Fan_Speed_t Thermostat_GetFanSpeed (void)
 float mapPotToTemp(uint16_t pot_value)
 {
 
-    // Map 0-4095 (12-bit ADC) to temperature range
-    return POT_TO_TEMP_MIN + ((float)pot_value / 4095.0f) * (POT_TO_TEMP_MAX - POT_TO_TEMP_MIN);
+    // Calibrated wiper voltage -> 0.1 °C through the constexpr pot table
+    return (float)SensorCal_PotTempDeci(ADC_Acq_RawToMv(pot_value)) * 0.1f;
 }
 
 Thermostat_Status_t Thermostat_GetStatus(void)
@@ -204,26 +323,196 @@ Thermostat_Status_t Thermostat_GetStatus(void)
 
 
 
-void Fan_Logic (float target_temp, float current_temp)
+// ==================== FAN CONTROLLER ====================
+
+static Fan_Speed_t Fan_Quantize(float demand_pct, Fan_Speed_t current)
 {
-        float diff = abs(current_temp - target_temp);
+    int level = (int)current;
 
-        if (diff <= 0.5) {
-            g_status.fan_speed = FAN_SPEED_OFF;
-            updateLEDs(FAN_SPEED_OFF);
+    while (level < FAN_SPEED_HIGH && demand_pct >= g_stageUp[level + 1]) level++;
+    while (level > FAN_SPEED_OFF && demand_pct < g_stageDown[level]) level--;
 
-        } else if (diff <= 1.5) {
-            g_status.fan_speed = FAN_SPEED_LOW;
-            updateLEDs(FAN_SPEED_LOW);
-        } else if (diff <= 3.0) {
-            g_status.fan_speed = FAN_SPEED_MEDIUM;
-            updateLEDs(FAN_SPEED_MEDIUM);
+    return (Fan_Speed_t)level;
+}
 
-        } else {
-            g_status.fan_speed = FAN_SPEED_HIGH;
-            updateLEDs(FAN_SPEED_HIGH);
+static void Fan_StartSettle(int64_t now_us, float target_temp, float current_temp)
+{
+    g_settleStartUs = now_us;
+    g_inBandSinceUs = 0;
+    g_settleSign = (target_temp >= current_temp) ? 1.0f : -1.0f;
+    g_overshoot = 0.0f;
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    g_fanStats.settling = true;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+}
 
-        }
+/**
+ * @brief Settling time = step -> first entry into the band that then holds
+ *        for FAN_SETTLE_HOLD_MS; overshoot = furthest excursion past the target
+ */
+static void Fan_TrackSettle(int64_t now_us, float target_temp, float current_temp)
+{
+    if (!g_fanStats.settling) return;
+
+    float err = target_temp - current_temp;
+    float past = -g_settleSign * err;
+    if (past > g_overshoot) g_overshoot = past;
+
+    if (fabsf(err) > FAN_SETTLE_BAND_C) {
+        g_inBandSinceUs = 0;
+        return;
+    }
+
+    if (g_inBandSinceUs == 0) g_inBandSinceUs = now_us;
+    if (now_us - g_inBandSinceUs < (int64_t)FAN_SETTLE_HOLD_MS * 1000) return;
 
+    uint32_t settle_ms = (uint32_t)((g_inBandSinceUs - g_settleStartUs) / 1000);
 
-}
\ No newline at end of file
+    portENTER_CRITICAL(&g_fanStatsMux);
+    g_fanStats.settle_last_ms = settle_ms;
+    if (settle_ms > g_fanStats.settle_max_ms) g_fanStats.settle_max_ms = settle_ms;
+    g_fanStats.overshoot_c = g_overshoot;
+    g_fanStats.settling = false;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+
+    DEBUG_PRINT(FAN_CONTROL, "Settled in %lu ms, overshoot %.2f°C",
+                (unsigned long)settle_ms, g_overshoot);
+}
+
+void Thermostat_FanAuto(float target_temp, float current_temp, float dt_s)
+{
+    int64_t now_us = esp_timer_get_time();
+    float diff = target_temp - current_temp;
+
+    if (g_ctrlMode != THERMOSTAT_MODE_AUTO) {
+        Thermostat_Pid_Reset(&g_pid);
+        g_autoSpeed = FAN_SPEED_OFF;
+        g_ctrlMode = THERMOSTAT_MODE_AUTO;
+        Fan_StartSettle(now_us, target_temp, current_temp);
+    } else if (fabsf(target_temp - g_lastTarget) >= TEMP_CHANGE_THRESHOLD) {
+        Fan_StartSettle(now_us, target_temp, current_temp);
+    }
+    g_lastTarget = target_temp;
+
+    // Heating/cooling switch with hysteresis; inside the band keep the last one
+    if (diff > HYSTERESIS_VALUE) {
+        g_status.heating = true;
+    } else if (diff < -HYSTERESIS_VALUE) {
+        g_status.heating = false;
+    }
+    Thermostat_Pid_SetTuning(&g_pid, g_status.heating ? &g_heatGains : &g_coolGains,
+                             g_status.heating ? 1.0f : -1.0f);
+
+    float demand = Thermostat_Pid_Update(&g_pid, target_temp, current_temp, dt_s);
+
+    Fan_Speed_t speed = Fan_Quantize(demand, g_autoSpeed);
+    if (speed != g_autoSpeed) {
+        DEBUG_PRINT(FAN_CONTROL, "%s Δ=%.2f°C demand=%.1f%% → speed %d",
+                    g_status.heating ? "HEAT" : "COOL", diff, demand, speed);
+        g_autoSpeed = speed;
+    }
+
+    // PWM: on/off follows the LOW stage hysteresis, duty spans min..100 %
+    float duty = (speed == FAN_SPEED_OFF) ? 0.0f :
+                 FAN_PWM_MIN_DUTY_PCT + demand * (100.0f - FAN_PWM_MIN_DUTY_PCT) / 100.0f;
+    Fan_ApplyOutput(duty, speed);
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    g_fanStats.demand_pct = demand;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+
+    Fan_TrackSettle(now_us, target_temp, current_temp);
+}
+
+void Thermostat_FanManual(void)
+{
+    if (g_ctrlMode != THERMOSTAT_MODE_MANUAL) {
+        // Entering MANUAL keeps whatever speed the loop was running at
+        g_manualSpeed = g_gasPurge ? g_autoSpeed : g_status.fan_speed;
+        g_ctrlMode = THERMOSTAT_MODE_MANUAL;
+    }
+    Fan_ApplyOutput(g_speedDuty[g_manualSpeed], g_manualSpeed);
+}
+
+void Thermostat_FanOff(void)
+{
+    if (g_ctrlMode != THERMOSTAT_MODE_OFF) {
+        Thermostat_Pid_Reset(&g_pid);
+        g_autoSpeed = FAN_SPEED_OFF;
+        g_ctrlMode = THERMOSTAT_MODE_OFF;
+
+        portENTER_CRITICAL(&g_fanStatsMux);
+        g_fanStats.demand_pct = 0.0f;
+        g_fanStats.settling = false;
+        portEXIT_CRITICAL(&g_fanStatsMux);
+    }
+    Fan_ApplyOutput(0.0f, FAN_SPEED_OFF);
+}
+
+/**
+ * @brief Account one control tick
+ * @param now_us  esp_timer time the task woke
+ * @param periods Timer periods since the previous tick (>1 = missed ticks)
+ */
+void Thermostat_FanRecordTick(int64_t now_us, uint32_t periods)
+{
+    if (periods == 0) periods = 1;
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    if (g_lastTickUs != 0) {
+        int64_t error = now_us - g_lastTickUs - (int64_t)periods * FAN_CTRL_PERIOD_MS * 1000;
+        uint32_t jitter = (uint32_t)(error < 0 ? -error : error);
+
+        if (jitter > g_fanStats.jitter_max_us) g_fanStats.jitter_max_us = jitter;
+        g_jitterSumUs += jitter;
+        g_windowTicks++;
+    }
+    g_lastTickUs = now_us;
+
+    g_fanStats.ticks++;
+    g_fanStats.missed_ticks += periods - 1;
+    g_dutySum += g_fanStats.duty_pct * periods;
+    g_windowPeriods += periods;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+}
+
+void Thermostat_GetFanStats(Fan_Control_Stats_t* stats)
+{
+    if (stats == NULL) return;
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    *stats = g_fanStats;
+    stats->jitter_avg_us = g_windowTicks ? (uint32_t)(g_jitterSumUs / g_windowTicks) : 0;
+    stats->duty_avg_pct = g_windowPeriods ? g_dutySum / g_windowPeriods : 0.0f;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+}
+
+/**
+ * @brief JSON report of the loop metrics; starts a new jitter/duty window
+ */
+int Thermostat_FormatFanReport(char* buffer, uint16_t size)
+{
+    Fan_Control_Stats_t stats;
+
+    portENTER_CRITICAL(&g_fanStatsMux);
+    stats = g_fanStats;
+    stats.jitter_avg_us = g_windowTicks ? (uint32_t)(g_jitterSumUs / g_windowTicks) : 0;
+    stats.duty_avg_pct = g_windowPeriods ? g_dutySum / g_windowPeriods : 0.0f;
+    g_fanStats.jitter_max_us = 0;
+    g_jitterSumUs = 0;
+    g_windowTicks = 0;
+    g_dutySum = 0.0f;
+    g_windowPeriods = 0;
+    portEXIT_CRITICAL(&g_fanStatsMux);
+
+    return snprintf(buffer, size,
+                    "{\"jitter_max_us\":%lu,\"jitter_avg_us\":%lu,\"missed\":%lu,"
+                    "\"demand\":%.1f,\"duty_avg\":%.1f,\"settle_ms\":%lu,"
+                    "\"settle_max_ms\":%lu,\"overshoot\":%.2f,\"settling\":%s,\"heating\":%s}",
+                    (unsigned long)stats.jitter_max_us, (unsigned long)stats.jitter_avg_us,
+                    (unsigned long)stats.missed_ticks, stats.demand_pct, stats.duty_avg_pct,
+                    (unsigned long)stats.settle_last_ms, (unsigned long)stats.settle_max_ms,
+                    stats.overshoot_c, stats.settling ? "true" : "false",
+                    g_status.heating ? "true" : "false");
+}
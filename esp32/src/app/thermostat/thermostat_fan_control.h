@@ -17,13 +17,24 @@ Thermostat_Mode_t Thermostat_GetMode(void);
 void Thermostat_SetFanSpeed(Fan_Speed_t speed);
 Fan_Speed_t Thermostat_GetFanSpeed (void);
 
+void Thermostat_SetGasPurge(bool active);
+bool Thermostat_IsGasPurge(void);
+
 bool Thermostat_SetTargetTemp(float temp);
 float Thermostat_GetTargetTemp(void);
 
 void Thermostat_StoreTemp(float temp);
 float Thermostat_GetTemp(void);
 
-void Fan_Logic (float target_temp, float current_temp);
+// Fixed-rate fan controller, called once per FAN_CTRL_PERIOD_MS tick
+void Thermostat_FanAuto(float target_temp, float current_temp, float dt_s);
+void Thermostat_FanManual(void);
+void Thermostat_FanOff(void);
+void Thermostat_FanRecordTick(int64_t now_us, uint32_t periods);
+
+void Thermostat_GetFanStats(Fan_Control_Stats_t* stats);
+int  Thermostat_FormatFanReport(char* buffer, uint16_t size);
+
 Thermostat_Status_t Thermostat_GetStatus(void);
 void Thermostat_PublishData(void);
 
@@ -0,0 +1,82 @@
+#include "thermostat_pid.h"
+
+static float Pid_Clamp(float value, float low, float high)
+{
+    if (value < low) return low;
+    if (value > high) return high;
+    return value;
+}
+
+void Thermostat_Pid_Init(Thermostat_Pid_t* pid, float out_min, float out_max,
+                         float rate_max, float d_alpha)
+{
+    pid->gains.kp = 0.0f;
+    pid->gains.ki = 0.0f;
+    pid->gains.kd = 0.0f;
+    pid->direction = 1.0f;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+    pid->rate_max = rate_max;
+    pid->d_alpha = Pid_Clamp(d_alpha, 0.0f, 1.0f);
+    Thermostat_Pid_Reset(pid);
+}
+
+void Thermostat_Pid_SetTuning(Thermostat_Pid_t* pid, const Thermostat_PidGains_t* gains,
+                              float direction)
+{
+    if (direction != pid->direction) {
+        Thermostat_Pid_Reset(pid);
+    }
+    pid->gains = *gains;
+    pid->direction = (direction < 0.0f) ? -1.0f : 1.0f;
+}
+
+void Thermostat_Pid_Reset(Thermostat_Pid_t* pid)
+{
+    pid->integral = 0.0f;
+    pid->d_filtered = 0.0f;
+    pid->prev_measurement = 0.0f;
+    pid->output = pid->out_min;
+    pid->primed = false;
+    pid->limited = false;
+}
+
+float Thermostat_Pid_Update(Thermostat_Pid_t* pid, float setpoint, float measurement, float dt_s)
+{
+    if (dt_s <= 0.0f) return pid->output;
+
+    float error = pid->direction * (setpoint - measurement);
+
+    // Derivative on measurement, low-passed: the sensor updates in steps
+    // slower than the control period
+    if (!pid->primed) {
+        pid->prev_measurement = measurement;
+        pid->primed = true;
+    }
+    float slope = (measurement - pid->prev_measurement) / dt_s;
+    pid->prev_measurement = measurement;
+    pid->d_filtered += pid->d_alpha * (slope - pid->d_filtered);
+
+    float p_term = pid->gains.kp * error;
+    float d_term = -pid->direction * pid->gains.kd * pid->d_filtered;
+    float i_candidate = pid->integral + pid->gains.ki * error * dt_s;
+
+    float unlimited = p_term + i_candidate + d_term;
+    float output = Pid_Clamp(unlimited, pid->out_min, pid->out_max);
+
+    if (pid->rate_max > 0.0f) {
+        float step = pid->rate_max * dt_s;
+        output = Pid_Clamp(output, pid->output - step, pid->output + step);
+    }
+
+    // Anti-windup: only integrate when it does not push further into a limit
+    pid->limited = (output != unlimited);
+    if (!pid->limited ||
+        (unlimited > output && error < 0.0f) ||
+        (unlimited < output && error > 0.0f)) {
+        pid->integral = Pid_Clamp(i_candidate, pid->out_min, pid->out_max);
+    }
+
+    pid->output = output;
+    return output;
+}
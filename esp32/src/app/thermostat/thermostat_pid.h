@@ -0,0 +1,70 @@
+/**
+ * @file thermostat_pid.h
+ * @brief Fixed-step PID for the fan demand loop
+ *
+ * @note The caller runs Thermostat_Pid_Update() at a fixed period and passes
+ *       that period as dt. The error is signed by the active direction
+ *       (heating: target - temp, cooling: temp - target), so a positive output
+ *       always means "more airflow". Integration is clamped while the output is
+ *       saturated or rate-limited (anti-windup). The derivative acts on the
+ *       measurement, so a new target does not kick the output.
+ */
+
+#ifndef THERMOSTAT_PID_H
+#define THERMOSTAT_PID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef struct {
+    float kp;               ///< Output % per °C of error
+    float ki;               ///< Output % per °C·s of accumulated error
+    float kd;               ///< Output % per °C/s of measurement slope
+} Thermostat_PidGains_t;
+
+typedef struct {
+    Thermostat_PidGains_t gains;
+    float direction;        ///< +1 heating, -1 cooling
+    float out_min;          ///< Output clamp (%)
+    float out_max;
+    float rate_max;         ///< Output slew limit (% per second)
+    float d_alpha;          ///< Derivative low-pass weight (0..1, 1 = unfiltered)
+
+    float integral;         ///< I contribution, already scaled by ki (%)
+    float d_filtered;       ///< Filtered measurement slope (°C/s)
+    float prev_measurement;
+    float output;           ///< Last (clamped, rate-limited) output (%)
+    bool  primed;           ///< prev_measurement is valid
+    bool  limited;          ///< Last output was clamped or rate-limited
+} Thermostat_Pid_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+void  Thermostat_Pid_Init(Thermostat_Pid_t* pid, float out_min, float out_max,
+                          float rate_max, float d_alpha);
+
+/**
+ * @brief Select gains and direction
+ * @note A direction flip resets the controller: integral action built up
+ *       while heating means nothing once the room needs cooling.
+ */
+void  Thermostat_Pid_SetTuning(Thermostat_Pid_t* pid, const Thermostat_PidGains_t* gains,
+                               float direction);
+
+/**
+ * @brief Clear integral, derivative and output state (output restarts at out_min)
+ */
+void  Thermostat_Pid_Reset(Thermostat_Pid_t* pid);
+
+/**
+ * @brief One control step
+ * @param setpoint     Target temperature (°C)
+ * @param measurement  Room temperature (°C)
+ * @param dt_s         Step length in seconds (the fixed control period)
+ * @return Demand in out_min..out_max (%)
+ */
+float Thermostat_Pid_Update(Thermostat_Pid_t* pid, float setpoint, float measurement, float dt_s);
+
+#endif // THERMOSTAT_PID_H
@@ -0,0 +1,379 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thermostat_precond.h"
+#include "thermostat_fan_control.h"
+#include "thermostat_config.h"
+#include "../occupancy/occupancy.h"
+#include "../../app_cfg.h"
+#include "esp_timer.h"
+
+// Schedule and model as stored in NVS
+typedef struct {
+    int64_t arrival;
+    float   setpoint;
+} Precond_Schedule_t;
+
+typedef struct {
+    float    rate_heat;
+    float    rate_cool;
+    uint32_t samples;
+} Precond_Model_t;
+
+static portMUX_TYPE       g_precondMux = portMUX_INITIALIZER_UNLOCKED;
+static Precond_Schedule_t g_schedule = { 0, 0.0f };
+static Precond_Model_t    g_model = { PRECOND_DEFAULT_RATE_C_PER_H, PRECOND_DEFAULT_RATE_C_PER_H, 0 };
+static int64_t            g_finishedArrival = 0;    // Last schedule run to the end
+static volatile bool      g_scheduleChanged = false;
+static volatile bool      g_modelDirty = false;
+// NVS writes wait for the processor: the setters run in the MQTT callback
+// and under the temperature mutex
+static volatile bool      g_scheduleSave = false;
+static volatile bool      g_modelSave = false;
+
+static Precond_State_t g_state = PRECOND_IDLE;
+static time_t          g_start = 0;
+static bool            g_arrivalMeasured = false;
+static bool            g_haveResult = false;
+static float           g_arrivalError = 0.0f;
+static TaskHandle_t    g_processor = NULL;
+static volatile bool   g_reportReady = false;
+
+// Learning: previous stored sample
+static float   g_prevTemp = 0.0f;
+static int64_t g_prevUs = 0;
+
+// ==================== INTERNAL ====================
+
+static bool Precond_ClockValid(time_t now)
+{
+    return now >= TIME_VALID_EPOCH;
+}
+
+/**
+ * @brief Number after "key": in a flat JSON object
+ */
+static bool Precond_JsonNumber(const char* json, const char* key, double* value)
+{
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    const char* p = strstr(json, pattern);
+    if (p == NULL) return false;
+    p = strchr(p + strlen(pattern), ':');
+    if (p == NULL) return false;
+
+    char* end = NULL;
+    *value = strtod(p + 1, &end);
+    return end != p + 1;
+}
+
+static void Precond_SaveSchedule(const Precond_Schedule_t* schedule)
+{
+    Preferences prefs;
+    if (prefs.begin(PRECOND_NVS_NS, false)) {
+        if (schedule->arrival != 0) {
+            prefs.putBytes("sched", schedule, sizeof(*schedule));
+        } else {
+            prefs.remove("sched");
+        }
+        prefs.end();
+    }
+}
+
+static void Precond_SaveModel(void)
+{
+    Precond_Model_t model;
+    portENTER_CRITICAL(&g_precondMux);
+    model = g_model;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    Preferences prefs;
+    if (prefs.begin(PRECOND_NVS_NS, false)) {
+        prefs.putBytes("model", &model, sizeof(model));
+        prefs.end();
+    }
+}
+
+/**
+ * @brief Seconds needed to move the room from temp to setpoint
+ */
+static int32_t Precond_LeadSeconds(float temp, float setpoint)
+{
+    portENTER_CRITICAL(&g_precondMux);
+    float rate = (setpoint >= temp) ? g_model.rate_heat : g_model.rate_cool;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    float lead = fabsf(setpoint - temp) / rate * 3600.0f + PRECOND_MARGIN_S;
+    if (lead > PRECOND_MAX_LEAD_S) lead = PRECOND_MAX_LEAD_S;
+    return (int32_t)lead;
+}
+
+static void Precond_Finish(const Precond_Schedule_t* schedule, bool no_show)
+{
+    if (g_state == PRECOND_ACTIVE && no_show) {
+        Occupancy_EndPrecondition();
+    }
+    g_state = PRECOND_IDLE;
+    g_start = 0;
+
+    // A schedule that arrived meanwhile stays; it is planned on the next pass
+    Precond_Schedule_t none = { 0, 0.0f };
+    portENTER_CRITICAL(&g_precondMux);
+    bool current = (g_schedule.arrival == schedule->arrival);
+    if (current) g_schedule = none;
+    g_finishedArrival = schedule->arrival;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    // The retained topic still holds this schedule; remember it so a
+    // reconnect does not arm it again
+    Preferences prefs;
+    if (prefs.begin(PRECOND_NVS_NS, false)) {
+        if (current) prefs.remove("sched");
+        prefs.putLong64("done", schedule->arrival);
+        prefs.end();
+    }
+
+    g_reportReady = true;
+}
+
+// ==================== PUBLIC API ====================
+
+void Thermostat_Precond_Init(void)
+{
+    Preferences prefs;
+    if (prefs.begin(PRECOND_NVS_NS, true)) {
+        Precond_Model_t model;
+        if (prefs.getBytes("model", &model, sizeof(model)) == sizeof(model) &&
+            model.rate_heat >= PRECOND_RATE_MIN_C_PER_H && model.rate_cool >= PRECOND_RATE_MIN_C_PER_H) {
+            g_model = model;
+        }
+        g_finishedArrival = prefs.getLong64("done", 0);
+        Precond_Schedule_t schedule;
+        if (prefs.getBytes("sched", &schedule, sizeof(schedule)) == sizeof(schedule)) {
+            g_schedule = schedule;
+            g_scheduleChanged = true;
+        }
+        prefs.end();
+    }
+
+    DEBUG_PRINT(PRECOND, "Model: heat %.2f / cool %.2f °C/h (%lu samples)",
+                g_model.rate_heat, g_model.rate_cool, (unsigned long)g_model.samples);
+}
+
+void Thermostat_Precond_SetProcessor(TaskHandle_t task)
+{
+    g_processor = task;
+    if (g_processor != NULL) xTaskNotifyGive(g_processor);
+}
+
+bool Thermostat_Precond_Schedule(const char* payload)
+{
+    Precond_Schedule_t schedule = { 0, 0.0f };
+    double arrival = 0, target = 0;
+
+    if (payload != NULL && payload[0] != '\0') {
+        if (!Precond_JsonNumber(payload, "arrival", &arrival)) return false;
+        if (arrival != 0) {
+            if (!Precond_JsonNumber(payload, "target", &target) ||
+                target < POT_TO_TEMP_MIN || target > POT_TO_TEMP_MAX) {
+                return false;
+            }
+            schedule.arrival = (int64_t)arrival;
+            schedule.setpoint = (float)target;
+        }
+    }
+
+    portENTER_CRITICAL(&g_precondMux);
+    // Already run to the end: the retained copy coming back after a reconnect
+    bool same = (g_schedule.arrival == schedule.arrival && g_schedule.setpoint == schedule.setpoint) ||
+                (schedule.arrival != 0 && schedule.arrival == g_finishedArrival);
+    if (!same) g_schedule = schedule;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    // Retained messages come back on every reconnect; only new ones hit flash
+    if (!same) {
+        g_scheduleSave = true;
+        g_scheduleChanged = true;
+        if (g_processor != NULL) xTaskNotifyGive(g_processor);
+    }
+    return true;
+}
+
+void Thermostat_Precond_RecordTemp(float temp)
+{
+    int64_t now = esp_timer_get_time();
+    float prev = g_prevTemp;
+    int64_t prev_us = g_prevUs;
+    g_prevTemp = temp;
+    g_prevUs = now;
+
+    if (prev_us == 0 || Thermostat_GetMode() != THERMOSTAT_MODE_AUTO) return;
+
+    float dt_h = (now - prev_us) / 3600e6f;
+    if (dt_h <= 0.0f || dt_h * 3600.0f > PRECOND_LEARN_MAX_GAP_S) return;
+
+    // Only a run where the fan was pushing towards a target still far away
+    Fan_Control_Stats_t fan;
+    Thermostat_GetFanStats(&fan);
+    float error = Thermostat_GetTargetTemp() - prev;
+    float moved = temp - prev;
+    if (fan.duty_pct < PRECOND_LEARN_MIN_DUTY_PCT || fabsf(error) < PRECOND_LEARN_MIN_ERROR_C ||
+        (error > 0.0f) != (moved > 0.0f)) {
+        return;
+    }
+
+    float rate = constrain(fabsf(moved) / dt_h, PRECOND_RATE_MIN_C_PER_H, PRECOND_RATE_MAX_C_PER_H);
+    bool save;
+    portENTER_CRITICAL(&g_precondMux);
+    float* learned = (error > 0.0f) ? &g_model.rate_heat : &g_model.rate_cool;
+    *learned += PRECOND_LEARN_ALPHA * (rate - *learned);
+    g_model.samples++;
+    save = (g_model.samples % PRECOND_LEARN_SAVE_EVERY) == 0;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    DEBUG_PRINT(PRECOND, "Learned %s rate %.2f °C/h", (error > 0.0f) ? "heat" : "cool", rate);
+    g_modelDirty = true;
+    if (save) {
+        g_modelSave = true;
+        if (g_processor != NULL) xTaskNotifyGive(g_processor);
+    }
+}
+
+void Thermostat_Precond_Process(void)
+{
+    // Flags first: a schedule stored after this still lands in the snapshot
+    bool save_schedule = g_scheduleSave;
+    if (save_schedule) g_scheduleSave = false;
+    bool save_model = g_modelSave;
+    if (save_model) g_modelSave = false;
+
+    Precond_Schedule_t schedule;
+    portENTER_CRITICAL(&g_precondMux);
+    schedule = g_schedule;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    if (save_schedule) Precond_SaveSchedule(&schedule);
+    if (save_model) Precond_SaveModel();
+
+    if (g_scheduleChanged) {
+        g_scheduleChanged = false;
+        if (g_state == PRECOND_ACTIVE) {
+            Occupancy_EndPrecondition();    // Re-planned below from the new schedule
+        }
+        g_state = (schedule.arrival != 0) ? PRECOND_WAITING : PRECOND_IDLE;
+        g_arrivalMeasured = false;
+        g_reportReady = true;
+        DEBUG_PRINT(PRECOND, "Schedule: arrival %lld, setpoint %.1f",
+                    (long long)schedule.arrival, schedule.setpoint);
+    }
+
+    if (g_modelDirty) {
+        g_modelDirty = false;
+        g_reportReady = true;
+    }
+
+    time_t now = time(NULL);
+    if (g_state == PRECOND_IDLE || !Precond_ClockValid(now)) return;
+
+    bool occupied = (Occupancy_GetState() == OCC_STATE_OCCUPIED);
+
+    if (g_state == PRECOND_WAITING) {
+        if (now >= schedule.arrival + PRECOND_NO_SHOW_S) {
+            Precond_Finish(&schedule, false);  // Stale (e.g. powered off meanwhile)
+            return;
+        }
+        time_t start = (time_t)schedule.arrival - Precond_LeadSeconds(Thermostat_GetTemp(), schedule.setpoint);
+        if (start != g_start) {
+            g_start = start;
+            g_reportReady = true;
+        }
+        if (now < start) return;
+
+        // Someone is already in the room at start time: it is in use, leave it be
+        if (occupied) {
+            DEBUG_PRINT(PRECOND, "Room occupied at start, nothing to do");
+            Precond_Finish(&schedule, false);
+            return;
+        }
+        Occupancy_BeginPrecondition(schedule.setpoint);
+        g_state = PRECOND_ACTIVE;
+        g_reportReady = true;
+        DEBUG_PRINT(PRECOND, "Start, %ld s before arrival", (long)(schedule.arrival - now));
+        return;
+    }
+
+    // PRECOND_ACTIVE
+    if (occupied || (!g_arrivalMeasured && now >= schedule.arrival)) {
+        // How close the prediction got: at the booked time, or on an early arrival
+        if (!g_arrivalMeasured) {
+            g_arrivalError = Thermostat_GetTemp() - schedule.setpoint;
+            g_arrivalMeasured = true;
+            g_haveResult = true;
+            g_reportReady = true;
+        }
+    }
+    if (occupied) {
+        DEBUG_PRINT(PRECOND, "Guest arrived");
+        Precond_Finish(&schedule, false);
+    } else if (now >= schedule.arrival + PRECOND_NO_SHOW_S) {
+        DEBUG_PRINT(PRECOND, "No-show, setback restored");
+        Precond_Finish(&schedule, true);
+    }
+}
+
+TickType_t Thermostat_Precond_WaitTicks(void)
+{
+    if (g_state == PRECOND_IDLE) return portMAX_DELAY;
+
+    uint32_t wait_ms = PRECOND_CHECK_PERIOD_MS;
+    time_t now = time(NULL);
+    if (g_state == PRECOND_WAITING && Precond_ClockValid(now) && g_start > now &&
+        (uint32_t)(g_start - now) * 1000UL < wait_ms) {
+        wait_ms = (uint32_t)(g_start - now) * 1000UL;
+    }
+    return pdMS_TO_TICKS(wait_ms) + 1;
+}
+
+void Thermostat_Precond_GetStats(Precond_Stats_t* stats)
+{
+    if (stats == NULL) return;
+
+    portENTER_CRITICAL(&g_precondMux);
+    stats->arrival = (time_t)g_schedule.arrival;
+    stats->setpoint = g_schedule.setpoint;
+    stats->rate_heat = g_model.rate_heat;
+    stats->rate_cool = g_model.rate_cool;
+    stats->samples = g_model.samples;
+    portEXIT_CRITICAL(&g_precondMux);
+
+    stats->state = g_state;
+    stats->start = g_start;
+    stats->have_result = g_haveResult;
+    stats->arrival_error_c = g_arrivalError;
+}
+
+bool Thermostat_Precond_TakeReport(char* buffer, uint16_t size)
+{
+    static const char* const names[] = { "idle", "waiting", "active" };
+
+    if (!g_reportReady) return false;
+    g_reportReady = false;
+
+    Precond_Stats_t s;
+    Thermostat_Precond_GetStats(&s);
+    int n = snprintf(buffer, size,
+                     "{\"state\":\"%s\",\"arrival\":%lld,\"setpoint\":%.1f,\"start\":%lld,"
+                     "\"rate_heat\":%.2f,\"rate_cool\":%.2f,\"samples\":%lu",
+                     names[s.state], (long long)s.arrival, s.setpoint, (long long)s.start,
+                     s.rate_heat, s.rate_cool, (unsigned long)s.samples);
+    if (n > 0 && n < size) {
+        if (s.have_result) {
+            snprintf(buffer + n, size - n, ",\"arrival_error_c\":%.1f}", s.arrival_error_c);
+        } else {
+            snprintf(buffer + n, size - n, "}");
+        }
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file thermostat_precond.h
+ * @brief Arrival pre-conditioning: reach the guest's setpoint by check-in
+ *
+ * @note The dashboard publishes the expected arrival (Unix time) and comfort
+ *       setpoint on MQTT_TOPIC_PRECOND. The schedule is kept in NVS and runs
+ *       from the SNTP-set system clock, so a network drop after it arrives
+ *       does not stop it. The start time is arrival - |setpoint - temp| /
+ *       rate - margin, where the heating and cooling rates (°C/h) are learned
+ *       from consecutive Thermostat_StoreTemp() samples taken while the fan
+ *       was driving towards the target.
+ */
+
+#ifndef THERMOSTAT_PRECOND_H
+#define THERMOSTAT_PRECOND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef enum {
+    PRECOND_IDLE = 0,       // No schedule
+    PRECOND_WAITING,        // Schedule held, start time not reached
+    PRECOND_ACTIVE,         // Setback lifted, driving to the setpoint
+} Precond_State_t;
+
+typedef struct {
+    Precond_State_t state;
+    time_t   arrival;           ///< Scheduled arrival (Unix s), 0 = none
+    float    setpoint;
+    time_t   start;             ///< Planned start for the current temperature
+    float    rate_heat;         ///< Learned °C/h
+    float    rate_cool;
+    uint32_t samples;           ///< Rate samples learned since the model was reset
+    bool     have_result;
+    float    arrival_error_c;   ///< temp - setpoint at the last arrival
+} Precond_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Load the learned model and any pending schedule from NVS
+ */
+void Thermostat_Precond_Init(void);
+
+/**
+ * @brief Task that runs Thermostat_Precond_Process() (room control task)
+ */
+void Thermostat_Precond_SetProcessor(TaskHandle_t task);
+
+/**
+ * @brief Parse and store a schedule from the MQTT payload
+ * @note Payload: {"arrival":<unix s>,"target":<°C>}; arrival 0 or an empty
+ *       payload cancels. The arrival of the last finished schedule is
+ *       ignored (retained copy). Safe from the MQTT callback: no publishing,
+ *       and the NVS write is left to Thermostat_Precond_Process().
+ * @return false if the payload was rejected
+ */
+bool Thermostat_Precond_Schedule(const char* payload);
+
+/**
+ * @brief Learn from one stored temperature sample (Thermostat_StoreTemp)
+ * @note Runs under the temperature mutex; the model is saved by the processor
+ */
+void Thermostat_Precond_RecordTemp(float temp);
+
+/**
+ * @brief Start / finish pre-conditioning when due
+ * @note Room control task with the room status mutex held (it drives the
+ *       occupancy setback)
+ */
+void Thermostat_Precond_Process(void);
+
+/**
+ * @brief Ticks until Thermostat_Precond_Process() is next due
+ */
+TickType_t Thermostat_Precond_WaitTicks(void);
+
+void Thermostat_Precond_GetStats(Precond_Stats_t* stats);
+
+/**
+ * @brief Status JSON, once per change (for MQTT_TOPIC_PRECOND_STATUS)
+ */
+bool Thermostat_Precond_TakeReport(char* buffer, uint16_t size);
+
+#endif // THERMOSTAT_PRECOND_H
@@ -2,14 +2,26 @@
 #include "thermostat_config.h"
 #include "thermostat_types.h"
 #include "thermostat_fan_control.h"
+#include "thermostat_precond.h"
 
 #include "../../hal/sensors/hal_mq5/hal_mq5.h"
 #include "../../hal/communication/hal_wifi/hal_wifi.h"
 #include "../../hal/communication/hal_mqtt/hal_mqtt.h"
 #include "../../hal/sensors/hal_dht/hal_dht.h"
 #include "../../hal/sensors/hal_potentiometer/hal_potentiometer.h"
+#include "../../hal/hal_power/hal_power.h"
 #include "../../app_cfg.h"
 #include "../room/room_rtos.h"
+#include "../room/room_report.h"
+#include "../app_rtos/app_rtos.h"
+#include "../rules/rules.h"
+#include "../occupancy/occupancy.h"
+#include "../access/access.h"
+#include "../cmd_trace/cmd_trace.h"
+#include "../shadow/shadow.h"
+#include "../../drivers/driver_adc/driver_adc.h"
+#include "../../hal/hal_led/hal_led.h"
+#include "esp_timer.h"
 // ==================== NAMING CONVENTIONS ====================
 // Functions:     PascalCase or camelCase (choose one)
 // Variables:     camelCase for locals, g_camelCase for globals
@@ -26,7 +38,7 @@ TaskHandle_t tempSensorTaskHandle   = NULL;
 TaskHandle_t userInputTaskHandle    = NULL;
 TaskHandle_t fanControlTaskHandle   = NULL;
 TaskHandle_t mqttPublishTaskHandle  = NULL;
-TaskHandle_t wifiTaskHandle         = NULL;
+TaskHandle_t gasSensorTaskHandle    = NULL;
 
 // ==================== GLOBAL VARIABLES ====================
 Thermostat_Status_t thermostat_values;
@@ -34,7 +46,9 @@ Thermostat_Status_t thermostat_values;
 // ==================== RTOS OBJECTS ====================
 EventGroupHandle_t thermostatEventGroup = NULL;
 QueueHandle_t mqttPublishQueue = NULL;
-SemaphoreHandle_t wifiConnectedSem = NULL;
+// Task_Mqtt waits on both: a message to publish, or a wake (room status)
+static SemaphoreHandle_t mqttWakeSem = NULL;
+static QueueSetHandle_t  mqttWaitSet = NULL;
 
 // ==================== DEBUG STATISTICS ====================
 #if DEBUG_ENABLED
@@ -43,7 +57,7 @@ TaskDebugStats_t g_tempSensorStats = {0};
 TaskDebugStats_t g_userInputStats = {0};
 TaskDebugStats_t g_fanControlStats = {0};
 TaskDebugStats_t g_mqttStats = {0};
-TaskDebugStats_t g_wifiStats = {0};
+TaskDebugStats_t g_gasSensorStats = {0};
 #endif
 
 // ==================== DEBUG HELPER FUNCTIONS ====================
@@ -57,8 +71,9 @@ void Debug_PrintStackUsage(const char* taskName, TaskHandle_t handle, TaskDebugS
             stats->minStackRemaining = stackRemaining;
         }
         
+        // ESP-IDF reports the high-water mark in bytes, not words
         Serial.printf("[STACK] %s: %u bytes free (min: %u)\n", 
-                     taskName, stackRemaining * 4, stats->minStackRemaining * 4);
+                     taskName, stackRemaining, stats->minStackRemaining);
     }
 }
 
@@ -68,7 +83,7 @@ void Debug_PrintAllStackUsage(void) {
     Debug_PrintStackUsage("UserInput", userInputTaskHandle, &g_userInputStats);
     Debug_PrintStackUsage("FanControl", fanControlTaskHandle, &g_fanControlStats);
     Debug_PrintStackUsage("MQTT", mqttPublishTaskHandle, &g_mqttStats);
-    Debug_PrintStackUsage("WiFi", wifiTaskHandle, &g_wifiStats);
+    Debug_PrintStackUsage("GasSensor", gasSensorTaskHandle, &g_gasSensorStats);
     Serial.println("========================================\n");
 }
 #endif
@@ -135,109 +150,29 @@ void InitThermostat(void) {
     Thermostat_Init_Hardware();
     DEBUG_PRINT(TEMP_SENSOR, "✓ Hardware OK");
     
-    // Create event group
-    thermostatEventGroup = xEventGroupCreate();
-    if (thermostatEventGroup == NULL) {
-        Serial.println("[ERROR] Event group failed!");
-        return;
-    }
+    // RTOS objects come from the static table in app_rtos_cfg.h
+    thermostatEventGroup = App_RTOS_CreateEventGroup(APP_EVENT_GROUP_THERMOSTAT);
     
     // Init fan control mutex
     Thermostat_InitMutexes();
+
+    // Learned thermal model and any schedule received before a reboot
+    Thermostat_Precond_Init();
     
-    // Create MQTT publish queue
-    mqttPublishQueue = xQueueCreate(5, sizeof(mqtt_pub_msg_t));
-    if (mqttPublishQueue == NULL) {
-        Serial.println("[ERROR] MQTT queue failed!");
-        return;
-    }
-    DEBUG_PRINT(MQTT, "✓ Queue created");
-    
-    // Create WiFi semaphore
-    wifiConnectedSem = xSemaphoreCreateBinary();
-    if (wifiConnectedSem == NULL) {
-        Serial.println("[ERROR] Semaphore failed!");
-        return;
-    }
-    DEBUG_PRINT(WIFI, "✓ Semaphore created");
-    
-    // Create tasks
-    BaseType_t result;
-    
-    result = xTaskCreate(
-        Task_TemperatureSensor,
-        "TempSensor",
-        TEMP_SENSOR_STACK_SIZE,
-        NULL,
-        TEMP_SENSOR_PRIORITY,
-        &tempSensorTaskHandle
-    );
-    if (result != pdPASS) {
-        Serial.println("[ERROR] Failed to create TempSensor task!");
-        return;
-    }
-    DEBUG_PRINT(TEMP_SENSOR, "Task created (Stack: %d, Priority: %d)", 
-                TEMP_SENSOR_STACK_SIZE, TEMP_SENSOR_PRIORITY);
-    
-    result = xTaskCreate(
-        Task_UserInput,
-        "UserInput",
-        USER_INPUT_STACK_SIZE,
-        NULL,
-        USER_INPUT_PRIORITY,
-        &userInputTaskHandle
-    );
-    if (result != pdPASS) {
-        Serial.println("[ERROR] Failed to create UserInput task!");
-        return;
-    }
-    DEBUG_PRINT(USER_INPUT, "Task created (Stack: %d, Priority: %d)", 
-                USER_INPUT_STACK_SIZE, USER_INPUT_PRIORITY);
-    
-    result = xTaskCreate(
-        Task_FanControl,
-        "FanControl",
-        FAN_CONTROL_STACK_SIZE,
-        NULL,
-        FAN_CONTROL_PRIORITY,
-        &fanControlTaskHandle
-    );
-    if (result != pdPASS) {
-        Serial.println("[ERROR] Failed to create FanControl task!");
-        return;
+    mqttPublishQueue = App_RTOS_CreateQueue(APP_QUEUE_MQTT_PUBLISH);
+    mqttWakeSem = App_RTOS_CreateSemaphore(APP_SEM_MQTT_WAKE);
+    mqttWaitSet = App_RTOS_CreateQueueSet(APP_QUEUE_SET_MQTT_WAIT);
+    if (mqttWaitSet != NULL) {
+        xQueueAddToSet(mqttPublishQueue, mqttWaitSet);
+        xQueueAddToSet(mqttWakeSem, mqttWaitSet);
+        Room_Report_SetWake(mqttWakeSem);
     }
-    DEBUG_PRINT(FAN_CONTROL, "Task created (Stack: %d, Priority: %d)", 
-                FAN_CONTROL_STACK_SIZE, FAN_CONTROL_PRIORITY);
     
-    result = xTaskCreate(
-        Task_Mqtt,
-        "MqttPublish",
-        MQTT_STACK_SIZE,
-        NULL,
-        MQTT_PRIORITY,
-        &mqttPublishTaskHandle
-    );
-    if (result != pdPASS) {
-        Serial.println("[ERROR] Failed to create MQTT task!");
-        return;
-    }
-    DEBUG_PRINT(MQTT, "Task created (Stack: %d, Priority: %d)", 
-                MQTT_STACK_SIZE, MQTT_PRIORITY);
-    
-    result = xTaskCreate(
-        Task_Wifi,
-        "Wifi_Task",
-        WIFI_STACK_SIZE,
-        NULL,
-        WIFI_PRIORITY,
-        &wifiTaskHandle
-    );
-    if (result != pdPASS) {
-        Serial.println("[ERROR] Failed to create WiFi task!");
-        return;
-    }
-    DEBUG_PRINT(WIFI, "Task created (Stack: %d, Priority: %d)", 
-                WIFI_STACK_SIZE, WIFI_PRIORITY);
+    tempSensorTaskHandle  = App_RTOS_CreateTask(APP_TASK_TEMP_SENSOR);
+    userInputTaskHandle   = App_RTOS_CreateTask(APP_TASK_USER_INPUT);
+    fanControlTaskHandle  = App_RTOS_CreateTask(APP_TASK_FAN_CONTROL);
+    mqttPublishTaskHandle = App_RTOS_CreateTask(APP_TASK_MQTT);
+    gasSensorTaskHandle   = App_RTOS_CreateTask(APP_TASK_GAS_SENSOR);
     
     Serial.println("[INIT] ✓ All tasks ready\n");
 }
@@ -277,9 +212,17 @@ void Task_TemperatureSensor(void* pvParameters) {
         g_tempSensorStats.lastRunTime = millis();
         #endif
         
-        // Read sensor (simulated with random for testing)
-        temperature = ReadTemperatureSensor(); // Random 15-35°C
-        humidity    = ReadHumiditySensor   ();
+        // One DHT22 transaction gives both values
+        DHT22_Reading_t reading;
+        if (DHT22_Read(&reading) != DHT22_OK) {
+            // Keep the last good values; never feed NAN/0 into the control loop
+            DEBUG_PRINT(TEMP_SENSOR, "✗ DHT22 invalid (status=%d, attempts=%u)",
+                        reading.status, reading.attempts);
+            vTaskDelay(pdMS_TO_TICKS(Occupancy_ScalePeriod(TEMP_SENSOR_SAMPLE_RATE_MS)));
+            continue;
+        }
+        temperature = reading.temperature;
+        humidity    = reading.humidity;
         
         DEBUG_PRINT(TEMP_SENSOR, "[%u] Temp=%.2f°C", g_tempSensorStats.taskRunCount, temperature);
         
@@ -327,7 +270,7 @@ void Task_TemperatureSensor(void* pvParameters) {
         }
         #endif
         
-        vTaskDelay(pdMS_TO_TICKS(TEMP_SENSOR_SAMPLE_RATE_MS));
+        vTaskDelay(pdMS_TO_TICKS(Occupancy_ScalePeriod(TEMP_SENSOR_SAMPLE_RATE_MS)));
     }
 }
 
@@ -335,77 +278,186 @@ void Task_TemperatureSensor(void* pvParameters) {
 
 
 
+// ==================== GAS DETECTION ====================
+// The detector runs on every ADC burst (ADC_ACQ_PERIOD_MS) using the raw burst
+// mean; the low-pass value used for telemetry would add several periods of lag.
+#define GAS_ROR_WINDOW_SAMPLES  (GAS_ROR_WINDOW_MS / ADC_ACQ_PERIOD_MS)
+#define GAS_NOTIFY_TIMEOUT_MS   (ADC_ACQ_PERIOD_MS * 4)
+
+typedef enum {
+    GAS_TRIP_NONE = 0,
+    GAS_TRIP_THRESHOLD,     // Absolute level reached
+    GAS_TRIP_RATE           // Fast rise, trips before the absolute level
+} Gas_Trip_t;
+
+typedef struct {
+    uint16_t history[GAS_ROR_WINDOW_SAMPLES];
+    uint8_t  head;
+    uint8_t  filled;
+    uint8_t  confirm;       // Consecutive bursts meeting a trip condition
+} Gas_Detector_t;
+
+static const char* const GAS_TRIP_NAMES[] = { "none", "threshold", "rate" };
+
 /**
- * @brief Task: Read user input (potentiometer) for target temperature
+ * @brief Feed one burst into the detector
+ * @param rise Set to the rise over the last GAS_ROR_WINDOW_MS (0 if falling)
+ * @return Trip cause once GAS_CONFIRM_SAMPLES bursts agree, else GAS_TRIP_NONE
+ */
+static Gas_Trip_t Gas_Evaluate(Gas_Detector_t* det, uint16_t raw, uint16_t* rise)
+{
+    // history[head] is the sample one full window ago once the ring is full
+    uint16_t oldest = (det->filled == GAS_ROR_WINDOW_SAMPLES) ? det->history[det->head] : raw;
+    det->history[det->head] = raw;
+    det->head = (uint8_t)((det->head + 1) % GAS_ROR_WINDOW_SAMPLES);
+    if (det->filled < GAS_ROR_WINDOW_SAMPLES) det->filled++;
+
+    *rise = (raw > oldest) ? (uint16_t)(raw - oldest) : 0;
+
+    Gas_Trip_t trip = GAS_TRIP_NONE;
+    if (raw >= GAS_ALARM_RAW_THRESHOLD) {
+        trip = GAS_TRIP_THRESHOLD;
+    } else if (*rise >= GAS_ROR_RAW_DELTA) {
+        trip = GAS_TRIP_RATE;
+    }
+
+    if (trip == GAS_TRIP_NONE) {
+        det->confirm = 0;
+        return GAS_TRIP_NONE;
+    }
+    if (det->confirm < GAS_CONFIRM_SAMPLES) det->confirm++;
+    return (det->confirm >= GAS_CONFIRM_SAMPLES) ? trip : GAS_TRIP_NONE;
+}
+
+/**
+ * @brief Publish the alarm state straight to the broker (retained)
+ * @note PubSubClient only publishes QoS 0, so delivery is covered by the
+ *       retained flag plus re-publishing every GAS_ALARM_REPEAT_MS while active
+ */
+static bool Gas_PublishAlarm(bool active, bool armed, Gas_Trip_t cause,
+                             uint16_t raw, uint16_t rise, uint32_t latencyMs)
+{
+    char payload[128];
+    snprintf(payload, sizeof(payload),
+             "{\"alarm\":%s,\"armed\":%s,\"cause\":\"%s\",\"raw\":%u,\"rise\":%u,\"latency_ms\":%lu}",
+             active ? "true" : "false", armed ? "true" : "false",
+             GAS_TRIP_NAMES[cause], raw, rise, (unsigned long)latencyMs);
+    return MQTT_PublishUrgent(MQTT_TOPIC_GAS_ALARM, payload, true, pdMS_TO_TICKS(GAS_PUBLISH_WAIT_MS));
+}
+
+/**
+ * @brief Task: Gas leak detection on every MQ5 burst, alarm publish and local response
  * @param pvParameters Unused
+ * @note Highest application priority. Woken by the ADC engine, so detection
+ *       runs within one burst of the sample. The alarm goes out from this task
+ *       through MQTT_PublishUrgent, never through mqttPublishQueue; routine
+ *       levels still take the queue.
  */
 void Task_GasSensor(void* pvParameters) {
     (void)pvParameters;
     
-    float gas_value = 0;
-    float last_gas_value = INVALID_TEMP_VALUE;
+    Gas_Detector_t detector = {};
+    Gas_Trip_t cause = GAS_TRIP_NONE;
+    bool alarm = false;
+    bool stateSent = false;         // Publish once at start to replace a stale retained alarm
+    int64_t detectedUs = 0;
+    uint32_t latencyMs = 0;
+    uint32_t clearSince = 0;
+    uint32_t lastAlarmPublish = 0;
+    uint32_t lastTelemetry = 0;
+    const uint32_t startMs = millis();
     mqtt_pub_msg_t msg;
     
-    #if DEBUG_TIMING
-    uint32_t startTime = 0;
-    uint32_t executionTime = 0;
-    #endif
-    
-    DEBUG_PRINT(USER_INPUT, "Started");
-    vTaskDelay(pdMS_TO_TICKS(1500));
+    ADC_Acq_SetListener(MQ5_PIN, xTaskGetCurrentTaskHandle());
+    DEBUG_PRINT(GAS_SENSOR, "Started (warm-up %u s)", (unsigned)(GAS_WARMUP_MS / 1000));
     
     while (1) {
-        #if DEBUG_TIMING
-        startTime = millis();
-        #endif
+        // One wake-up per ADC burst; the timeout only catches a stalled engine
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GAS_NOTIFY_TIMEOUT_MS)) == 0) {
+            DEBUG_PRINT(GAS_SENSOR, "✗ No ADC burst");
+            continue;
+        }
         
         #if DEBUG_ENABLED
-        g_userInputStats.taskRunCount++;
-        g_userInputStats.lastRunTime = millis();
+        g_gasSensorStats.taskRunCount++;
+        g_gasSensorStats.lastRunTime = millis();
         #endif
         
-        // Read potentiometer
-        MQ5_1_main();
-        gas_value = MQ5_1_value();
+        uint32_t now = millis();
+        uint16_t raw = ADC_Acq_GetLatest(MQ5_PIN);
+        uint16_t rise = 0;
+        Gas_Trip_t trip = Gas_Evaluate(&detector, raw, &rise);
+        
+        // The heater output drifts while warming up; keep filling the window only
+        bool armed = (now - startMs) >= GAS_WARMUP_MS;
+        if (!armed) trip = GAS_TRIP_NONE;
+        
+        if (!alarm && trip != GAS_TRIP_NONE) {
+            detectedUs = esp_timer_get_time();
+            latencyMs = 0;
+            alarm = true;
+            cause = trip;
+            clearSince = 0;
+            stateSent = false;
+            
+            // Local response first: it does not depend on the network
+            LED_ON(GAS_ALARM_LED_PIN);
+            Thermostat_SetGasPurge(true);
+            DEBUG_PRINT(GAS_SENSOR, "⚠ ALARM (%s) raw=%u rise=%u", GAS_TRIP_NAMES[cause], raw, rise);
+        }
+        else if (alarm) {
+            if (raw >= GAS_CLEAR_RAW_THRESHOLD) {
+                clearSince = 0;
+            } else if (clearSince == 0) {
+                clearSince = now;
+            } else if (now - clearSince >= GAS_CLEAR_HOLD_MS) {
+                alarm = false;
+                stateSent = false;
+                
+                LED_OFF(GAS_ALARM_LED_PIN);
+                Thermostat_SetGasPurge(false);
+                xEventGroupSetBits(thermostatEventGroup, MODE_UPDATED_BIT);  // Fan task re-applies mode
+                DEBUG_PRINT(GAS_SENSOR, "✓ Alarm cleared raw=%u", raw);
+            }
+        }
         
+        // Retry every burst until the state change is out, then repeat while active
+        if (!stateSent || (alarm && now - lastAlarmPublish >= GAS_ALARM_REPEAT_MS)) {
+            if (Gas_PublishAlarm(alarm, armed, alarm ? cause : GAS_TRIP_NONE, raw, rise, latencyMs)) {
+                if (alarm && latencyMs == 0) {
+                    // Detection -> frame handed to the TCP stack
+                    latencyMs = (uint32_t)((esp_timer_get_time() - detectedUs) / 1000);
+                    if (latencyMs == 0) latencyMs = 1;
+                    DEBUG_PRINT(GAS_SENSOR, "→ Alarm published in %lu ms", (unsigned long)latencyMs);
+                }
+                stateSent = true;
+                lastAlarmPublish = now;
+            }
+        }
         
-        // Check if target changed significantly
-        if (fabs(gas_value - last_gas_value) >= TARGET_TEMP_THRESHOLD) {
-            last_gas_value = gas_value;
-            
-            // Prepare MQTT message
-            msg.type = MQTT_PUB_TARGET;
-            msg.value = gas_value;
-            
-            // Send to queue
-            if (xQueueSend(mqttPublishQueue, &msg, pdMS_TO_TICKS(100)) == pdPASS) {
-                DEBUG_PRINT(USER_INPUT, "→ MQTT Queue");
+        // Routine level on the normal path; never block the safety loop on it
+        if (now - lastTelemetry >= GAS_TELEMETRY_INTERVAL_MS) {
+            lastTelemetry = now;
+            msg.type = MQTT_PUB_GAS;
+            msg.value = MQ5_1_ppm();
+            if (xQueueSend(mqttPublishQueue, &msg, 0) == pdPASS) {
+                DEBUG_PRINT(GAS_SENSOR, "→ MQTT Queue");
             } else {
-                DEBUG_PRINT(USER_INPUT, "✗ Queue FULL");
+                DEBUG_PRINT(GAS_SENSOR, "✗ Queue FULL");
             }
-            
-            // Signal fan control
-            xEventGroupSetBits(thermostatEventGroup, TARGET_UPDATED_BIT);
         }
         
-
-        
         #if DEBUG_STACK_MONITOR
         static uint32_t lastStackCheck = 0;
         if (millis() - lastStackCheck > STACK_MONITOR_INTERVAL_MS) {
-            Debug_PrintStackUsage("UserInput", userInputTaskHandle, &g_userInputStats);
+            Debug_PrintStackUsage("GasSensor", gasSensorTaskHandle, &g_gasSensorStats);
             lastStackCheck = millis();
         }
         #endif
-        
-        vTaskDelay(pdMS_TO_TICKS(INPUT_SAMPLE_RATE_MS));
     }
 }
 
 
-
-
-
 /**
  * @brief Task: Read user input (potentiometer) for target temperature
  * @param pvParameters Unused
@@ -436,8 +488,7 @@ void Task_UserInput(void* pvParameters) {
         g_userInputStats.lastRunTime = millis();
         #endif
         
-        // Read potentiometer
-        POT_main();
+        // Read potentiometer (updated by the sensor registry)
         pot_value = POT_value_Getter();
         target_temp = mapPotToTemp(pot_value);
         
@@ -445,6 +496,10 @@ void Task_UserInput(void* pvParameters) {
         
         // Check if target changed significantly
         if (fabs(target_temp - last_target_temp) >= TARGET_TEMP_THRESHOLD) {
+            // Turning the dial is a person in the room (not the first reading)
+            if (last_target_temp != INVALID_TEMP_VALUE) {
+                Occupancy_ReportActivity(OCC_EVIDENCE_DIAL);
+            }
             Thermostat_SetTargetTemp(target_temp);
             last_target_temp = target_temp;
             
@@ -478,7 +533,17 @@ void Task_UserInput(void* pvParameters) {
 }
 
 /**
- * @brief Task: Control fan based on temperature difference
+ * @brief esp_timer callback: release one control step
+ */
+static void Fan_TickCallback(void* arg) {
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+/**
+ * @brief Task: Fixed-rate fan control loop
+ * @note Runs every FAN_CTRL_PERIOD_MS off an esp_timer (hardware timer, not
+ *       the RTOS tick). Events only update the loop inputs; the PID and the
+ *       output stage run on the tick so the step size is constant.
  * @param pvParameters Unused
  */
 void Task_FanControl(void* pvParameters) {
@@ -490,24 +555,38 @@ void Task_FanControl(void* pvParameters) {
     bool target_valid = false;
     
     Thermostat_Mode_t current_mode = THERMOSTAT_MODE_OFF;
-    Fan_Speed_t manual_fan_speed = FAN_SPEED_OFF;
     
     DEBUG_PRINT(FAN_CONTROL, "Started");
     
+    esp_timer_create_args_t tickArgs = {};
+    tickArgs.callback = Fan_TickCallback;
+    tickArgs.arg = xTaskGetCurrentTaskHandle();
+    tickArgs.dispatch_method = ESP_TIMER_TASK;
+    tickArgs.name = "fan_ctrl";
+    tickArgs.skip_unhandled_events = true;     // One catch-up tick after light sleep
+    
+    esp_timer_handle_t tickTimer = NULL;
+    if (esp_timer_create(&tickArgs, &tickTimer) != ESP_OK ||
+        esp_timer_start_periodic(tickTimer, (uint64_t)FAN_CTRL_PERIOD_MS * 1000) != ESP_OK) {
+        Serial.println("[ERROR] Fan control timer failed");
+        vTaskDelete(NULL);
+    }
+    
     while (1) {
+        // Count > 1 means the task fell behind by that many periods
+        uint32_t periods = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        Thermostat_FanRecordTick(esp_timer_get_time(), periods);
+        
         #if DEBUG_ENABLED
         g_fanControlStats.taskRunCount++;
         g_fanControlStats.lastRunTime = millis();
         #endif
         
-        // Wait for any relevant event
-        EventBits_t bits = xEventGroupWaitBits(
+        // Collect pending events without blocking
+        EventBits_t bits = xEventGroupClearBits(
             thermostatEventGroup,
             TEMP_UPDATED_BIT | TARGET_UPDATED_BIT | TARGET_FROM_MQTT_BIT | 
-            MODE_UPDATED_BIT | FAN_SPEED_UPDATED_BIT,
-            pdTRUE,    // Clear bits after reading
-            pdFALSE,   // Wait for ANY bit (not all)
-            portMAX_DELAY
+            MODE_UPDATED_BIT | FAN_SPEED_UPDATED_BIT
         );
         
         // Process temperature update
@@ -517,18 +596,12 @@ void Task_FanControl(void* pvParameters) {
             DEBUG_PRINT(FAN_CONTROL, "Current: %.2f°C", current_temp);
         }
         
-        // Process target temperature update (from POT)
-        if (bits & TARGET_UPDATED_BIT) {
-            target_temp = Thermostat_GetTargetTemp();
-            target_valid = true;
-            DEBUG_PRINT(FAN_CONTROL, "Target(POT): %.1f°C", target_temp);
-        }
-        
-        // Process target temperature update (from MQTT)
-        if (bits & TARGET_FROM_MQTT_BIT) {
+        // Process target temperature update (from POT or MQTT)
+        if (bits & (TARGET_UPDATED_BIT | TARGET_FROM_MQTT_BIT)) {
             target_temp = Thermostat_GetTargetTemp();
             target_valid = true;
-            DEBUG_PRINT(FAN_CONTROL, "Target(MQTT): %.1f°C", target_temp);
+            DEBUG_PRINT(FAN_CONTROL, "Target(%s): %.1f°C",
+                        (bits & TARGET_FROM_MQTT_BIT) ? "MQTT" : "POT", target_temp);
         }
         
         // Process mode change (from MQTT)
@@ -540,14 +613,9 @@ void Task_FanControl(void* pvParameters) {
             DEBUG_PRINT(FAN_CONTROL, "Mode: %s", mode_str);
         }
         
-        // Process manual fan speed update (from MQTT)
+        // Manual speed was already applied by the MQTT handler
         if (bits & FAN_SPEED_UPDATED_BIT) {
-            manual_fan_speed = Thermostat_GetFanSpeed();
-            const char* speed_str = (manual_fan_speed == FAN_SPEED_OFF) ? "OFF" :
-                                    (manual_fan_speed == FAN_SPEED_LOW) ? "LOW" :
-                                    (manual_fan_speed == FAN_SPEED_MEDIUM) ? "MEDIUM" :
-                                    (manual_fan_speed == FAN_SPEED_HIGH) ? "HIGH" : "UNKNOWN";
-            DEBUG_PRINT(FAN_CONTROL, "Manual Speed: %s", speed_str);
+            DEBUG_PRINT(FAN_CONTROL, "Manual Speed: %d", Thermostat_GetFanSpeed());
         }
         
         // Execute fan control logic based on mode
@@ -555,30 +623,23 @@ void Task_FanControl(void* pvParameters) {
         
         switch (current_mode) {
             case THERMOSTAT_MODE_OFF:
-                // Turn off fan
-                DEBUG_PRINT(FAN_CONTROL, "[%u] Mode=OFF → Fan OFF", g_fanControlStats.taskRunCount);
-                Thermostat_SetFanSpeed(FAN_SPEED_OFF);
+                Thermostat_FanOff();
                 break;
             
             case THERMOSTAT_MODE_AUTO:
-                // Run automatic logic based on temperature difference
+                // PID on the signed error; the step is the nominal period so
+                // missed ticks are integrated, not dropped
                 if (temp_valid && target_valid) {
-                    float diff = target_temp - current_temp;
-                    DEBUG_PRINT(FAN_CONTROL, "[%u] Mode=AUTO, Δ=%.2f°C → Auto Logic", 
-                               g_fanControlStats.taskRunCount, diff);
-                    Fan_Logic(target_temp, current_temp);
-                } else {
+                    Thermostat_FanAuto(target_temp, current_temp,
+                                       (float)(periods * FAN_CTRL_PERIOD_MS) / 1000.0f);
+                } else if (bits & MODE_UPDATED_BIT) {
                     DEBUG_PRINT(FAN_CONTROL, "[%u] Mode=AUTO but missing data (temp=%d, target=%d)",
                                g_fanControlStats.taskRunCount, temp_valid, target_valid);
                 }
                 break;
             
             case THERMOSTAT_MODE_MANUAL:
-                // Use manually set fan speed
-                manual_fan_speed = Thermostat_GetFanSpeed();
-                DEBUG_PRINT(FAN_CONTROL, "[%u] Mode=MANUAL → Speed=%d", 
-                           g_fanControlStats.taskRunCount, manual_fan_speed);
-                Thermostat_SetFanSpeed(manual_fan_speed);
+                Thermostat_FanManual();
                 break;
             
             default:
@@ -586,6 +647,11 @@ void Task_FanControl(void* pvParameters) {
                 break;
         }
         
+        // MQTT commands take effect here, not in the handler that queued them
+        if (bits & TARGET_FROM_MQTT_BIT)  Cmd_Trace_AppliedType(CMD_TRACE_CMD_TARGET);
+        if (bits & MODE_UPDATED_BIT)      Cmd_Trace_AppliedType(CMD_TRACE_CMD_MODE);
+        if (bits & FAN_SPEED_UPDATED_BIT) Cmd_Trace_AppliedType(CMD_TRACE_CMD_FAN_SPEED);
+        
         #if DEBUG_STACK_MONITOR
         static uint32_t lastStackCheck = 0;
         if (millis() - lastStackCheck > STACK_MONITOR_INTERVAL_MS) {
@@ -603,13 +669,23 @@ void Task_FanControl(void* pvParameters) {
 void Task_Mqtt(void *pvParameters) {
     mqtt_pub_msg_t msg;
     char payload[16];
+    // One buffer for every report: static, because MQTT_Loop() runs the
+    // whole PubSubClient callback (NVS, Serial) on this stack
+    static char report[MQTT_REPORT_SIZE];
+    static_assert(MQTT_REPORT_SIZE >= SHADOW_DOC_MAX, "Report buffer must hold a shadow document");
+#if DEBUG_STACK_MONITOR
+    UBaseType_t stackLow = UINT32_MAX;
+#endif
     
     DEBUG_PRINT(MQTT, "Started - Waiting WiFi");
     
-    xSemaphoreTake(wifiConnectedSem, portMAX_DELAY);
-    DEBUG_PRINT(MQTT, "✓ WiFi ready");
-    
     for (;;) {
+        // Wait on the connectivity bit; nothing suspends this task from outside
+        if (!WIFI_IsConnected()) {
+            WIFI_WaitConnected(portMAX_DELAY);
+            DEBUG_PRINT(MQTT, "✓ WiFi ready");
+        }
+        
         #if DEBUG_ENABLED
         g_mqttStats.taskRunCount++;
         g_mqttStats.lastRunTime = millis();
@@ -619,17 +695,109 @@ void Task_Mqtt(void *pvParameters) {
             // Keep alive
             MQTT_Loop();
 
-            static bool subscribed = false;
-            if (!subscribed && MQTT_IsConnected())
+            #if DEBUG_STACK_MONITOR
+            // The callback just ran here: log every new low-water mark (bytes)
+            UBaseType_t stackFree = uxTaskGetStackHighWaterMark(NULL);
+            if (stackFree < stackLow) {
+                stackLow = stackFree;
+                Serial.printf("[STACK] MQTT: %u bytes never used\n", (unsigned)stackFree);
+            }
+            #endif
+
+            // (Re)subscribe after every broker connect; the shadow then
+            // starts over with a full snapshot
+            static uint32_t subscribedConnect = 0;
+            uint32_t connects = MQTT_GetConnectCount();
+            if (connects != subscribedConnect && MQTT_IsConnected())
             {
                 MQTT_SubscribeTopics();
-                subscribed = true;
+                Shadow_RequestFull();
+                subscribedConnect = connects;
             }
 
             Room_RTOS_MQTTWarrper();
 
-            // Check queue
-            if (xQueueReceive(mqttPublishQueue, &msg, pdMS_TO_TICKS(200)) == pdTRUE) {
+            // Reported state: snapshot after a connect, deltas afterwards
+            if (Shadow_TakeReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_SHADOW_REPORTED, report);
+            }
+
+            // Round-trip timing for commands sent with a correlation ID
+            while (Cmd_Trace_TakeReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_CMD_ACK, report);
+            }
+
+            // One-shot boot metric: reset -> WiFi -> first publish
+            static bool bootReported = false;
+            if (!bootReported && MQTT_GetFirstPublishMs() != 0) {
+                snprintf(report, sizeof(report),
+                         "{\"wifi_ms\":%lu,\"first_publish_ms\":%lu,\"fast_connect\":%s}",
+                         (unsigned long)WIFI_GetFirstConnectMs(),
+                         (unsigned long)MQTT_GetFirstPublishMs(),
+                         WIFI_UsedFastConnect() ? "true" : "false");
+                MQTT_Publish(MQTT_TOPIC_BOOT, report);
+                DEBUG_PRINT(MQTT, "Boot: %s", report);
+                bootReported = true;
+            }
+
+            if (WIFI_TakeRoamReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_WIFI_ROAM, report);
+            }
+
+            // Occupancy: on every state change and periodically
+            static uint32_t lastOccReport = 0;
+            if (Occupancy_TakeChange() || millis() - lastOccReport >= OCC_REPORT_INTERVAL_MS) {
+                Occupancy_FormatReport(report, sizeof(report));
+                MQTT_Publish(MQTT_TOPIC_OCCUPANCY, report);
+                lastOccReport = millis();
+            }
+
+            // Pre-conditioning plan / result, on change
+            if (Thermostat_Precond_TakeReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_PRECOND_STATUS, report);
+            }
+
+            // Outcome of the last rule load (boot, NVS or MQTT_TOPIC_RULES)
+            if (Rules_TakeReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_RULES_STATUS, report);
+            }
+
+            // Allowlist version and last update result (boot, MQTT_TOPIC_ACCESS)
+            if (Access_TakeReport(report, sizeof(report))) {
+                MQTT_Publish(MQTT_TOPIC_ACCESS_STATUS, report);
+            }
+
+            // Fan loop metrics (tick jitter, settling, mean duty) for tuning
+            static uint32_t lastFanReport = 0;
+            if (millis() - lastFanReport >= Occupancy_ScalePeriod(FAN_REPORT_INTERVAL_MS)) {
+                Thermostat_FormatFanReport(report, sizeof(report));
+                MQTT_Publish(MQTT_TOPIC_FAN_CTRL, report);
+                DEBUG_PRINT(FAN_CONTROL, "Report: %s", report);
+                lastFanReport = millis();
+            }
+
+            #if POWER_MGMT_ENABLED == STD_ON
+            // Periodic power report (modelled current, sleep share, latency cost)
+            static uint32_t lastPowerReport = 0;
+            if (millis() - lastPowerReport >= POWER_REPORT_INTERVAL_MS) {
+                Power_FormatReport(report, sizeof(report));
+                MQTT_Publish(MQTT_TOPIC_POWER, report);
+                lastPowerReport = millis();
+            }
+            #endif
+
+            // Wait for a message or a room status change; a pending status
+            // shortens the wait. This wait is the only pacing of the loop.
+            TickType_t wait = pdMS_TO_TICKS(Room_Report_WaitMs(200));
+            bool received;
+            if (mqttWaitSet != NULL) {
+                QueueSetMemberHandle_t ready = xQueueSelectFromSet(mqttWaitSet, wait);
+                if (ready == mqttWakeSem) xSemaphoreTake(mqttWakeSem, 0);
+                received = (ready == mqttPublishQueue) && xQueueReceive(mqttPublishQueue, &msg, 0) == pdTRUE;
+            } else {
+                received = xQueueReceive(mqttPublishQueue, &msg, wait) == pdTRUE;
+            }
+            if (received) {
                 switch (msg.type) {
                     case MQTT_PUB_TEMP:
                         snprintf(payload, sizeof(payload), "%.2f", msg.value);
@@ -649,75 +817,32 @@ void Task_Mqtt(void *pvParameters) {
                         DEBUG_PRINT(MQTT, "Pub: humidity=%s", payload);
                         break;
 
+                    case MQTT_PUB_GAS:
+                        snprintf(payload, sizeof(payload), "%.0f", msg.value);
+                        MQTT_Publish(MQTT_TOPIC_GAS, payload);
+                        DEBUG_PRINT(MQTT, "Pub: gas=%s", payload);
+                        break;
+
                     default:
                         DEBUG_PRINT(MQTT, "✗ Unknown type=%d", msg.type);
                         break;
                 }
             }
-        }
-        
-        #if DEBUG_STACK_MONITOR
-        static uint32_t lastStackCheck = 0;
-        if (millis() - lastStackCheck > STACK_MONITOR_INTERVAL_MS) {
-            Debug_PrintStackUsage("MQTT", mqttPublishTaskHandle, &g_mqttStats);
-            Debug_PrintQueueStatus();
-            lastStackCheck = millis();
-        }
-        #endif
-        
-        vTaskDelay(pdMS_TO_TICKS(200));
-    }
-}
 
-/**
- * @brief Task: WiFi connection management
- * @param pvParameters Unused
- */
-void Task_Wifi(void *pvParameters) {
-    static bool wasConnected = false;
-    
-    DEBUG_PRINT(WIFI, "Started");
-    
-    for (;;) {
-        #if DEBUG_ENABLED
-        g_wifiStats.taskRunCount++;
-        g_wifiStats.lastRunTime = millis();
-        #endif
-        
-        bool connected = WIFI_IsConnected();
-        
-        if (connected) {
-            if (!wasConnected) {
-                DEBUG_PRINT(WIFI, "✓ Connected");
-                
-                if (mqttPublishTaskHandle != NULL) {
-                    xSemaphoreGive(wifiConnectedSem);
-                    vTaskResume(mqttPublishTaskHandle);
-                }
-                wasConnected = true;
-            }
+            // Coalesced room status, published outside any room lock
+            Room_Report_Flush();
         } else {
-            if (wasConnected) {
-                DEBUG_PRINT(WIFI, "✗ Disconnected");
-                
-                if (mqttPublishTaskHandle != NULL) {
-                    vTaskSuspend(mqttPublishTaskHandle);
-                }
-                wasConnected = false;
-            }
+            // Connected but the client is not set up yet
+            vTaskDelay(pdMS_TO_TICKS(200));
         }
         
-        WIFI_Process();
-        
         #if DEBUG_STACK_MONITOR
         static uint32_t lastStackCheck = 0;
         if (millis() - lastStackCheck > STACK_MONITOR_INTERVAL_MS) {
-            Debug_PrintStackUsage("WiFi", wifiTaskHandle, &g_wifiStats);
-            Debug_PrintSystemInfo();  // Print full system info periodically
+            Debug_PrintStackUsage("MQTT", mqttPublishTaskHandle, &g_mqttStats);
+            Debug_PrintQueueStatus();
             lastStackCheck = millis();
         }
         #endif
-        
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
\ No newline at end of file
@@ -16,6 +16,6 @@ void Task_TemperatureSensor(void* pvParameters);
 void Task_UserInput(void* pvParameters);
 void Task_FanControl(void* pvParameters);
 void Task_Mqtt(void* pvParameters);
-void Task_Wifi(void* pvParameters);
+void Task_GasSensor(void* pvParameters);
 
 #endif
@@ -28,6 +28,21 @@ typedef struct {
     bool heating;           // Heating status
 } Thermostat_Status_t;
 
+// Fan controller metrics, read with Thermostat_GetFanStats()
+typedef struct {
+    uint32_t ticks;             // Control steps run
+    uint32_t missed_ticks;      // Periods that passed without a step of their own
+    uint32_t jitter_max_us;     // Worst |tick spacing - period| in the report window
+    uint32_t jitter_avg_us;     // Mean |tick spacing - period| in the report window
+    float    demand_pct;        // Latest PID output
+    float    duty_pct;          // Output actually applied (after gas purge / stage)
+    float    duty_avg_pct;      // Mean duty over the report window (energy proxy)
+    uint32_t settle_last_ms;    // Last completed settling time, 0 = none yet
+    uint32_t settle_max_ms;
+    float    overshoot_c;       // Overshoot past the target during the last settle
+    bool     settling;          // A target step is still being tracked
+} Fan_Control_Stats_t;
+
 #if DEBUG_ENABLED
 typedef struct {
     uint32_t taskRunCount;
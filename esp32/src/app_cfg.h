@@ -17,7 +17,7 @@
 #define UART_ENABLED        STD_ON
 #define ALARM_ENABLED       STD_OFF
 #define CHATAPP_ENABLED     STD_OFF
-#define SPI_ENABLED         STD_OFF
+#define SPI_ENABLED         STD_ON
 #define I2C_ENABLED         STD_OFF
 #define LED_ENABLED         STD_ON
 #define LITTLEFS_ENABLED    STD_OFF
@@ -27,6 +27,7 @@
 #define DHT22_ENABLED       STD_ON
 #define LDR_1_ENABLED       STD_ON
 #define MQ5_1_ENABLED       STD_ON
+#define POWER_MGMT_ENABLED  STD_ON
 /* =========================
  * Debug Flags
  * ========================= */
@@ -46,13 +47,30 @@
 #define DHT22_DEBUG         STD_ON
 #define LDR_1_DEBUG         STD_ON
 #define MQ5_1_DEBUG         STD_ON
+#define POWER_DEBUG         STD_ON
+#define RULES_DEBUG         STD_ON
+#define OCCUPANCY_DEBUG     STD_ON
+#define ACCESS_DEBUG        STD_ON
+#define CMD_TRACE_DEBUG     STD_OFF
+#define SHADOW_DEBUG        STD_ON
 /* =========================
  * UART Configuration
- * ========================= */
-#define UART_BAUD_RATE      9600
-#define UART_FRAME_LENGTH   SERIAL_8N1
-#define UART_TX_PIN         17
-#define UART_RX_PIN         16
+ * =========================
+ * Framed binary links to co-processors (driver_uart): 8N1, no flow control.
+ * GPIO 16/17 are shared with the alarm LEDs (ALARM_ENABLED).
+ */
+// X(id, uart_num, baud, tx_pin, rx_pin)
+#define UART_PORT_TABLE(X) \
+    X(LINK, UART_NUM_2, 921600, 17, 16)
+
+#define UART_RX_BUFFER          1024    // IDF driver ring per port (bytes)
+#define UART_TX_BUFFER          1024    // UART_SendFrame() only blocks when this is full
+#define UART_EVENT_QUEUE_LEN    16
+#define UART_RX_FRAMES          8       // Decoded frames per port, power of two
+#define UART_FRAME_MAX_PAYLOAD  64
+#define UART_IDLE_MS            50      // Link keeps the chip out of light sleep this long after its last byte
+#define UART_STACK_SIZE         3072
+#define UART_PRIORITY           3
 
 
 /* =========================
@@ -75,6 +93,27 @@
 #define I2C_SDA_PIN         21
 #define I2C_SCL_PIN         22
 #define I2C_FREQUENCY       1000000
+// GPIO 21/22 are also RFID_SS_PIN/RFID_RST_PIN: move the reader before
+// enabling I2C
+
+
+/* =========================
+ * Bus Manager
+ * =========================
+ * Every SPI/I2C device is a row here; driver_bus arbitrates the shared buses.
+ * X(id, bus, select, clock_hz, mode, priority)
+ *   select   SPI: CS pin, -1 if the device's library drives its own CS
+ *            I2C: 7-bit address
+ *   clock_hz 0 = the library sets its own clock (MFRC522_SPICLOCK)
+ *   mode     SPI mode (SPI_MODE0..3), ignored on I2C
+ *   priority BUS_PRIO_HIGH transactions are queued ahead of normal ones
+ */
+#define BUS_DEVICE_TABLE(X) \
+    X(RFID,     BUS_SPI,    -1,     0,      SPI_MODE0,  BUS_PRIO_HIGH)
+
+#define BUS_QUEUE_LEN           8       // Pending transactions per bus and priority
+#define BUS_STACK_SIZE          2048
+#define BUS_PRIORITY            4
 
 
 /* =========================
@@ -139,23 +178,90 @@
  * ========================= */
 
 #define DHT22_PIN           14
-#define DHT22_TYPE         DHT22
+#define DHT22_RMT_CHANNEL   4       // RMT RX channel capturing the DHT22 frame
+#define DHT22_MAX_RETRIES   2       // Extra transactions after a bad frame
+#define DHT22_RETRY_DELAY_MS 2000   // Sensor minimum sampling interval
 
 #define MQ5_PIN             33
 #define LDR_PIN             35
 
 
-#define ADC_MIN_RAW 0
-#define ADC_MAX_RAW 4095
-
 #define MQ5_MIN_MAPPED 0
 #define MQ5_MAX_MAPPED 255
 
-#define MQ5_MIN_RAW  0
-#define MQ5_MAX_RAW  4095
+/* =========================
+ * Gas Leak Detection
+ * ========================= */
+// Evaluated on every ADC burst (ADC_ACQ_PERIOD_MS) from the raw burst mean
+#define GAS_ALARM_LED_PIN           13      // Local alarm indicator / buzzer driver
+#define GAS_ALARM_RAW_THRESHOLD     2400    // Absolute level that trips the alarm
+#define GAS_CLEAR_RAW_THRESHOLD     2000    // Level the reading must fall below to clear
+#define GAS_CLEAR_HOLD_MS           5000    // Time below the clear level before release
+#define GAS_ROR_WINDOW_MS           1000    // Rate-of-rise look-back
+#define GAS_ROR_RAW_DELTA           400     // Rise within the window that trips the alarm
+#define GAS_CONFIRM_SAMPLES         2       // Consecutive bursts needed to trip (spike reject)
+#define GAS_WARMUP_MS               60000   // MQ5 heater settle time, detector muted
+#define GAS_ALARM_REPEAT_MS         1000    // Re-publish period while the alarm is active
+#define GAS_PUBLISH_WAIT_MS         20      // Max wait for the MQTT client on an alarm
+#define GAS_TELEMETRY_INTERVAL_MS   10000   // Routine gas level through the publish queue
 
 #define ADC_RESOLUTION 12
-#define LDR_SAMPLE_COUNT 5
+
+/* =========================
+ * ADC Acquisition (DMA)
+ * ========================= */
+// ADC1 pins sampled together by driver_adc: X(pin)
+#define ADC_ACQ_CHANNEL_TABLE(X) \
+    X(LDR_PIN)  \
+    X(MQ5_PIN)  \
+    X(POT_PIN)
+
+#define ADC_ACQ_SAMPLE_FREQ_HZ      20000   // Lowest DMA rate on ESP32, shared by all channels
+#define ADC_ACQ_SAMPLES_PER_CHANNEL 64      // Oversampling per burst
+#define ADC_ACQ_PERIOD_MS           50      // One burst (~10 ms) per period
+#define ADC_ACQ_IIR_SHIFT           2       // Low-pass across bursts, alpha = 1/4
+#define ADC_ACQ_STACK_SIZE          2048
+#define ADC_ACQ_PRIORITY            4       // Paces the gas detector; blocked on DMA almost all the time
+
+/* =========================
+ * Sensor Registry
+ * ========================= */
+// Analog sensors updated in one batched pass after every ADC burst.
+// X(id, enabled, pin, resolution_bits, period_ms, out_min, out_max, filter...)
+//   period_ms     update rate, rounded up to whole ADC_ACQ_PERIOD_MS bursts
+//   out_min/max   linear scaling of the full input range
+//   filter        SensorFilter.h type run at the sensor rate (last, may contain commas)
+#define SENSORH_TABLE(X) \
+    X(LDR_1,  LDR_1_ENABLED,  LDR_PIN,  ADC_RESOLUTION,  100,  0,               100,             SensorFilter_Chain<SensorFilter_Median<5>, SensorFilter_Ema<2>>) \
+    X(MQ5_1,  MQ5_1_ENABLED,  MQ5_PIN,  ADC_RESOLUTION,  250,  MQ5_MIN_MAPPED,  MQ5_MAX_MAPPED,  SensorFilter_Kalman<4, 400>) \
+    X(POT_1,  POT_ENABLED,    POT_PIN,  POT_RESOLUTION,  100,  0,               4095,            SensorFilter_Chain<SensorFilter_Median<3>, SensorFilter_Ema<2>>)
+
+/* =========================
+ * Sensor Calibration
+ * ========================= */
+// Engineering-unit curves, tabulated once at boot (SensorCal) over the pin
+// voltage from the eFuse-calibrated ADC. Re-measure R0 / R10 per batch.
+#define SENSORCAL_POINTS            33      // Table points per curve
+
+// LDR from 3V3 to the pin, fixed resistor from the pin to GND
+#define LDR_SUPPLY_MV               3300
+#define LDR_FIXED_OHM               10000
+#define LDR_R10_OHM                 15000   // LDR resistance at 10 lux
+#define LDR_GAMMA                   0.7f    // log(R) / log(lux) slope
+#define LDR_MAX_LUX                 20000
+
+// MQ5 module: 5 V heater/divider, output scaled into the ADC range
+#define MQ5_SUPPLY_MV               5000
+#define MQ5_OUT_SCALE               1.5f    // Sensor output / pin voltage (10k:20k divider)
+#define MQ5_LOAD_OHM                20000   // RL on the module
+#define MQ5_R0_OHM                  10000   // Rs in clean air, measure per sensor
+#define MQ5_CURVE_A                 1163.8f // ppm = A * (Rs/R0)^B, LPG curve
+#define MQ5_CURVE_B                 -3.874f
+#define MQ5_MAX_PPM                 10000
+
+// Potentiometer wiper across 3V3 -> target temperature (linear). The curve
+// ends at the ADC full-scale reading; this is only used until it is known
+#define POT_SUPPLY_MV               3300
 
 /* =========================
  * WiFi Configuration
@@ -163,6 +269,36 @@
 #define WIFI_SSID           "maha"
 #define WIFI_PASSWORD       "000000000"
 
+// Fast connect: reuse the last channel/BSSID/lease (RTC memory, NVS after a
+// power cycle) to associate without a scan and skip DHCP
+#define WIFI_FAST_CONNECT_ENABLED       STD_ON
+#define WIFI_FAST_CONNECT_STATIC_IP     STD_ON
+#define WIFI_FAST_CONNECT_TIMEOUT_MS    2000   // Then fall back to scan + DHCP
+
+// Fallback networks tried in order after the primary fails: X(ssid, password)
+#define WIFI_FALLBACK_TABLE(X) \
+    /* X("hotel-floor1-backup", "password") */
+
+// Roaming between APs that share the SSID
+#define WIFI_ROAM_ENABLED               STD_ON
+#define WIFI_ROAM_CHECK_INTERVAL_MS     5000
+#define WIFI_ROAM_RSSI_THRESHOLD_DBM    (-72)  // Averaged RSSI below this -> scan
+#define WIFI_ROAM_LOSS_THRESHOLD_PCT    20     // Publish failures above this -> scan
+#define WIFI_ROAM_LOSS_MIN_SAMPLES      5
+#define WIFI_ROAM_HYSTERESIS_DB         8      // Candidate must beat current by this
+#define WIFI_ROAM_SCAN_BACKOFF_MS       30000  // Minimum time between roam scans
+#define WIFI_ROAM_SCAN_DWELL_MS         120    // Active scan time per channel
+
+// Connection manager task: WiFi/IP events and the timer only notify it
+#define WIFI_STACK_SIZE                 4096
+#define WIFI_PRIORITY                   2
+
+
+/* =========================
+ * Time Configuration
+ * ========================= */
+#define NTP_SERVER          "pool.ntp.org"     // SNTP starts on every WiFi connect
+#define TIME_VALID_EPOCH    1700000000L        // Clock is set once past this (UTC)
 
 /* =========================
  * MQTT Configuration
@@ -170,6 +306,15 @@
 #define MQTT_BROKER         "mqtt.saddevastator.qzz.io"
 #define MQTT_PORT           1883
 #define MQTT_RECONNECT_MS   5000
+#define MQTT_BIRTH_ONLINE   "online"           // Retained on connect
+#define MQTT_WILL_OFFLINE   "offline"          // Last will
+#define MQTT_BUFFER_SIZE    1280               // Fits RULES_SOURCE_MAX plus header
+
+/* =========================
+ * Room Identity / Card Tokens
+ * ========================= */
+#define ROOM_NUMBER             101                     // Matches the hotel/101 topics
+#define ACCESS_TOKEN_KEY_ID     1                       // Bump when the key is rotated
 /* =========================
  * MQTT Topics
  * ========================= */
@@ -181,8 +326,10 @@
 #define ROOM_TOPIC_LED2_STATUS  "room/led2/status"
 #define ROOM_TOPIC_LDR_RAW      "room/ldr/raw"
 #define ROOM_TOPIC_LDR_PERCENT  "room/ldr/percentage"
+#define ROOM_TOPIC_LDR_LUX      "room/ldr/lux"
 #define ROOM_TOPIC_MODE_CTRL    "room/mode/control"      // Set mode: AUTO/MANUAL/OFF
 #define ROOM_TOPIC_MODE_STATUS  "room/mode/status"       // Current mode status
+#define ROOM_TOPIC_STATUS       "room/status"            // Coalesced mode + lights (room_report.h)
 #define ROOM_TOPIC_AUTO_DIM     "room/auto_dim/control"  // Deprecated - use mode instead
 
 #define MQTT_TOPIC_TEMP         "hotel/101/telemetry/temperature"
@@ -190,9 +337,49 @@
 #define MQTT_TOPIC_TARGET       "hotel/101/control/target_temp"
 #define MQTT_TOPIC_HEATING      "home/thermostat/heating"
 #define MQTT_TOPIC_LUMINOSITY   "hotel/101/telemetry/luminosity"
-#define MQTT_TOPIC_GAS          "home/thermostat/gas"
+#define MQTT_TOPIC_GAS          "hotel/101/telemetry/gas"
+#define MQTT_TOPIC_GAS_ALARM    "hotel/101/alarm/gas"
 #define MQTT_TOPIC_CONTROL      "hotel/101/control/mode"
 #define MQTT_TOPIC_SET_SPEED    "hotel/101/control/fan_speed"
+#define MQTT_TOPIC_POWER        "hotel/101/telemetry/power"
+#define MQTT_TOPIC_FAN_CTRL     "hotel/101/telemetry/fan_ctrl"
+#define MQTT_TOPIC_STATUS       "hotel/101/status"
+#define MQTT_TOPIC_BOOT         "hotel/101/telemetry/boot"
+#define MQTT_TOPIC_WIFI_ROAM    "hotel/101/telemetry/wifi_roam"
+#define MQTT_TOPIC_OCCUPANCY    "hotel/101/telemetry/occupancy"
+#define MQTT_TOPIC_PRECOND      "hotel/101/control/precondition"  // {"arrival":<unix s>,"target":22.5}
+#define MQTT_TOPIC_PRECOND_STATUS "hotel/101/telemetry/precondition"
+#define MQTT_TOPIC_RULES        "hotel/101/config/rules"          // Retained rule source
+#define MQTT_TOPIC_RULES_STATUS "hotel/101/config/rules/status"   // Compile result
+#define MQTT_TOPIC_ACCESS       "hotel/101/config/access"         // Signed allowlist updates
+#define MQTT_TOPIC_ACCESS_STATUS "hotel/101/config/access/status" // Version, card count, last result
+#define MQTT_TOPIC_JOURNAL      "hotel/101/audit/access"          // Compressed decision records
+#define MQTT_TOPIC_JOURNAL_ACK  "hotel/101/audit/access/ack"      // Last stored sequence number
+#define MQTT_TOPIC_CMD_ACK      "hotel/101/telemetry/cmd_ack"     // Per-command stage timings
+#define MQTT_TOPIC_SHADOW_DESIRED  "hotel/101/shadow/desired"     // Retained, set by the cloud
+#define MQTT_TOPIC_SHADOW_REPORTED "hotel/101/shadow/reported"    // Snapshot on connect, then deltas
+#define MQTT_TOPIC_SHADOW_GET      "hotel/101/shadow/get"         // Any payload: send a snapshot
+
+/* =========================
+ * Command Tracing
+ * =========================
+ * A control payload may end in "@<id>" ("ON@d41f", "22.5@17"). The id is
+ * stripped before parsing and the command's stage times are acknowledged on
+ * MQTT_TOPIC_CMD_ACK once its effect is applied and echoed.
+ */
+// Traced control topics: X(id, name, topic)
+#define CMD_TRACE_CMD_TABLE(X) \
+    X(TARGET,       "target",       MQTT_TOPIC_TARGET)      \
+    X(MODE,         "mode",         MQTT_TOPIC_CONTROL)     \
+    X(FAN_SPEED,    "fan_speed",    MQTT_TOPIC_SET_SPEED)   \
+    X(ROOM_MODE,    "room_mode",    ROOM_TOPIC_MODE_CTRL)   \
+    X(LED1,         "led1",         ROOM_TOPIC_LED1_CTRL)   \
+    X(LED2,         "led2",         ROOM_TOPIC_LED2_CTRL)
+
+#define CMD_TRACE_SEPARATOR     '@'
+#define CMD_TRACE_ID_MAX        16      // Characters, [A-Za-z0-9_-]
+#define CMD_TRACE_SLOTS         8       // Commands in flight
+#define CMD_TRACE_TIMEOUT_MS    5000    // Never applied: acknowledged as "timeout"
 
 
 
@@ -209,6 +396,24 @@
 #define HUMIDITY_MAX        90.0f
 
 
+/* =========================
+ * Power Management Configuration
+ * ========================= */
+// Light sleep and tickless idle also need a core built with
+// CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#define POWER_CPU_FREQ_MAX_MHZ          240
+#define POWER_CPU_FREQ_MIN_MHZ          80     // Keeps APB at 80 MHz for LEDC/UART
+#define POWER_LIGHT_SLEEP_ENABLE        STD_ON
+#define POWER_WIFI_MODEM_SLEEP_ENABLE   STD_ON // DTIM-based (WIFI_PS_MIN_MODEM)
+#define POWER_WIFI_DTIM_PERIOD_MS       307    // AP beacon 102.4 ms x DTIM 3
+#define POWER_REPORT_INTERVAL_MS        60000
+
+// Current model used for the average draw estimate (ESP32 datasheet typ.)
+#define POWER_CURRENT_ACTIVE_MA         45.0f  // 80-240 MHz DFS + modem sleep
+#define POWER_CURRENT_LIGHT_SLEEP_MA    0.8f
+#define POWER_CURRENT_DTIM_WAKE_MA      2.0f   // Beacon wakeups averaged over DTIM
+
+
 /* =========================
  * System Configuration
  * ========================= */
@@ -0,0 +1,289 @@
+/**
+ * @file driver_adc.cpp
+ * @brief Implementation of the DMA ADC acquisition engine
+ */
+
+#include <Arduino.h>
+#include "driver_adc.h"
+#include "../../app_cfg.h"
+#include "../../app/app_rtos/app_rtos.h"
+
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+// ==================== MACROS ====================
+
+#if SENSORH_DEBUG == STD_ON
+    #define ADC_DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+    #define ADC_DEBUG_PRINTF(...) ((void)0)
+#endif
+
+#define ADC_ACQ_PIN_COUNT       40      // ESP32 GPIO numbers
+#define ADC_ACQ_ADC1_CHANNELS   8
+#define ADC_ACQ_READ_TIMEOUT_MS 50
+#define ADC_ACQ_DEFAULT_VREF_MV 1100    // Only used on chips without eFuse calibration
+#define ADC_ACQ_MV_LUT_SHIFT    6       // One calibration point every 64 codes
+#define ADC_ACQ_MV_LUT_SIZE     ((4096 >> ADC_ACQ_MV_LUT_SHIFT) + 1)
+
+// ==================== CHANNEL TABLE ====================
+
+#define ADC_ACQ_PIN_ENTRY(pin) pin,
+static const uint8_t g_pins[] = {
+    ADC_ACQ_CHANNEL_TABLE(ADC_ACQ_PIN_ENTRY)
+};
+
+#define ADC_ACQ_CHANNEL_COUNT   (sizeof(g_pins) / sizeof(g_pins[0]))
+#define ADC_ACQ_FRAME_BYTES     (ADC_ACQ_SAMPLES_PER_CHANNEL * ADC_ACQ_CHANNEL_COUNT * SOC_ADC_DIGI_RESULT_BYTES)
+
+static_assert(ADC_ACQ_CHANNEL_COUNT <= ADC_ACQ_ADC1_CHANNELS, "Only ADC1 channels can use DMA");
+static_assert((ADC_ACQ_FRAME_BYTES % 4) == 0, "DMA frame must be a multiple of 4 bytes");
+
+// ==================== STATE ====================
+
+static bool g_started = false;
+
+static int8_t g_slotByPin[ADC_ACQ_PIN_COUNT];
+static int8_t g_slotByChannel[ADC_ACQ_ADC1_CHANNELS];
+
+static uint8_t g_frame[ADC_ACQ_FRAME_BYTES];
+
+// Written only by the consumer task; 16-bit reads are atomic
+static volatile uint16_t g_filtered[ADC_ACQ_CHANNEL_COUNT];
+static volatile uint16_t g_latest[ADC_ACQ_CHANNEL_COUNT];
+static volatile uint32_t g_readyMask = 0;
+static int32_t g_filterQ4[ADC_ACQ_CHANNEL_COUNT];     // Low-pass state, raw * 16
+static TaskHandle_t volatile g_listener[ADC_ACQ_CHANNEL_COUNT];
+static volatile ADC_Acq_FrameHook_t g_frameHook = NULL;
+
+static ADC_Acq_Stats_t g_stats;
+
+// Raw code -> mV from the eFuse characterisation, built once in ADC_Acq_Init()
+static uint16_t g_mvLut[ADC_ACQ_MV_LUT_SIZE];
+static esp_adc_cal_value_t g_calSource = ESP_ADC_CAL_VAL_DEFAULT_VREF;
+
+// ==================== PRIVATE FUNCTIONS ====================
+
+/**
+ * @brief Sample the calibrated transfer curve into g_mvLut
+ * @note esp_adc_cal_raw_to_voltage() is too slow for the sample path; the
+ *       curve is smooth, so 64 linear segments keep the error below 1 mV
+ */
+static void ADC_Acq_BuildMvLut(void)
+{
+    esp_adc_cal_characteristics_t chars;
+    g_calSource = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                           ADC_ACQ_DEFAULT_VREF_MV, &chars);
+
+    for (uint16_t i = 0; i < ADC_ACQ_MV_LUT_SIZE; i++) {
+        uint32_t raw = (uint32_t)i << ADC_ACQ_MV_LUT_SHIFT;
+        if (raw > 4095) raw = 4095;
+        g_mvLut[i] = (uint16_t)esp_adc_cal_raw_to_voltage(raw, &chars);
+    }
+}
+
+/**
+ * @brief Average each channel over the burst, then low-pass across bursts
+ */
+static void ADC_Acq_ProcessFrame(uint32_t length)
+{
+    uint32_t sum[ADC_ACQ_CHANNEL_COUNT] = {0};
+    uint16_t count[ADC_ACQ_CHANNEL_COUNT] = {0};
+
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t* sample = (const adc_digi_output_data_t*)&g_frame[i];
+        uint8_t channel = sample->type1.channel;
+        int8_t slot = (channel < ADC_ACQ_ADC1_CHANNELS) ? g_slotByChannel[channel] : -1;
+
+        if (slot < 0) {
+            g_stats.dropped++;
+            continue;
+        }
+        sum[slot] += sample->type1.data;
+        count[slot]++;
+    }
+
+    for (uint8_t slot = 0; slot < ADC_ACQ_CHANNEL_COUNT; slot++) {
+        if (count[slot] == 0) continue;
+
+        // Oversampled mean; N samples cut white noise by sqrt(N)
+        uint16_t mean = (uint16_t)((sum[slot] + count[slot] / 2) / count[slot]);
+        g_latest[slot] = mean;
+
+        if (!(g_readyMask & (1UL << slot))) {
+            g_filterQ4[slot] = (int32_t)mean << 4;
+            g_readyMask |= (1UL << slot);
+        } else {
+            g_filterQ4[slot] += (((int32_t)mean << 4) - g_filterQ4[slot]) >> ADC_ACQ_IIR_SHIFT;
+        }
+        g_filtered[slot] = (uint16_t)((g_filterQ4[slot] + 8) >> 4);
+        g_stats.samples += count[slot];
+
+        TaskHandle_t listener = g_listener[slot];
+        if (listener != NULL) xTaskNotifyGive(listener);
+    }
+    g_stats.frames++;
+}
+
+/**
+ * @brief Run one DMA burst and decode it
+ * @note The converter only runs for the burst, so the I2S/ADC clock is off
+ *       (and light sleep allowed) for the rest of the period
+ */
+static void ADC_Acq_Burst(void)
+{
+    uint32_t length = 0;
+
+    adc_digi_start();
+    esp_err_t err = adc_digi_read_bytes(g_frame, sizeof(g_frame), &length, ADC_ACQ_READ_TIMEOUT_MS);
+    adc_digi_stop();
+
+    if (err == ESP_OK && length > 0) {
+        ADC_Acq_ProcessFrame(length);
+
+        ADC_Acq_FrameHook_t hook = g_frameHook;
+        if (hook != NULL) hook();
+    } else {
+        g_stats.errors++;
+    }
+
+    // Drop any partial frame queued before the stop took effect
+    uint32_t stale = 0;
+    while (adc_digi_read_bytes(g_frame, sizeof(g_frame), &stale, 0) == ESP_OK && stale > 0) {
+        g_stats.dropped += stale / SOC_ADC_DIGI_RESULT_BYTES;
+    }
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+bool ADC_Acq_Init(void)
+{
+#if SENSORH_ENABLED == STD_ON
+    if (g_started) return true;
+
+    static adc_digi_pattern_config_t pattern[ADC_ACQ_CHANNEL_COUNT];
+    uint32_t channelMask = 0;
+
+    memset(g_slotByPin, -1, sizeof(g_slotByPin));
+    memset(g_slotByChannel, -1, sizeof(g_slotByChannel));
+
+    for (uint8_t slot = 0; slot < ADC_ACQ_CHANNEL_COUNT; slot++) {
+        int8_t channel = digitalPinToAnalogChannel(g_pins[slot]);
+        if (channel < 0 || channel >= ADC_ACQ_ADC1_CHANNELS) {
+            ADC_DEBUG_PRINTF("[ADC] GPIO%u is not an ADC1 pin\n", g_pins[slot]);
+            return false;
+        }
+
+        g_slotByPin[g_pins[slot]] = slot;
+        g_slotByChannel[channel] = slot;
+        channelMask |= (1UL << channel);
+
+        pattern[slot].atten = ADC_ATTEN_DB_11;      // Same 0-3.3 V range as analogRead()
+        pattern[slot].channel = channel;
+        pattern[slot].unit = 0;                     // ADC1
+        pattern[slot].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    ADC_Acq_BuildMvLut();
+
+    adc_digi_init_config_t init_config = {
+        .max_store_buf_size = ADC_ACQ_FRAME_BYTES * 2,
+        .conv_num_each_intr = ADC_ACQ_FRAME_BYTES,
+        .adc1_chan_mask = channelMask,
+        .adc2_chan_mask = 0,
+    };
+    if (adc_digi_initialize(&init_config) != ESP_OK) {
+        ADC_DEBUG_PRINTF("[ADC] DMA init failed\n");
+        return false;
+    }
+
+    adc_digi_configuration_t dig_cfg = {
+        .conv_limit_en = true,                      // Required on ESP32
+        .conv_limit_num = 250,
+        .pattern_num = ADC_ACQ_CHANNEL_COUNT,
+        .adc_pattern = pattern,
+        .sample_freq_hz = ADC_ACQ_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    if (adc_digi_controller_configure(&dig_cfg) != ESP_OK) {
+        ADC_DEBUG_PRINTF("[ADC] DMA config failed\n");
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    g_started = true;
+    App_RTOS_CreateTask(APP_TASK_ADC_ACQ);
+
+    ADC_DEBUG_PRINTF("[ADC] %u channels, %u Hz, %u samples/channel every %u ms\n",
+                     (unsigned)ADC_ACQ_CHANNEL_COUNT, (unsigned)ADC_ACQ_SAMPLE_FREQ_HZ,
+                     (unsigned)ADC_ACQ_SAMPLES_PER_CHANNEL, (unsigned)ADC_ACQ_PERIOD_MS);
+    ADC_DEBUG_PRINTF("[ADC] Calibration: %s, full scale %u mV\n",
+                     g_calSource == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two-point" :
+                     g_calSource == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref",
+                     g_mvLut[ADC_ACQ_MV_LUT_SIZE - 1]);
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint16_t ADC_Acq_GetFiltered(uint8_t pin)
+{
+    if (!g_started || pin >= ADC_ACQ_PIN_COUNT || g_slotByPin[pin] < 0) return 0;
+    return g_filtered[g_slotByPin[pin]];
+}
+
+uint16_t ADC_Acq_GetLatest(uint8_t pin)
+{
+    if (!g_started || pin >= ADC_ACQ_PIN_COUNT || g_slotByPin[pin] < 0) return 0;
+    return g_latest[g_slotByPin[pin]];
+}
+
+uint16_t ADC_Acq_RawToMv(uint16_t raw)
+{
+    if (raw > 4095) raw = 4095;
+
+    uint16_t i = raw >> ADC_ACQ_MV_LUT_SHIFT;
+    uint16_t frac = raw & ((1U << ADC_ACQ_MV_LUT_SHIFT) - 1);
+    int32_t span = (int32_t)g_mvLut[i + 1] - g_mvLut[i];
+
+    return (uint16_t)(g_mvLut[i] + ((span * frac) >> ADC_ACQ_MV_LUT_SHIFT));
+}
+
+bool ADC_Acq_HasPin(uint8_t pin)
+{
+    return g_started && pin < ADC_ACQ_PIN_COUNT && g_slotByPin[pin] >= 0;
+}
+
+bool ADC_Acq_IsReady(void)
+{
+    return g_readyMask == ((1UL << ADC_ACQ_CHANNEL_COUNT) - 1);
+}
+
+void ADC_Acq_GetStats(ADC_Acq_Stats_t* stats)
+{
+    if (stats != NULL) *stats = g_stats;
+}
+
+bool ADC_Acq_SetListener(uint8_t pin, TaskHandle_t task)
+{
+    if (!g_started || pin >= ADC_ACQ_PIN_COUNT || g_slotByPin[pin] < 0) return false;
+    g_listener[g_slotByPin[pin]] = task;
+    return true;
+}
+
+void ADC_Acq_SetFrameHook(ADC_Acq_FrameHook_t hook)
+{
+    g_frameHook = hook;
+}
+
+void ADC_Acq_Task(void* pvParameters)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        ADC_Acq_Burst();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(ADC_ACQ_PERIOD_MS));
+    }
+}
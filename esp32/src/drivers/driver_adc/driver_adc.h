@@ -0,0 +1,97 @@
+/**
+ * @file driver_adc.h
+ * @brief ADC1 acquisition engine on the continuous (DMA) ADC driver
+ *
+ * @note All channels in ADC_ACQ_CHANNEL_TABLE are sampled together in DMA
+ *       bursts; a short consumer task decimates each burst and runs a per-channel
+ *       low-pass filter. Readers only fetch the latest filtered value.
+ */
+
+#ifndef DRIVER_ADC_H
+#define DRIVER_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+/**
+ * @brief Called from the acquisition task after every processed burst
+ */
+typedef void (*ADC_Acq_FrameHook_t)(void);
+
+/**
+ * @brief Acquisition counters for diagnostics
+ */
+typedef struct {
+    uint32_t frames;            ///< Bursts processed
+    uint32_t samples;           ///< Conversions decoded
+    uint32_t dropped;           ///< Conversions for unknown channels / short reads
+    uint32_t errors;            ///< Driver read errors or timeouts
+} ADC_Acq_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Configure the DMA ADC for every channel in ADC_ACQ_CHANNEL_TABLE
+ *        and start the consumer task
+ * @note Safe to call more than once; only the first call does anything
+ * @return true if the engine is running
+ */
+bool ADC_Acq_Init(void);
+
+/**
+ * @brief Latest filtered value of a pin (12-bit), O(1) and non-blocking
+ * @param pin GPIO number listed in ADC_ACQ_CHANNEL_TABLE
+ * @return Filtered raw value, 0 for unknown pins or before the first burst
+ */
+uint16_t ADC_Acq_GetFiltered(uint8_t pin);
+
+/**
+ * @brief Oversampled mean of the most recent burst, without the low-pass
+ */
+uint16_t ADC_Acq_GetLatest(uint8_t pin);
+
+/**
+ * @brief Convert a 12-bit code to millivolts at the pin
+ * @note Uses a table built at init from the eFuse ADC calibration (falls back
+ *       to the nominal Vref on uncalibrated chips); interpolation is integer
+ *       only. Returns 0 before ADC_Acq_Init().
+ */
+uint16_t ADC_Acq_RawToMv(uint16_t raw);
+
+/**
+ * @brief true if the pin is listed in ADC_ACQ_CHANNEL_TABLE
+ */
+bool ADC_Acq_HasPin(uint8_t pin);
+
+/**
+ * @brief true once every channel has seen at least one burst
+ */
+bool ADC_Acq_IsReady(void);
+
+void ADC_Acq_GetStats(ADC_Acq_Stats_t* stats);
+
+/**
+ * @brief Wake a task (xTaskNotifyGive) after every burst that sampled a pin
+ * @note One listener per pin; the listener reads ADC_Acq_GetLatest() so it
+ *       sees each burst without the low-pass delay. Pass NULL to detach.
+ * @return false for pins not in ADC_ACQ_CHANNEL_TABLE
+ */
+bool ADC_Acq_SetListener(uint8_t pin, TaskHandle_t task);
+
+/**
+ * @brief Run a function in the acquisition task after every burst
+ * @note Meant for short batched post-processing (the sensor registry); it
+ *       delays the next burst by its own run time. One hook, NULL detaches.
+ */
+void ADC_Acq_SetFrameHook(ADC_Acq_FrameHook_t hook);
+
+/**
+ * @brief Consumer task entry (created from the RTOS table)
+ */
+void ADC_Acq_Task(void* pvParameters);
+
+#endif // DRIVER_ADC_H
@@ -0,0 +1,282 @@
+/**
+ * @file driver_bus.cpp
+ * @brief Implementation of the SPI/I2C bus manager
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <string.h>
+#include "driver_bus.h"
+#include "../../app/app_rtos/app_rtos.h"
+#include "esp_timer.h"
+
+// ==================== MACROS ====================
+
+#if SPI_DEBUG == STD_ON || I2C_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define BUS_I2C_BUFFER      128     // Wire TX/RX buffer on ESP32
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef struct {
+    Bus_Id_t       bus;
+    int16_t        select;
+    uint32_t       clock;
+    uint8_t        mode;
+    Bus_Priority_t priority;
+} Bus_DeviceCfg_t;
+
+typedef struct {
+    bool              running;
+    SemaphoreHandle_t mutex;
+    QueueHandle_t     queue[2];         // Indexed by Bus_Priority_t
+    TaskHandle_t      worker;           // Notified once per queued transaction
+    Bus_Stats_t       stats;
+} Bus_State_t;
+
+// ==================== STATIC VARIABLES ====================
+
+#define BUS_DEVICE_CFG(id, bus, select, clock, mode, prio)  { bus, select, clock, mode, prio },
+static const Bus_DeviceCfg_t g_devices[BUS_DEV_COUNT] = {
+    BUS_DEVICE_TABLE(BUS_DEVICE_CFG)
+};
+#undef BUS_DEVICE_CFG
+
+static Bus_State_t g_bus[BUS_COUNT];
+static portMUX_TYPE g_statsMux = portMUX_INITIALIZER_UNLOCKED;
+static bool g_started = false;
+#if I2C_ENABLED == STD_ON
+static uint32_t g_i2cClock = 0;     // Worker/mutex holder only
+#endif
+
+// ==================== PRIVATE FUNCTIONS ====================
+
+static const Bus_DeviceCfg_t* Bus_GetDevice(Bus_Device_t device)
+{
+    if (device >= BUS_DEV_COUNT) return NULL;
+    const Bus_DeviceCfg_t* cfg = &g_devices[device];
+    return g_bus[cfg->bus].running ? cfg : NULL;
+}
+
+static bool Bus_Lock(Bus_Id_t bus, TickType_t wait)
+{
+    int64_t start = esp_timer_get_time();
+    if (xSemaphoreTake(g_bus[bus].mutex, wait) != pdTRUE) return false;
+
+    uint32_t waited = (uint32_t)(esp_timer_get_time() - start);
+    portENTER_CRITICAL(&g_statsMux);
+    if (waited > g_bus[bus].stats.max_wait_us) g_bus[bus].stats.max_wait_us = waited;
+    portEXIT_CRITICAL(&g_statsMux);
+    return true;
+}
+
+static void Bus_Count(Bus_Id_t bus, Bus_Status_t status)
+{
+    portENTER_CRITICAL(&g_statsMux);
+    if (status == BUS_OK) g_bus[bus].stats.completed++;
+    else g_bus[bus].stats.errors++;
+    portEXIT_CRITICAL(&g_statsMux);
+}
+
+static Bus_Status_t Bus_RunSpi(const Bus_DeviceCfg_t* cfg, const Bus_Transaction_t* t)
+{
+    uint32_t clock = (cfg->clock != 0) ? cfg->clock : SPI_FREQUENCY;
+    SPI.beginTransaction(SPISettings(clock, SPI_BIT_ORDER, cfg->mode));
+    if (cfg->select >= 0) digitalWrite(cfg->select, LOW);
+
+    if (t->tx_len > 0) {
+        SPI.writeBytes(t->tx, t->tx_len);
+    }
+    if (t->rx_len > 0) {
+        memset(t->rx, 0xFF, t->rx_len);
+        SPI.transferBytes(t->rx, t->rx, t->rx_len);
+    }
+
+    if (cfg->select >= 0) digitalWrite(cfg->select, HIGH);
+    SPI.endTransaction();
+    return BUS_OK;
+}
+
+#if I2C_ENABLED == STD_ON
+static Bus_Status_t Bus_RunI2c(const Bus_DeviceCfg_t* cfg, const Bus_Transaction_t* t)
+{
+    if (t->tx_len > BUS_I2C_BUFFER || t->rx_len > BUS_I2C_BUFFER) return BUS_ERR_ARG;
+
+    uint32_t clock = (cfg->clock != 0) ? cfg->clock : I2C_FREQUENCY;
+    if (clock != g_i2cClock) {
+        Wire.setClock(clock);
+        g_i2cClock = clock;
+    }
+
+    uint8_t address = (uint8_t)cfg->select;
+    if (t->tx_len > 0) {
+        Wire.beginTransmission(address);
+        Wire.write(t->tx, t->tx_len);
+        // Keep the bus for a read: repeated start instead of stop
+        switch (Wire.endTransmission(t->rx_len == 0)) {
+        case 0:  break;
+        case 2:
+        case 3:  return BUS_ERR_NACK;
+        case 5:  return BUS_ERR_TIMEOUT;
+        default: return BUS_ERR_FAILED;
+        }
+    }
+    if (t->rx_len > 0) {
+        if (Wire.requestFrom(address, (uint8_t)t->rx_len) != t->rx_len) return BUS_ERR_NACK;
+        for (uint16_t i = 0; i < t->rx_len; i++) {
+            t->rx[i] = (uint8_t)Wire.read();
+        }
+    }
+    return BUS_OK;
+}
+#endif
+
+/**
+ * @brief Execute a transaction; the caller holds the bus mutex
+ */
+static Bus_Status_t Bus_Run(const Bus_DeviceCfg_t* cfg, const Bus_Transaction_t* t)
+{
+    if ((t->tx_len > 0 && t->tx == NULL) || (t->rx_len > 0 && t->rx == NULL)) {
+        return BUS_ERR_ARG;
+    }
+    if (cfg->bus == BUS_SPI) {
+        return Bus_RunSpi(cfg, t);
+    }
+#if I2C_ENABLED == STD_ON
+    return Bus_RunI2c(cfg, t);
+#else
+    return BUS_ERR_ARG;
+#endif
+}
+
+static void Bus_Serve(Bus_Id_t bus)
+{
+    Bus_Transaction_t t;
+
+    while (1) {
+        // One notification per transaction; high priority first, each
+        // queue in submission order
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        if (xQueueReceive(g_bus[bus].queue[BUS_PRIO_HIGH], &t, 0) != pdTRUE &&
+            xQueueReceive(g_bus[bus].queue[BUS_PRIO_NORMAL], &t, 0) != pdTRUE) {
+            continue;
+        }
+
+        Bus_Lock(bus, portMAX_DELAY);
+        Bus_Status_t status = Bus_Run(&g_devices[t.device], &t);
+        xSemaphoreGive(g_bus[bus].mutex);
+
+        Bus_Count(bus, status);
+        if (t.done != NULL) {
+            t.done(t.device, status, t.context);
+        }
+    }
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void Bus_Init(void)
+{
+    if (g_started) return;
+    g_started = true;
+    memset(g_bus, 0, sizeof(g_bus));
+
+#if SPI_ENABLED == STD_ON
+    // CS lines the manager drives idle high; library-driven devices own theirs
+    SPI.begin(SPI_SCK_PIN, SPI_MISO_PIN, SPI_MOSI_PIN, -1);
+    for (uint8_t i = 0; i < BUS_DEV_COUNT; i++) {
+        if (g_devices[i].bus == BUS_SPI && g_devices[i].select >= 0) {
+            pinMode(g_devices[i].select, OUTPUT);
+            digitalWrite(g_devices[i].select, HIGH);
+        }
+    }
+    g_bus[BUS_SPI].mutex = App_RTOS_CreateMutex(APP_MUTEX_BUS_SPI);
+    g_bus[BUS_SPI].queue[BUS_PRIO_NORMAL] = App_RTOS_CreateQueue(APP_QUEUE_BUS_SPI);
+    g_bus[BUS_SPI].queue[BUS_PRIO_HIGH] = App_RTOS_CreateQueue(APP_QUEUE_BUS_SPI_HIGH);
+    g_bus[BUS_SPI].worker = App_RTOS_CreateTask(APP_TASK_BUS_SPI);
+    g_bus[BUS_SPI].running = true;
+    DEBUG_PRINTF("[BUS] SPI up (SCK %d MISO %d MOSI %d)\n", SPI_SCK_PIN, SPI_MISO_PIN, SPI_MOSI_PIN);
+#endif
+
+#if I2C_ENABLED == STD_ON
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_FREQUENCY);
+    g_i2cClock = I2C_FREQUENCY;
+    g_bus[BUS_I2C].mutex = App_RTOS_CreateMutex(APP_MUTEX_BUS_I2C);
+    g_bus[BUS_I2C].queue[BUS_PRIO_NORMAL] = App_RTOS_CreateQueue(APP_QUEUE_BUS_I2C);
+    g_bus[BUS_I2C].queue[BUS_PRIO_HIGH] = App_RTOS_CreateQueue(APP_QUEUE_BUS_I2C_HIGH);
+    g_bus[BUS_I2C].worker = App_RTOS_CreateTask(APP_TASK_BUS_I2C);
+    g_bus[BUS_I2C].running = true;
+    DEBUG_PRINTF("[BUS] I2C up (SDA %d SCL %d, %lu Hz)\n", I2C_SDA_PIN, I2C_SCL_PIN,
+                 (unsigned long)I2C_FREQUENCY);
+#endif
+}
+
+bool Bus_Submit(const Bus_Transaction_t* transaction, TickType_t wait)
+{
+    if (transaction == NULL) return false;
+    const Bus_DeviceCfg_t* cfg = Bus_GetDevice(transaction->device);
+    if (cfg == NULL) return false;
+
+    Bus_State_t* state = &g_bus[cfg->bus];
+    if (xQueueSendToBack(state->queue[cfg->priority], transaction, wait) != pdTRUE) {
+        portENTER_CRITICAL(&g_statsMux);
+        state->stats.queue_full++;
+        portEXIT_CRITICAL(&g_statsMux);
+        return false;
+    }
+    xTaskNotifyGive(state->worker);
+    return true;
+}
+
+Bus_Status_t Bus_Transfer(const Bus_Transaction_t* transaction, TickType_t wait)
+{
+    if (transaction == NULL) return BUS_ERR_ARG;
+    const Bus_DeviceCfg_t* cfg = Bus_GetDevice(transaction->device);
+    if (cfg == NULL) return BUS_ERR_ARG;
+
+    if (!Bus_Lock(cfg->bus, wait)) return BUS_ERR_TIMEOUT;
+    Bus_Status_t status = Bus_Run(cfg, transaction);
+    xSemaphoreGive(g_bus[cfg->bus].mutex);
+
+    Bus_Count(cfg->bus, status);
+    return status;
+}
+
+bool Bus_Acquire(Bus_Device_t device, TickType_t wait)
+{
+    const Bus_DeviceCfg_t* cfg = Bus_GetDevice(device);
+    return cfg != NULL && Bus_Lock(cfg->bus, wait);
+}
+
+void Bus_Release(Bus_Device_t device)
+{
+    const Bus_DeviceCfg_t* cfg = Bus_GetDevice(device);
+    if (cfg != NULL) {
+        xSemaphoreGive(g_bus[cfg->bus].mutex);
+    }
+}
+
+void Bus_GetStats(Bus_Id_t bus, Bus_Stats_t* stats)
+{
+    if (stats == NULL || bus >= BUS_COUNT) return;
+    portENTER_CRITICAL(&g_statsMux);
+    *stats = g_bus[bus].stats;
+    portEXIT_CRITICAL(&g_statsMux);
+}
+
+void Bus_SpiTask(void* parameter)
+{
+    (void)parameter;
+    Bus_Serve(BUS_SPI);
+}
+
+void Bus_I2cTask(void* parameter)
+{
+    (void)parameter;
+    Bus_Serve(BUS_I2C);
+}
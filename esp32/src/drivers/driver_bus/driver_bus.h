@@ -0,0 +1,119 @@
+/**
+ * @file driver_bus.h
+ * @brief Shared SPI/I2C bus manager: per-device settings, arbitration and
+ *        queued transactions
+ *
+ * @note Devices are rows in BUS_DEVICE_TABLE (app_cfg.h). Each bus has a
+ *       mutex (priority inheritance) and a worker task:
+ *       - Bus_Submit() queues a transaction and returns at once; the worker
+ *         runs it with the device's clock/mode and calls the completion
+ *         callback. BUS_PRIO_HIGH devices have their own queue, drained
+ *         before the normal one; each queue is FIFO.
+ *       - Bus_Transfer() runs one in the calling task, e.g. during init.
+ *       - Bus_Acquire()/Bus_Release() lend the whole bus to a driver built on
+ *         an Arduino library (the MFRC522) that talks to SPI/Wire itself.
+ *
+ *       A transaction writes tx_len bytes, then reads rx_len bytes: with CS
+ *       held low on SPI, with a repeated start on I2C.
+ */
+
+#ifndef DRIVER_BUS_H
+#define DRIVER_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "../../app_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef enum {
+    BUS_SPI = 0,
+    BUS_I2C,
+    BUS_COUNT
+} Bus_Id_t;
+
+typedef enum {
+    BUS_PRIO_NORMAL = 0,
+    BUS_PRIO_HIGH
+} Bus_Priority_t;
+
+#define BUS_ENUM_DEVICE(id, bus, select, clock, mode, prio)    BUS_DEV_##id,
+typedef enum {
+    BUS_DEVICE_TABLE(BUS_ENUM_DEVICE)
+    BUS_DEV_COUNT
+} Bus_Device_t;
+#undef BUS_ENUM_DEVICE
+
+typedef enum {
+    BUS_OK = 0,
+    BUS_ERR_ARG,            // Unknown device, bus disabled or bad lengths
+    BUS_ERR_NACK,           // I2C address or data not acknowledged
+    BUS_ERR_TIMEOUT,        // Bus busy past the wait, or I2C timeout
+    BUS_ERR_FAILED          // Other I2C error
+} Bus_Status_t;
+
+/**
+ * @brief Completion callback, runs in the bus worker task
+ * @note Keep it short (copy the result, notify a task): the next transaction
+ *       on the bus waits for it
+ */
+typedef void (*Bus_Callback_t)(Bus_Device_t device, Bus_Status_t status, void* context);
+
+/**
+ * @brief One write-then-read exchange
+ * @note Buffers belong to the caller and must stay valid until the callback
+ */
+typedef struct {
+    Bus_Device_t   device;
+    const uint8_t* tx;
+    uint16_t       tx_len;
+    uint8_t*       rx;
+    uint16_t       rx_len;
+    Bus_Callback_t done;        ///< Optional
+    void*          context;
+} Bus_Transaction_t;
+
+typedef struct {
+    uint32_t completed;
+    uint32_t errors;
+    uint32_t queue_full;        ///< Bus_Submit() calls refused
+    uint32_t max_wait_us;       ///< Longest wait for the bus mutex
+} Bus_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Start every enabled bus (SPI_ENABLED, I2C_ENABLED) and its worker
+ * @note Safe to call more than once; only the first call does anything
+ */
+void Bus_Init(void);
+
+/**
+ * @brief Queue a transaction for the device's bus worker
+ * @param wait Ticks to wait for a free queue slot
+ * @return false if the device's bus is not running or the queue stayed full
+ */
+bool Bus_Submit(const Bus_Transaction_t* transaction, TickType_t wait);
+
+/**
+ * @brief Run a transaction in the calling task, blocking
+ */
+Bus_Status_t Bus_Transfer(const Bus_Transaction_t* transaction, TickType_t wait);
+
+/**
+ * @brief Exclusive use of the device's bus for library-driven access
+ * @note Not recursive. Every successful call needs a Bus_Release().
+ */
+bool Bus_Acquire(Bus_Device_t device, TickType_t wait);
+void Bus_Release(Bus_Device_t device);
+
+void Bus_GetStats(Bus_Id_t bus, Bus_Stats_t* stats);
+
+/**
+ * @brief Worker task entries (created from the RTOS table)
+ */
+void Bus_SpiTask(void* parameter);
+void Bus_I2cTask(void* parameter);
+
+#endif // DRIVER_BUS_H
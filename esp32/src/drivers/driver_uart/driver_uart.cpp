@@ -1,53 +1,457 @@
-#include "Arduino.h"
-#include "../../app_cfg.h"
+/**
+ * @file driver_uart.cpp
+ * @brief Implementation of the framed UART links
+ */
+
+#include <Arduino.h>
+#include <string.h>
 #include "driver_uart.h"
-//#include <String.h>
+#include "../../app/app_rtos/app_rtos.h"
+#include "../../hal/hal_power/hal_power.h"
+
+#include "driver/uart.h"
+#include "driver/gpio.h"
+
+// ==================== MACROS ====================
 
 #if UART_DEBUG == STD_ON
-#define DEBUG_PRINTLN(var) Serial.println(var)
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
 #else
-#define DEBUG_PRINTLN(var)
+#define DEBUG_PRINTF(...)
 #endif
 
-static UART_t UART[UART_MAXLENGH] = {{UART_BAUD_RATE, UART_FRAME_LENGTH, UART_TX_PIN, UART_RX_PIN}};
-static HardwareSerial myserial[UART_MAXLENGH] = {Serial1, Serial2};
+#define UART_HEADER_LEN     2       // type, seq
+#define UART_CRC_LEN        2
+#define UART_RAW_MAX        (UART_HEADER_LEN + UART_FRAME_MAX_PAYLOAD + UART_CRC_LEN)
+#define UART_COBS_MAX       (UART_RAW_MAX + (UART_RAW_MAX / 254) + 1)
+#define UART_READ_CHUNK     128
+#define UART_RING_MASK      (UART_RX_FRAMES - 1)
+
+#if (UART_RX_FRAMES & UART_RING_MASK) != 0
+#error "UART_RX_FRAMES must be a power of two"
+#endif
+
+static_assert(UART_FRAME_MAX_PAYLOAD <= 250, "Frame must fit one COBS block");
+
+// ==================== TYPE DEFINITIONS ====================
+
+typedef struct {
+    uart_port_t num;
+    uint32_t    baud;
+    int         tx_pin;
+    int         rx_pin;
+} UART_PortCfg_t;
+
+typedef struct {
+    QueueHandle_t events;
+
+    // Stream decoder, receive task only
+    uint8_t  cobs[UART_COBS_MAX];
+    uint16_t cobs_len;
+    bool     discarding;            // Overlong frame: skip to the next delimiter
+    bool     seq_valid;
+    uint8_t  rx_seq;
+
+    // Decoded frames: the task writes head, the reader writes tail
+    UART_Frame_t frames[UART_RX_FRAMES];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    TaskHandle_t volatile listener;
+
+    uint8_t tx_seq;                 // Under g_txMutex
+    UART_Stats_t stats;
+} UART_PortState_t;
+
+// ==================== STATIC VARIABLES ====================
 
-void UART_Init(void)
+#define UART_PORT_CFG(id, num, baud, tx, rx)    { num, baud, tx, rx },
+static const UART_PortCfg_t g_cfg[UART_PORT_COUNT] = {
+    UART_PORT_TABLE(UART_PORT_CFG)
+};
+#undef UART_PORT_CFG
+
+static UART_PortState_t g_port[UART_PORT_COUNT];
+static QueueSetHandle_t g_eventSet = NULL;
+static SemaphoreHandle_t g_txMutex = NULL;
+static portMUX_TYPE g_statsMux = portMUX_INITIALIZER_UNLOCKED;
+static bool g_started = false;
+
+// POWER_LOCK_UART is held from the first byte in either direction until the
+// link has been idle for UART_IDLE_MS with every TX FIFO drained
+static SemaphoreHandle_t g_activeSem = NULL;    // In g_eventSet: starts the idle countdown
+static portMUX_TYPE g_linkMux = portMUX_INITIALIZER_UNLOCKED;
+static bool g_linkBusy = false;
+static TickType_t g_lastActivity = 0;
+
+// CRC-16/CCITT-FALSE, one nibble at a time
+static const uint16_t g_crcNibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+// ==================== PRIVATE FUNCTIONS ====================
+
+static uint16_t UART_Crc16(const uint8_t* data, uint16_t length)
 {
-#if UART_ENABLED == STD_ON
-    for (uint8_t i; i < UART_MAXLENGH; i++)
-    {
-        myserial[i].begin(UART[i].buadRate, UART[i].FrameLength, UART[i].RXPin, UART[i].TXPin);
-        DEBUG_PRINTLN("UART" + String(i) + " initialize");
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 4) ^ g_crcNibble[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ g_crcNibble[(crc >> 12) ^ (data[i] & 0x0F)]);
     }
-#endif
+    return crc;
 }
 
-void UART_Send_Data(UARTN_t uart_n, String payload)
+/**
+ * @brief COBS-encode and append the 0x00 delimiter
+ * @return Bytes written to out (at most length + length / 254 + 2)
+ */
+static uint16_t UART_CobsEncode(const uint8_t* in, uint16_t length, uint8_t* out)
 {
-#if UART_ENABLED == STD_ON
-    if (myserial[uart_n].available())
-    {
-        myserial[uart_n].println(payload);
-        DEBUG_PRINTLN("UART send" + String(payload));
+    uint16_t code_at = 0;
+    uint16_t o = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_at] = code;
+                code_at = o++;
+                code = 1;
+            }
+        }
     }
-#endif
+    out[code_at] = code;
+    out[o++] = 0x00;
+    return o;
+}
+
+/**
+ * @brief Decode one COBS frame (without its delimiter) in place
+ * @return Decoded length, or -1 if the encoding is invalid
+ */
+static int16_t UART_CobsDecode(uint8_t* buf, uint16_t length)
+{
+    uint16_t i = 0;
+    uint16_t o = 0;
+
+    while (i < length) {
+        uint8_t code = buf[i++];
+        if (code == 0 || (uint16_t)(i + code - 1) > length) return -1;
+        for (uint8_t k = 1; k < code; k++) {
+            buf[o++] = buf[i++];
+        }
+        if (code != 0xFF && i < length) {
+            buf[o++] = 0;
+        }
+    }
+    return (int16_t)o;
 }
-void UART_Receive_Data(UARTN_t uart_n, String &payload)
+
+static void UART_Count(uint32_t* counter)
+{
+    portENTER_CRITICAL(&g_statsMux);
+    (*counter)++;
+    portEXIT_CRITICAL(&g_statsMux);
+}
+
+static void UART_FrameDone(UART_PortState_t* p)
+{
+    int16_t n = UART_CobsDecode(p->cobs, p->cobs_len);
+    p->cobs_len = 0;
+
+    if (n < UART_HEADER_LEN + UART_CRC_LEN) {
+        UART_Count(&p->stats.framing_errors);
+        return;
+    }
+
+    uint16_t body = (uint16_t)(n - UART_CRC_LEN);
+    uint16_t crc = (uint16_t)(p->cobs[body] | (p->cobs[body + 1] << 8));
+    if (UART_Crc16(p->cobs, body) != crc) {
+        UART_Count(&p->stats.crc_errors);
+        return;
+    }
+
+    uint8_t seq = p->cobs[1];
+    uint8_t missed = p->seq_valid ? (uint8_t)(seq - (uint8_t)(p->rx_seq + 1)) : 0;
+    p->rx_seq = seq;
+    p->seq_valid = true;
+
+    uint32_t head = p->head;
+    bool full = (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE)) >= UART_RX_FRAMES;
+    if (!full) {
+        UART_Frame_t* f = &p->frames[head & UART_RING_MASK];
+        f->type = p->cobs[0];
+        f->seq = seq;
+        f->length = (uint8_t)(body - UART_HEADER_LEN);
+        memcpy(f->payload, p->cobs + UART_HEADER_LEN, f->length);
+        __atomic_store_n(&p->head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    portENTER_CRITICAL(&g_statsMux);
+    p->stats.seq_gaps += missed;
+    if (full) p->stats.dropped++;
+    else p->stats.rx_frames++;
+    portEXIT_CRITICAL(&g_statsMux);
+
+    TaskHandle_t listener = p->listener;
+    if (!full && listener != NULL) {
+        xTaskNotifyGive(listener);
+    }
+}
+
+static void UART_Consume(UART_PortState_t* p, const uint8_t* data, int length)
+{
+    for (int i = 0; i < length; i++) {
+        uint8_t b = data[i];
+        if (b == 0x00) {
+            if (p->discarding) {
+                p->discarding = false;
+                p->cobs_len = 0;
+            } else if (p->cobs_len > 0) {
+                UART_FrameDone(p);
+            }
+        } else if (!p->discarding) {
+            if (p->cobs_len < UART_COBS_MAX) {
+                p->cobs[p->cobs_len++] = b;
+            } else {
+                p->discarding = true;
+                UART_Count(&p->stats.framing_errors);
+            }
+        }
+    }
+}
+
+static void UART_HandleEvent(uint8_t port, const uart_event_t* event)
+{
+    static uint8_t chunk[UART_READ_CHUNK];
+    UART_PortState_t* p = &g_port[port];
+
+    switch (event->type) {
+    case UART_DATA: {
+        size_t remaining = event->size;
+        while (remaining > 0) {
+            int n = uart_read_bytes(g_cfg[port].num, chunk,
+                                    remaining < sizeof(chunk) ? remaining : sizeof(chunk), 0);
+            if (n <= 0) break;
+            UART_Consume(p, chunk, n);
+            remaining -= (size_t)n;
+        }
+        break;
+    }
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+        // Bytes are gone: drop the partial frame and resync on the next delimiter
+        uart_flush_input(g_cfg[port].num);
+        p->cobs_len = 0;
+        p->discarding = true;
+        UART_Count(&p->stats.overflows);
+        break;
+    case UART_FRAME_ERR:
+    case UART_PARITY_ERR:
+        p->discarding = true;
+        UART_Count(&p->stats.framing_errors);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Note link activity and keep the chip awake
+ */
+static void UART_Touch(void)
+{
+    bool first;
+
+    // The lock changes hands inside the spinlock so a release racing a new
+    // frame cannot leave the link busy without it
+    portENTER_CRITICAL(&g_linkMux);
+    g_lastActivity = xTaskGetTickCount();
+    first = !g_linkBusy;
+    if (first) {
+        g_linkBusy = true;
+        Power_LockAcquire(POWER_LOCK_UART);
+    }
+    portEXIT_CRITICAL(&g_linkMux);
+
+    if (first) xSemaphoreGive(g_activeSem);
+}
+
+/**
+ * @brief Drop the wake lock once the link is idle and nothing is left to send
+ * @return Ticks to wait before checking again, portMAX_DELAY once released
+ */
+static TickType_t UART_IdleCheck(void)
+{
+    TickType_t wait = portMAX_DELAY;
+    bool drained = true;
+
+    for (uint8_t i = 0; i < UART_PORT_COUNT; i++) {
+        if (uart_wait_tx_done(g_cfg[i].num, 0) != ESP_OK) drained = false;
+    }
+
+    portENTER_CRITICAL(&g_linkMux);
+    if (g_linkBusy) {
+        // A frame queued after the drain check touched the link, so it is not idle
+        TickType_t idle = xTaskGetTickCount() - g_lastActivity;
+        if (idle >= pdMS_TO_TICKS(UART_IDLE_MS) && drained) {
+            g_linkBusy = false;
+            Power_LockRelease(POWER_LOCK_UART);
+        } else {
+            wait = (idle < pdMS_TO_TICKS(UART_IDLE_MS)) ? pdMS_TO_TICKS(UART_IDLE_MS) - idle : 1;
+        }
+    }
+    portEXIT_CRITICAL(&g_linkMux);
+    return wait;
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+bool UART_Init(void)
 {
 #if UART_ENABLED == STD_ON
-    if (myserial[uart_n].available())
-    {
-        Serial1.print(payload);
-        payload = myserial[uart_n].readStringUntil('\n');
-        DEBUG_PRINTLN("UART receive" + String(payload));
+    if (g_started) return true;
+
+    memset(g_port, 0, sizeof(g_port));
+    g_eventSet = App_RTOS_CreateQueueSet(APP_QUEUE_SET_UART_EVENT);
+    g_txMutex = App_RTOS_CreateMutex(APP_MUTEX_UART_TX);
+    g_activeSem = App_RTOS_CreateSemaphore(APP_SEM_UART_ACTIVE);
+    if (g_eventSet == NULL || g_txMutex == NULL ||
+        xQueueAddToSet(g_activeSem, g_eventSet) != pdPASS) return false;
+
+    for (uint8_t i = 0; i < UART_PORT_COUNT; i++) {
+        const UART_PortCfg_t* cfg = &g_cfg[i];
+        uart_config_t uart_config = {
+            .baud_rate = (int)cfg->baud,
+            .data_bits = UART_DATA_8_BITS,
+            .parity = UART_PARITY_DISABLE,
+            .stop_bits = UART_STOP_BITS_1,
+            .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+            .rx_flow_ctrl_thresh = 0,
+            .source_clk = UART_SCLK_APB,
+        };
+
+        // The event queue joins the set while still empty (pins not routed yet)
+        bool ok = uart_driver_install(cfg->num, UART_RX_BUFFER, UART_TX_BUFFER,
+                                      UART_EVENT_QUEUE_LEN, &g_port[i].events, 0) == ESP_OK &&
+                  xQueueAddToSet(g_port[i].events, g_eventSet) == pdPASS &&
+                  uart_param_config(cfg->num, &uart_config) == ESP_OK &&
+                  uart_set_pin(cfg->num, cfg->tx_pin, cfg->rx_pin,
+                               UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) == ESP_OK;
+        if (!ok) {
+            DEBUG_PRINTF("[UART] Port %u (UART%d) init failed\n", i, (int)cfg->num);
+            return false;
+        }
+        // An unconnected link must idle high, not float into framing errors
+        gpio_pullup_en((gpio_num_t)cfg->rx_pin);
+#if POWER_MGMT_ENABLED == STD_ON
+        // A start bit wakes the chip from light sleep (ESP32 UART wakeup only
+        // exists on UART0/1); bytes that arrive during the wakeup are lost and
+        // the decoder resyncs on the next delimiter
+        gpio_wakeup_enable((gpio_num_t)cfg->rx_pin, GPIO_INTR_LOW_LEVEL);
+#endif
+
+        DEBUG_PRINTF("[UART] Port %u on UART%d, %u baud, TX %d RX %d\n",
+                     i, (int)cfg->num, (unsigned)cfg->baud, cfg->tx_pin, cfg->rx_pin);
     }
+
+    g_started = true;
+    App_RTOS_CreateTask(APP_TASK_UART);
+    return true;
+#else
+    return false;
 #endif
 }
 
+bool UART_SendFrame(UART_Port_t port, uint8_t type, const uint8_t* payload, uint8_t length)
+{
+    if (!g_started || port >= UART_PORT_COUNT || length > UART_FRAME_MAX_PAYLOAD) return false;
+    if (length > 0 && payload == NULL) return false;
+
+    uint8_t raw[UART_RAW_MAX];
+    uint8_t wire[UART_COBS_MAX + 1];
+    UART_PortState_t* p = &g_port[port];
+
+    xSemaphoreTake(g_txMutex, portMAX_DELAY);
+    UART_Touch();
+
+    // The sequence number is taken under the mutex so frames leave in order
+    raw[0] = type;
+    raw[1] = p->tx_seq++;
+    memcpy(raw + UART_HEADER_LEN, payload, length);
+    uint16_t body = (uint16_t)(UART_HEADER_LEN + length);
+    uint16_t crc = UART_Crc16(raw, body);
+    raw[body] = (uint8_t)crc;
+    raw[body + 1] = (uint8_t)(crc >> 8);
+
+    uint16_t n = UART_CobsEncode(raw, (uint16_t)(body + UART_CRC_LEN), wire);
+    bool ok = uart_write_bytes(g_cfg[port].num, (const char*)wire, n) == (int)n;
+
+    xSemaphoreGive(g_txMutex);
+
+    if (ok) {
+        portENTER_CRITICAL(&g_statsMux);
+        p->stats.tx_frames++;
+        portEXIT_CRITICAL(&g_statsMux);
+    }
+    return ok;
+}
+
+bool UART_ReceiveFrame(UART_Port_t port, UART_Frame_t* frame)
+{
+    if (!g_started || port >= UART_PORT_COUNT || frame == NULL) return false;
+
+    UART_PortState_t* p = &g_port[port];
+    uint32_t tail = p->tail;
+    if (__atomic_load_n(&p->head, __ATOMIC_ACQUIRE) == tail) return false;
+
+    *frame = p->frames[tail & UART_RING_MASK];
+    __atomic_store_n(&p->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void UART_SetListener(UART_Port_t port, TaskHandle_t task)
+{
+    if (port < UART_PORT_COUNT) {
+        g_port[port].listener = task;
+    }
+}
 
+void UART_GetStats(UART_Port_t port, UART_Stats_t* stats)
+{
+    if (stats == NULL || port >= UART_PORT_COUNT) return;
+    portENTER_CRITICAL(&g_statsMux);
+    *stats = g_port[port].stats;
+    portEXIT_CRITICAL(&g_statsMux);
+}
 
-void UART_getSerial(HardwareSerial&serial,UARTN_t uart)
+void UART_Task(void* parameter)
 {
-    serial = myserial[uart];
+    (void)parameter;
+    uart_event_t event;
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        // Sleeps until the ISR posts an event on any port; while the link is
+        // busy it also wakes to release the wake lock once idle
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(g_eventSet, wait);
+
+        if (ready == g_activeSem) {
+            xSemaphoreTake(g_activeSem, 0);
+        }
+        for (uint8_t i = 0; i < UART_PORT_COUNT; i++) {
+            if (ready == g_port[i].events &&
+                xQueueReceive(g_port[i].events, &event, 0) == pdTRUE) {
+                UART_Touch();
+                UART_HandleEvent(i, &event);
+                break;
+            }
+        }
+        wait = UART_IdleCheck();
+    }
 }
@@ -1,26 +1,92 @@
+/**
+ * @file driver_uart.h
+ * @brief Event-driven UART links with a COBS-framed, CRC-checked protocol
+ *
+ * @note Each port in UART_PORT_TABLE runs on the ESP-IDF UART driver: the ISR
+ *       moves bytes between the hardware FIFOs and the driver rings, and one
+ *       task blocks on the ports' event queues. It decodes complete frames
+ *       into a per-port single-producer/single-consumer ring, so readers never
+ *       poll the UART and never take a lock.
+ *
+ *       Frame on the wire:
+ *         COBS(<type u8> <seq u8> <payload 0..UART_FRAME_MAX_PAYLOAD>
+ *              <crc16 LE>) 0x00
+ *       crc16 is CRC-16/CCITT-FALSE over type, seq and payload. seq counts
+ *       frames per direction; a jump is counted as a gap, not rejected.
+ */
+
 #ifndef DRIVER_UART_H
 #define DRIVER_UART_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "../../app_cfg.h"
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define UART_ENUM_PORT(id, num, baud, tx, rx)   UART_PORT_##id,
+typedef enum {
+    UART_PORT_TABLE(UART_ENUM_PORT)
+    UART_PORT_COUNT
+} UART_Port_t;
+#undef UART_ENUM_PORT
+
+typedef struct {
+    uint8_t type;
+    uint8_t seq;
+    uint8_t length;
+    uint8_t payload[UART_FRAME_MAX_PAYLOAD];
+} UART_Frame_t;
+
+/**
+ * @brief Per-port counters for diagnostics
+ */
+typedef struct {
+    uint32_t rx_frames;         ///< Valid frames queued for the reader
+    uint32_t tx_frames;
+    uint32_t crc_errors;
+    uint32_t framing_errors;    ///< Bad COBS, too short or too long
+    uint32_t overflows;         ///< Hardware FIFO or driver ring overrun
+    uint32_t dropped;           ///< Valid frames lost because the reader lagged
+    uint32_t seq_gaps;          ///< Frames the peer sent that never arrived
+} UART_Stats_t;
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Install the driver on every port in UART_PORT_TABLE and start the
+ *        receive task
+ * @return true if all ports are running
+ */
+bool UART_Init(void);
+
+/**
+ * @brief Encode and queue one frame for transmission
+ * @note Whole frames are queued atomically, so several tasks may send on the
+ *       same port. Returns as soon as the frame is in the driver's TX ring.
+ */
+bool UART_SendFrame(UART_Port_t port, uint8_t type, const uint8_t* payload, uint8_t length);
+
+/**
+ * @brief Take the oldest received frame, never blocks
+ * @note One reader per port
+ * @return false if none is waiting
+ */
+bool UART_ReceiveFrame(UART_Port_t port, UART_Frame_t* frame);
+
+/**
+ * @brief Wake a task (xTaskNotifyGive) whenever a frame arrives on the port
+ * @note One listener per port, NULL detaches
+ */
+void UART_SetListener(UART_Port_t port, TaskHandle_t task);
+
+void UART_GetStats(UART_Port_t port, UART_Stats_t* stats);
+
+/**
+ * @brief Receive task entry (created from the RTOS table)
+ */
+void UART_Task(void* parameter);
 
-typedef enum
-{
-    UART1,
-    UART2,
-    UART_MAXLENGH
-} UARTN_t;
-
-typedef struct
-{
-    uint32_t buadRate;
-    uint32_t FrameLength;
-    uint8_t TXPin;
-    uint8_t RXPin;
-} UART_t;
-
-void UART_Init(void);
-void UART_Receive_Data(UARTN_t uart_n, String &payload);
-void UART_Send_Data(UARTN_t uart_n, String payload);
-void UART_getSerial(HardwareSerial*serial,UARTN_t uart);
-
-#endif
\ No newline at end of file
+#endif // DRIVER_UART_H
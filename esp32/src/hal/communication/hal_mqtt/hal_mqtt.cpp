@@ -7,7 +7,16 @@
 #include "../../../app/room/room_types.h"
 #include "../../../app/room/room_logic.h"
 #include "../../../app/room/room_rtos.h"
+#include "../../../app/room/room_report.h"
+#include "../../../app/rules/rules.h"
+#include "../../../app/thermostat/thermostat_precond.h"
+#include "../../../app/access/access.h"
+#include "../../../app/access/access_journal.h"
+#include "../../../app/cmd_trace/cmd_trace.h"
+#include "../../../app/shadow/shadow.h"
 #include "helpers.h"
+#include "esp_timer.h"
+#include "../../../app/app_rtos/app_rtos.h"
 
 static WiFiClient wifiClient;
 static PubSubClient mqttClient(wifiClient);
@@ -16,6 +25,32 @@ static PubSubClient mqttClient(wifiClient);
 
 static const char* g_broker;
 static int g_port;
+static uint32_t g_firstPublishMs = 0;
+static volatile uint32_t g_connectCount = 0;
+
+// PubSubClient is not thread-safe: every call on mqttClient happens under this
+// lock so the gas task can publish directly instead of waiting for Task_Mqtt.
+// The message callback runs inside loop() with the lock held, so callbacks
+// must queue their publishes (Room_RTOS_SendMQTTMessage, Room_Report_MarkDirty)
+// rather than call MQTT_Publish.
+static SemaphoreHandle_t g_clientMutex = NULL;
+
+static bool MQTT_Lock(TickType_t wait)
+{
+    return g_clientMutex != NULL && xSemaphoreTake(g_clientMutex, wait) == pdTRUE;
+}
+
+static void MQTT_Unlock(void)
+{
+    xSemaphoreGive(g_clientMutex);
+}
+
+static void MQTT_MarkFirstPublish(void)
+{
+    if (g_firstPublishMs == 0) {
+        g_firstPublishMs = (uint32_t)(esp_timer_get_time() / 1000);
+    }
+}
 
 
 /**
@@ -90,6 +125,31 @@ static void mqttCallback(char* topic, byte* payload, unsigned int length)
  *       Add this to your PubSubClient or MQTT library callback
  */
 void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
+    // Rule sources are larger than the command buffer below; the room
+    // control task compiles them, not this callback
+    if (strcmp(topic, MQTT_TOPIC_RULES) == 0) {
+        if (!Rules_Submit((const char*)payload, length)) {
+            Serial.printf("[MQTT] Rules update too long (%u bytes)\n", length);
+        }
+        return;
+    }
+    // Signed allowlist update: the RFID task checks the HMAC and writes NVS
+    if (strcmp(topic, MQTT_TOPIC_ACCESS) == 0) {
+        Access_Submit((const char*)payload, length);
+        return;
+    }
+    // Desired state document; may be larger than the command buffer below
+    if (strcmp(topic, MQTT_TOPIC_SHADOW_DESIRED) == 0) {
+        if (!Shadow_ApplyDesired((const char*)payload, length)) {
+            Serial.printf("[MQTT] Invalid shadow document (%u bytes)\n", length);
+        }
+        return;
+    }
+    if (strcmp(topic, MQTT_TOPIC_SHADOW_GET) == 0) {
+        Shadow_RequestFull();
+        return;
+    }
+
     // Create null-terminated string from payload
     char message[128] = {0};  // Increased size for room messages
     if (length >= sizeof(message)) {
@@ -97,6 +157,8 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
     }
     memcpy(message, payload, length);
     message[length] = '\0';
+    // Strips a trailing correlation ID ("value@cid") before the parsers run
+    uint8_t trace = Cmd_Trace_Begin(topic, message);
     
     Serial.printf("[MQTT RX] Topic: %s, Payload: %s\n", topic, message);
     
@@ -107,17 +169,20 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
     if (strcmp(topic, MQTT_TOPIC_TARGET) == 0) {
         // Set target temperature from MQTT
         float target = atof(message);
+        Cmd_Trace_Parsed(trace);
         if (target >= 15.0f && target <= 35.0f) {  // Validate range
             Thermostat_SetTargetTemp(target);
             thermostatMqttEventSet();  // Trigger fan control update
             Serial.printf("[MQTT] Target temp set to: %.1f°C\n", target);
         } else {
             Serial.printf("[MQTT] Invalid target temp: %.1f°C\n", target);
+            Cmd_Trace_Finish(trace, CMD_TRACE_INVALID);
         }
     }
     else if (strcmp(topic, MQTT_TOPIC_CONTROL) == 0) {
         // Set thermostat mode from MQTT
         Thermostat_Mode_t mode = ParseMode(message);
+        Cmd_Trace_Parsed(trace);
         Thermostat_SetMode(mode);
         thermostatMqttModeEventSet();  // Trigger fan control update
         
@@ -125,16 +190,27 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
                                 (mode == THERMOSTAT_MODE_AUTO) ? "AUTO" :
                                 (mode == THERMOSTAT_MODE_MANUAL) ? "MANUAL" : "UNKNOWN";
         Serial.printf("[MQTT] Thermostat mode set to: %s\n", mode_name);
-        
-        // Publish mode status confirmation
-        //MQTT_Publish(MQTT_TOPIC_MODE_STATUS, mode_name);
+        // Confirmed through the shadow (reported "mode")
+    }
+    else if (strcmp(topic, MQTT_TOPIC_JOURNAL_ACK) == 0) {
+        // Cloud stored the access journal up to this sequence number
+        Access_Journal_Ack(message);
+    }
+    else if (strcmp(topic, MQTT_TOPIC_PRECOND) == 0) {
+        // Expected arrival + comfort setpoint from the reservation system
+        if (Thermostat_Precond_Schedule(message)) {
+            Serial.printf("[MQTT] Pre-conditioning schedule: %s\n", message);
+        } else {
+            Serial.printf("[MQTT] Invalid pre-conditioning schedule: %s\n", message);
+        }
     }
     else if (strcmp(topic, MQTT_TOPIC_SET_SPEED) == 0) {
         // Set manual fan speed from MQTT (only works in MANUAL mode)
         Fan_Speed_t speed = ParseFanSpeed(message);
+        Cmd_Trace_Parsed(trace);
         
         Thermostat_Mode_t current_mode = Thermostat_GetMode();
-        if (current_mode == THERMOSTAT_MODE_MANUAL) {
+        if (Rules_Check(RULES_EVT_FAN_CMD)) {
             Thermostat_SetFanSpeed(speed);
             thermostatMqttFanSpeedEventSet();  // Trigger fan control update
             
@@ -143,11 +219,10 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
                                      (speed == FAN_SPEED_MEDIUM) ? "MEDIUM" :
                                      (speed == FAN_SPEED_HIGH) ? "HIGH" : "UNKNOWN";
             Serial.printf("[MQTT] Fan speed set to: %s\n", speed_name);
-            
-            // Publish speed status confirmation
-            //MQTT_Publish(MQTT_TOPIC_FAN_SPEED_STATUS, speed_name);
+            // Confirmed through the shadow (reported "fan_speed")
         } else {
-            Serial.printf("[MQTT] Cannot set fan speed - not in MANUAL mode (current: %d)\n", current_mode);
+            Serial.printf("[MQTT] Fan speed command denied by rules (mode: %d)\n", current_mode);
+            Cmd_Trace_Finish(trace, CMD_TRACE_DENIED);
         }
     }
     
@@ -158,57 +233,64 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
     else if (strcmp(topic, ROOM_TOPIC_MODE_CTRL) == 0) {
         // Set room lighting mode from MQTT
         Room_Mode_t room_mode = Room_Logic_ParseMode(message);
+        Cmd_Trace_Parsed(trace);
         if (room_mode != 0xFF) {  // Valid mode
             Room_Logic_SetMode(room_mode);
+            Cmd_Trace_Applied(trace);
             const char* mode_str = Room_Logic_GetModeString();
             Serial.printf("[MQTT] Room mode set to: %s\n", mode_str);
             
-            // Publish mode status confirmation
-            Room_RTOS_PublishModeStatus();
+            // Confirm with the next room status (echoes even if unchanged)
+            Room_Report_MarkDirty(ROOM_REPORT_MODE, trace);
         } else {
             Serial.printf("[MQTT] Invalid room mode: %s\n", message);
+            Cmd_Trace_Finish(trace, CMD_TRACE_INVALID);
         }
     }
     else if (strcmp(topic, ROOM_TOPIC_LED1_CTRL) == 0) {
-        // Control LED1 (only works in MANUAL mode)
-        Room_Mode_t current_room_mode = Room_Logic_GetMode();
-        
-        if (current_room_mode != ROOM_MODE_MANUAL) {
-            Serial.printf("[MQTT] Cannot control LED1 - Room mode is %s (need MANUAL)\n", 
+        // Control LED1 (the default rules allow it in MANUAL mode only)
+        if (!Rules_Check(RULES_EVT_LED_CMD)) {
+            Serial.printf("[MQTT] LED1 command denied by rules - Room mode is %s\n", 
                          Room_Logic_GetModeString());
+            Cmd_Trace_Finish(trace, CMD_TRACE_DENIED);
             return;
         }
         
         Room_LED_State_t state = Room_Logic_ParseLEDState(message);
+        Cmd_Trace_Parsed(trace);
         if (state != 0xFF) {  // Valid state
             Room_Logic_SetLED(ROOM_LED_1, state, ROOM_CONTROL_MQTT);
+            Cmd_Trace_Applied(trace);
             Serial.printf("[MQTT] LED1 set to: %s\n", state == ROOM_LED_ON ? "ON" : "OFF");
             
-            // Publish LED status confirmation
-            Room_RTOS_PublishLEDStatus(ROOM_LED_1);
+            // Confirm with the next room status (echoes even if unchanged)
+            Room_Report_MarkDirty(ROOM_REPORT_LED1, trace);
         } else {
             Serial.printf("[MQTT] Invalid LED1 command: %s\n", message);
+            Cmd_Trace_Finish(trace, CMD_TRACE_INVALID);
         }
     }
     else if (strcmp(topic, ROOM_TOPIC_LED2_CTRL) == 0) {
-        // Control LED2 (only works in MANUAL mode)
-        Room_Mode_t current_room_mode = Room_Logic_GetMode();
-        
-        if (current_room_mode != ROOM_MODE_MANUAL) {
-            Serial.printf("[MQTT] Cannot control LED2 - Room mode is %s (need MANUAL)\n", 
+        // Control LED2 (the default rules allow it in MANUAL mode only)
+        if (!Rules_Check(RULES_EVT_LED_CMD)) {
+            Serial.printf("[MQTT] LED2 command denied by rules - Room mode is %s\n", 
                          Room_Logic_GetModeString());
+            Cmd_Trace_Finish(trace, CMD_TRACE_DENIED);
             return;
         }
         
         Room_LED_State_t state = Room_Logic_ParseLEDState(message);
+        Cmd_Trace_Parsed(trace);
         if (state != 0xFF) {  // Valid state
             Room_Logic_SetLED(ROOM_LED_2, state, ROOM_CONTROL_MQTT);
+            Cmd_Trace_Applied(trace);
             Serial.printf("[MQTT] LED2 set to: %s\n", state == ROOM_LED_ON ? "ON" : "OFF");
             
-            // Publish LED status confirmation
-            Room_RTOS_PublishLEDStatus(ROOM_LED_2);
+            // Confirm with the next room status (echoes even if unchanged)
+            Room_Report_MarkDirty(ROOM_REPORT_LED2, trace);
         } else {
             Serial.printf("[MQTT] Invalid LED2 command: %s\n", message);
+            Cmd_Trace_Finish(trace, CMD_TRACE_INVALID);
         }
     }
     else if (strcmp(topic, ROOM_TOPIC_AUTO_DIM) == 0) {
@@ -218,9 +300,6 @@ void MQTT_MessageCallback(char* topic, uint8_t* payload, unsigned int length) {
             Room_Logic_SetAutoDimMode(autodim_mode);  // This maps to AUTO/MANUAL mode
             Serial.printf("[MQTT] Auto-dim set to: %s\n", 
                          autodim_mode == ROOM_AUTO_DIM_ENABLED ? "ENABLED" : "DISABLED");
-            
-            // Publish mode status confirmation
-            Room_RTOS_PublishModeStatus();
         } else {
             Serial.printf("[MQTT] Invalid auto-dim command: %s\n", message);
         }
@@ -242,8 +321,17 @@ void MQTT_Init(const char* broker, int port)
     g_broker = broker;
     g_port = port;
 
+    if (g_clientMutex == NULL) {
+        g_clientMutex = App_RTOS_CreateMutex(APP_MUTEX_MQTT_CLIENT);
+    }
+
+    // Small alarm frames must not sit behind Nagle waiting for an ACK
+    wifiClient.setNoDelay(true);
+
     mqttClient.setServer(g_broker, g_port);
     mqttClient.setCallback(MQTT_MessageCallback);
+    // Room for a full rule source on MQTT_TOPIC_RULES
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
 }
 
 void MQTT_Loop(void)
@@ -251,12 +339,19 @@ void MQTT_Loop(void)
     // Only try MQTT if WiFi is connected
     if (WIFI_IsConnected())
     {
-        if (!mqttClient.connected()) MQTT_Reconnect();
-        mqttClient.loop();
+        if (!MQTT_IsConnected()) MQTT_Reconnect();
+        int64_t waitStart = esp_timer_get_time();
+        if (MQTT_Lock(portMAX_DELAY)) {
+            Cmd_Trace_PollStart((uint32_t)(esp_timer_get_time() - waitStart));
+            mqttClient.loop();
+            Cmd_Trace_PollEnd();
+            MQTT_Unlock();
+        }
     }
 }
 
-void MQTT_SubscribeAll(void)
+// Caller holds the client lock
+static void MQTT_SubscribeAllLocked(void)
 {
     mqttClient.subscribe("home/thermostat/temperature");
     mqttClient.subscribe("home/thermostat/humidity");
@@ -267,17 +362,30 @@ void MQTT_SubscribeAll(void)
     mqttClient.subscribe("home/thermostat/control");
 }
 
+void MQTT_SubscribeAll(void)
+{
+    if (MQTT_Lock(portMAX_DELAY)) {
+        MQTT_SubscribeAllLocked();
+        MQTT_Unlock();
+    }
+}
+
 
-void MQTT_Publish(const char* topic, const char* payload)
+bool MQTT_Publish(const char* topic, const char* payload)
 {
-    if (!WIFI_IsConnected() || !mqttClient.connected()) 
+    if (!WIFI_IsConnected() || !MQTT_Lock(portMAX_DELAY))
     {
         Serial.println("MQTT publish failed: Not connected");
-        return;
+        return false;
     }
 
-    if (mqttClient.publish(topic, payload))
+    bool ok = mqttClient.connected() && mqttClient.publish(topic, payload);
+    MQTT_Unlock();
+    WIFI_ReportLinkResult(ok);
+
+    if (ok)
     {
+        MQTT_MarkFirstPublish();
         Serial.print("Published to ");
         Serial.print(topic);
         Serial.print(": ");
@@ -287,17 +395,59 @@ void MQTT_Publish(const char* topic, const char* payload)
     {
         Serial.println("MQTT publish failed");
     }
+    return ok;
+}
+
+
+bool MQTT_PublishUrgent(const char* topic, const char* payload, bool retained, TickType_t wait)
+{
+    if (!WIFI_IsConnected() || !MQTT_Lock(wait)) return false;
+
+    bool ok = mqttClient.connected() && mqttClient.publish(topic, payload, retained);
+    MQTT_Unlock();
+    WIFI_ReportLinkResult(ok);
+
+    if (ok) MQTT_MarkFirstPublish();
+    return ok;
 }
 
+bool MQTT_PublishBinary(const char* topic, const uint8_t* payload, unsigned int length, TickType_t wait)
+{
+    if (!WIFI_IsConnected() || !MQTT_Lock(wait)) return false;
+
+    bool ok = mqttClient.connected() && mqttClient.publish(topic, payload, length);
+    MQTT_Unlock();
+    WIFI_ReportLinkResult(ok);
+
+    if (ok) MQTT_MarkFirstPublish();
+    return ok;
+}
 
 bool MQTT_IsConnected(void)
 {
-    return mqttClient.connected();
+    if (!MQTT_Lock(portMAX_DELAY)) return false;
+    bool connected = mqttClient.connected();
+    MQTT_Unlock();
+    return connected;
+}
+
+uint32_t MQTT_GetFirstPublishMs(void)
+{
+    return g_firstPublishMs;
+}
+
+uint32_t MQTT_GetConnectCount(void)
+{
+    return g_connectCount;
 }
 void MQTT_SubscribeTopics(void)
 {
-    if (MQTT_IsConnected())
+    if (MQTT_Lock(portMAX_DELAY))
     {
+        if (!mqttClient.connected()) {
+            MQTT_Unlock();
+            return;
+        }
         mqttClient.subscribe(MQTT_TOPIC_TARGET);
         mqttClient.subscribe(MQTT_TOPIC_TEMP);
         mqttClient.subscribe(MQTT_TOPIC_SET_SPEED);
@@ -308,6 +458,13 @@ void MQTT_SubscribeTopics(void)
         mqttClient.subscribe(ROOM_TOPIC_LED1_CTRL);
         mqttClient.subscribe(ROOM_TOPIC_LED2_CTRL);
     //    mqttClient.subscribe(ROOM_TOPIC_AUTO_DIM);
+        mqttClient.subscribe(MQTT_TOPIC_RULES);
+        mqttClient.subscribe(MQTT_TOPIC_PRECOND);
+        mqttClient.subscribe(MQTT_TOPIC_ACCESS);
+        mqttClient.subscribe(MQTT_TOPIC_JOURNAL_ACK);
+        mqttClient.subscribe(MQTT_TOPIC_SHADOW_DESIRED);
+        mqttClient.subscribe(MQTT_TOPIC_SHADOW_GET);
+        MQTT_Unlock();
 
         Serial.println("[MQTT] Subscribed to target & control topics");
     }
@@ -316,22 +473,32 @@ void MQTT_SubscribeTopics(void)
 
 static void MQTT_Reconnect(void)
 {
-    while (!mqttClient.connected())
+    while (!MQTT_IsConnected())
     {
         if (!WIFI_IsConnected())
         {
-            delay(1000); // Wait until WiFi reconnects
+            WIFI_WaitConnected(portMAX_DELAY);
             continue;
         }
 
         String id = "ESP32-" + String(random(0xffff), HEX);
-        if (mqttClient.connect(id.c_str()))
-        {
-            MQTT_SubscribeAll();
-        }
-        else
+        bool connected = false;
+        if (MQTT_Lock(portMAX_DELAY))
         {
-            delay(2000);
+            connected = mqttClient.connect(id.c_str(), MQTT_TOPIC_STATUS, 0, true, MQTT_WILL_OFFLINE);
+            if (connected)
+            {
+                // Birth message marks the room online as early as possible
+                if (mqttClient.publish(MQTT_TOPIC_STATUS, MQTT_BIRTH_ONLINE, true)) {
+                    MQTT_MarkFirstPublish();
+                }
+                MQTT_SubscribeAllLocked();
+                g_connectCount++;
+            }
+            MQTT_Unlock();
         }
+
+        // Back off without the lock so an alarm can still get the client
+        if (!connected) delay(2000);
     }
 }
@@ -2,12 +2,14 @@
 #define HAL_MQTT_H
 
 #include <PubSubClient.h>
+#include "freertos/FreeRTOS.h"
 
 // Make mqttClient accessible to other modules (if needed)
 typedef enum {
     MQTT_PUB_TEMP,
     MQTT_PUB_TARGET,
-    MQTT_PUB_HUM
+    MQTT_PUB_HUM,
+    MQTT_PUB_GAS
 
 } mqtt_pub_type_t;
 
@@ -21,7 +23,14 @@ void MQTT_Task_Init(void);
 void MQTT_SubscribeTopics(void);
 void MQTT_Loop(void);
 void MQTT_SubscribeAll(void);
-void MQTT_Publish(const char* topic, const char* payload);  // ← Make sure this line exists
+bool MQTT_Publish(const char* topic, const char* payload);  // false if it was not sent
 bool MQTT_IsConnected(void);
+// Publish straight from the calling task, bypassing every queue. Waits at most
+// `wait` ticks for the client; returns false if it could not be sent now.
+bool MQTT_PublishUrgent(const char* topic, const char* payload, bool retained, TickType_t wait);
+// Same for binary payloads (not retained)
+bool MQTT_PublishBinary(const char* topic, const uint8_t* payload, unsigned int length, TickType_t wait);
+uint32_t MQTT_GetFirstPublishMs(void);   // ms since reset, 0 until then
+uint32_t MQTT_GetConnectCount(void);     // Successful broker connects since boot
 
 #endif // MQTT_H
\ No newline at end of file
@@ -3,6 +3,19 @@
 #include "../../../app_cfg.h"
 #include "hal_wifi.h"
 #include "../hal_mqtt/hal_mqtt.h"
+#include "../../hal_power/hal_power.h"
+#include "../../../app/app_rtos/app_rtos.h"
+
+#include <Preferences.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/dhcp.h"
+#include "lwip/etharp.h"
+#include "lwip/tcpip.h"
+#include <time.h>
 
 #if WIFI_DEBUG == STD_ON
 #define DEBUG_PRINTLN(var) Serial.println(var)
@@ -16,6 +29,9 @@ bool mqttInitialized = false;
 void onWifiConnected(void)
 {
     Serial.println("WiFi Connected! IP: " + WiFi.localIP().toString());
+
+    // UTC wall clock for scheduled pre-conditioning; keeps running offline
+    configTime(0, 0, NTP_SERVER);
     
     // Initialize MQTT only when WiFi is connected
     if (!mqttInitialized) {
@@ -38,11 +54,300 @@ static WIFI_Config_t g_wifiCfg = {
     .on_disconnect = NULL
 };
 
-static WIFI_Status_t g_wifiStatus = WIFI_STATUS_DISCONNECTED;
-static unsigned long g_lastReconnectAttempt = 0;
-static unsigned long g_connectStartTime = 0;
+static volatile WIFI_Status_t g_wifiStatus = WIFI_STATUS_DISCONNECTED;
+static EventGroupHandle_t g_wifiEventGroup = NULL;
+static TimerHandle_t g_wifiTimer = NULL;
+static TaskHandle_t volatile g_wifiTask = NULL;
+static volatile uint32_t g_disconnectReason = 0;
+
+#define WIFI_CONNECT_TIMEOUT_MS     15000
+#define WIFI_FALLBACK_DELAY_MS      50
+#define WIFI_LINK_CHECK_MS          WIFI_ROAM_CHECK_INTERVAL_MS  // Connected tick
+
+// WiFi task notification bits
+#define WIFI_NOTIFY_TIMER           (1UL << 0)
+#define WIFI_NOTIFY_GOT_IP          (1UL << 1)
+#define WIFI_NOTIFY_DISCONNECTED    (1UL << 2)
+#define WIFI_NOTIFY_SCAN_DONE       (1UL << 3)
+
+/* =========================
+ * Networks and roaming state
+ * ========================= */
+typedef struct {
+    const char *ssid;
+    const char *password;
+} WIFI_Network_t;
+
+#define WIFI_FALLBACK_ENTRY(ssid, password) { ssid, password },
+#define WIFI_FALLBACK_ONE(ssid, password)   + 1
+#define WIFI_FALLBACK_COUNT  (0 WIFI_FALLBACK_TABLE(WIFI_FALLBACK_ONE))
+
+// The table is empty by default; keep one slot so the array is never zero-length
+static const WIFI_Network_t g_fallbacks[WIFI_FALLBACK_COUNT > 0 ? WIFI_FALLBACK_COUNT : 1] = {
+    WIFI_FALLBACK_TABLE(WIFI_FALLBACK_ENTRY)
+};
+#define WIFI_NETWORK_COUNT  (1 + WIFI_FALLBACK_COUNT)
+
+static uint8_t g_networkIndex = 0;          // 0 = primary from WIFI_Config_t
 
-#define WIFI_CONNECT_TIMEOUT_MS 15000
+static int16_t g_rssiAvgX16 = 0;            // RSSI moving average, dBm * 16
+static portMUX_TYPE g_linkMux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t g_linkTotal = 0;
+static uint16_t g_linkFailed = 0;
+
+static bool g_scanning = false;
+static uint32_t g_lastScanMs = 0;
+static WIFI_RoamReason_t g_scanReason = WIFI_ROAM_REASON_RSSI;
+
+static bool g_roaming = false;
+static uint32_t g_roamStartMs = 0;
+static WIFI_RoamEvent_t g_roamPending;
+static char g_roamReport[WIFI_ROAM_REPORT_SIZE];    // Formatted here, handed out once
+static bool g_roamReady = false;
+
+/* =========================
+ * Fast connect cache
+ * ========================= */
+#define WIFI_CACHE_MAGIC        0x57464332UL   // "WFC2"
+#define WIFI_CACHE_NVS_NS       "wifi"
+#define WIFI_CACHE_NVS_KEY      "fast"
+#define WIFI_LEASE_MARGIN_S     60              // Stop reusing the lease this early
+
+typedef struct {
+    uint32_t magic;
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint8_t  network;       // Index into primary + fallback list
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t lease_expiry;  // UTC seconds; 0 = unknown, never reused as static
+    uint32_t checksum;
+} WIFI_FastCache_t;
+
+// RTC memory survives resets and deep sleep; NVS covers a power cycle
+static RTC_NOINIT_ATTR WIFI_FastCache_t g_rtcCache;
+static WIFI_FastCache_t g_cache;
+static bool g_cacheValid = false;
+static bool g_fastAttempt = false;
+static bool g_fastConnected = false;
+static uint32_t g_firstConnectMs = 0;
+
+// Running on the cached lease as a static address, without a DHCP client
+static bool g_staticLease = false;
+static volatile bool g_ipConflict = false;      // Set from the tcpip thread
+
+static uint32_t WIFI_CacheChecksum(const WIFI_FastCache_t *cache)
+{
+    // FNV-1a over everything but the checksum itself
+    const uint8_t *p = (const uint8_t *)cache;
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < offsetof(WIFI_FastCache_t, checksum); i++) {
+        hash = (hash ^ p[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool WIFI_CacheIsValid(const WIFI_FastCache_t *cache)
+{
+    return cache->magic == WIFI_CACHE_MAGIC &&
+           cache->channel >= 1 && cache->channel <= 14 &&
+           cache->checksum == WIFI_CacheChecksum(cache);
+}
+
+static bool WIFI_LeaseValid(const WIFI_FastCache_t *cache)
+{
+    // No clock after a power cycle: the expiry can't be checked, use DHCP
+    time_t now = time(NULL);
+    return now >= TIME_VALID_EPOCH && cache->lease_expiry != 0 &&
+           (uint32_t)now + WIFI_LEASE_MARGIN_S < cache->lease_expiry;
+}
+
+static struct netif *WIFI_StaNetif(void)
+{
+    esp_netif_t *sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    return sta != NULL ? (struct netif *)esp_netif_get_netif_impl(sta) : NULL;
+}
+
+// Seconds left on the DHCP lease, 0 when not bound. Read outside the tcpip
+// thread; a stale coarse tick is at most 60 s, covered by the margin.
+static uint32_t WIFI_DhcpLeaseLeftS(void)
+{
+    struct netif *netif = WIFI_StaNetif();
+    struct dhcp *dhcp = (netif != NULL) ? netif_dhcp_data(netif) : NULL;
+
+    if (dhcp == NULL || dhcp->state != DHCP_STATE_BOUND ||
+        dhcp->t0_timeout <= dhcp->lease_used) return 0;
+    return (uint32_t)(dhcp->t0_timeout - dhcp->lease_used) * DHCP_COARSE_TIMER_SECS;
+}
+
+// tcpip thread: ask who owns our address. A reply from another host (or its
+// gratuitous ARP) leaves an ARP entry for our own IP.
+static void WIFI_ArpProbe(void *ctx)
+{
+    (void)ctx;
+    struct netif *netif = WIFI_StaNetif();
+    if (netif != NULL) etharp_request(netif, netif_ip4_addr(netif));
+}
+
+static void WIFI_ArpCheck(void *ctx)
+{
+    (void)ctx;
+    struct netif *netif = WIFI_StaNetif();
+    struct eth_addr *eth;
+    const ip4_addr_t *ip;
+
+    if (netif != NULL && etharp_find_addr(netif, netif_ip4_addr(netif), &eth, &ip) >= 0) {
+        g_ipConflict = true;
+    }
+}
+
+static void WIFI_CacheLoad(void)
+{
+#if WIFI_FAST_CONNECT_ENABLED == STD_ON
+    if (WIFI_CacheIsValid(&g_rtcCache) && g_rtcCache.network < WIFI_NETWORK_COUNT) {
+        g_cache = g_rtcCache;
+        g_cacheValid = true;
+        DEBUG_PRINTLN("[WIFI] Fast connect cache from RTC");
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NVS_NS, true)) {
+        if (prefs.getBytes(WIFI_CACHE_NVS_KEY, &g_cache, sizeof(g_cache)) == sizeof(g_cache) &&
+            WIFI_CacheIsValid(&g_cache) && g_cache.network < WIFI_NETWORK_COUNT) {
+            g_rtcCache = g_cache;
+            g_cacheValid = true;
+            DEBUG_PRINTLN("[WIFI] Fast connect cache from NVS");
+        }
+        prefs.end();
+    }
+#endif
+}
+
+static void WIFI_CacheStore(void)
+{
+#if WIFI_FAST_CONNECT_ENABLED == STD_ON
+    WIFI_FastCache_t fresh;
+    memset(&fresh, 0, sizeof(fresh));
+
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == NULL) return;
+
+    fresh.magic   = WIFI_CACHE_MAGIC;
+    memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    fresh.channel = (uint8_t)WiFi.channel();
+    fresh.network = g_networkIndex;
+    fresh.ip      = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet  = (uint32_t)WiFi.subnetMask();
+    fresh.dns     = (uint32_t)WiFi.dnsIP();
+
+    time_t now = time(NULL);
+    uint32_t left = WIFI_DhcpLeaseLeftS();
+    if (g_staticLease) {
+        // Our own static config: no new lease, keep the cached expiry
+        fresh.lease_expiry = g_cache.lease_expiry;
+    } else if (now >= TIME_VALID_EPOCH && left > 0) {
+        fresh.lease_expiry = (uint32_t)now + left;
+    }
+    fresh.checksum = WIFI_CacheChecksum(&fresh);
+
+    g_rtcCache = fresh;
+
+    // Only touch flash when the AP/address changed or the stored lease is
+    // used up; an older expiry in NVS only means DHCP sooner
+    if (g_cacheValid &&
+        memcmp(&fresh, &g_cache, offsetof(WIFI_FastCache_t, lease_expiry)) == 0 &&
+        (fresh.lease_expiry == 0 || WIFI_LeaseValid(&g_cache))) {
+        g_cache = fresh;
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NVS_NS, false)) {
+        prefs.putBytes(WIFI_CACHE_NVS_KEY, &fresh, sizeof(fresh));
+        prefs.end();
+    }
+    g_cache = fresh;
+    g_cacheValid = true;
+    DEBUG_PRINTLN("[WIFI] Fast connect cache updated");
+#endif
+}
+
+static void WIFI_UseDhcp(void)
+{
+    // A zero address drops the static config and (re)starts the DHCP client
+    g_staticLease = false;
+    WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+}
+
+static void WIFI_CacheInvalidate(void)
+{
+    g_cacheValid = false;
+    g_rtcCache.magic = 0;
+
+    // Drop the static lease so the next attempt runs DHCP
+    WIFI_UseDhcp();
+}
+
+// Connected tick: leave the cached address for DHCP once its lease has run
+// out or another host answers for it
+static void WIFI_LeaseCheck(void)
+{
+#if WIFI_FAST_CONNECT_ENABLED == STD_ON
+    if (!g_staticLease) {
+        // The first lease after a power cycle is bound before NTP sets the clock
+        if (g_cacheValid && g_cache.lease_expiry == 0 && time(NULL) >= TIME_VALID_EPOCH) {
+            WIFI_CacheStore();
+        }
+        return;
+    }
+
+    if (g_ipConflict) {
+        Serial.println("[WIFI] Cached address in use - switching to DHCP");
+    } else if (!WIFI_LeaseValid(&g_cache)) {
+        Serial.println("[WIFI] Cached lease expired - switching to DHCP");
+    } else {
+        tcpip_callback(WIFI_ArpCheck, NULL);
+        return;
+    }
+
+    // Never reuse this lease again, across resets and power cycles
+    g_cache.lease_expiry = 0;
+    g_cache.checksum = WIFI_CacheChecksum(&g_cache);
+    g_rtcCache = g_cache;
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NVS_NS, false)) {
+        prefs.putBytes(WIFI_CACHE_NVS_KEY, &g_cache, sizeof(g_cache));
+        prefs.end();
+    }
+    WIFI_UseDhcp();
+#endif
+}
+
+static WIFI_Network_t WIFI_GetNetwork(uint8_t index)
+{
+    if (index == 0 || index >= WIFI_NETWORK_COUNT) {
+        WIFI_Network_t primary = { g_wifiCfg.ssid, g_wifiCfg.password };
+        return primary;
+    }
+    return g_fallbacks[index - 1];
+}
+
+static void WIFI_FormatBssid(const uint8_t *bssid, char *out, size_t size)
+{
+    snprintf(out, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+             bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+}
+
+static void WIFI_ArmTimer(uint32_t ms)
+{
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    // Changing the period also (re)starts the one-shot timer
+    xTimerChangePeriod(g_wifiTimer, ticks > 0 ? ticks : 1, 0);
+}
 
 static void WIFI_StartConnection(void)
 {
@@ -52,84 +357,420 @@ static void WIFI_StartConnection(void)
         return;
     }
 
-    WiFi.disconnect(false, false);
-    delay(100);
-
     WiFi.mode(WIFI_STA);
-    WiFi.begin(g_wifiCfg.ssid, g_wifiCfg.password);
+    Power_ApplyWifiSleep();
+
+    g_fastAttempt = g_cacheValid;
+    if (g_fastAttempt)
+    {
+        g_networkIndex = g_cache.network;
+    }
+    WIFI_Network_t net = WIFI_GetNetwork(g_networkIndex);
+
+    if (g_fastAttempt)
+    {
+#if WIFI_FAST_CONNECT_STATIC_IP == STD_ON
+        // Reuse the previous lease while it is still valid; the AP-side
+        // DHCP round trip is the slowest part of association
+        if (WIFI_LeaseValid(&g_cache)) {
+            g_staticLease = true;
+            WiFi.config(IPAddress(g_cache.ip), IPAddress(g_cache.gateway),
+                        IPAddress(g_cache.subnet), IPAddress(g_cache.dns));
+        } else if (g_staticLease) {
+            WIFI_UseDhcp();
+        }
+#endif
+        // Known channel + BSSID: the driver probes one channel, no full scan
+        WiFi.begin(net.ssid, net.password, g_cache.channel, g_cache.bssid);
+        DEBUG_PRINTLN("[WIFI] Fast connect attempt");
+    }
+    else
+    {
+        WiFi.begin(net.ssid, net.password);
+        Serial.printf("[WIFI] Connecting to %s\n", net.ssid);
+    }
     g_wifiStatus = WIFI_STATUS_CONNECTING;
-    g_connectStartTime = millis();
+
+    // Connect timeout; GOT_IP stops it
+    WIFI_ArmTimer(g_fastAttempt ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS);
 }
 
-void WIFI_Init_(const WIFI_Config_t *config)
+// Attempt failed: a failed fast connect or roam falls back to a scan right
+// away; a failed scan connect moves on to the next network and waits for
+// the reconnect interval
+static void WIFI_ScheduleRetry(void)
 {
-    g_wifiCfg = *config;
-    g_lastReconnectAttempt = millis();
-    WIFI_StartConnection();
+    g_wifiStatus = WIFI_STATUS_DISCONNECTED;
+
+    if (g_fastAttempt)
+    {
+        DEBUG_PRINTLN("[WIFI] Fast connect failed - falling back to scan");
+        WIFI_CacheInvalidate();
+        WIFI_ArmTimer(WIFI_FALLBACK_DELAY_MS);
+    }
+    else if (g_roaming)
+    {
+        DEBUG_PRINTLN("[WIFI] Roam failed - reconnecting");
+        g_roaming = false;
+        WIFI_ArmTimer(WIFI_FALLBACK_DELAY_MS);
+    }
+    else
+    {
+        g_networkIndex = (g_networkIndex + 1) % WIFI_NETWORK_COUNT;
+        WIFI_ArmTimer(g_wifiCfg.reconnect_interval_ms);
+    }
+}
+
+/* =========================
+ * Roaming
+ * ========================= */
+static uint8_t WIFI_TakeLossPct(void)
+{
+    uint16_t total, failed;
+
+    portENTER_CRITICAL(&g_linkMux);
+    total = g_linkTotal;
+    failed = g_linkFailed;
+    if (total >= WIFI_ROAM_LOSS_MIN_SAMPLES) {
+        g_linkTotal = 0;
+        g_linkFailed = 0;
+    }
+    portEXIT_CRITICAL(&g_linkMux);
+
+    if (total < WIFI_ROAM_LOSS_MIN_SAMPLES) return 0;
+    return (uint8_t)((failed * 100U) / total);
+}
+
+static void WIFI_RoamTo(uint8_t network, const uint8_t *bssid, uint8_t channel,
+                        int8_t rssi, WIFI_RoamReason_t reason)
+{
+    const uint8_t *current = WiFi.BSSID();
+    WIFI_Network_t net = WIFI_GetNetwork(network);
+    char from[18], to[18];
+
+    memset(&g_roamPending, 0, sizeof(g_roamPending));
+    if (current != NULL) memcpy(g_roamPending.bssid_from, current, 6);
+    memcpy(g_roamPending.bssid_to, bssid, 6);
+    g_roamPending.rssi_before = (int8_t)(g_rssiAvgX16 / 16);
+    g_roamPending.channel = channel;
+    g_roamPending.reason = reason;
+
+    WIFI_FormatBssid(g_roamPending.bssid_from, from, sizeof(from));
+    WIFI_FormatBssid(bssid, to, sizeof(to));
+    Serial.printf("[WIFI] Roaming %s (%d dBm) -> %s/%s ch%u (%d dBm), reason %s\n",
+                  from, g_roamPending.rssi_before, net.ssid, to, channel, rssi,
+                  reason == WIFI_ROAM_REASON_LOSS ? "loss" : "rssi");
+
+    // Our own disconnect is filtered in WIFI_OnDisconnected, so update
+    // the connectivity bits here
+    xEventGroupClearBits(g_wifiEventGroup, WIFI_EVT_CONNECTED_BIT);
+    xEventGroupSetBits(g_wifiEventGroup, WIFI_EVT_DISCONNECTED_BIT);
+
+    // The cached lease belongs to the cached network only
+    if (g_staticLease && network != g_networkIndex) WIFI_UseDhcp();
+
+    g_roaming = true;
+    g_fastAttempt = false;
+    g_roamStartMs = millis();
+    g_networkIndex = network;
+    g_wifiStatus = WIFI_STATUS_CONNECTING;
+
+    // Targeted join keeps the IP config, so the gap is one association
+    WiFi.begin(net.ssid, net.password, channel, bssid);
+    WIFI_ArmTimer(WIFI_FAST_CONNECT_TIMEOUT_MS);
 }
 
-void WIFI_Process(void)
+static void WIFI_OnScanDone(void)
 {
-    wl_status_t st = WiFi.status();
+    g_scanning = false;
+
+    int16_t count = WiFi.scanComplete();
+    if (g_wifiStatus != WIFI_STATUS_CONNECTED || count <= 0) {
+        WiFi.scanDelete();
+        return;
+    }
+
+    const uint8_t *current = WiFi.BSSID();
+    WIFI_Network_t net = WIFI_GetNetwork(g_networkIndex);
+    WIFI_Network_t primary = WIFI_GetNetwork(0);
+    int16_t currentRssi = g_rssiAvgX16 / 16;
+
+    int16_t bestScore = currentRssi + WIFI_ROAM_HYSTERESIS_DB - 1;
+    int16_t best = -1;
+    uint8_t bestNetwork = g_networkIndex;
+
+    for (int16_t i = 0; i < count; i++) {
+        // Raw record: no String per scanned AP
+        const wifi_ap_record_t *ap = (const wifi_ap_record_t *)WiFi.getScanInfoByIndex(i);
+        if (ap == NULL || (current != NULL && memcmp(ap->bssid, current, 6) == 0)) continue;
+
+        const char *ssid = (const char *)ap->ssid;
+        int16_t rssi = ap->rssi;
+        int16_t score;
+        uint8_t network;
+
+        if (strcmp(ssid, net.ssid) == 0) {
+            score = rssi;
+            network = g_networkIndex;
+        } else if (g_networkIndex != 0 && strcmp(ssid, primary.ssid) == 0 &&
+                   rssi >= WIFI_ROAM_RSSI_THRESHOLD_DBM) {
+            // Prefer getting back onto the primary SSID from a fallback
+            score = rssi + WIFI_ROAM_HYSTERESIS_DB;
+            network = 0;
+        } else {
+            continue;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+            bestNetwork = network;
+        }
+    }
+
+    if (best >= 0) {
+        uint8_t bssid[6];
+        memcpy(bssid, WiFi.BSSID(best), 6);
+        WIFI_RoamTo(bestNetwork, bssid, (uint8_t)WiFi.channel(best),
+                    (int8_t)WiFi.RSSI(best), g_scanReason);
+    } else {
+        DEBUG_PRINTLN("[WIFI] Roam scan: no better AP");
+    }
+    WiFi.scanDelete();
+}
+
+static void WIFI_RoamCheck(void)
+{
+    int8_t rssi = WiFi.RSSI();
+    if (rssi != 0) {
+        // EMA with alpha = 1/4 keeps one bad beacon from triggering a scan
+        if (g_rssiAvgX16 == 0) g_rssiAvgX16 = rssi * 16;
+        else g_rssiAvgX16 += (rssi * 16 - g_rssiAvgX16) / 4;
+    }
+
+    uint8_t lossPct = WIFI_TakeLossPct();
+    bool weak  = (g_rssiAvgX16 / 16) < WIFI_ROAM_RSSI_THRESHOLD_DBM;
+    bool lossy = lossPct >= WIFI_ROAM_LOSS_THRESHOLD_PCT;
+
+    if ((weak || lossy) && !g_scanning &&
+        (g_lastScanMs == 0 || millis() - g_lastScanMs >= WIFI_ROAM_SCAN_BACKOFF_MS))
+    {
+        Serial.printf("[WIFI] Link degraded (avg %d dBm, loss %u%%) - scanning\n",
+                      g_rssiAvgX16 / 16, lossPct);
+        g_scanReason = lossy ? WIFI_ROAM_REASON_LOSS : WIFI_ROAM_REASON_RSSI;
+        g_lastScanMs = millis();
+        // Async: the radio hops channels between beacons, the link stays up
+        g_scanning = (WiFi.scanNetworks(true, false, false, WIFI_ROAM_SCAN_DWELL_MS) == WIFI_SCAN_RUNNING);
+    }
+}
+
+/* =========================
+ * Event handling
+ * =========================
+ * WiFi/IP events arrive on the Arduino event task and the timer fires in the
+ * timer service task; both only notify the WiFi task, so every state change
+ * (and all the WiFi, NVS, MQTT and Serial work it does) runs in one context
+ * with its own stack.
+ */
+static void WIFI_Notify(uint32_t bits)
+{
+    TaskHandle_t task = g_wifiTask;
+    if (task != NULL) {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
+
+static void WIFI_OnGotIp(void)
+{
+    WIFI_CacheStore();
+    if (g_wifiStatus == WIFI_STATUS_CONNECTED) return;  // Lease renewal
+
+    xTimerStop(g_wifiTimer, 0);
+    g_wifiStatus = WIFI_STATUS_CONNECTED;
+    g_rssiAvgX16 = WiFi.RSSI() * 16;
+
+    if (g_roaming) {
+        char report[WIFI_ROAM_REPORT_SIZE];
+        char to[18];
+        g_roaming = false;
+        g_roamPending.rssi_after = (int8_t)WiFi.RSSI();
+        g_roamPending.duration_ms = millis() - g_roamStartMs;
+
+        // Formatted here so the MQTT task only copies the finished report
+        WIFI_FormatRoamEvent(&g_roamPending, report, sizeof(report));
+        portENTER_CRITICAL(&g_linkMux);
+        memcpy(g_roamReport, report, sizeof(g_roamReport));
+        g_roamReady = true;
+        portEXIT_CRITICAL(&g_linkMux);
 
+        WIFI_FormatBssid(g_roamPending.bssid_to, to, sizeof(to));
+        Serial.printf("[WIFI] Roamed to %s in %lu ms, RSSI %d -> %d dBm\n", to,
+                      (unsigned long)g_roamPending.duration_ms,
+                      g_roamPending.rssi_before, g_roamPending.rssi_after);
+    }
+    if (g_firstConnectMs == 0) {
+        g_firstConnectMs = (uint32_t)(esp_timer_get_time() / 1000);
+        g_fastConnected = g_fastAttempt;
+    }
+    Serial.print("WiFi connected! IP: ");
+    Serial.println(WiFi.localIP());
+
+    if (g_staticLease) {
+        // Checked on the connected tick
+        g_ipConflict = false;
+        tcpip_callback(WIFI_ArpProbe, NULL);
+    }
+
+    xEventGroupClearBits(g_wifiEventGroup, WIFI_EVT_DISCONNECTED_BIT);
+    xEventGroupSetBits(g_wifiEventGroup, WIFI_EVT_CONNECTED_BIT);
+
+    if (g_wifiCfg.on_connect)
+        g_wifiCfg.on_connect();
+
+    WIFI_ArmTimer(WIFI_LINK_CHECK_MS);
+}
+
+static void WIFI_OnDisconnected(uint32_t reason)
+{
     switch (g_wifiStatus)
     {
+    case WIFI_STATUS_CONNECTED:
+        // Stale: the link came back before this notification was handled
+        if (WiFi.isConnected()) break;
+
+        xEventGroupClearBits(g_wifiEventGroup, WIFI_EVT_CONNECTED_BIT);
+        xEventGroupSetBits(g_wifiEventGroup, WIFI_EVT_DISCONNECTED_BIT);
+        g_wifiStatus = WIFI_STATUS_DISCONNECTED;
+        Serial.printf("WiFi disconnected! (reason %u)\n", (unsigned)reason);
+
+        if (g_wifiCfg.on_disconnect)
+            g_wifiCfg.on_disconnect();
+        WIFI_ArmTimer(g_wifiCfg.reconnect_interval_ms);
+        break;
+
     case WIFI_STATUS_CONNECTING:
-        if (st == WL_CONNECTED)
-        {
-            delay(500);
-            
-            if (WiFi.status() == WL_CONNECTED) {
-                g_wifiStatus = WIFI_STATUS_CONNECTED;
-                Serial.print("WiFi connected! IP: ");
-                Serial.println(WiFi.localIP());
-                
-                if (g_wifiCfg.on_connect)
-                    g_wifiCfg.on_connect();
-            }
-        }
-        else if (st == WL_CONNECT_FAILED ||
-                 st == WL_NO_SSID_AVAIL)
-        {
-            g_wifiStatus = WIFI_STATUS_DISCONNECTED;
-            g_lastReconnectAttempt = millis();
-        }
-        else if (millis() - g_connectStartTime >= WIFI_CONNECT_TIMEOUT_MS)
-        {
-            DEBUG_PRINTLN("WiFi connection timeout");
-            WiFi.disconnect(false, false);
-            g_wifiStatus = WIFI_STATUS_DISCONNECTED;
-            g_lastReconnectAttempt = millis();
-        }
+        DEBUG_PRINTLN("[WIFI] Association failed");
+        WIFI_ScheduleRetry();
         break;
 
-    case WIFI_STATUS_CONNECTED:
-        if (st != WL_CONNECTED)
-        {
-            g_wifiStatus = WIFI_STATUS_DISCONNECTED;
-            Serial.println("WiFi disconnected!");
-            
-            if (g_wifiCfg.on_disconnect)
-                g_wifiCfg.on_disconnect();
-            g_lastReconnectAttempt = millis();
-        }
+    default:
+        break;
+    }
+}
+
+static void WIFI_EventHandler(arduino_event_t *event)
+{
+    switch (event->event_id)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        WIFI_Notify(WIFI_NOTIFY_GOT_IP);
+        break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        // Raised by our own disconnect()/begin(); the caller already handles it
+        if (event->event_info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+        g_disconnectReason = event->event_info.wifi_sta_disconnected.reason;
+        WIFI_Notify(WIFI_NOTIFY_DISCONNECTED);
+        break;
+
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+        WIFI_Notify(WIFI_NOTIFY_SCAN_DONE);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void WIFI_OnTimer(void)
+{
+    switch (g_wifiStatus)
+    {
+    case WIFI_STATUS_CONNECTING:
+        DEBUG_PRINTLN("WiFi connection timeout");
+        g_wifiStatus = WIFI_STATUS_DISCONNECTED;
+        WiFi.disconnect(false, false);
+        WIFI_ScheduleRetry();
         break;
 
     case WIFI_STATUS_DISCONNECTED:
-        if (millis() - g_lastReconnectAttempt >= g_wifiCfg.reconnect_interval_ms)
-        {
-            Serial.println("Attempting to reconnect WiFi...");
-            WIFI_StartConnection();
-            g_lastReconnectAttempt = millis();
-        }
+        Serial.println("Attempting to reconnect WiFi...");
+        WIFI_StartConnection();
+        break;
+
+    case WIFI_STATUS_CONNECTED:
+        WIFI_LeaseCheck();
+#if WIFI_ROAM_ENABLED == STD_ON
+        WIFI_RoamCheck();
+#endif
+        WIFI_ArmTimer(WIFI_LINK_CHECK_MS);
         break;
 
-    case WIFI_STATUS_ERROR:
     default:
         break;
     }
 }
 
+void WIFI_TimerCallback(TimerHandle_t timer)
+{
+    WIFI_Notify(WIFI_NOTIFY_TIMER);
+}
+
+void WIFI_Task(void *parameter)
+{
+    (void)parameter;
+    uint32_t events;
+
+    // Set here as well: the first events can arrive before WIFI_Init_ returns
+    g_wifiTask = xTaskGetCurrentTaskHandle();
+
+    WIFI_CacheLoad();
+    WIFI_StartConnection();
+
+    while (1)
+    {
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+
+        // The link events first, so a timer that raced them sees the new state
+        if (events & WIFI_NOTIFY_GOT_IP)       WIFI_OnGotIp();
+        if (events & WIFI_NOTIFY_DISCONNECTED) WIFI_OnDisconnected(g_disconnectReason);
+        if (events & WIFI_NOTIFY_SCAN_DONE)    WIFI_OnScanDone();
+        if (events & WIFI_NOTIFY_TIMER)        WIFI_OnTimer();
+    }
+}
+
+void WIFI_Init_(const WIFI_Config_t *config)
+{
+    g_wifiCfg = *config;
+
+    g_wifiEventGroup = App_RTOS_CreateEventGroup(APP_EVENT_GROUP_WIFI);
+    g_wifiTimer      = App_RTOS_CreateTimer(APP_TIMER_WIFI_RECONNECT);
+    xEventGroupSetBits(g_wifiEventGroup, WIFI_EVT_DISCONNECTED_BIT);
+
+    // Reconnect policy lives here, not in the Arduino event handler
+    WiFi.setAutoReconnect(false);
+    // The SDK would otherwise rewrite its own NVS copy on every begin()
+    WiFi.persistent(false);
+    WiFi.onEvent(WIFI_EventHandler);
+
+    // The task loads the fast connect cache and starts the first attempt
+    g_wifiTask = App_RTOS_CreateTask(APP_TASK_WIFI);
+}
+
+EventGroupHandle_t WIFI_GetEventGroup(void)
+{
+    return g_wifiEventGroup;
+}
+
+bool WIFI_WaitConnected(TickType_t timeout)
+{
+    if (g_wifiEventGroup == NULL) return false;
+
+    EventBits_t bits = xEventGroupWaitBits(g_wifiEventGroup, WIFI_EVT_CONNECTED_BIT,
+                                           pdFALSE, pdTRUE, timeout);
+    return (bits & WIFI_EVT_CONNECTED_BIT) != 0;
+}
+
 WIFI_Status_t WIFI_GetStatus(void)
 {
     return g_wifiStatus;
@@ -145,4 +786,55 @@ int WIFI_GetRSSI(void)
     if (WiFi.status() == WL_CONNECTED)
         return WiFi.RSSI();
     return 0;
-}
\ No newline at end of file
+}
+
+uint32_t WIFI_GetFirstConnectMs(void)
+{
+    return g_firstConnectMs;
+}
+
+bool WIFI_UsedFastConnect(void)
+{
+    return g_fastConnected;
+}
+
+void WIFI_ReportLinkResult(bool ok)
+{
+    portENTER_CRITICAL(&g_linkMux);
+    if (g_linkTotal < UINT16_MAX) {
+        g_linkTotal++;
+        if (!ok) g_linkFailed++;
+    }
+    portEXIT_CRITICAL(&g_linkMux);
+}
+
+bool WIFI_TakeRoamReport(char *buffer, uint16_t size)
+{
+    bool ready;
+
+    if (buffer == NULL || size == 0) return false;
+
+    portENTER_CRITICAL(&g_linkMux);
+    ready = g_roamReady;
+    if (ready) {
+        strncpy(buffer, g_roamReport, size - 1);
+        buffer[size - 1] = '\0';
+        g_roamReady = false;
+    }
+    portEXIT_CRITICAL(&g_linkMux);
+    return ready;
+}
+
+int WIFI_FormatRoamEvent(const WIFI_RoamEvent_t *event, char *buffer, uint16_t size)
+{
+    char from[18], to[18];
+    WIFI_FormatBssid(event->bssid_from, from, sizeof(from));
+    WIFI_FormatBssid(event->bssid_to, to, sizeof(to));
+
+    return snprintf(buffer, size,
+                    "{\"from\":\"%s\",\"to\":\"%s\",\"channel\":%u,\"rssi_before\":%d,"
+                    "\"rssi_after\":%d,\"roam_ms\":%lu,\"reason\":\"%s\"}",
+                    from, to, event->channel, event->rssi_before, event->rssi_after,
+                    (unsigned long)event->duration_ms,
+                    event->reason == WIFI_ROAM_REASON_LOSS ? "loss" : "rssi");
+}
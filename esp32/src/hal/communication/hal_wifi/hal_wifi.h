@@ -6,6 +6,9 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/timers.h>
 
 extern bool mqttInitialized ;
 
@@ -19,6 +22,29 @@ typedef enum
 
 } WIFI_Status_t;
 
+// Connectivity bits in the WiFi event group; exactly one is set at a time
+#define WIFI_EVT_CONNECTED_BIT      (1 << 0)    // Associated and IP assigned
+#define WIFI_EVT_DISCONNECTED_BIT   (1 << 1)
+
+typedef enum
+{
+    WIFI_ROAM_REASON_RSSI = 0,      // Averaged RSSI under threshold
+    WIFI_ROAM_REASON_LOSS           // Publish failure rate over threshold
+
+} WIFI_RoamReason_t;
+
+typedef struct
+{
+    uint8_t  bssid_from[6];
+    uint8_t  bssid_to[6];
+    uint8_t  channel;
+    int8_t   rssi_before;           // Averaged RSSI that triggered the roam
+    int8_t   rssi_after;            // First reading on the new AP
+    uint32_t duration_ms;           // Link down time
+    WIFI_RoamReason_t reason;
+
+} WIFI_RoamEvent_t;
+
 typedef void (*WIFI_Callback_t)(void);
 
 typedef struct
@@ -31,8 +57,12 @@ typedef struct
 
 } WIFI_Config_t;
 
+// Event driven; on_connect/on_disconnect run in the WiFi task
 void WIFI_Init_(const WIFI_Config_t *config);
-void WIFI_Process(void);
+void WIFI_Task(void *parameter);
+void WIFI_TimerCallback(TimerHandle_t timer);
+EventGroupHandle_t WIFI_GetEventGroup(void);
+bool WIFI_WaitConnected(TickType_t timeout);
 WIFI_Status_t WIFI_GetStatus(void);
 bool WIFI_IsConnected(void);
 int WIFI_GetRSSI(void);
@@ -40,6 +70,18 @@ uint32_t WIFI_GetIP_v4(void);
 
 void WIFI_PrintConnectStatus(void);
 
+// Boot metrics: ms since reset of the first association (0 until then) and
+// whether it came from the cached channel/BSSID/lease
+uint32_t WIFI_GetFirstConnectMs(void);
+bool WIFI_UsedFastConnect(void);
+
+// Roaming: publish results feed the loss trend; completed roams are
+// formatted in the WiFi task and handed out once each as a JSON report
+#define WIFI_ROAM_REPORT_SIZE   160
+void WIFI_ReportLinkResult(bool ok);
+bool WIFI_TakeRoamReport(char *buffer, uint16_t size);
+int  WIFI_FormatRoamEvent(const WIFI_RoamEvent_t *event, char *buffer, uint16_t size);
+
 
 void onWifiConnected(void);
 void onWifiDisconnected(void);
@@ -0,0 +1,226 @@
+#include <Arduino.h>
+#include "../../app_cfg.h"
+#include "hal_power.h"
+
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_wifi.h"
+#include "driver/gpio.h"
+
+#if POWER_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+#define POWER_MAX_WAKE_BUTTONS  4
+
+typedef struct {
+    uint8_t pin;
+    TaskHandle_t task;
+} Power_WakeButton_t;
+
+static const char* const g_lockNames[POWER_LOCK_COUNT] = { "pwm", "button", "sensor", "uart" };
+
+static esp_pm_lock_handle_t g_locks[POWER_LOCK_COUNT];
+static uint32_t g_lockMask = 0;
+static bool g_lightSleepActive = false;
+
+// Residency accounting (esp_timer microseconds)
+static portMUX_TYPE g_powerMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t g_windowStartUs = 0;
+static int64_t g_lockedSinceUs = 0;
+static int64_t g_lockedTotalUs = 0;
+
+static Power_WakeButton_t g_wakeButtons[POWER_MAX_WAKE_BUTTONS];
+static uint8_t g_wakeButtonCount = 0;
+
+static void IRAM_ATTR Power_WakeButtonISR(void* arg)
+{
+    Power_WakeButton_t* button = (Power_WakeButton_t*)arg;
+    BaseType_t woken = pdFALSE;
+
+    // Level interrupt: mask it until the task has seen the pin released
+    gpio_intr_disable((gpio_num_t)button->pin);
+    vTaskNotifyGiveFromISR(button->task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void Power_Init(void)
+{
+#if POWER_MGMT_ENABLED == STD_ON
+    esp_err_t err;
+
+    for (uint8_t i = 0; i < POWER_LOCK_COUNT; i++) {
+        g_locks[i] = NULL;
+        err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, g_lockNames[i], &g_locks[i]);
+        if (err != ESP_OK) {
+            g_locks[i] = NULL;
+        }
+    }
+
+    esp_pm_config_esp32_t pm_config = {
+        .max_freq_mhz = POWER_CPU_FREQ_MAX_MHZ,
+        .min_freq_mhz = POWER_CPU_FREQ_MIN_MHZ,
+#if (POWER_LIGHT_SLEEP_ENABLE == STD_ON) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+        .light_sleep_enable = true
+#else
+        .light_sleep_enable = false
+#endif
+    };
+
+    err = esp_pm_configure(&pm_config);
+    if (err == ESP_OK) {
+        g_lightSleepActive = pm_config.light_sleep_enable;
+        DEBUG_PRINTF("[POWER] DFS %d-%d MHz, light sleep %s\n",
+                     POWER_CPU_FREQ_MIN_MHZ, POWER_CPU_FREQ_MAX_MHZ,
+                     g_lightSleepActive ? "ON" : "OFF");
+    } else {
+        // Stock Arduino core ships without CONFIG_PM_ENABLE
+        g_lightSleepActive = false;
+        DEBUG_PRINTF("[POWER] esp_pm unavailable (%s) - modem sleep only\n",
+                     esp_err_to_name(err));
+    }
+
+    // Buttons wake the chip from light sleep
+    esp_sleep_enable_gpio_wakeup();
+
+    g_windowStartUs = esp_timer_get_time();
+#endif
+}
+
+void Power_ApplyWifiSleep(void)
+{
+#if (POWER_MGMT_ENABLED == STD_ON) && (POWER_WIFI_MODEM_SLEEP_ENABLE == STD_ON)
+    // Radio wakes for every DTIM beacon; needed for automatic light sleep
+    esp_err_t err = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[POWER] Modem sleep failed: %s\n", esp_err_to_name(err));
+    }
+#endif
+}
+
+void Power_LockAcquire(Power_Lock_t lock)
+{
+#if POWER_MGMT_ENABLED == STD_ON
+    if (lock >= POWER_LOCK_COUNT) return;
+
+    // The PM lock changes with the mask bit, inside the spinlock (esp_pm
+    // locks are ISR-safe), so racing callers cannot leave them out of step
+    portENTER_CRITICAL(&g_powerMux);
+    if (!(g_lockMask & (1UL << lock))) {
+        if (g_lockMask == 0) {
+            g_lockedSinceUs = esp_timer_get_time();
+        }
+        g_lockMask |= (1UL << lock);
+        if (g_locks[lock] != NULL) esp_pm_lock_acquire(g_locks[lock]);
+    }
+    portEXIT_CRITICAL(&g_powerMux);
+#endif
+}
+
+void Power_LockRelease(Power_Lock_t lock)
+{
+#if POWER_MGMT_ENABLED == STD_ON
+    if (lock >= POWER_LOCK_COUNT) return;
+
+    portENTER_CRITICAL(&g_powerMux);
+    if (g_lockMask & (1UL << lock)) {
+        g_lockMask &= ~(1UL << lock);
+        if (g_lockMask == 0) {
+            g_lockedTotalUs += esp_timer_get_time() - g_lockedSinceUs;
+        }
+        if (g_locks[lock] != NULL) esp_pm_lock_release(g_locks[lock]);
+    }
+    portEXIT_CRITICAL(&g_powerMux);
+#endif
+}
+
+void Power_RegisterWakeButton(uint8_t pin, TaskHandle_t task)
+{
+#if POWER_MGMT_ENABLED == STD_ON
+    if (g_wakeButtonCount >= POWER_MAX_WAKE_BUTTONS || task == NULL) return;
+
+    Power_WakeButton_t* button = &g_wakeButtons[g_wakeButtonCount++];
+    button->pin = pin;
+    button->task = task;
+
+    // Arduino may already own the ISR service; that is fine
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        DEBUG_PRINTF("[POWER] ISR service failed: %s\n", esp_err_to_name(err));
+        return;
+    }
+
+    // Buttons are active-low with pull-ups; gpio_wakeup_enable also sets
+    // the pin interrupt to the same level
+    gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_LOW_LEVEL);
+    gpio_isr_handler_add((gpio_num_t)pin, Power_WakeButtonISR, button);
+    gpio_intr_enable((gpio_num_t)pin);
+
+    DEBUG_PRINTF("[POWER] Wake button on GPIO%d\n", pin);
+#endif
+}
+
+void Power_RearmWakeButton(uint8_t pin)
+{
+#if POWER_MGMT_ENABLED == STD_ON
+    gpio_intr_enable((gpio_num_t)pin);
+#endif
+}
+
+void Power_GetStats(Power_Stats_t* stats)
+{
+    if (stats == NULL) return;
+
+    int64_t now = esp_timer_get_time();
+    int64_t window_us;
+    int64_t locked_us;
+
+    portENTER_CRITICAL(&g_powerMux);
+    window_us = now - g_windowStartUs;
+    locked_us = g_lockedTotalUs;
+    if (g_lockMask != 0) {
+        locked_us += now - g_lockedSinceUs;
+        g_lockedSinceUs = now;
+    }
+    // Start a new window
+    g_windowStartUs = now;
+    g_lockedTotalUs = 0;
+    portEXIT_CRITICAL(&g_powerMux);
+
+    if (window_us <= 0) window_us = 1;
+    if (!g_lightSleepActive) locked_us = window_us;
+
+    // Sleep-eligible time is an upper bound: tasks still wake for their
+    // own periods, so treat the result as a best case
+    float awake = (float)locked_us / (float)window_us;
+    float eligible = 1.0f - awake;
+
+    stats->window_ms = (uint32_t)(window_us / 1000);
+    stats->sleep_eligible_pct = (uint8_t)(eligible * 100.0f + 0.5f);
+    stats->avg_current_ma = awake * POWER_CURRENT_ACTIVE_MA +
+                            eligible * (POWER_CURRENT_LIGHT_SLEEP_MA + POWER_CURRENT_DTIM_WAKE_MA);
+#if POWER_WIFI_MODEM_SLEEP_ENABLE == STD_ON
+    stats->cmd_latency_worst_ms = POWER_WIFI_DTIM_PERIOD_MS;
+#else
+    stats->cmd_latency_worst_ms = 0;
+#endif
+    stats->light_sleep_active = g_lightSleepActive;
+}
+
+int Power_FormatReport(char* buffer, uint16_t size)
+{
+    Power_Stats_t stats;
+    Power_GetStats(&stats);
+
+    DEBUG_PRINTF("[POWER] avg=%.1fmA sleep=%u%% latency<=%ums (window %ums)\n",
+                 stats.avg_current_ma, stats.sleep_eligible_pct,
+                 stats.cmd_latency_worst_ms, stats.window_ms);
+
+    return snprintf(buffer, size,
+                    "{\"avg_ma\":%.2f,\"sleep_pct\":%u,\"cmd_latency_ms\":%u,\"light_sleep\":%s}",
+                    stats.avg_current_ma, stats.sleep_eligible_pct,
+                    stats.cmd_latency_worst_ms,
+                    stats.light_sleep_active ? "true" : "false");
+}
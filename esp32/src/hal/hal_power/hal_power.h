@@ -0,0 +1,42 @@
+#ifndef HAL_POWER_H
+#define HAL_POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Wake locks - while any is held the chip may scale frequency but never
+// enters automatic light sleep
+typedef enum {
+    POWER_LOCK_PWM = 0,     // LEDC outputs active (APB clock must keep running)
+    POWER_LOCK_BUTTON,      // Button pressed / debounce in progress
+    POWER_LOCK_SENSOR,      // Peripheral capture in progress (DHT22 RMT frame)
+    POWER_LOCK_UART,        // Co-processor link active (RX bytes or TX draining)
+    POWER_LOCK_COUNT
+} Power_Lock_t;
+
+typedef struct {
+    uint32_t window_ms;             // Length of the measurement window
+    uint8_t  sleep_eligible_pct;    // Share of the window with no wake lock held
+    float    avg_current_ma;        // Modelled average current draw
+    uint32_t cmd_latency_worst_ms;  // Worst-case command delay added by modem sleep
+    bool     light_sleep_active;    // esp_pm accepted the light sleep config
+} Power_Stats_t;
+
+void Power_Init(void);
+void Power_ApplyWifiSleep(void);
+
+// Idempotent per lock; safe to call from inside another spinlock section
+void Power_LockAcquire(Power_Lock_t lock);
+void Power_LockRelease(Power_Lock_t lock);
+
+// Buttons stay usable through light sleep: the pin is armed as a low-level
+// GPIO wakeup source and the ISR notifies the given task.
+void Power_RegisterWakeButton(uint8_t pin, TaskHandle_t task);
+void Power_RearmWakeButton(uint8_t pin);
+
+void Power_GetStats(Power_Stats_t* stats);
+int  Power_FormatReport(char* buffer, uint16_t size);
+
+#endif // HAL_POWER_H
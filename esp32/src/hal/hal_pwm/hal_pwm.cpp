@@ -1,4 +1,5 @@
 #include "hal_pwm.h"
+#include "../hal_power/hal_power.h"
 
 // Platform-specific includes
 #ifdef ARDUINO
@@ -16,8 +17,67 @@
     extern "C" {
         #include "esp32-hal-ledc.h"
     }
+    #include "driver/ledc.h"
+    #include "esp_timer.h"
 #endif
 
+#define PWM_CHANNEL_COUNT   16
+#define PWM_FADE_MARGIN_MS  5   // Slack before a fade-out counts as finished
+
+// Channels with a non-zero duty; LEDC stops in light sleep so the chip
+// is kept awake while any light is on
+static uint16_t g_activeChannels = 0;
+static portMUX_TYPE g_pwmMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool g_fadeInstalled = false;
+static esp_timer_handle_t g_fadeOffTimers[PWM_CHANNEL_COUNT];
+static int64_t g_fadeEndUs[PWM_CHANNEL_COUNT];     // Running fade finishes at (esp_timer)
+
+static void PWM_TrackActivity(PWM_Channel_t channel, uint32_t value)
+{
+    // The wake lock follows the mask inside the spinlock: a fade-off timer
+    // releasing it late would otherwise undo a channel just switched on
+    portENTER_CRITICAL(&g_pwmMux);
+    uint16_t before = g_activeChannels;
+
+    if (value != 0) {
+        g_activeChannels |= (1U << channel);
+    } else {
+        g_activeChannels &= ~(1U << channel);
+    }
+
+    if (before == 0 && g_activeChannels != 0) {
+        Power_LockAcquire(POWER_LOCK_PWM);
+    } else if (before != 0 && g_activeChannels == 0) {
+        Power_LockRelease(POWER_LOCK_PWM);
+    }
+    portEXIT_CRITICAL(&g_pwmMux);
+}
+
+/**
+ * @brief A fade to zero keeps the channel active until the LEDC is done,
+ *        otherwise light sleep would freeze the output mid-ramp
+ */
+static void PWM_FadeOffDone(void* arg)
+{
+    PWM_TrackActivity((PWM_Channel_t)(uintptr_t)arg, 0);
+}
+
+/**
+ * @brief Abort a fade still running on the channel
+ * @note The LEDC driver makes any duty or fade call wait on the channel's
+ *       fade semaphore until the running fade ends, up to the whole fade
+ *       time. Callers hold the room and MQTT client locks, so the fade is
+ *       stopped where it is instead and the new duty starts from there.
+ */
+static void PWM_StopFade(PWM_Channel_t channel)
+{
+    if (g_fadeEndUs[channel] == 0) return;
+    if (esp_timer_get_time() < g_fadeEndUs[channel]) {
+        ledc_fade_stop((ledc_mode_t)(channel / 8), (ledc_channel_t)(channel % 8));
+    }
+    g_fadeEndUs[channel] = 0;
+}
 
 void PWM_Init(PWM_Channel_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution)
 {
@@ -26,16 +86,29 @@ void PWM_Init(PWM_Channel_t channel, uint8_t pin, uint32_t frequency, uint8_t re
     ledcSetup(channel, frequency, resolution);
     ledcAttachPin(pin, channel);
     ledcWrite(channel, 0); // Start at 0
+
+    // Fade ISR is shared by every channel; a second install is harmless
+    if (!g_fadeInstalled) {
+        esp_err_t err = ledc_fade_func_install(0);
+        g_fadeInstalled = (err == ESP_OK || err == ESP_ERR_INVALID_STATE);
+    }
 #else
     // Add support for other platforms here
     #error "PWM not implemented for this platform"
 #endif
 }
 
-void PWM_Write(PWM_Channel_t channel, uint8_t value)
+void PWM_Write(PWM_Channel_t channel, uint32_t value)
 {
 #if defined(ESP32)
+    if (channel < PWM_CHANNEL_COUNT) {
+        if (g_fadeOffTimers[channel] != NULL) {
+            esp_timer_stop(g_fadeOffTimers[channel]);
+        }
+        PWM_StopFade(channel);
+    }
     ledcWrite(channel, value);
+    PWM_TrackActivity(channel, value);
 #else
     #error "PWM not implemented for this platform"
 #endif
@@ -49,3 +122,57 @@ void PWM_SetFrequency(PWM_Channel_t channel, uint32_t frequency)
     #error "PWM not implemented for this platform"
 #endif
 }
+
+void PWM_FadeTo(PWM_Channel_t channel, uint32_t duty, uint32_t time_ms)
+{
+#if defined(ESP32)
+    if (channel >= PWM_CHANNEL_COUNT) return;
+
+    // Arduino channel n is LEDC group n / 8, channel n % 8
+    ledc_mode_t mode = (ledc_mode_t)(channel / 8);
+    ledc_channel_t ledc_ch = (ledc_channel_t)(channel % 8);
+
+    if (!g_fadeInstalled) {
+        // No fade service: fall back to a step
+        ledcWrite(channel, duty);
+        PWM_TrackActivity(channel, duty);
+        return;
+    }
+
+    if (g_fadeOffTimers[channel] != NULL) {
+        esp_timer_stop(g_fadeOffTimers[channel]);
+    }
+    PWM_StopFade(channel);
+
+    if (duty != 0 || time_ms == 0) {
+        PWM_TrackActivity(channel, duty);
+    }
+
+    if (time_ms == 0) {
+        ledc_set_duty_and_update(mode, ledc_ch, duty, 0);
+        return;
+    }
+
+    ledc_set_fade_with_time(mode, ledc_ch, duty, (int)time_ms);
+    ledc_fade_start(mode, ledc_ch, LEDC_FADE_NO_WAIT);
+    g_fadeEndUs[channel] = esp_timer_get_time() + (int64_t)time_ms * 1000;
+
+    if (duty == 0) {
+        if (g_fadeOffTimers[channel] == NULL) {
+            esp_timer_create_args_t args = {};
+            args.callback = PWM_FadeOffDone;
+            args.arg = (void*)(uintptr_t)channel;
+            args.dispatch_method = ESP_TIMER_TASK;
+            args.name = "pwm_fade";
+            esp_timer_create(&args, &g_fadeOffTimers[channel]);
+        }
+        if (g_fadeOffTimers[channel] != NULL) {
+            esp_timer_start_once(g_fadeOffTimers[channel], (uint64_t)(time_ms + PWM_FADE_MARGIN_MS) * 1000);
+        } else {
+            PWM_TrackActivity(channel, 0);
+        }
+    }
+#else
+    #error "PWM not implemented for this platform"
+#endif
+}
@@ -8,8 +8,13 @@ typedef uint8_t PWM_Channel_t;
 
 // Function prototypes
 void PWM_Init(PWM_Channel_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution);
-void PWM_Write(PWM_Channel_t channel, uint8_t value);
+void PWM_Write(PWM_Channel_t channel, uint32_t value);
 void PWM_SetFrequency(PWM_Channel_t channel, uint32_t frequency);
 
+// Hardware fade to `duty` over `time_ms` (0 = immediate). The LEDC ramps on
+// its own and the call never blocks: a fade still running on the channel is
+// stopped where it is and the new one starts from that duty.
+void PWM_FadeTo(PWM_Channel_t channel, uint32_t duty, uint32_t time_ms);
+
 #endif // HAL_PWM_H
 
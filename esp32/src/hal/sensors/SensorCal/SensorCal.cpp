@@ -0,0 +1,104 @@
+#include <Arduino.h>
+#include <math.h>
+#include "../../../app_cfg.h"
+#include "../../../drivers/driver_adc/driver_adc.h"
+#include "SensorCal.h"
+
+#if SENSORH_DEBUG == STD_ON
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINTF(...)
+#endif
+
+// Point spacing so the last point is at or above the supply voltage
+#define SENSORCAL_STEP(supply_mv)   ((int32_t)(((supply_mv) + SENSORCAL_POINTS - 2) / (SENSORCAL_POINTS - 1)))
+
+// ==================== TABLES ====================
+
+static int32_t g_ldrLux[SENSORCAL_POINTS];
+static int32_t g_mq5Ppm[SENSORCAL_POINTS];
+
+// The pot is a plain divider, so two points describe it exactly. They span
+// the ADC's calibrated full-scale reading (about 3.1 V at 11 dB), not the
+// supply, or the top of the range could never be reached
+static constexpr int32_t POT_TEMP_DECI[] = {
+    (int32_t)(TEMP_MIN * 10.0f),
+    (int32_t)(TEMP_MAX * 10.0f)
+};
+
+static const SensorCal_Curve_t LDR_CURVE = { 0, SENSORCAL_STEP(LDR_SUPPLY_MV), SENSORCAL_POINTS, g_ldrLux };
+static const SensorCal_Curve_t MQ5_CURVE = { 0, SENSORCAL_STEP(MQ5_SUPPLY_MV / MQ5_OUT_SCALE), SENSORCAL_POINTS, g_mq5Ppm };
+static SensorCal_Curve_t       g_potCurve = { 0, POT_SUPPLY_MV, 2, POT_TEMP_DECI };
+
+// ==================== CURVE MODELS (boot only) ====================
+
+/**
+ * @brief LDR on the high side: R = Rfixed * (Vcc - V) / V, lux = 10 * (R10 / R)^(1/gamma)
+ */
+static int32_t SensorCal_LdrModel(float mv)
+{
+    if (mv <= 0.0f) return 0;
+    if (mv >= LDR_SUPPLY_MV) return LDR_MAX_LUX;
+
+    float r = (float)LDR_FIXED_OHM * (LDR_SUPPLY_MV - mv) / mv;
+    float lux = 10.0f * powf((float)LDR_R10_OHM / r, 1.0f / LDR_GAMMA);
+    return (lux > LDR_MAX_LUX) ? LDR_MAX_LUX : (int32_t)(lux + 0.5f);
+}
+
+/**
+ * @brief MQ5 load divider: Rs = RL * (Vc - Vout) / Vout, ppm = A * (Rs / R0)^B
+ */
+static int32_t SensorCal_Mq5Model(float mv)
+{
+    float vout = mv * MQ5_OUT_SCALE;
+    if (vout <= 0.0f) return 0;
+    if (vout >= MQ5_SUPPLY_MV) return MQ5_MAX_PPM;
+
+    float rs = (float)MQ5_LOAD_OHM * (MQ5_SUPPLY_MV - vout) / vout;
+    float ppm = MQ5_CURVE_A * powf(rs / (float)MQ5_R0_OHM, MQ5_CURVE_B);
+    return (ppm > MQ5_MAX_PPM) ? MQ5_MAX_PPM : (int32_t)(ppm + 0.5f);
+}
+
+static void SensorCal_Tabulate(const SensorCal_Curve_t* curve, int32_t* table, int32_t (*model)(float))
+{
+    for (uint8_t i = 0; i < curve->count; i++) {
+        table[i] = model((float)(curve->x0 + i * curve->step));
+    }
+}
+
+// ==================== PUBLIC FUNCTIONS ====================
+
+void SensorCal_Init(void)
+{
+    static bool initialized = false;
+    if (initialized) return;
+
+    SensorCal_Tabulate(&LDR_CURVE, g_ldrLux, SensorCal_LdrModel);
+    SensorCal_Tabulate(&MQ5_CURVE, g_mq5Ppm, SensorCal_Mq5Model);
+
+    // ADC_Acq_Init() has built the mV table by now
+    uint16_t full_scale_mv = ADC_Acq_RawToMv(4095);
+    if (full_scale_mv > 0) g_potCurve.step = full_scale_mv;
+    initialized = true;
+
+    DEBUG_PRINTF("[SENSOR] Calibration tables: %u points, LDR %ld..%ld lux, MQ5 %ld..%ld ppm, pot 0..%ld mV\n",
+                 (unsigned)SENSORCAL_POINTS,
+                 (long)g_ldrLux[0], (long)g_ldrLux[SENSORCAL_POINTS - 1],
+                 (long)g_mq5Ppm[0], (long)g_mq5Ppm[SENSORCAL_POINTS - 1],
+                 (long)g_potCurve.step);
+}
+
+int32_t SensorCal_LdrLux(uint16_t mv)
+{
+    return SensorCal_Lookup(&LDR_CURVE, mv);
+}
+
+int32_t SensorCal_Mq5Ppm(uint16_t mv)
+{
+    return SensorCal_Lookup(&MQ5_CURVE, mv);
+}
+
+int32_t SensorCal_PotTempDeci(uint16_t mv)
+{
+    return SensorCal_Lookup(&g_potCurve, mv);
+}
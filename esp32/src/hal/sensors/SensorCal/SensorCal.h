@@ -0,0 +1,59 @@
+/**
+ * @file SensorCal.h
+ * @brief Pin voltage -> engineering unit conversion tables
+ *
+ * @note Every conversion is one table lookup with integer interpolation.
+ *       Nonlinear curves (LDR lux, MQ5 ppm) are tabulated once at boot from
+ *       the parameters in app_cfg.h; linear ones are constexpr points (the
+ *       pot's end point is the ADC full-scale reading, set at boot). Inputs are
+ *       millivolts from ADC_Acq_RawToMv(), which already applies the eFuse
+ *       ADC calibration.
+ */
+
+#ifndef _SENSORCAL_H
+#define _SENSORCAL_H
+
+#include <stdint.h>
+
+// ==================== TYPE DEFINITIONS ====================
+
+/**
+ * @brief Uniformly spaced curve: y[i] is the output at x0 + i * step
+ */
+typedef struct {
+    int32_t        x0;
+    int32_t        step;
+    uint8_t        count;
+    const int32_t* y;
+} SensorCal_Curve_t;
+
+// ==================== INLINE FUNCTIONS ====================
+
+/**
+ * @brief Piecewise-linear lookup, clamped to the ends of the table
+ */
+static inline int32_t SensorCal_Lookup(const SensorCal_Curve_t* curve, int32_t x)
+{
+    int32_t offset = x - curve->x0;
+    if (offset <= 0) return curve->y[0];
+
+    int32_t i = offset / curve->step;
+    if (i >= curve->count - 1) return curve->y[curve->count - 1];
+
+    int32_t frac = offset - i * curve->step;
+    return curve->y[i] + (int32_t)(((int64_t)(curve->y[i + 1] - curve->y[i]) * frac) / curve->step);
+}
+
+// ==================== FUNCTION PROTOTYPES ====================
+
+/**
+ * @brief Tabulate the boot-time curves
+ * @note Safe to call more than once; only the first call does anything
+ */
+void SensorCal_Init(void);
+
+int32_t SensorCal_LdrLux(uint16_t mv);          ///< Illuminance in lux
+int32_t SensorCal_Mq5Ppm(uint16_t mv);          ///< Gas concentration in ppm (LPG)
+int32_t SensorCal_PotTempDeci(uint16_t mv);     ///< Target temperature in 0.1 °C
+
+#endif
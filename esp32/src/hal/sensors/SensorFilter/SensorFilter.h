@@ -0,0 +1,200 @@
+/**
+ * @file SensorFilter.h
+ * @brief Header-only fixed-point filters for sensor channels
+ *
+ * @note Every filter is a small POD-like class with no heap use and no
+ *       floating point: `int32_t update(int32_t x)` consumes one sample and
+ *       returns the filtered value, `reset()` forgets all history. A
+ *       zero-initialised instance (static storage) is ready to use and
+ *       primes itself from the first sample.
+ *
+ *       Filters are chosen per channel in SENSORH_TABLE and can be stacked
+ *       with SensorFilter_Chain. Per-update cycle cost is measured on target
+ *       by SensorH_Init() when SENSORH_DEBUG is on.
+ */
+
+#ifndef _SENSORFILTER_H
+#define _SENSORFILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ==================== PASS-THROUGH ====================
+
+class SensorFilter_None {
+public:
+    void    reset(void) {}
+    int32_t update(int32_t x) { return x; }
+};
+
+// ==================== EMA ====================
+
+/**
+ * @brief First-order low-pass, alpha = 1 / 2^Shift
+ * @note State is kept in Q8 so small steps are not lost to truncation
+ */
+template <uint8_t Shift>
+class SensorFilter_Ema {
+    static_assert(Shift >= 1 && Shift <= 15, "EMA shift must be 1..15");
+
+public:
+    void reset(void) { m_primed = false; }
+
+    int32_t update(int32_t x)
+    {
+        if (!m_primed) {
+            m_acc = x * 256;
+            m_primed = true;
+        } else {
+            m_acc += ((x * 256) - m_acc) >> Shift;
+        }
+        return (m_acc + 128) >> 8;
+    }
+
+private:
+    int32_t m_acc;
+    bool    m_primed;
+};
+
+// ==================== SLIDING MEDIAN ====================
+
+/**
+ * @brief Median of the last N samples; removes single-sample spikes
+ *        without smearing steps
+ * @note Sorts a copy of the window per update (insertion sort, N <= 15)
+ */
+template <uint8_t N>
+class SensorFilter_Median {
+    static_assert(N >= 3 && N <= 15 && (N % 2) == 1, "Median window must be odd, 3..15");
+
+public:
+    void reset(void) { m_count = 0; m_head = 0; }
+
+    int32_t update(int32_t x)
+    {
+        m_window[m_head] = x;
+        m_head = (uint8_t)((m_head + 1) % N);
+        if (m_count < N) m_count++;
+
+        int32_t sorted[N];
+        for (uint8_t i = 0; i < m_count; i++) {
+            int32_t v = m_window[i];
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        return sorted[m_count / 2];
+    }
+
+private:
+    int32_t m_window[N];
+    uint8_t m_head;
+    uint8_t m_count;
+};
+
+// ==================== 1-D KALMAN ====================
+
+/**
+ * @brief Scalar Kalman filter for a slowly drifting level
+ * @tparam ProcessNoise     Q, expected drift variance per update (input units^2)
+ * @tparam MeasurementNoise R, sample noise variance (input units^2)
+ * @note Estimate and covariance are Q8, the gain Q16. Adapts its gain: fast
+ *       while uncertain, then settles to a steady low-pass set by Q/R.
+ */
+template <uint16_t ProcessNoise, uint16_t MeasurementNoise>
+class SensorFilter_Kalman {
+    static_assert(MeasurementNoise > 0, "Measurement noise must be positive");
+
+public:
+    void reset(void) { m_primed = false; }
+
+    int32_t update(int32_t z)
+    {
+        if (!m_primed) {
+            m_x = z * 256;
+            m_p = (int32_t)MeasurementNoise << 8;
+            m_primed = true;
+            return z;
+        }
+
+        m_p += (int32_t)ProcessNoise << 8;
+        int32_t k = (int32_t)(((int64_t)m_p << 16) / (m_p + ((int32_t)MeasurementNoise << 8)));
+        m_x += (int32_t)(((int64_t)k * (z * 256 - m_x)) >> 16);
+        m_p = (int32_t)(((int64_t)m_p * (65536 - k)) >> 16);
+
+        return (m_x + 128) >> 8;
+    }
+
+private:
+    int32_t m_x;        // Estimate, Q8
+    int32_t m_p;        // Estimate variance, Q8
+    bool    m_primed;
+};
+
+// ==================== SLEW-RATE LIMITER ====================
+
+/**
+ * @brief Output moves toward the input by at most MaxStep per update
+ * @note Meant for actuator set-points (dimming, fan duty) so a sensor step
+ *       becomes a ramp instead of a visible jump
+ */
+template <uint16_t MaxStep>
+class SensorFilter_Slew {
+    static_assert(MaxStep > 0, "Slew step must be positive");
+
+public:
+    void reset(void) { m_primed = false; }
+
+    int32_t update(int32_t x)
+    {
+        if (!m_primed) {
+            m_y = x;
+            m_primed = true;
+        } else if (x > m_y + (int32_t)MaxStep) {
+            m_y += MaxStep;
+        } else if (x < m_y - (int32_t)MaxStep) {
+            m_y -= MaxStep;
+        } else {
+            m_y = x;
+        }
+        return m_y;
+    }
+
+private:
+    int32_t m_y;
+    bool    m_primed;
+};
+
+// ==================== CHAIN ====================
+
+/**
+ * @brief Run filters in order, e.g. SensorFilter_Chain<SensorFilter_Median<5>, SensorFilter_Ema<2>>
+ */
+template <typename... Filters>
+class SensorFilter_Chain;
+
+template <typename First>
+class SensorFilter_Chain<First> {
+public:
+    void    reset(void) { m_first.reset(); }
+    int32_t update(int32_t x) { return m_first.update(x); }
+
+private:
+    First m_first;
+};
+
+template <typename First, typename... Rest>
+class SensorFilter_Chain<First, Rest...> {
+public:
+    void    reset(void) { m_first.reset(); m_rest.reset(); }
+    int32_t update(int32_t x) { return m_rest.update(m_first.update(x)); }
+
+private:
+    First                       m_first;
+    SensorFilter_Chain<Rest...> m_rest;
+};
+
+#endif
@@ -1,30 +1,94 @@
 #include <Arduino.h>
 #include "../../../app_cfg.h"
 #include "SensorH.h"
+#include "../SensorCal/SensorCal.h"
 
 #if SENSORH_DEBUG == STD_ON
-#define DEBUG_PRINTLN(var) Serial.println(var)
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
 #else
-#define DEBUG_PRINTLN(var)
+#define DEBUG_PRINTF(...)
 #endif
 
-void SensorH_Init( SensorH_t  *config)
+SensorH_State_t g_sensorHState[SENSORH_COUNT];
+
+#if SENSORH_DEBUG == STD_ON
+#define SENSORH_BENCH_SAMPLES   256
+
+/**
+ * @brief Average cycles per update() of a fresh filter on a noisy ramp
+ * @note Includes a few cycles of loop overhead; run once at init
+ */
+template <typename Filter>
+static uint32_t SensorH_FilterCycles(void)
 {
-#if SENSORH_ENABLED == STD_ON
+    Filter filter = Filter();
+    volatile int32_t sink = 0;
 
-    DEBUG_PRINTLN("SensorH Initialized");
-    DEBUG_PRINTLN("Channel: " + String(config->channel));
-    DEBUG_PRINTLN("Resolution: " + String(config->resolution));
-    analogReadResolution(config->resolution);
+    uint32_t start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < SENSORH_BENCH_SAMPLES; i++) {
+        sink = filter.update(2048 + i + (int32_t)((i * 37) & 63) - 32);
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
 
+    (void)sink;
+    return cycles / SENSORH_BENCH_SAMPLES;
+}
+
+#define SENSORH_BENCH_ENTRY(id, ...) \
+    DEBUG_PRINTF("[SENSOR] " #id " filter: %lu cycles/update\n", \
+                 (unsigned long)SensorH_FilterCycles<SensorH_Analog<SENSORH_##id>::Filter>());
+
+static void SensorH_BenchmarkFilters(void)
+{
+    DEBUG_PRINTF("[SENSOR] Filter cost (cycles/update): none %lu, ema %lu, median5 %lu, kalman %lu, slew %lu\n",
+                 (unsigned long)SensorH_FilterCycles<SensorFilter_None>(),
+                 (unsigned long)SensorH_FilterCycles<SensorFilter_Ema<2>>(),
+                 (unsigned long)SensorH_FilterCycles<SensorFilter_Median<5>>(),
+                 (unsigned long)SensorH_FilterCycles<SensorFilter_Kalman<4, 400>>(),
+                 (unsigned long)SensorH_FilterCycles<SensorFilter_Slew<8>>());
+    SENSORH_TABLE(SENSORH_BENCH_ENTRY)
+}
 #endif
+
+/**
+ * @brief Update every registered sensor; runs after each ADC burst
+ * @note Expanded from the table, so each row is a direct call with its
+ *       descriptor folded in - no loop over descriptors at run time
+ */
+#define SENSORH_SAMPLE_ENTRY(id, ...) SensorH_Analog<SENSORH_##id>::sample();
+static void SensorH_ServiceAll(void)
+{
+    SENSORH_TABLE(SENSORH_SAMPLE_ENTRY)
 }
 
-uint32_t SensorH_ReadValue(uint8_t channel)
+void SensorH_Init(void)
 {
 #if SENSORH_ENABLED == STD_ON
-    int rawValue = analogRead(channel);
-    DEBUG_PRINTLN("Read Value from channel " + String(channel) + ": " + String(rawValue));
-    return rawValue;
+    static bool initialized = false;
+    if (initialized) return;
+
+    // All ADC pins are sampled by the DMA engine; it also builds the mV table
+    if (!ADC_Acq_Init()) {
+        DEBUG_PRINTF("[SENSOR] ADC acquisition not running\n");
+        return;
+    }
+
+    for (uint8_t id = 0; id < SENSORH_COUNT; id++) {
+        const SensorH_Desc_t* desc = &SENSORH_DESC[id];
+        if (desc->enabled && !ADC_Acq_HasPin(desc->pin)) {
+            DEBUG_PRINTF("[SENSOR] GPIO%u is missing from ADC_ACQ_CHANNEL_TABLE\n", desc->pin);
+        }
+        DEBUG_PRINTF("[SENSOR] #%u GPIO%u %u-bit every %u ms -> %ld..%ld\n",
+                     id, desc->pin, desc->resolution,
+                     (unsigned)(desc->divider * ADC_ACQ_PERIOD_MS),
+                     (long)desc->out_min, (long)desc->out_max);
+    }
+
+    SensorCal_Init();
+#if SENSORH_DEBUG == STD_ON
+    SensorH_BenchmarkFilters();
 #endif
-}
\ No newline at end of file
+    ADC_Acq_SetFrameHook(SensorH_ServiceAll);
+    initialized = true;
+#endif
+}
@@ -1,14 +1,136 @@
+/**
+ * @file SensorH.h
+ * @brief Analog sensor registry
+ *
+ * @note Sensors are rows of SENSORH_TABLE in app_cfg.h. Each row becomes a
+ *       constexpr descriptor and a SensorH_Analog<SENSORH_<id>> type whose
+ *       getters and sampling step are resolved at compile time. All sensors
+ *       are updated in one pass after every ADC burst; nothing in this module
+ *       blocks or polls millis().
+ */
+
 #ifndef _SENSORH_H
 #define _SENSORH_H
+
 #include <stdint.h>
+#include <stdbool.h>
+#include "../../../app_cfg.h"
+#include "../../../drivers/driver_adc/driver_adc.h"
+#include "../SensorFilter/SensorFilter.h"
+
+#define SENSORH_INVALID     0xFFFF      // Returned by getters of disabled sensors
+#define SENSORH_ADC_BITS    12
+
+// ==================== TYPE DEFINITIONS ====================
+
+#define SENSORH_ID_ENTRY(id, enabled, pin, res, period_ms, out_min, out_max, ...) SENSORH_##id,
+typedef enum {
+    SENSORH_TABLE(SENSORH_ID_ENTRY)
+    SENSORH_COUNT
+} SensorH_Id_t;
+
+typedef struct {
+    bool     enabled;
+    uint8_t  pin;
+    uint8_t  resolution;        // Bits kept from the 12-bit ADC result
+    uint16_t divider;           // Update every N bursts
+    int32_t  out_min;
+    int32_t  out_max;
+} SensorH_Desc_t;
+
+typedef struct {
+    volatile uint16_t raw;      // Latest burst mean at `resolution` bits
+    volatile uint16_t filtered; // After the sensor's filter
+    volatile int32_t  value;    // `filtered` scaled to out_min..out_max
+    uint16_t ticks;
+    bool     primed;
+} SensorH_State_t;
+
+// ==================== DESCRIPTOR TABLE ====================
+
+#define SENSORH_DIVIDER(period_ms) \
+    (((period_ms) <= ADC_ACQ_PERIOD_MS) ? 1 : (((period_ms) + ADC_ACQ_PERIOD_MS - 1) / ADC_ACQ_PERIOD_MS))
+
+#define SENSORH_DESC_ENTRY(id, enabled, pin, res, period_ms, out_min, out_max, ...) \
+    { (enabled) == STD_ON, (pin), (res), SENSORH_DIVIDER(period_ms), (out_min), (out_max) },
+
+static constexpr SensorH_Desc_t SENSORH_DESC[SENSORH_COUNT] = {
+    SENSORH_TABLE(SENSORH_DESC_ENTRY)
+};
+
+// Written only by the ADC acquisition task (see SensorH_Analog::sample)
+extern SensorH_State_t g_sensorHState[SENSORH_COUNT];
+
+/**
+ * @brief Filter type of each row (the table's last column)
+ */
+template <SensorH_Id_t Id>
+struct SensorH_FilterOf;
+
+#define SENSORH_FILTER_ENTRY(id, enabled, pin, res, period_ms, out_min, out_max, ...) \
+    template <> struct SensorH_FilterOf<SENSORH_##id> { typedef __VA_ARGS__ type; };
+SENSORH_TABLE(SENSORH_FILTER_ENTRY)
+
+// ==================== SENSOR TYPE ====================
+
+/**
+ * @brief Typed view of one registry row
+ * @note Everything but the state load is a constant, so e.g.
+ *       SensorH_Analog<SENSORH_LDR_1>::value() is a single memory read.
+ */
+template <SensorH_Id_t Id>
+class SensorH_Analog {
+    static_assert(Id < SENSORH_COUNT, "Unknown sensor id");
+    static_assert(SENSORH_DESC[Id].resolution >= 1 && SENSORH_DESC[Id].resolution <= SENSORH_ADC_BITS,
+                  "Sensor resolution must be 1..12 bits");
+
+public:
+    typedef typename SensorH_FilterOf<Id>::type Filter;
+
+    static constexpr bool     enabled(void) { return SENSORH_DESC[Id].enabled; }
+    static constexpr uint8_t  pin(void)     { return SENSORH_DESC[Id].pin; }
+    static constexpr uint16_t maxRaw(void)  { return (uint16_t)((1U << SENSORH_DESC[Id].resolution) - 1); }
+
+    static uint16_t raw(void)      { return enabled() ? g_sensorHState[Id].raw : SENSORH_INVALID; }
+    static uint16_t filtered(void) { return enabled() ? g_sensorHState[Id].filtered : SENSORH_INVALID; }
+    static int32_t  value(void)    { return enabled() ? g_sensorHState[Id].value : SENSORH_INVALID; }
+
+    /**
+     * @brief One registry step; called from the batched pass only
+     */
+    static void sample(void)
+    {
+        if (!enabled()) return;
+
+        SensorH_State_t& s = g_sensorHState[Id];
+        if (s.primed && ++s.ticks < SENSORH_DESC[Id].divider) return;
+        s.ticks = 0;
+
+        uint16_t in = (uint16_t)(ADC_Acq_GetLatest(pin()) >> (SENSORH_ADC_BITS - SENSORH_DESC[Id].resolution));
+        s.raw = in;
+        s.primed = true;
+
+        int32_t f = s_filter.update(in);
+        if (f < 0) f = 0;
+        if (f > maxRaw()) f = maxRaw();
+        s.filtered = (uint16_t)f;
+        s.value = SENSORH_DESC[Id].out_min +
+                  ((int32_t)f * (SENSORH_DESC[Id].out_max - SENSORH_DESC[Id].out_min) + maxRaw() / 2) / maxRaw();
+    }
+
+private:
+    static Filter s_filter;     // Zero-initialised, primes on the first sample
+};
+
+template <SensorH_Id_t Id>
+typename SensorH_Analog<Id>::Filter SensorH_Analog<Id>::s_filter;
 
-typedef struct
-{
-    uint8_t channel;
-    uint8_t resolution;
-} SensorH_t;
+// ==================== FUNCTION PROTOTYPES ====================
 
-void SensorH_Init( SensorH_t *config);
-uint32_t SensorH_ReadValue(uint8_t channel);
+/**
+ * @brief Start the ADC engine and attach the batched pass to it
+ * @note Safe to call from every sensor module; only the first call does anything
+ */
+void SensorH_Init(void);
 
-#endif
\ No newline at end of file
+#endif
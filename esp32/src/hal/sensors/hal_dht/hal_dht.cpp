@@ -1,81 +1,201 @@
 #include <Arduino.h>
-#include <DHT.h>
 #include "../../../app_cfg.h"
 #include "hal_dht.h"
+#include "../../hal_power/hal_power.h"
+
+#include "driver/rmt.h"
+#include "driver/gpio.h"
 
 #if DHT22_DEBUG == STD_ON
-#define DEBUG_PRINTLN(var) Serial.println(var)
+#define DEBUG_PRINTF(...) Serial.printf(__VA_ARGS__)
 #else
-#define DEBUG_PRINTLN(var)
+#define DEBUG_PRINTF(...)
 #endif
 
-static double temp = 0.0;
+// The RMT captures the pulse train in hardware with interrupts enabled;
+// the calling task just sleeps on the ring buffer until the frame is done.
+#define DHT22_RMT_CLK_DIV        80     // 80 MHz APB / 80 = 1 us per tick
+#define DHT22_RMT_IDLE_US        200    // Longer than any DHT22 pulse -> end of frame
+#define DHT22_RMT_FILTER_TICKS   100    // Glitch filter in APB cycles (~1.25 us)
+#define DHT22_RMT_RINGBUF_BYTES  1024
 
-// Declare DHT object globally (outside function)
-#if DHT22_ENABLED==STD_ON
-DHT dht22(DHT22_PIN, DHT22);
-#endif
+#define DHT22_START_LOW_MS       2      // Host start signal, >= 1 ms
+#define DHT22_RX_TIMEOUT_MS      15     // Whole frame takes ~5 ms
+#define DHT22_BIT_THRESHOLD_US   48     // '0' high ~27 us, '1' high ~70 us
+#define DHT22_PULSE_MAX_US       120    // Longer highs are not data bits
+#define DHT22_FRAME_BITS         40
+
+static RingbufHandle_t g_rxRing = NULL;
+static bool g_ready = false;
+static DHT22_Stats_t g_stats;
 
 void DHT22_INIT(void)
 {
 #if DHT22_ENABLED==STD_ON
-  dht22.begin();
+  rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)DHT22_PIN, (rmt_channel_t)DHT22_RMT_CHANNEL);
+  config.clk_div = DHT22_RMT_CLK_DIV;
+  config.mem_block_num = 1;                       // 64 items, frame needs ~42
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = DHT22_RMT_FILTER_TICKS;
+  config.rx_config.idle_threshold = DHT22_RMT_IDLE_US;
+
+  if (rmt_config(&config) != ESP_OK ||
+      rmt_driver_install((rmt_channel_t)DHT22_RMT_CHANNEL, DHT22_RMT_RINGBUF_BYTES, 0) != ESP_OK ||
+      rmt_get_ringbuf_handle((rmt_channel_t)DHT22_RMT_CHANNEL, &g_rxRing) != ESP_OK) {
+    Serial.println("[ERROR] DHT22 RMT init failed");
+    return;
+  }
+
+  // Same pin drives the start pulse: open-drain, idle released (pulled up)
+  gpio_set_direction((gpio_num_t)DHT22_PIN, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode((gpio_num_t)DHT22_PIN, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)DHT22_PIN, 1);
+
+  g_ready = true;
+  DEBUG_PRINTF("[SENSOR] DHT22 on GPIO%d via RMT channel %d\n", DHT22_PIN, DHT22_RMT_CHANNEL);
 #endif
 }
 
+/**
+ * @brief Turn captured RMT items into the 5-byte DHT22 frame
+ * @note Uses the last 40 high pulses so a missed response edge at the
+ *       start of the capture does not shift the bits
+ */
+static DHT22_Status_t DHT22_Decode(const rmt_item32_t* items, size_t count, uint8_t frame[5])
+{
+  uint8_t highs[DHT22_FRAME_BITS + 8];
+  uint8_t n = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint16_t durations[2] = { (uint16_t)items[i].duration0, (uint16_t)items[i].duration1 };
+    uint8_t levels[2] = { (uint8_t)items[i].level0, (uint8_t)items[i].level1 };
 
-float ReadTemperatureSensor() {
+    for (uint8_t half = 0; half < 2; half++) {
+      if (durations[half] == 0) break;            // End marker
+      if (levels[half] != 1 || durations[half] > DHT22_PULSE_MAX_US) continue;
 
-  #if DHT22_ENABLED==STD_ON
-  float tempc = dht22.readTemperature(); // Returns temperature in Celsius
-  
-  // Check if reading failed
-  if (isnan(tempc)) {
-    Serial.println("[ERROR] Failed to read temperatureF!");
-    return 0.0;  // Return default value on error
+      // Keep a sliding window of the most recent highs
+      if (n == sizeof(highs)) {
+        memmove(highs, highs + 1, sizeof(highs) - 1);
+        n--;
+      }
+      highs[n++] = (uint8_t)durations[half];
+    }
   }
-  else{
-  Serial.print("[SENSOR] TemperatureF: ");
-  Serial.print(tempc);
-  Serial.println(" °C");
-}
-  return tempc;
-  #endif
+
+  if (n < DHT22_FRAME_BITS) return DHT22_ERR_DECODE;
+
+  memset(frame, 0, 5);
+  const uint8_t* bits = &highs[n - DHT22_FRAME_BITS];
+  for (uint8_t i = 0; i < DHT22_FRAME_BITS; i++) {
+    frame[i / 8] = (uint8_t)((frame[i / 8] << 1) | (bits[i] > DHT22_BIT_THRESHOLD_US ? 1 : 0));
+  }
+
+  uint8_t sum = (uint8_t)(frame[0] + frame[1] + frame[2] + frame[3]);
+  return (sum == frame[4]) ? DHT22_OK : DHT22_ERR_CHECKSUM;
 }
 
-float ReadTemperatureSensorF() {
-  #if DHT22_ENABLED==STD_ON
-  float tempf = dht22.readTemperature(true);  // Returns temperature in Celsius
-  
-  // Check if reading failed
-  if (isnan(tempf)) {
-    Serial.println("[ERROR] Failed to read temperature!");
-    return 0.0;  // Return default value on error
+static DHT22_Status_t DHT22_Transaction(DHT22_Reading_t* reading)
+{
+  size_t length = 0;
+  uint8_t frame[5];
+  DHT22_Status_t status;
+
+  // Drop anything left over from a previous attempt
+  rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(g_rxRing, &length, 0);
+  if (items != NULL) vRingbufferReturnItem(g_rxRing, items);
+
+  // APB must keep running while the RMT is sampling
+  Power_LockAcquire(POWER_LOCK_SENSOR);
+
+  gpio_set_level((gpio_num_t)DHT22_PIN, 0);
+  vTaskDelay(pdMS_TO_TICKS(DHT22_START_LOW_MS));
+  gpio_set_level((gpio_num_t)DHT22_PIN, 1);
+  rmt_rx_start((rmt_channel_t)DHT22_RMT_CHANNEL, true);
+
+  items = (rmt_item32_t*)xRingbufferReceive(g_rxRing, &length, pdMS_TO_TICKS(DHT22_RX_TIMEOUT_MS));
+  rmt_rx_stop((rmt_channel_t)DHT22_RMT_CHANNEL);
+
+  Power_LockRelease(POWER_LOCK_SENSOR);
+
+  if (items == NULL) {
+    g_stats.timeouts++;
+    return DHT22_ERR_TIMEOUT;
+  }
+
+  status = DHT22_Decode(items, length / sizeof(rmt_item32_t), frame);
+  vRingbufferReturnItem(g_rxRing, items);
+
+  if (status == DHT22_ERR_CHECKSUM) {
+    g_stats.checksum_errors++;
+    return status;
+  }
+  if (status != DHT22_OK) {
+    g_stats.decode_errors++;
+    return status;
+  }
+
+  float humidity = (float)((frame[0] << 8) | frame[1]) / 10.0f;
+  float temperature = (float)(((frame[2] & 0x7F) << 8) | frame[3]) / 10.0f;
+  if (frame[2] & 0x80) temperature = -temperature;
+
+  // Datasheet range; anything else is a corrupted frame that happened to sum
+  if (humidity > 100.0f || temperature < -40.0f || temperature > 80.0f) {
+    g_stats.decode_errors++;
+    return DHT22_ERR_DECODE;
   }
-  else{
-  Serial.print("[SENSOR] Temperature: ");
-  Serial.print(tempf);
-  Serial.println(" °F");
+
+  reading->temperature = temperature;
+  reading->humidity = humidity;
+  return DHT22_OK;
 }
-  return tempf;
+
+DHT22_Status_t DHT22_Read(DHT22_Reading_t* reading)
+{
+  if (reading == NULL) return DHT22_ERR_DECODE;
+
+  reading->temperature = NAN;
+  reading->humidity = NAN;
+  reading->attempts = 0;
+  reading->status = DHT22_ERR_DISABLED;
+
+#if DHT22_ENABLED==STD_ON
+  if (!g_ready) return reading->status;
+
+  g_stats.reads++;
+  for (uint8_t attempt = 0; attempt <= DHT22_MAX_RETRIES; attempt++) {
+    if (attempt > 0) {
+      g_stats.retries++;
+      // Sensor needs a pause between transactions
+      vTaskDelay(pdMS_TO_TICKS(DHT22_RETRY_DELAY_MS));
+    }
+
+    reading->attempts++;
+    reading->status = DHT22_Transaction(reading);
+    if (reading->status == DHT22_OK) break;
+
+    DEBUG_PRINTF("[SENSOR] DHT22 attempt %u failed (%d)\n", reading->attempts, reading->status);
+  }
+
+  if (reading->status == DHT22_OK) {
+    DEBUG_PRINTF("[SENSOR] Temperature: %.1f °C, humidity: %.1f%%\n",
+                 reading->temperature, reading->humidity);
+  } else {
+    reading->temperature = NAN;
+    reading->humidity = NAN;
+    Serial.println("[ERROR] Failed to read DHT22!");
+  }
 #endif
+
+  return reading->status;
 }
 
+bool DHT22_IsValid(const DHT22_Reading_t* reading)
+{
+  return reading != NULL && reading->status == DHT22_OK;
+}
 
-float ReadHumiditySensor() {
-  #if DHT22_ENABLED==STD_ON
-  float humi = dht22.readHumidity(); // Returns temperature in Celsius
-  
-  // Check if reading failed
-  if (isnan(humi)) {
-    Serial.println("[ERROR] Failed to read Humidity!");
-    return 0.0;  // Return default value on error
-  }
-  else{
-  Serial.print("[SENSOR] humidity: ");
-  Serial.print(humi);
-  Serial.println("%");
+void DHT22_GetStats(DHT22_Stats_t* stats)
+{
+  if (stats != NULL) *stats = g_stats;
 }
-  return humi;
-  #endif
-}
\ No newline at end of file
@@ -1,11 +1,37 @@
 #ifndef HAL_DHT_H
 #define HAL_DHT_H
 
+#include <stdint.h>
+#include <stdbool.h>
 
+typedef enum {
+  DHT22_OK = 0,
+  DHT22_ERR_TIMEOUT,      // No complete pulse train captured
+  DHT22_ERR_DECODE,       // Too few bits or implausible values
+  DHT22_ERR_CHECKSUM,     // Frame captured but parity byte mismatched
+  DHT22_ERR_DISABLED
+} DHT22_Status_t;
+
+// One transaction yields both values; they are only meaningful when
+// status == DHT22_OK (otherwise both are NAN)
+typedef struct {
+  float temperature;      // °C
+  float humidity;         // %RH
+  DHT22_Status_t status;
+  uint8_t attempts;       // Transactions used, including retries
+} DHT22_Reading_t;
+
+typedef struct {
+  uint32_t reads;
+  uint32_t retries;
+  uint32_t timeouts;
+  uint32_t decode_errors;
+  uint32_t checksum_errors;
+} DHT22_Stats_t;
 
 void  DHT22_INIT(void);
-float ReadTemperatureSensor();
-float ReadTemperatureSensorF() ;
-float ReadHumiditySensor();
+DHT22_Status_t DHT22_Read(DHT22_Reading_t* reading);
+bool  DHT22_IsValid(const DHT22_Reading_t* reading);
+void  DHT22_GetStats(DHT22_Stats_t* stats);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,8 +1,9 @@
 #ifndef HAL_LDR_H
 #define HAL_LDR_H
 
+#include <stdint.h>
+
 void LDR_1_init(void);
-void LDR_1_main(void);
 
 uint16_t LDR_1_getRawValue(void);
 uint16_t LDR_1_getAveragedValue(void);
@@ -1,51 +1,24 @@
 #include <Arduino.h>
 #include "../../../app_cfg.h"
 #include "../SensorH/SensorH.h"
+#include "../SensorCal/SensorCal.h"
 #include "hal_mq5.h"
 
-#if MQ5_1_DEBUG == STD_ON
-#define DEBUG_PRINTLN(var) Serial.println(var)
-#define DEBUG_PRINT(var) Serial.print(var)
-#else
-#define DEBUG_PRINTLN(var)
-#define DEBUG_PRINT(var)
-#endif
+// Sampling, filtering and scaling are the MQ5_1 row of SENSORH_TABLE
+typedef SensorH_Analog<SENSORH_MQ5_1> Mq5_1;
 
-// Sensor object
-static  SensorH_t config = {MQ5_PIN, ADC_RESOLUTION};
-
-static uint16_t MQ5_value;
-static uint16_t outputValue;
 void MQ5_1_init(void)
 {
-#if MQ5_1_ENABLED == STD_ON
-    SensorH_Init(&config);
-#endif
+    SensorH_Init();
 }
 
-void MQ5_1_main(void)
+uint16_t MQ5_1_value(void)
 {
-#if  MQ5_1_ENABLED == STD_ON
-    static unsigned long lastReadTime = 0;
-    const unsigned long READ_INTERVAL = 1000;
-    
-    if (millis() - lastReadTime >= READ_INTERVAL) {
-        lastReadTime = millis();
-        MQ5_value = SensorH_ReadValue(config.channel);
-        MQ5_value = constrain(MQ5_value, MQ5_MIN_RAW, MQ5_MAX_RAW);
-        outputValue = map(MQ5_value, MQ5_MIN_RAW, MQ5_MAX_RAW, 
-                  MQ5_MIN_MAPPED, MQ5_MAX_MAPPED);
-        DEBUG_PRINT("MQ5 Value: ");
-        DEBUG_PRINTLN(outputValue);
-    }
-#endif
+    return (uint16_t)Mq5_1::value();   // SENSORH_INVALID if MQ5_1 is disabled
 }
 
-uint16_t MQ5_1_value(void)
+uint16_t MQ5_1_ppm(void)
 {
-#if MQ5_1_ENABLED == STD_ON
-    return outputValue;
-    #else
-    return 0xFFFF;  // Indicate error if MQ5_1 is disabled
-#endif
-}
\ No newline at end of file
+    if (!Mq5_1::enabled()) return SENSORH_INVALID;
+    return (uint16_t)SensorCal_Mq5Ppm(ADC_Acq_RawToMv(Mq5_1::filtered()));
+}
@@ -1,9 +1,11 @@
 #ifndef HAL_MQ5_H
 #define HAL_MQ5_H
 
+#include <stdint.h>
+
 void MQ5_1_init(void);
-void MQ5_1_main(void);
 
 uint16_t MQ5_1_value(void);
+uint16_t MQ5_1_ppm(void);       // Calibrated concentration, LPG-equivalent ppm
 
 #endif
@@ -1,8 +1,9 @@
 #ifndef HAL_POTENTIOMETER_H
 #define HAL_POTENTIOMETER_H
 
+#include <stdint.h>
+
 void POT_init(void);
-void POT_main(void);
 
 uint16_t POT_value_Getter(void);
 
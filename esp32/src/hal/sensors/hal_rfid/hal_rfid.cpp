@@ -2,6 +2,8 @@
 #include <SPI.h>
 #include <MFRC522.h>
 #include "hal_rfid.h"
+#include "esp_timer.h"
+#include "../../../drivers/driver_bus/driver_bus.h"
 
 
 #if MQ5_1_DEBUG == STD_ON
@@ -14,10 +16,28 @@
 
 
 
+#define RFID_BLOCK_SIZE     16
+#define RFID_ROOM_BLOCK     4       // Sector 1, block 0
+#define RFID_NO_TRAILER     0xFF
+
 static uint8_t lastUID[10];
 static uint8_t lastUIDSize = 0;
 MFRC522 mfrc522(RFID_SS_PIN, RFID_RST_PIN);
 
+// Card session: key and the sector currently authenticated
+static const byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static MFRC522::MIFARE_Key sessionKey;
+static byte sessionTrailer = RFID_NO_TRAILER;
+static bool sessionOpen = false;
+static bool sessionBus = false;         // SPI bus held from SessionBegin to SessionEnd
+static uint32_t sessionAuths = 0;
+
+static RFID_OpTiming_t opTiming[RFID_OP_COUNT];
+
+#define RFID_OP_NAME(id)    #id,
+static const char *const opNames[RFID_OP_COUNT] = { RFID_OP_TABLE(RFID_OP_NAME) };
+#undef RFID_OP_NAME
+
 
 
 static String uid_to_string(byte *buffer, byte bufferSize)
@@ -41,17 +61,57 @@ static String uid_to_string(byte *buffer, byte bufferSize)
 }
 
 
-static bool compare_uid(byte *uid1, byte size1, byte *uid2, byte size2)
+// Sector trailer of a block: 4-block sectors below 128, 16-block above (4K)
+static byte rfid_trailer_block(byte blockAddr)
 {
-    #if  RFID_ENABLED == STD_ON
-    if (size1 != size2) return false;
-    
-    for (byte i = 0; i < size1; i++) {
-        if (uid1[i] != uid2[i]) return false;
+    return (blockAddr < 128) ? (blockAddr | 0x03) : (blockAddr | 0x0F);
+}
+
+static bool rfid_is_trailer(byte blockAddr)
+{
+    return rfid_trailer_block(blockAddr) == blockAddr;
+}
+
+// Authenticate only when the block is in a different sector than the last one
+static bool rfid_session_auth(byte blockAddr)
+{
+    byte trailer = rfid_trailer_block(blockAddr);
+    if (trailer == sessionTrailer) {
+        return true;
     }
-    
+
+    MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
+        MFRC522::PICC_CMD_MF_AUTH_KEY_A,
+        trailer,
+        &sessionKey,
+        &(mfrc522.uid)
+    );
+    sessionAuths++;
+
+    if (status != MFRC522::STATUS_OK) {
+        Serial.printf("[RFID] Authentication failed for block %d: %s\n",
+                      blockAddr, mfrc522.GetStatusCodeName(status));
+        sessionTrailer = RFID_NO_TRAILER;
+        return false;
+    }
+
+    sessionTrailer = trailer;
     return true;
-    #endif
+}
+
+static uint32_t rfid_op_done(RFID_Op_t op, int64_t start, bool ok)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    RFID_OpTiming_t *t = &opTiming[op];
+
+    t->count++;
+    if (!ok) t->failures++;
+    t->last_us = us;
+    if (us > t->max_us) t->max_us = us;
+    t->total_us += us;
+    t->auths += sessionAuths;
+    sessionAuths = 0;
+    return us;
 }
 
 /* ==================== Public Functions ==================== */
@@ -116,12 +176,17 @@ bool RFID_INIT(void)
 bool RFID_INIT(void)
 {
     #if  RFID_ENABLED == STD_ON
-    SPI.begin();
+    // SPI is brought up by the bus manager (Bus_Init); the reader shares it
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) {
+        Serial.println("[RFID] ERROR: SPI bus not running (SPI_ENABLED)");
+        return false;
+    }
     mfrc522.PCD_Init();
     delay(50);  // Give reader time to initialize
     
     // Verify communication
     byte version = mfrc522.PCD_ReadRegister(mfrc522.VersionReg);
+    Bus_Release(BUS_DEV_RFID);
     
     if (version == 0x00 || version == 0xFF) {
         Serial.println("[RFID] ERROR: Communication failed");
@@ -140,7 +205,10 @@ bool RFID_INIT(void)
 bool RFID_IsNewCardPresent(void)
 {
     #if  RFID_ENABLED == STD_ON
-    return mfrc522.PICC_IsNewCardPresent();
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return false;
+    bool present = mfrc522.PICC_IsNewCardPresent();
+    Bus_Release(BUS_DEV_RFID);
+    return present;
     #endif
 }
 
@@ -150,6 +218,7 @@ void RFID_DiagnosticScan(void)
     static unsigned long lastCheck = 0;
     
     if (millis() - lastCheck > 500) {
+        if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return;
         if (mfrc522.PICC_IsNewCardPresent()) {
             Serial.println("[RFID] *** TAG DETECTED ***");
             if (mfrc522.PICC_ReadCardSerial()) {
@@ -163,15 +232,43 @@ void RFID_DiagnosticScan(void)
         } else {
             Serial.println("[RFID] No tag detected - Keep tag on reader");
         }
+        Bus_Release(BUS_DEV_RFID);
         lastCheck = millis();
     }
 }
 
 
+bool RFID_ReadUID(byte *uid, byte *size)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return false;
+    if (!mfrc522.PICC_ReadCardSerial()) {
+        Bus_Release(BUS_DEV_RFID);
+        rfid_op_done(RFID_OP_READ_UID, start, false);
+        return false;
+    }
+
+    lastUIDSize = mfrc522.uid.size;
+    memcpy(lastUID, mfrc522.uid.uidByte, lastUIDSize);
+    memcpy(uid, mfrc522.uid.uidByte, lastUIDSize);
+    *size = lastUIDSize;
+
+    mfrc522.PICC_HaltA();
+    Bus_Release(BUS_DEV_RFID);
+    rfid_op_done(RFID_OP_READ_UID, start, true);
+
+    return true;
+    #endif
+}
+
+
 bool RFID_ReadCard(String *uid, byte *rawUID, byte *size)
 {
     #if  RFID_ENABLED == STD_ON
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return false;
     if (!mfrc522.PICC_ReadCardSerial()) {
+        Bus_Release(BUS_DEV_RFID);
         return false;
     }
     
@@ -197,55 +294,12 @@ bool RFID_ReadCard(String *uid, byte *rawUID, byte *size)
     
     // Halt PICC
     mfrc522.PICC_HaltA();
+    Bus_Release(BUS_DEV_RFID);
     
     return true;
     #endif
 }
 
-bool RFID_CheckAuthorization(const String &uid)
-{
-    #if  RFID_ENABLED == STD_ON
-    // Authorized UIDs list
-    const char *authorizedUIDs[] = {
-        "04:86:46:52:71:40:80",  // Card 1
-        "59:52:67:D9",            // Card 2
-        // Add more authorized UIDs here
-    };
-    
-    const int numAuthorized = sizeof(authorizedUIDs) / sizeof(authorizedUIDs[0]);
-    
-    for (int i = 0; i < numAuthorized; i++) {
-        if (uid == String(authorizedUIDs[i])) {
-            Serial.printf("[RFID] Access GRANTED for UID: %s\n", uid.c_str());
-            return true;
-        }
-    }
-    
-    Serial.printf("[RFID] Access DENIED for UID: %s\n", uid.c_str());
-    return false;
-    #endif
-}
-
-bool RFID_CheckAuthorizationRaw(byte *uid, byte size)
-{
-    #if  RFID_ENABLED == STD_ON
-    // Authorized UIDs (byte arrays)
-    const byte authorizedUID1[] = {0x04, 0x86, 0x46, 0x52, 0x71, 0x40, 0x80};
-    const byte authorizedUID2[] = {0x59, 0x52, 0x67, 0xD9};
-    
-    if (compare_uid(uid, size, (byte*)authorizedUID1, sizeof(authorizedUID1))) {
-        return true;
-    }
-    
-    if (compare_uid(uid, size, (byte*)authorizedUID2, sizeof(authorizedUID2))) {
-        return true;
-    }
-    
-    return false;
-    #endif
-}
-
-
 String RFID_GetLastUID(void)
 {
     #if  RFID_ENABLED == STD_ON
@@ -256,9 +310,11 @@ String RFID_GetLastUID(void)
 void RFID_Reset(void)
 {
     #if  RFID_ENABLED == STD_ON
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return;
     mfrc522.PCD_Reset();
     delay(50);
     mfrc522.PCD_Init();
+    Bus_Release(BUS_DEV_RFID);
     Serial.println("[RFID] Reader reset");
     #endif
 }
@@ -268,10 +324,12 @@ bool RFID_SelfTest(void)
 {
     #if  RFID_ENABLED == STD_ON
     Serial.println("[RFID] Running self-test...");
+    if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) return false;
     bool result = mfrc522.PCD_PerformSelfTest();
     
     // Re-initialize after self-test
     mfrc522.PCD_Init();
+    Bus_Release(BUS_DEV_RFID);
     
     if (result) {
         Serial.println("[RFID] Self-test PASSED");
@@ -288,246 +346,297 @@ void RFID_GetStatus(void)
 {
     #if  RFID_ENABLED == STD_ON
     Serial.println("\n[RFID] Reader Status:");
-    Serial.printf("  Version: 0x%02X\n", 
-                  mfrc522.PCD_ReadRegister(mfrc522.VersionReg));
+    byte version = 0;
+    if (Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) {
+        version = mfrc522.PCD_ReadRegister(mfrc522.VersionReg);
+        Bus_Release(BUS_DEV_RFID);
+    }
+    Serial.printf("  Version: 0x%02X\n", version);
     Serial.printf("  Last UID: %s\n", RFID_GetLastUID().c_str());
+    for (uint8_t op = 0; op < RFID_OP_COUNT; op++) {
+        const RFID_OpTiming_t *t = &opTiming[op];
+        if (t->count == 0) continue;
+        Serial.printf("  %-12s n=%lu fail=%lu last=%luus max=%luus avg=%luus auth=%lu\n",
+                      opNames[op], (unsigned long)t->count, (unsigned long)t->failures,
+                      (unsigned long)t->last_us, (unsigned long)t->max_us,
+                      (unsigned long)(t->total_us / t->count), (unsigned long)t->auths);
+    }
     #endif    
 }
 
 
-bool RFID_WriteRoomNumber(const String &roomNumber, byte *key)
+bool RFID_SessionBegin(const byte *key)
 {
     #if  RFID_ENABLED == STD_ON
-    // Default key if not provided
-    byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    if (key == nullptr) {
-        key = defaultKey;
-    }
-    
-    // Prepare data block (16 bytes)
-    byte dataBlock[16];
-    memset(dataBlock, 0, 16);
-    
-    // Copy room number to block (max 15 chars, leave 1 for null terminator)
-    int len = roomNumber.length();
-    if (len > 15) len = 15;
-    memcpy(dataBlock, roomNumber.c_str(), len);
-    
-    // Block address (Sector 1, Block 4)
-    byte blockAddr = 4;
-    byte trailerBlock = 7;  // Sector 1 trailer
-    
-    // Create key structure
-    MFRC522::MIFARE_Key mifareKey;
-    for (byte i = 0; i < 6; i++) {
-        mifareKey.keyByte[i] = key[i];
-    }
-    
-    // Authenticate using key A
-    MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
-        MFRC522::PICC_CMD_MF_AUTH_KEY_A, 
-        trailerBlock, 
-        &mifareKey, 
-        &(mfrc522.uid)
-    );
-    
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Authentication failed: %s\n", 
-                     mfrc522.GetStatusCodeName(status));
-        return false;
+    const byte *k = (key != nullptr) ? key : defaultKey;
+    memcpy(sessionKey.keyByte, k, sizeof(sessionKey.keyByte));
+    sessionTrailer = RFID_NO_TRAILER;
+    sessionAuths = 0;
+
+    // The whole session is one bus ownership; RFID_SessionEnd() gives it back
+    if (!sessionBus) {
+        if (!Bus_Acquire(BUS_DEV_RFID, portMAX_DELAY)) {
+            sessionOpen = false;
+            return false;
+        }
+        sessionBus = true;
     }
-    
-    // Write data to block
-    status = mfrc522.MIFARE_Write(blockAddr, dataBlock, 16);
+
+    // A card halted after RFID_ReadCard()/RFID_ReadUID() is woken and
+    // selected again; Select also refreshes mfrc522.uid
+    byte atqa[2];
+    byte atqaSize = sizeof(atqa);
+    mfrc522.PICC_WakeupA(atqa, &atqaSize);
+
+    MFRC522::StatusCode status = mfrc522.PICC_Select(&mfrc522.uid);
     if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Write failed: %s\n", 
-                     mfrc522.GetStatusCodeName(status));
+        Serial.printf("[RFID] No card to open a session: %s\n",
+                      mfrc522.GetStatusCodeName(status));
+        sessionOpen = false;
         return false;
     }
-    
-    Serial.printf("[RFID] Room number '%s' written successfully to block %d\n", 
-                  roomNumber.c_str(), blockAddr);
-    
-    // Halt PICC
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    
+
+    sessionOpen = true;
     return true;
     #endif
 }
 
 
-bool RFID_ReadRoomNumber(String *roomNumber, byte *key)
+bool RFID_SessionRead(byte firstBlock, byte *data, byte blocks)
 {
     #if  RFID_ENABLED == STD_ON
-    // Default key if not provided
-    byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    if (key == nullptr) {
-        key = defaultKey;
-    }
-    
-    byte buffer[18];
-    byte size = sizeof(buffer);
-    byte blockAddr = 4;
-    byte trailerBlock = 7;
-    
-    // Create key structure
-    MFRC522::MIFARE_Key mifareKey;
-    for (byte i = 0; i < 6; i++) {
-        mifareKey.keyByte[i] = key[i];
-    }
-    
-    // Authenticate
-    MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
-        MFRC522::PICC_CMD_MF_AUTH_KEY_A,
-        trailerBlock,
-        &mifareKey,
-        &(mfrc522.uid)
-    );
-    
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Authentication failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
-        return false;
-    }
-    
-    // Read data from block
-    status = mfrc522.MIFARE_Read(blockAddr, buffer, &size);
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Read failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
-        return false;
+    if (!sessionOpen) return false;
+
+    byte buffer[RFID_BLOCK_SIZE + 2];   // Data + CRC_A
+    byte blockAddr = firstBlock;
+
+    while (blocks > 0) {
+        if (rfid_is_trailer(blockAddr)) {
+            blockAddr++;
+            continue;
+        }
+        if (!rfid_session_auth(blockAddr)) {
+            return false;
+        }
+
+        byte size = sizeof(buffer);
+        MFRC522::StatusCode status = mfrc522.MIFARE_Read(blockAddr, buffer, &size);
+        if (status != MFRC522::STATUS_OK) {
+            Serial.printf("[RFID] Read of block %d failed: %s\n",
+                          blockAddr, mfrc522.GetStatusCodeName(status));
+            return false;
+        }
+
+        memcpy(data, buffer, RFID_BLOCK_SIZE);
+        data += RFID_BLOCK_SIZE;
+        blockAddr++;
+        blocks--;
     }
-    
-    // Convert to string (stop at null terminator or end of data)
-    *roomNumber = "";
-    for (int i = 0; i < 16 && buffer[i] != 0; i++) {
-        *roomNumber += (char)buffer[i];
+
+    return true;
+    #endif
+}
+
+
+bool RFID_SessionWrite(byte firstBlock, const byte *data, byte blocks)
+{
+    #if  RFID_ENABLED == STD_ON
+    if (!sessionOpen) return false;
+
+    byte dataBlock[RFID_BLOCK_SIZE];
+    byte blockAddr = firstBlock;
+
+    while (blocks > 0) {
+        if (rfid_is_trailer(blockAddr)) {
+            blockAddr++;
+            continue;
+        }
+        if (blockAddr == 0) {
+            Serial.println("[RFID] ERROR: Block 0 holds manufacturer data");
+            return false;
+        }
+        if (!rfid_session_auth(blockAddr)) {
+            return false;
+        }
+
+        memcpy(dataBlock, data, RFID_BLOCK_SIZE);
+        MFRC522::StatusCode status = mfrc522.MIFARE_Write(blockAddr, dataBlock, RFID_BLOCK_SIZE);
+        if (status != MFRC522::STATUS_OK) {
+            Serial.printf("[RFID] Write of block %d failed: %s\n",
+                          blockAddr, mfrc522.GetStatusCodeName(status));
+            return false;
+        }
+
+        data += RFID_BLOCK_SIZE;
+        blockAddr++;
+        blocks--;
     }
-    
-    Serial.printf("[RFID] Room number read: '%s'\n", roomNumber->c_str());
-    
-    // Halt PICC
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    
+
     return true;
     #endif
 }
 
 
-bool RFID_DeleteRoomNumber(byte *key)
+void RFID_SessionEnd(void)
 {
     #if  RFID_ENABLED == STD_ON
-    // Default key if not provided
-    byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    if (key == nullptr) {
-        key = defaultKey;
+    if (sessionOpen) {
+        mfrc522.PICC_HaltA();
+        mfrc522.PCD_StopCrypto1();
     }
-    
-    // Prepare empty data block (all zeros)
-    byte dataBlock[16];
-    memset(dataBlock, 0, 16);
-    
-    byte blockAddr = 4;
-    byte trailerBlock = 7;
-    
-    // Create key structure
-    MFRC522::MIFARE_Key mifareKey;
-    for (byte i = 0; i < 6; i++) {
-        mifareKey.keyByte[i] = key[i];
+    if (sessionBus) {
+        Bus_Release(BUS_DEV_RFID);
+        sessionBus = false;
     }
-    
-    // Authenticate
-    MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
-        MFRC522::PICC_CMD_MF_AUTH_KEY_A,
-        trailerBlock,
-        &mifareKey,
-        &(mfrc522.uid)
-    );
-    
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Authentication failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
-        return false;
+    sessionOpen = false;
+    sessionTrailer = RFID_NO_TRAILER;
+    #endif
+}
+
+
+void RFID_GetOpTiming(RFID_Op_t op, RFID_OpTiming_t *timing)
+{
+    if (op >= RFID_OP_COUNT || timing == nullptr) return;
+    *timing = opTiming[op];
+}
+
+
+bool RFID_WriteRoomNumber(const String &roomNumber, byte *key)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+
+    // Room number in one block (max 15 chars, leave 1 for null terminator)
+    byte dataBlock[RFID_BLOCK_SIZE];
+    memset(dataBlock, 0, sizeof(dataBlock));
+    int len = roomNumber.length();
+    if (len > 15) len = 15;
+    memcpy(dataBlock, roomNumber.c_str(), len);
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionWrite(RFID_ROOM_BLOCK, dataBlock, 1);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_WRITE_ROOM, start, ok);
+
+    if (ok) {
+        Serial.printf("[RFID] Room number '%s' written to block %d (%lu us)\n",
+                      roomNumber.c_str(), RFID_ROOM_BLOCK, (unsigned long)us);
     }
-    
-    // Write zeros to block
-    status = mfrc522.MIFARE_Write(blockAddr, dataBlock, 16);
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Delete failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
+    return ok;
+    #endif
+}
+
+
+bool RFID_ReadRoomNumber(String *roomNumber, byte *key)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+    byte dataBlock[RFID_BLOCK_SIZE];
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionRead(RFID_ROOM_BLOCK, dataBlock, 1);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_READ_ROOM, start, ok);
+
+    if (!ok) {
         return false;
     }
-    
-    Serial.printf("[RFID] Room number deleted from block %d\n", blockAddr);
-    
-    // Halt PICC
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    
+
+    // Stop at null terminator or end of data
+    char text[RFID_BLOCK_SIZE + 1];
+    memcpy(text, dataBlock, RFID_BLOCK_SIZE);
+    text[RFID_BLOCK_SIZE] = '\0';
+    *roomNumber = text;
+
+    Serial.printf("[RFID] Room number read: '%s' (%lu us)\n",
+                  roomNumber->c_str(), (unsigned long)us);
     return true;
     #endif
 }
 
 
+bool RFID_DeleteRoomNumber(byte *key)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+    byte dataBlock[RFID_BLOCK_SIZE];
+    memset(dataBlock, 0, sizeof(dataBlock));
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionWrite(RFID_ROOM_BLOCK, dataBlock, 1);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_DELETE_ROOM, start, ok);
+
+    if (ok) {
+        Serial.printf("[RFID] Room number deleted from block %d (%lu us)\n",
+                      RFID_ROOM_BLOCK, (unsigned long)us);
+    }
+    return ok;
+    #endif
+}
+
+
 bool RFID_WriteBlock(byte blockAddr, byte *data, byte dataSize, byte *key)
 {
     #if  RFID_ENABLED == STD_ON
-    if (dataSize > 16) {
+    if (dataSize > RFID_BLOCK_SIZE) {
         Serial.println("[RFID] ERROR: Data size exceeds 16 bytes");
         return false;
     }
-    
-    // Default key if not provided
-    byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    if (key == nullptr) {
-        key = defaultKey;
+    if (rfid_is_trailer(blockAddr)) {
+        Serial.println("[RFID] ERROR: Refusing to write a sector trailer");
+        return false;
     }
-    
-    // Prepare data block (pad with zeros if needed)
-    byte dataBlock[16];
-    memset(dataBlock, 0, 16);
+
+    int64_t start = esp_timer_get_time();
+
+    // Pad with zeros if needed
+    byte dataBlock[RFID_BLOCK_SIZE];
+    memset(dataBlock, 0, sizeof(dataBlock));
     memcpy(dataBlock, data, dataSize);
-    
-    // Calculate trailer block for this sector
-    byte trailerBlock = (blockAddr / 4) * 4 + 3;
-    
-    // Create key structure
-    MFRC522::MIFARE_Key mifareKey;
-    for (byte i = 0; i < 6; i++) {
-        mifareKey.keyByte[i] = key[i];
-    }
-    
-    // Authenticate
-    MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
-        MFRC522::PICC_CMD_MF_AUTH_KEY_A,
-        trailerBlock,
-        &mifareKey,
-        &(mfrc522.uid)
-    );
-    
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Authentication failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
-        return false;
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionWrite(blockAddr, dataBlock, 1);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_WRITE_BLOCK, start, ok);
+
+    if (ok) {
+        Serial.printf("[RFID] Block %d written (%lu us)\n", blockAddr, (unsigned long)us);
     }
-    
-    // Write data
-    status = mfrc522.MIFARE_Write(blockAddr, dataBlock, 16);
-    if (status != MFRC522::STATUS_OK) {
-        Serial.printf("[RFID] Write failed: %s\n",
-                     mfrc522.GetStatusCodeName(status));
-        return false;
+    return ok;
+    #endif
+}
+
+
+bool RFID_WriteToken(const byte *token, byte *key)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionWrite(RFID_TOKEN_BLOCK, token, RFID_TOKEN_SIZE / RFID_BLOCK_SIZE);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_WRITE_TOKEN, start, ok);
+
+    if (ok) {
+        Serial.printf("[RFID] Token written (%lu us)\n", (unsigned long)us);
     }
-    
-    Serial.printf("[RFID] Data written successfully to block %d\n", blockAddr);
-    
-    // Halt PICC
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    
-    return true;
+    return ok;
+    #endif
+}
+
+
+bool RFID_ReadToken(byte *token, byte *key)
+{
+    #if  RFID_ENABLED == STD_ON
+    int64_t start = esp_timer_get_time();
+
+    bool ok = RFID_SessionBegin(key) &&
+              RFID_SessionRead(RFID_TOKEN_BLOCK, token, RFID_TOKEN_SIZE / RFID_BLOCK_SIZE);
+    RFID_SessionEnd();
+    rfid_op_done(RFID_OP_READ_TOKEN, start, ok);
+
+    return ok;
     #endif
 }
 
@@ -536,58 +645,26 @@ bool RFID_FormatCard(byte *key)
 {
     #if  RFID_ENABLED == STD_ON
     Serial.println("[RFID] WARNING: Formatting card - all data will be erased!");
-    
-    // Default key if not provided
-    byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    if (key == nullptr) {
-        key = defaultKey;
+
+    int64_t start = esp_timer_get_time();
+    byte emptySector[3 * RFID_BLOCK_SIZE];
+    memset(emptySector, 0, sizeof(emptySector));
+
+    // Sectors 1-15 (sector 0 contains manufacturer data, skip it): one
+    // authentication and three block writes each
+    bool ok = RFID_SessionBegin(key);
+    byte sector = 1;
+    for (; ok && sector < 16; sector++) {
+        ok = RFID_SessionWrite(sector * 4, emptySector, 3);
     }
-    
-    byte emptyBlock[16];
-    memset(emptyBlock, 0, 16);
-    
-    // Format sectors 1-15 (sector 0 contains manufacturer data, skip it)
-    for (byte sector = 1; sector < 16; sector++) {
-        byte trailerBlock = sector * 4 + 3;
-        
-        // Create key structure
-        MFRC522::MIFARE_Key mifareKey;
-        for (byte i = 0; i < 6; i++) {
-            mifareKey.keyByte[i] = key[i];
-        }
-        
-        // Authenticate
-        MFRC522::StatusCode status = mfrc522.PCD_Authenticate(
-            MFRC522::PICC_CMD_MF_AUTH_KEY_A,
-            trailerBlock,
-            &mifareKey,
-            &(mfrc522.uid)
-        );
-        
-        if (status != MFRC522::STATUS_OK) {
-            Serial.printf("[RFID] Auth failed for sector %d\n", sector);
-            continue;
-        }
-        
-        // Clear blocks in this sector (skip trailer block)
-        for (byte blockOffset = 0; blockOffset < 3; blockOffset++) {
-            byte blockAddr = sector * 4 + blockOffset;
-            
-            status = mfrc522.MIFARE_Write(blockAddr, emptyBlock, 16);
-            if (status != MFRC522::STATUS_OK) {
-                Serial.printf("[RFID] Failed to clear block %d\n", blockAddr);
-            }
-        }
-        
-        Serial.printf("[RFID] Sector %d formatted\n", sector);
+    RFID_SessionEnd();
+    uint32_t us = rfid_op_done(RFID_OP_FORMAT, start, ok);
+
+    if (ok) {
+        Serial.printf("[RFID] Card format complete (%lu us)\n", (unsigned long)us);
+    } else {
+        Serial.printf("[RFID] Card format stopped at sector %d\n", sector - 1);
     }
-    
-    Serial.println("[RFID] Card format complete");
-    
-    // Halt PICC
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    
-    return true;
+    return ok;
     #endif
-}
\ No newline at end of file
+}
@@ -5,6 +5,41 @@
 #define RFID_SS_PIN 21
 #define RFID_RST_PIN 22
 
+// The MFRC522 library clocks SPI at MFRC522_SPICLOCK (platformio.ini build
+// flag, 10 MHz = datasheet maximum). Keep the reader wiring short.
+
+// Signed validity token (format in app/access/access_token.h): sector 1,
+// the two blocks after the room number
+#define RFID_TOKEN_BLOCK    5
+#define RFID_TOKEN_SIZE     32
+
+// Timed card operations: X(id)
+#define RFID_OP_TABLE(X) \
+    X(READ_UID)     \
+    X(READ_ROOM)    \
+    X(WRITE_ROOM)   \
+    X(DELETE_ROOM)  \
+    X(WRITE_BLOCK)  \
+    X(FORMAT)       \
+    X(READ_TOKEN)   \
+    X(WRITE_TOKEN)
+
+#define RFID_ENUM_OP(id)    RFID_OP_##id,
+typedef enum {
+    RFID_OP_TABLE(RFID_ENUM_OP)
+    RFID_OP_COUNT
+} RFID_Op_t;
+#undef RFID_ENUM_OP
+
+typedef struct {
+    uint32_t count;
+    uint32_t failures;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t total_us;
+    uint32_t auths;         // Sector authentications, all calls
+} RFID_OpTiming_t;
+
 // function declarations
 bool RFID_INIT(void);
 
@@ -12,9 +47,9 @@ bool RFID_IsNewCardPresent(void);
 
 void RFID_DiagnosticScan(void);
 bool RFID_ReadCard(String *uid, byte *rawUID = nullptr, byte *size = nullptr);
+// Raw UID only (up to 10 bytes), no String or type lookup: the access path
+bool RFID_ReadUID(byte *uid, byte *size);
 
-bool RFID_CheckAuthorization(const String &uid);
-bool RFID_CheckAuthorizationRaw(byte *uid, byte size);
 String RFID_GetLastUID(void);
 void RFID_Reset(void);
 bool RFID_SelfTest(void);
@@ -25,5 +60,18 @@ bool RFID_ReadRoomNumber(String *roomNumber, byte *key = nullptr);
 bool RFID_DeleteRoomNumber(byte *key = nullptr);
 bool RFID_WriteBlock(byte blockAddr, byte *data, byte dataSize, byte *key = nullptr);
 bool RFID_FormatCard(byte *key = nullptr);
+// RFID_TOKEN_SIZE bytes at RFID_TOKEN_BLOCK: one authentication, one session
+bool RFID_WriteToken(const byte *token, byte *key = nullptr);
+bool RFID_ReadToken(byte *token, byte *key = nullptr);
+
+// Card session: one authentication per sector for any number of blocks.
+// Trailer blocks are skipped, so "blocks" counts data blocks only. The
+// session holds the SPI bus (driver_bus): always close it with SessionEnd.
+bool RFID_SessionBegin(const byte *key = nullptr);
+bool RFID_SessionRead(byte firstBlock, byte *data, byte blocks);
+bool RFID_SessionWrite(byte firstBlock, const byte *data, byte blocks);
+void RFID_SessionEnd(void);
+
+void RFID_GetOpTiming(RFID_Op_t op, RFID_OpTiming_t *timing);
 
 #endif
\ No newline at end of file
@@ -2,9 +2,18 @@
 
 #include "hal/communication/hal_mqtt/hal_mqtt.h"
 #include "hal/communication/hal_wifi/hal_wifi.h"
+#include "hal/hal_power/hal_power.h"
 
 #include "app/thermostat/thermostat_rtos.h"
 #include "app/room/room_rtos.h"
+#include "app/app_rtos/app_rtos.h"
+#include "app/rules/rules.h"
+#include "app/access/access.h"
+#include "app/access/access_journal.h"
+#include "app/access/access_token.h"
+#include "app/shadow/shadow.h"
+#include "drivers/driver_uart/driver_uart.h"
+#include "drivers/driver_bus/driver_bus.h"
 
 #include "app_cfg.h"
 
@@ -12,12 +21,18 @@
 
 void setup() 
 {
-    Serial.begin(9600);
-    delay(1000);
-    
+    // 9600 baud made the boot banner alone cost hundreds of ms
+    Serial.begin(SERIAL_BAUD_RATE);
+
     Serial.println("\n=== Smart Room System ===");
     Serial.println("Initializing...");  
 
+    // DFS, automatic light sleep and wake locks before any task starts
+    Power_Init();
+
+    // Shared SPI/I2C buses before any driver that sits on them
+    Bus_Init();
+
     // Configure WiFi
     WIFI_Config_t g_wifiCfg_cpy = {
         .ssid = WIFI_SSID,
@@ -27,15 +42,22 @@ void setup()
         .on_disconnect = onWifiDisconnected
     };
 
-    // Initialize WiFi
+    // Start association first; sensors and tasks come up while the radio
+    // is still connecting
     WIFI_Init_(&g_wifiCfg_cpy);
     
     Serial.println("WiFi initialization started");
     
-    delay(2000);
-    
+    // Automation rules before the modules that feed and consult them
+    Rules_Init();
+    Access_Init();
+    Access_Token_Init();
+    Access_Journal_Init();
+    Shadow_Init();
+    UART_Init();
     InitThermostat();
     Room_RTOS_Init();
+    App_RTOS_PrintBudget();
 
     Serial.println("System ready!");
     vTaskDelete(NULL); //remove void loop() 
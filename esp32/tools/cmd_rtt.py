@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Command round-trip timing for the room controllers.
+
+Sends control commands tagged with a correlation ID ("ON@<cid>"), waits for
+each room's acknowledgement on hotel/<room>/telemetry/cmd_ack and reports
+round-trip percentiles per room and command, split into:
+
+  device   callback entry -> ack formatted (parse, apply, echo stages)
+  poll     time the command could have sat in the socket before the
+           MQTT task polled it (poll_gap_us + lock_wait_us, upper bound)
+  network  round trip minus device time: broker, Wi-Fi and this host
+
+Usage:
+  cmd_rtt.py --host mqtt.local --room 101 --room 102 --count 50
+  cmd_rtt.py --cmd led1 --cmd target --interval 0.5
+
+Topic templates match src/app_cfg.h; pass --topic name=template to override.
+"""
+import argparse
+import json
+import secrets
+import statistics
+import sys
+import threading
+import time
+
+# name -> (topic template, payloads alternated between sends)
+COMMANDS = {
+    'target':    ('hotel/{room}/control/target_temp', ['22.0', '22.5']),
+    'mode':      ('hotel/{room}/control/mode',        ['AUTO', 'AUTO']),
+    'fan_speed': ('hotel/{room}/control/fan_speed',   ['1', '2']),
+    'room_mode': ('room/mode/control',                ['MANUAL', 'MANUAL']),
+    'led1':      ('hotel/room{room}/led1/control',    ['ON', 'OFF']),
+    'led2':      ('hotel/room{room}/led2/control',    ['ON', 'OFF']),
+}
+ACK_TOPIC = 'hotel/{room}/telemetry/cmd_ack'
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    ordered = sorted(values)
+    k = (len(ordered) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (k - lo)
+
+
+def fmt_ms(us):
+    return f'{us / 1000.0:8.2f}'
+
+
+class Probe:
+    def __init__(self, client, timeout):
+        self.client = client
+        self.timeout = timeout
+        self.lock = threading.Lock()
+        self.pending = {}       # cid -> (room, cmd, sent_ns, event)
+        self.results = []       # dicts: room, cmd, rtt_us, ack
+
+    def on_message(self, client, userdata, msg):
+        try:
+            ack = json.loads(msg.payload)
+        except ValueError:
+            return
+        now = time.perf_counter_ns()
+        with self.lock:
+            entry = self.pending.pop(ack.get('cid'), None)
+        if entry is None:
+            return
+        room, cmd, sent, done = entry
+        self.results.append({'room': room, 'cmd': cmd,
+                             'rtt_us': (now - sent) / 1000.0, 'ack': ack})
+        done.set()
+
+    def send(self, room, cmd, topic, payload):
+        cid = secrets.token_hex(4)
+        done = threading.Event()
+        with self.lock:
+            self.pending[cid] = (room, cmd, time.perf_counter_ns(), done)
+        self.client.publish(topic, f'{payload}@{cid}', qos=0)
+        if not done.wait(self.timeout):
+            with self.lock:
+                self.pending.pop(cid, None)
+            self.results.append({'room': room, 'cmd': cmd, 'rtt_us': None, 'ack': None})
+
+
+def report(results):
+    groups = {}
+    for r in results:
+        groups.setdefault((r['room'], r['cmd']), []).append(r)
+
+    print(f"{'room':>6} {'cmd':<10} {'n':>4} {'lost':>4} {'!ok':>4} "
+          f"{'p50':>8} {'p90':>8} {'p99':>8} | {'device':>8} {'poll':>8} {'network':>8}  (ms)")
+    for (room, cmd), rows in sorted(groups.items()):
+        acked = [r for r in rows if r['ack'] is not None]
+        failed = [r for r in acked if r['ack'].get('result') != 'ok']
+        rtt = [r['rtt_us'] for r in acked]
+        device = [r['ack'].get('ack_us', 0) for r in acked]
+        poll = [r['ack'].get('poll_gap_us', 0) + r['ack'].get('lock_wait_us', 0) for r in acked]
+        network = [r['rtt_us'] - r['ack'].get('ack_us', 0) for r in acked]
+        print(f'{room:>6} {cmd:<10} {len(rows):>4} {len(rows) - len(acked):>4} {len(failed):>4} '
+              f'{fmt_ms(percentile(rtt, 50))} {fmt_ms(percentile(rtt, 90))} '
+              f'{fmt_ms(percentile(rtt, 99))} | {fmt_ms(statistics.median(device) if device else float("nan"))} '
+              f'{fmt_ms(statistics.median(poll) if poll else float("nan"))} '
+              f'{fmt_ms(statistics.median(network) if network else float("nan"))}')
+
+        stages = {}
+        for r in acked:
+            for key in ('parse_us', 'apply_us', 'echo_us'):
+                if key in r['ack']:
+                    stages.setdefault(key, []).append(r['ack'][key])
+        if stages:
+            print(' ' * 12 + 'median stages: ' + ', '.join(
+                f'{k[:-3]} {statistics.median(v) / 1000.0:.2f}' for k, v in stages.items()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--host', default='localhost')
+    parser.add_argument('--port', type=int, default=1883)
+    parser.add_argument('--user', default='')
+    parser.add_argument('--password', default='')
+    parser.add_argument('--room', action='append', help='Room number (repeatable, default 101)')
+    parser.add_argument('--cmd', action='append', choices=sorted(COMMANDS),
+                        help='Command to time (repeatable, default led1)')
+    parser.add_argument('--topic', action='append', default=[], metavar='NAME=TEMPLATE',
+                        help='Override a command topic, {room} is substituted')
+    parser.add_argument('--count', type=int, default=20, help='Commands per room and type')
+    parser.add_argument('--interval', type=float, default=1.0, help='Seconds between commands')
+    parser.add_argument('--timeout', type=float, default=6.0, help='Seconds to wait for an ack')
+    args = parser.parse_args()
+
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit('paho-mqtt is required: pip install paho-mqtt')
+
+    commands = dict(COMMANDS)
+    for override in args.topic:
+        name, _, template = override.partition('=')
+        if name not in commands or not template:
+            sys.exit(f'bad --topic {override!r}')
+        commands[name] = (template, commands[name][1])
+
+    rooms = args.room or ['101']
+    cmds = args.cmd or ['led1']
+
+    client = mqtt.Client(client_id=f'cmd-rtt-{secrets.token_hex(4)}')
+    if args.user:
+        client.username_pw_set(args.user, args.password)
+    probe = Probe(client, args.timeout)
+    client.on_message = probe.on_message
+    client.connect(args.host, args.port)
+    for room in rooms:
+        client.subscribe(ACK_TOPIC.format(room=room), qos=0)
+    client.loop_start()
+    time.sleep(0.5)     # Let the subscriptions settle
+
+    try:
+        for i in range(args.count):
+            for room in rooms:
+                for cmd in cmds:
+                    template, payloads = commands[cmd]
+                    probe.send(room, cmd, template.format(room=room), payloads[i % len(payloads)])
+                    time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+    report(probe.results)
+
+
+if __name__ == '__main__':
+    main()
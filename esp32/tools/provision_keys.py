@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Commissioning: write the per-property signing keys into a room's NVS.
+
+The firmware reads the keys from the "keys" namespace (ACCESS_KEY_NVS_NS in
+src/app/access/access_cfg.h) and refuses whatever needs a missing key. This
+script builds an NVS image holding them and flashes it over the default
+"nvs" partition, so it also clears everything else kept there (WiFi cache,
+allowlist, learned rates): run it once, before the room goes into service.
+
+Keys are raw bytes given as hex. Omitted keys are generated; store the
+printed values in the dashboard (and kiosk), they are not shown again.
+Pass the same keys to every room of the property. Allowlist updates are
+signed per room (the room number is part of the signed text, see
+sign_access.py); --room goes on the printout with the matching signing
+command.
+
+Needs esptool and esp-idf-nvs-partition-gen (pip install both).
+
+Usage:
+  provision_keys.py --room 101 --port /dev/ttyUSB0
+  provision_keys.py --room 101 --port /dev/ttyUSB0 --token-key 00112233...  (kiosk key)
+  provision_keys.py --room 101 --out nvs_101.bin          (build the image only)
+"""
+import argparse
+import os
+import secrets
+import subprocess
+import sys
+import tempfile
+
+NAMESPACE = 'keys'
+
+# option -> NVS key (ACCESS_KEY_NVS_* in access_cfg.h)
+KEYS = {
+    'access_hmac': 'access_hmac',
+    'token_key':   'token',
+}
+KEY_MIN_LEN = 16        # ACCESS_KEY_MIN_LEN
+KEY_MAX_LEN = 64        # ACCESS_KEY_MAX_LEN
+
+# Default Arduino-ESP32 partition table
+NVS_OFFSET = 0x9000
+NVS_SIZE = 0x5000
+
+
+def parse_key(name, text):
+    if text is None:
+        return secrets.token_bytes(32)
+    try:
+        key = bytes.fromhex(text)
+    except ValueError:
+        sys.exit('%s: not hex' % name)
+    if not KEY_MIN_LEN <= len(key) <= KEY_MAX_LEN:
+        sys.exit('%s: %d bytes, need %d-%d' % (name, len(key), KEY_MIN_LEN, KEY_MAX_LEN))
+    return key
+
+
+def build_image(keys, path):
+    with tempfile.TemporaryDirectory() as tmp:
+        csv = os.path.join(tmp, 'keys.csv')
+        with open(csv, 'w') as f:
+            f.write('key,type,encoding,value\n')
+            f.write('%s,namespace,,\n' % NAMESPACE)
+            for name, key in keys.items():
+                f.write('%s,data,hex2bin,%s\n' % (name, key.hex()))
+        subprocess.check_call([sys.executable, '-m', 'esp_idf_nvs_partition_gen',
+                               'generate', csv, path, hex(NVS_SIZE)])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--room', required=True, type=int,
+                        help='room number the controller was built for (ROOM_NUMBER)')
+    parser.add_argument('--port', help='serial port of the room controller')
+    parser.add_argument('--out', help='keep the NVS image at this path')
+    for option in KEYS:
+        parser.add_argument('--' + option.replace('_', '-'), metavar='HEX',
+                            help='key bytes (default: 32 random bytes)')
+    args = parser.parse_args()
+
+    if args.port is None and args.out is None:
+        parser.error('need --port and/or --out')
+
+    keys = {KEYS[option]: parse_key(option, getattr(args, option)) for option in KEYS}
+
+    with tempfile.TemporaryDirectory() as tmp:
+        image = args.out or os.path.join(tmp, 'nvs.bin')
+        build_image(keys, image)
+
+        if args.port:
+            subprocess.check_call([sys.executable, '-m', 'esptool', '--port', args.port,
+                                   'write_flash', hex(NVS_OFFSET), image])
+
+    print('room         %d' % args.room)
+    for name, key in keys.items():
+        print('%-12s %s' % (name, key.hex()))
+    print('sign updates with: sign_access.py --key %s --room %d <version> <op> [<uid> ...]'
+          % (keys[KEYS['access_hmac']].hex(), args.room))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""
+Sign a key card allowlist update for one room.
+
+Prints the line to publish on hotel/<room>/config/access:
+
+  <room> <version> <add|revoke|set> [<uid> ...] <hmac>
+
+<hmac> is HMAC-SHA256 over everything before it, under the property's
+update key (the access_hmac value printed by provision_keys.py). The room
+is part of the signed text, so the line is refused by every other room
+(ACCESS_RESULT_WRONG_ROOM).
+
+Usage:
+  sign_access.py --key 00112233... --room 101 7 add 04:86:46:52:71:40:80
+  sign_access.py --key 00112233... --room 101 9 set 04864652714080 0A0B0C0D
+"""
+import argparse
+import hashlib
+import hmac
+import sys
+
+OPS = ('add', 'revoke', 'set')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--key', required=True, metavar='HEX', help='update key (access_hmac)')
+    parser.add_argument('--room', required=True, type=int, help='room number (ROOM_NUMBER)')
+    parser.add_argument('version', type=int, help='list version (stored + 1 for add/revoke)')
+    parser.add_argument('op', choices=OPS)
+    parser.add_argument('uids', nargs='*', help='card UIDs in hex, ":" allowed')
+    args = parser.parse_args()
+
+    try:
+        key = bytes.fromhex(args.key)
+    except ValueError:
+        sys.exit('key: not hex')
+
+    message = ' '.join([str(args.room), str(args.version), args.op] + args.uids)
+    mac = hmac.new(key, message.encode('ascii'), hashlib.sha256).hexdigest()
+    print('%s %s' % (message, mac))
+
+
+if __name__ == '__main__':
+    main()